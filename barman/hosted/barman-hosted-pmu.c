@@ -0,0 +1,89 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/**
+ * @file
+ * @brief   A fake PMU driver for the hosted build (`BM_CONFIG_USER_SUPPLIED_PMU_DRIVER`)
+ * @details Counter `n` of each simulated core increments at `1 / (n + 1)` of the rate of the hosted clock while the
+ *          core's PMU is started, so the values are monotonic and plausible without any access to hardware.
+ */
+
+#include "barman-hosted-stubs.h"
+
+#if BM_CONFIG_USER_SUPPLIED_PMU_DRIVER
+
+/** Per simulated core PMU state */
+struct barman_hosted_pmu
+{
+    /** The number of enabled counters */
+    bm_uint32 num_counters;
+    /** BM_TRUE whilst counting */
+    bm_bool started;
+    /** The timestamp at which counting last started */
+    bm_uint64 start_timestamp;
+    /** The accumulated count at the last stop */
+    bm_uint64 accumulated;
+};
+
+/** PMU state, only accessed by the thread bound to the core */
+static struct barman_hosted_pmu barman_hosted_pmus[BM_CONFIG_MAX_CORES];
+
+/**
+ * @brief   Get the PMU state for the calling thread's simulated core
+ * @return  The PMU state
+ */
+static struct barman_hosted_pmu * barman_hosted_current_pmu(void)
+{
+    return &barman_hosted_pmus[barman_hosted_get_current_core() % BM_CONFIG_MAX_CORES];
+}
+
+bm_uint32 barman_ext_init(bm_uint32 n_event_types, const bm_uint32 * event_types)
+{
+    struct barman_hosted_pmu * const pmu = barman_hosted_current_pmu();
+
+    (void) event_types;
+
+    pmu->num_counters = BM_MIN(n_event_types, BM_MAX_PMU_COUNTERS);
+    pmu->started = BM_FALSE;
+    pmu->accumulated = 0;
+
+    return pmu->num_counters;
+}
+
+void barman_ext_start(void)
+{
+    struct barman_hosted_pmu * const pmu = barman_hosted_current_pmu();
+
+    if (!pmu->started) {
+        pmu->start_timestamp = barman_hosted_now_ns();
+        pmu->started = BM_TRUE;
+    }
+}
+
+void barman_ext_stop(void)
+{
+    struct barman_hosted_pmu * const pmu = barman_hosted_current_pmu();
+
+    if (pmu->started) {
+        pmu->accumulated += barman_hosted_now_ns() - pmu->start_timestamp;
+        pmu->started = BM_FALSE;
+    }
+}
+
+bm_uint64 barman_ext_read_counter(bm_uint32 counter_no)
+{
+    const struct barman_hosted_pmu * const pmu = barman_hosted_current_pmu();
+    bm_uint64 elapsed = pmu->accumulated;
+
+    if (counter_no >= pmu->num_counters) {
+        return BM_PMU_INVALID_COUNTER_VALUE;
+    }
+
+    if (pmu->started) {
+        elapsed += barman_hosted_now_ns() - pmu->start_timestamp;
+    }
+
+    return elapsed / (counter_no + 1);
+}
+
+#endif
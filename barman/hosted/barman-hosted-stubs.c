@@ -0,0 +1,236 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/** @file */
+
+#include "barman-hosted-stubs.h"
+#include "barman-api.h"
+#include "barman-atomics.h"
+#include "data-store/barman-data-store.h"
+
+#include <string.h>
+#include <time.h>
+
+/** The offset of `header_length` within the protocol header; part of the fixed-offset section read by Streamline */
+#define BM_HOSTED_HEADER_LENGTH_OFFSET  12
+
+/** The simulated core the calling thread is bound to */
+static __thread bm_uint32 barman_hosted_current_core = 0;
+/** The task id of the calling thread */
+static __thread bm_task_id_t barman_hosted_current_task_id = 0;
+
+bm_uint64 barman_hosted_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (((bm_uint64) ts.tv_sec) * 1000000000ull) + ((bm_uint64) ts.tv_nsec);
+}
+
+void barman_hosted_get_clock_info(struct bm_protocol_clock_info * clock_info)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    clock_info->timestamp_base = barman_hosted_now_ns();
+    clock_info->timestamp_multiplier = 1;
+    clock_info->timestamp_divisor = 1;
+    clock_info->unix_base_ns = (((bm_uint64) ts.tv_sec) * 1000000000ull) + ((bm_uint64) ts.tv_nsec);
+}
+
+bm_uint64 barman_ext_get_timestamp(void)
+{
+    return barman_hosted_now_ns();
+}
+
+void barman_hosted_set_current_core(bm_uint32 core, bm_task_id_t task_id)
+{
+    barman_hosted_current_core = core;
+    barman_hosted_current_task_id = task_id;
+}
+
+bm_uint32 barman_hosted_get_current_core(void)
+{
+    return barman_hosted_current_core;
+}
+
+bm_uint32 barman_ext_midr(void)
+{
+    return BARMAN_HOSTED_MIDR;
+}
+
+bm_uintptr barman_ext_mpidr(void)
+{
+    return barman_hosted_current_core;
+}
+
+bm_uint32 barman_ext_map_multiprocessor_affinity_to_core_no(bm_uintptr mpidr)
+{
+    return (bm_uint32) (mpidr & 0xff);
+}
+
+bm_uint32 barman_ext_map_multiprocessor_affinity_to_cluster_no(bm_uintptr mpidr)
+{
+    return (bm_uint32) ((mpidr >> 8) & 0xff);
+}
+
+#if BM_CONFIG_MAX_TASK_INFOS > 0
+bm_task_id_t barman_ext_get_current_task_id(void)
+{
+    return barman_hosted_current_task_id;
+}
+#endif
+
+bm_bool barman_generated_initialize(void)
+{
+    /* CPU_CYCLES, INST_RETIRED, L1D_CACHE_REFILL, L1D_CACHE */
+    static const bm_uint32 event_types[] = { 0x11, 0x08, 0x03, 0x04 };
+
+    return barman_initialize_pmu_family(BARMAN_HOSTED_MIDR, sizeof(event_types) / sizeof(event_types[0]), event_types, BM_NULL);
+}
+
+bm_bool barman_hosted_initialize(bm_uint8 * buffer, bm_uintptr buffer_length)
+{
+    struct bm_protocol_clock_info clock_info;
+#if BM_CONFIG_MAX_TASK_INFOS > 0
+    struct bm_protocol_task_info task_info;
+
+    task_info.task_id = 0;
+    task_info.task_name = "hosted";
+#endif
+
+    barman_hosted_get_clock_info(&clock_info);
+
+#if BM_DATASTORE_IS_IN_MEMORY
+    return barman_initialize(buffer, buffer_length, "hosted", &clock_info,
+#else
+    (void) buffer_length;
+    return barman_initialize_with_user_supplied(buffer, "hosted", &clock_info,
+#endif
+#if BM_CONFIG_MAX_TASK_INFOS > 0
+                             1, &task_info,
+#endif
+#if BM_CONFIG_MAX_MMAP_LAYOUTS > 0
+                             0, BM_NULL,
+#endif
+                             0);
+}
+
+#if BM_CONFIG_USE_DATASTORE == BM_CONFIG_USE_DATASTORE_STREAMING_USER_SUPPLIED
+
+/** The frame callback */
+static barman_hosted_frame_callback barman_hosted_frame_callback_ptr = BM_NULL;
+/** Number of data frames written */
+static bm_atomic_uint64 barman_hosted_streaming_frames = 0;
+/** Number of bytes written */
+static bm_atomic_uint64 barman_hosted_streaming_bytes = 0;
+
+void barman_hosted_set_frame_callback(barman_hosted_frame_callback callback)
+{
+    barman_hosted_frame_callback_ptr = callback;
+}
+
+void barman_hosted_get_streaming_totals(bm_uint64 * frames, bm_uint64 * bytes)
+{
+    *frames = barman_atomic_load(&barman_hosted_streaming_frames);
+    *bytes = barman_atomic_load(&barman_hosted_streaming_bytes);
+}
+
+bm_bool barman_ext_streaming_backend_init(void * config)
+{
+    (void) config;
+
+    barman_atomic_store(&barman_hosted_streaming_frames, 0);
+    barman_atomic_store(&barman_hosted_streaming_bytes, 0);
+
+    return BM_TRUE;
+}
+
+void barman_ext_streaming_backend_write_frame(const bm_uint8 * data, bm_uintptr length, bm_uint16 channel, bm_bool flush)
+{
+    const barman_hosted_frame_callback callback = barman_hosted_frame_callback_ptr;
+
+    if (!flush) {
+        barman_atomic_fetch_add(&barman_hosted_streaming_frames, 1);
+    }
+    barman_atomic_fetch_add(&barman_hosted_streaming_bytes, length);
+
+    if (callback != BM_NULL) {
+        callback(data, length, channel, flush);
+    }
+}
+
+void barman_ext_streaming_backend_close(void)
+{
+}
+
+bm_uint32 barman_ext_streaming_backend_get_bank(void)
+{
+    return barman_hosted_current_core % BM_CONFIG_STREAMING_DATASTORE_USER_SUPPLIED_NUMBER_OF_BANKS;
+}
+
+#endif
+
+#if BM_DATASTORE_IS_IN_MEMORY
+
+/**
+ * @brief   Copy the datastore parameters out of the protocol header at the start of an in-memory buffer
+ * @param   buffer      The buffer
+ * @param   header_data [OUT] The datastore parameters
+ */
+static void barman_hosted_read_header_data(const bm_uint8 * buffer, struct bm_datastore_header_data * header_data)
+{
+    bm_uint32 header_length;
+
+    /* the datastore parameters are the last member of the protocol header */
+    memcpy(&header_length, buffer + BM_HOSTED_HEADER_LENGTH_OFFSET, sizeof(header_length));
+    memcpy(header_data, buffer + header_length - sizeof(*header_data), sizeof(*header_data));
+}
+
+bm_uint64 barman_hosted_get_total_written(const bm_uint8 * buffer)
+{
+    struct bm_datastore_header_data header_data;
+
+    barman_hosted_read_header_data(buffer, &header_data);
+
+    return header_data.total_written;
+}
+
+bm_bool barman_hosted_walk_in_memory_buffer(const bm_uint8 * buffer, barman_hosted_record_callback callback, void * arg)
+{
+    struct bm_datastore_header_data header_data;
+    bm_uint64 offset;
+
+    barman_hosted_read_header_data(buffer, &header_data);
+
+    for (offset = header_data.read_offset; offset < header_data.write_offset;) {
+        const bm_uint64 real_offset = offset % header_data.buffer_length;
+        bm_datastore_block_length length_value;
+        bm_datastore_block_length length;
+
+        /* a wrap-around alignment gap too small to hold a padding block is zero filled */
+        if ((header_data.buffer_length - real_offset) < sizeof(length_value)) {
+            offset += header_data.buffer_length - real_offset;
+            continue;
+        }
+
+        memcpy(&length_value, header_data.base_pointer + real_offset, sizeof(length_value));
+        length = BM_DATASTORE_GET_LENGTH_VALUE(length_value);
+
+        if ((length == 0) || ((length % sizeof(length_value)) != 0) || ((real_offset + sizeof(length_value) + length) > header_data.buffer_length)) {
+            return BM_FALSE;
+        }
+
+        if (!BM_DATASTORE_IS_PADDING_BLOCK(length_value)) {
+            callback(header_data.base_pointer + real_offset + sizeof(length_value), length, arg);
+        }
+
+        offset += sizeof(length_value) + length;
+    }
+
+    return (offset == header_data.write_offset);
+}
+
+#endif
@@ -0,0 +1,117 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/** @file */
+
+#ifndef INCLUDE_BARMAN_HOSTED_STUBS
+#define INCLUDE_BARMAN_HOSTED_STUBS
+
+#include "barman-config.h"
+#include "barman-protocol-api.h"
+#include "barman-types.h"
+#include "data-store/barman-data-store-types.h"
+
+/**
+ * @defgroup    bm_hosted   Hosted (Linux user space) stub backends
+ * @brief       Implementations of the barman external dependencies that allow barman to be linked into
+ *              a normal Linux process so that it can be benchmarked and tested on a development host.
+ * @{ */
+
+/**
+ * @brief   Read CLOCK_MONOTONIC in nanoseconds
+ * @return  The current time
+ */
+bm_uint64 barman_hosted_now_ns(void);
+
+/**
+ * @brief   Fill in a clock info structure that matches {@link barman_ext_get_timestamp}
+ * @param   clock_info  The object to fill
+ */
+void barman_hosted_get_clock_info(struct bm_protocol_clock_info * clock_info);
+
+/**
+ * @def     BARMAN_HOSTED_MIDR
+ * @brief   The MIDR value reported by the fake PMU for every simulated core (Cortex-A76 r0p0)
+ */
+#define BARMAN_HOSTED_MIDR      0x410fd0b0
+
+/**
+ * @brief   Bind the calling thread to a simulated core
+ * @details The MPIDR returned to barman for the thread encodes `core` in Aff0 so that `barman_get_core_no` returns it.
+ *          Each simulated core must be driven by at most one thread at a time, as is the case for a real core.
+ * @param   core    The core number, less than `BM_CONFIG_MAX_CORES`
+ * @param   task_id The task id reported for the thread by {@link barman_ext_get_current_task_id}
+ */
+void barman_hosted_set_current_core(bm_uint32 core, bm_task_id_t task_id);
+
+/**
+ * @brief   Get the simulated core the calling thread is bound to
+ * @return  The core number
+ */
+bm_uint32 barman_hosted_get_current_core(void);
+
+/**
+ * @brief   Initialize barman for the configured datastore using the hosted clock and a single task entry
+ * @param   buffer          The in-memory buffer; ignored by the streaming datastore
+ * @param   buffer_length   The length of `buffer`
+ * @return  BM_TRUE on success
+ */
+bm_bool barman_hosted_initialize(bm_uint8 * buffer, bm_uintptr buffer_length);
+
+#if BM_CONFIG_USE_DATASTORE == BM_CONFIG_USE_DATASTORE_STREAMING_USER_SUPPLIED
+
+/**
+ * @brief   Callback invoked for each frame written to the hosted streaming backend
+ * @param   data    The frame contents
+ * @param   length  The length of the frame
+ * @param   channel The channel the frame was written on
+ * @param   flush   BM_TRUE for header frames
+ */
+typedef void (*barman_hosted_frame_callback)(const bm_uint8 * data, bm_uintptr length, bm_uint16 channel, bm_bool flush);
+
+/**
+ * @brief   Set the callback that receives each frame written to the hosted streaming backend
+ * @param   callback    The callback, or BM_NULL to discard frames
+ */
+void barman_hosted_set_frame_callback(barman_hosted_frame_callback callback);
+
+/**
+ * @brief   Read the number of frames / bytes written to the hosted streaming backend since it was initialized
+ * @param   frames  [OUT] The number of data (non-header) frames
+ * @param   bytes   [OUT] The total number of bytes of all frames
+ */
+void barman_hosted_get_streaming_totals(bm_uint64 * frames, bm_uint64 * bytes);
+
+#endif
+
+#if BM_DATASTORE_IS_IN_MEMORY
+
+/**
+ * @brief   Callback invoked for each committed record by {@link barman_hosted_walk_in_memory_buffer}
+ * @param   data    The record
+ * @param   length  The length of the block containing the record
+ * @param   arg     The user argument
+ */
+typedef void (*barman_hosted_record_callback)(const bm_uint8 * data, bm_uintptr length, void * arg);
+
+/**
+ * @brief   Walk the blocks between the read and write offsets of an in-memory datastore, as Streamline does on import
+ * @param   buffer      The buffer that was passed to {@link barman_hosted_initialize}
+ * @param   callback    Called for each non padding block
+ * @param   arg         Passed to `callback`
+ * @return  BM_TRUE if the block chain was consistent, BM_FALSE if a block length was invalid
+ */
+bm_bool barman_hosted_walk_in_memory_buffer(const bm_uint8 * buffer, barman_hosted_record_callback callback, void * arg);
+
+/**
+ * @brief   Read the total number of bytes committed to an in-memory datastore
+ * @param   buffer  The buffer that was passed to {@link barman_hosted_initialize}
+ * @return  The `total_written` value from the datastore parameters
+ */
+bm_uint64 barman_hosted_get_total_written(const bm_uint8 * buffer);
+
+#endif
+
+/** @} */
+
+#endif /* INCLUDE_BARMAN_HOSTED_STUBS */
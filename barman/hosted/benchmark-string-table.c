@@ -0,0 +1,64 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/**
+ * @file
+ * @brief   Measures the cost of adding task records (and so inserting task names into the string table) to the protocol header.
+ * @details Simulates an RTOS with many tasks that share a smaller set of task names. Build with BM_CONFIG_STRING_TABLE_INDEX_SIZE=0 to
+ *          compare against the linear search. The default of 200 distinct names is about as many as fit in the string table; the
+ *          number may be given as the second argument to see the effect of a smaller set.
+ */
+
+#include "barman-hosted-stubs.h"
+#include "barman-protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_DISTINCT_NAMES  200
+#define NAME_LENGTH         5
+
+static bm_uint8 buffer[1024 * 1024];
+
+int main(int argc, char ** argv)
+{
+    static char names[MAX_DISTINCT_NAMES][NAME_LENGTH];
+    const bm_datastore_config datastore_config = { buffer, sizeof(buffer) };
+    const unsigned num_records = (argc > 1 ? (unsigned) strtoul(argv[1], NULL, 0) : BM_CONFIG_MAX_TASK_INFOS);
+    const unsigned num_names = (argc > 2 ? (unsigned) strtoul(argv[2], NULL, 0) : MAX_DISTINCT_NAMES);
+    struct bm_protocol_clock_info clock_info;
+    bm_uint64 start, end;
+    unsigned index;
+
+    barman_hosted_get_clock_info(&clock_info);
+
+    if (!barman_protocol_initialize(datastore_config, "hosted", &clock_info, 0, BM_NULL, 0, BM_NULL, 0)) {
+        fprintf(stderr, "barman_protocol_initialize failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if ((num_names == 0) || (num_names > MAX_DISTINCT_NAMES)) {
+        fprintf(stderr, "the number of distinct names must be between 1 and %u\n", MAX_DISTINCT_NAMES);
+        return EXIT_FAILURE;
+    }
+
+    for (index = 0; index < num_names; ++index) {
+        snprintf(names[index], sizeof(names[index]), "t%03u", index);
+    }
+
+    start = barman_hosted_now_ns();
+    for (index = 0; index < num_records; ++index) {
+        const struct bm_protocol_task_info task_info = { index, names[index % num_names] };
+
+        if (!barman_add_task_record(barman_ext_get_timestamp(), &task_info)) {
+            fprintf(stderr, "barman_add_task_record failed at record %u\n", index);
+            return EXIT_FAILURE;
+        }
+    }
+    end = barman_hosted_now_ns();
+
+    printf("string-table (index size %u): %u task records with %u names in %llu ns; %.1f ns/record\n", (unsigned) BM_CONFIG_STRING_TABLE_INDEX_SIZE,
+           num_records, num_names, (unsigned long long) (end - start), num_records > 0 ? ((double) (end - start)) / num_records : 0.0);
+
+    return EXIT_SUCCESS;
+}
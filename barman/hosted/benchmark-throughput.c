@@ -0,0 +1,103 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/**
+ * @file
+ * @brief   Measures sampling throughput through the public barman API into the configured datastore, with one writer
+ *          thread per simulated core.
+ * @details Usage: `<benchmark> [threads] [samples per thread] [buffer length]`. The buffer length is ignored by the
+ *          streaming datastore.
+ */
+
+#include "barman-api.h"
+#include "barman-hosted-stubs.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if BM_CONFIG_USE_DATASTORE == BM_CONFIG_USE_DATASTORE_LINEAR_RAM_BUFFER
+#define DATASTORE_NAME  "linear-ram-buffer"
+#elif BM_CONFIG_USE_DATASTORE == BM_CONFIG_USE_DATASTORE_CIRCULAR_RAM_BUFFER
+#define DATASTORE_NAME  "circular-ram-buffer"
+#elif BM_CONFIG_USE_DATASTORE == BM_CONFIG_USE_DATASTORE_STREAMING_USER_SUPPLIED
+#define DATASTORE_NAME  "streaming"
+#else
+#define DATASTORE_NAME  "user-supplied"
+#endif
+
+/** Per-writer state */
+struct writer
+{
+    pthread_t thread;
+    bm_uint32 core;
+    unsigned num_samples;
+};
+
+static void * writer_main(void * arg)
+{
+    const struct writer * const writer = (const struct writer *) arg;
+    unsigned sample;
+
+    barman_hosted_set_current_core(writer->core, writer->core + 1);
+
+    for (sample = 0; sample < writer->num_samples; ++sample) {
+        barman_sample_counters_with_program_counter((const void *) writer_main);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+    static struct writer writers[BM_CONFIG_MAX_CORES];
+    const unsigned num_threads = BM_MIN((argc > 1 ? (unsigned) strtoul(argv[1], NULL, 0) : BM_CONFIG_MAX_CORES), BM_CONFIG_MAX_CORES);
+    const unsigned num_samples = (argc > 2 ? (unsigned) strtoul(argv[2], NULL, 0) : 1000000);
+    const bm_uintptr buffer_length = (argc > 3 ? (bm_uintptr) strtoul(argv[3], NULL, 0) : 64 * 1024 * 1024);
+    bm_uint8 * const buffer = (bm_uint8 *) malloc(buffer_length);
+    bm_uint64 start, end, bytes_written;
+    unsigned index;
+
+    if (buffer == NULL) {
+        fprintf(stderr, "could not allocate %lu bytes\n", (unsigned long) buffer_length);
+        return EXIT_FAILURE;
+    }
+
+    if (!barman_hosted_initialize(buffer, buffer_length)) {
+        fprintf(stderr, "barman_hosted_initialize failed\n");
+        return EXIT_FAILURE;
+    }
+
+    barman_enable_sampling();
+
+    start = barman_hosted_now_ns();
+    for (index = 0; index < num_threads; ++index) {
+        writers[index].core = index;
+        writers[index].num_samples = num_samples;
+        if (pthread_create(&writers[index].thread, NULL, writer_main, &writers[index]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    for (index = 0; index < num_threads; ++index) {
+        pthread_join(writers[index].thread, NULL);
+    }
+    end = barman_hosted_now_ns();
+
+#if BM_DATASTORE_IS_IN_MEMORY
+    bytes_written = barman_hosted_get_total_written(buffer);
+#else
+    {
+        bm_uint64 frames;
+        barman_hosted_get_streaming_totals(&frames, &bytes_written);
+    }
+#endif
+
+    printf("%s: %u writers x %u samples in %llu ns; %.1f ns/sample; %.1f MiB/s written\n", DATASTORE_NAME, num_threads, num_samples,
+           (unsigned long long) (end - start), ((double) (end - start)) / ((double) num_threads * num_samples),
+           (((double) bytes_written) / (1024.0 * 1024.0)) / (((double) (end - start)) / 1e9));
+
+    free(buffer);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/**
+ * @file
+ * @brief   Multi-producer stress test for the configured datastore.
+ * @details One writer thread per simulated core samples the fake PMU and records task switches through the public barman
+ *          API. Afterwards the written records are decoded (by walking the in-memory buffer, or as frames arrive from the
+ *          streaming backend) and checked for a consistent block chain, valid record headers, per core monotonic timestamps,
+ *          and, where the datastore cannot drop data, exactly the expected number of records per core.
+ */
+
+#include "barman-api.h"
+#include "barman-hosted-stubs.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Record a task switch every this many samples */
+#define TASK_SWITCH_INTERVAL    16
+
+/* Mirrors the packed record header written by barman-protocol.c */
+#define RECORD_TYPE_SAMPLE_WITH_PC  2
+#define RECORD_TYPE_TASK_SWITCH     3
+#define RECORD_TYPE_MAX             9
+#define RECORD_HEADER_LENGTH        16
+
+/** Per-writer state */
+struct writer
+{
+    pthread_t thread;
+    bm_uint32 core;
+    unsigned num_samples;
+};
+
+/** Per core decode state */
+struct core_totals
+{
+    bm_uint64 last_timestamp;
+    unsigned num_samples;
+    unsigned num_task_switches;
+};
+
+static struct core_totals totals[BM_CONFIG_MAX_CORES];
+static unsigned num_errors = 0;
+
+static void * writer_main(void * arg)
+{
+    const struct writer * const writer = (const struct writer *) arg;
+    unsigned sample;
+
+    barman_hosted_set_current_core(writer->core, writer->core + 1);
+
+    for (sample = 0; sample < writer->num_samples; ++sample) {
+        barman_sample_counters_with_program_counter((const void *) (bm_uintptr) (sample + 1));
+
+        if ((sample % TASK_SWITCH_INTERVAL) == 0) {
+            barman_record_task_switch(BM_TASK_SWITCH_REASON_PREEMPTED);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief   Validate a single record and add it to the totals for its core
+ * @param   data    The record
+ * @param   length  The record length (possibly including alignment)
+ */
+static void check_record(const bm_uint8 * data, bm_uintptr length)
+{
+    bm_uint32 record_type, core;
+    bm_uint64 timestamp;
+
+    if (length < RECORD_HEADER_LENGTH) {
+        fprintf(stderr, "record too short (%lu bytes)\n", (unsigned long) length);
+        __atomic_fetch_add(&num_errors, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    memcpy(&record_type, data, sizeof(record_type));
+    memcpy(&core, data + 4, sizeof(core));
+    memcpy(&timestamp, data + 8, sizeof(timestamp));
+
+    if ((record_type == 0) || (record_type > RECORD_TYPE_MAX) || (core >= BM_CONFIG_MAX_CORES)) {
+        fprintf(stderr, "invalid record header (type %u, core %u)\n", record_type, core);
+        __atomic_fetch_add(&num_errors, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    /* each core is driven by one thread so its records are written in order */
+    if (timestamp < totals[core].last_timestamp) {
+        fprintf(stderr, "timestamp went backwards on core %u\n", core);
+        __atomic_fetch_add(&num_errors, 1, __ATOMIC_RELAXED);
+    }
+    totals[core].last_timestamp = timestamp;
+
+    if (record_type == RECORD_TYPE_SAMPLE_WITH_PC) {
+        totals[core].num_samples += 1;
+    }
+    else if (record_type == RECORD_TYPE_TASK_SWITCH) {
+        totals[core].num_task_switches += 1;
+    }
+}
+
+#if BM_DATASTORE_IS_IN_MEMORY
+
+static void on_record(const bm_uint8 * data, bm_uintptr length, void * arg)
+{
+    (void) arg;
+
+    check_record(data, length);
+}
+
+#else
+
+static void on_frame(const bm_uint8 * data, bm_uintptr length, bm_uint16 channel, bm_bool flush)
+{
+    (void) channel;
+
+    if (!flush) {
+        check_record(data, length);
+    }
+}
+
+#endif
+
+int main(int argc, char ** argv)
+{
+    static struct writer writers[BM_CONFIG_MAX_CORES];
+    const unsigned num_threads = BM_MIN((argc > 1 ? (unsigned) strtoul(argv[1], NULL, 0) : BM_CONFIG_MAX_CORES), BM_CONFIG_MAX_CORES);
+    const unsigned num_samples = (argc > 2 ? (unsigned) strtoul(argv[2], NULL, 0) : 20000);
+    const unsigned num_task_switches = (num_samples + TASK_SWITCH_INTERVAL - 1) / TASK_SWITCH_INTERVAL;
+#if BM_CONFIG_USE_DATASTORE == BM_CONFIG_USE_DATASTORE_CIRCULAR_RAM_BUFFER
+    /* small enough to wrap many times */
+    const bm_uintptr buffer_length = 256 * 1024;
+    const bm_bool expect_all_records = BM_FALSE;
+#else
+    /* large enough to hold every record */
+    const bm_uintptr buffer_length = (1024 * 1024) + ((bm_uintptr) num_threads * (num_samples + num_task_switches) * 128);
+    const bm_bool expect_all_records = BM_TRUE;
+#endif
+    bm_uint8 * const buffer = (bm_uint8 *) malloc(buffer_length);
+    unsigned index;
+
+    if (buffer == NULL) {
+        fprintf(stderr, "could not allocate %lu bytes\n", (unsigned long) buffer_length);
+        return EXIT_FAILURE;
+    }
+
+#if !BM_DATASTORE_IS_IN_MEMORY
+    barman_hosted_set_frame_callback(on_frame);
+#endif
+
+    if (!barman_hosted_initialize(buffer, buffer_length)) {
+        fprintf(stderr, "barman_hosted_initialize failed\n");
+        return EXIT_FAILURE;
+    }
+
+    barman_enable_sampling();
+
+    for (index = 0; index < num_threads; ++index) {
+        writers[index].core = index;
+        writers[index].num_samples = num_samples;
+        if (pthread_create(&writers[index].thread, NULL, writer_main, &writers[index]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    for (index = 0; index < num_threads; ++index) {
+        pthread_join(writers[index].thread, NULL);
+    }
+
+    barman_disable_sampling();
+
+#if BM_DATASTORE_IS_IN_MEMORY
+    if (!barman_hosted_walk_in_memory_buffer(buffer, on_record, NULL)) {
+        fprintf(stderr, "block chain is inconsistent\n");
+        num_errors += 1;
+    }
+#endif
+
+    for (index = 0; index < num_threads; ++index) {
+        printf("core %u: %u samples, %u task switches\n", index, totals[index].num_samples, totals[index].num_task_switches);
+
+        if ((totals[index].num_samples > num_samples) || (totals[index].num_task_switches > num_task_switches)) {
+            fprintf(stderr, "core %u has more records than were written\n", index);
+            num_errors += 1;
+        }
+        else if (expect_all_records && ((totals[index].num_samples != num_samples) || (totals[index].num_task_switches != num_task_switches))) {
+            fprintf(stderr, "core %u is missing records (expected %u samples, %u task switches)\n", index, num_samples, num_task_switches);
+            num_errors += 1;
+        }
+    }
+
+    free(buffer);
+
+    if (num_errors != 0) {
+        fprintf(stderr, "%u errors\n", num_errors);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
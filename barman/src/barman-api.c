@@ -20,11 +20,6 @@
 #error "BM_CONFIG_MIN_SAMPLE_PERIOD is not supported on M profile"
 #endif
 
-#if BM_CONFIG_USER_SUPPLIED_PMU_DRIVER
-extern bm_uint32 barman_ext_midr(void);
-extern bm_uintptr barman_ext_mpidr(void);
-#endif
-
 /**
  * @defgroup    bm_public_internals Public function internals
  * @{ */
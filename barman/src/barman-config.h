@@ -121,6 +121,21 @@
 #define BM_CONFIG_MAX_TASK_INFOS                    1
 #endif
 
+/**
+ * @def     BM_CONFIG_STRING_TABLE_INDEX_SIZE
+ * @brief   The number of slots in the hash index used to find strings already present in the string table.
+ * @details Must be zero or a power of two. The index is held outside of the data header so does not change the data
+ *          layout that is read by Streamline. When zero, or once the index is full, the string table is searched linearly
+ *          on each insert (as are task names, image names and custom chart strings).
+ *          The index costs 2 bytes of RAM per slot, so is off by default, which suits the few distinct names of most
+ *          applications. For an RTOS with many tasks, use 1024: twice as many slots as the 1024 byte string table can hold
+ *          strings (each takes at least two bytes), so the index never fills and is never more than half full, however
+ *          many tasks share the table.
+ */
+#ifndef BM_CONFIG_STRING_TABLE_INDEX_SIZE
+#define BM_CONFIG_STRING_TABLE_INDEX_SIZE           0
+#endif
+
 /**
  * @def     BM_CONFIG_MIN_SAMPLE_PERIOD
  * @brief   The minimum period between samples in ns. Any samples more frequent will be ignored.
@@ -503,8 +503,129 @@ static BM_INLINE void barman_protocol_init_record_header(struct bm_protocol_reco
     header->timestamp = timestamp;
 }
 
+#if BM_CONFIG_STRING_TABLE_INDEX_SIZE > 0
+
+#if (BM_CONFIG_STRING_TABLE_INDEX_SIZE & (BM_CONFIG_STRING_TABLE_INDEX_SIZE - 1)) != 0
+#error "BM_CONFIG_STRING_TABLE_INDEX_SIZE must be a power of two"
+#endif
+
+#if BM_PROTOCOL_STRING_TABLE_LENGTH >= 0xffff
+#error "The string table index stores offsets as bm_uint16"
+#endif
+
+/**
+ * @brief   Open addressed hash index over the string table.
+ * @details Each slot contains the offset of a string in the string table plus one, or zero if the slot is unused.
+ *          Slots are only ever written once, after the string they reference has been copied into the table.
+ */
+static bm_atomic_uint16 bm_protocol_string_table_index[BM_CONFIG_STRING_TABLE_INDEX_SIZE];
+
+/** Set once an insert into the index fails because all slots are used; the index is no longer authoritative after that */
+static bm_atomic_bool bm_protocol_string_table_index_full = BM_ATOMIC_VAR_INIT(BM_FALSE);
+
+/** Value returned by {@link barman_protocol_string_table_index_find} when the string is not indexed */
+#define BM_PROTOCOL_STRING_NOT_INDEXED  (~BM_UINT32(0))
+
+/**
+ * @brief   Calculate the (FNV-1a) hash of the first `length` characters of a string
+ * @param   string
+ * @param   length
+ * @return  The hash value
+ */
+BM_NONNULL((1))
+static BM_INLINE bm_uint32 barman_protocol_string_hash(const char * string, bm_uint32 length)
+{
+    bm_uint32 hash = 2166136261u;
+    bm_uint32 offset;
+
+    for (offset = 0; offset < length; ++offset) {
+        hash = (hash ^ (bm_uint8) string[offset]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief   Clear the string table index
+ */
+static BM_INLINE void barman_protocol_string_table_index_clear(void)
+{
+    barman_memset(bm_protocol_string_table_index, 0, sizeof(bm_protocol_string_table_index));
+    barman_atomic_store(&bm_protocol_string_table_index_full, BM_FALSE);
+}
+
+/**
+ * @brief   Find a string in the string table using the index
+ * @param   string_table
+ * @param   hash            The hash of the string
+ * @param   string          The string to find
+ * @param   string_length   The number of characters of `string` to match
+ * @return  The offset of the string in the table, or BM_PROTOCOL_STRING_NOT_INDEXED if it is not in the index
+ */
+BM_NONNULL((1, 3))
+static bm_uint32 barman_protocol_string_table_index_find(const struct bm_protocol_header_string_table * string_table, bm_uint32 hash,
+                                                         const char * string, bm_uint32 string_length)
+{
+    bm_uint32 slot = hash & (BM_CONFIG_STRING_TABLE_INDEX_SIZE - 1);
+    bm_uint32 probe;
+
+    for (probe = 0; probe < BM_CONFIG_STRING_TABLE_INDEX_SIZE; ++probe) {
+        const bm_uint32 entry = barman_atomic_load(&bm_protocol_string_table_index[slot]);
+
+        /* an empty slot terminates the probe sequence */
+        if (entry == 0) {
+            break;
+        }
+        else if ((entry - 1) + string_length < BM_PROTOCOL_STRING_TABLE_LENGTH) {
+            const char * const candidate = &string_table->string_table[entry - 1];
+            bm_uint32 offset = 0;
+
+            while ((offset < string_length) && (candidate[offset] == string[offset])) {
+                offset += 1;
+            }
+
+            if ((offset == string_length) && (candidate[string_length] == 0)) {
+                return entry - 1;
+            }
+        }
+
+        slot = (slot + 1) & (BM_CONFIG_STRING_TABLE_INDEX_SIZE - 1);
+    }
+
+    return BM_PROTOCOL_STRING_NOT_INDEXED;
+}
+
+/**
+ * @brief   Add a string that was appended to the string table to the index
+ * @param   hash            The hash of the string
+ * @param   table_offset    The offset of the string in the string table
+ */
+static void barman_protocol_string_table_index_add(bm_uint32 hash, bm_uint32 table_offset)
+{
+    bm_uint32 slot = hash & (BM_CONFIG_STRING_TABLE_INDEX_SIZE - 1);
+    bm_uint32 probe;
+
+    for (probe = 0; probe < BM_CONFIG_STRING_TABLE_INDEX_SIZE; ++probe) {
+        bm_uint16 expected = 0;
+
+        if (barman_atomic_cmp_ex_strong_pointer(&bm_protocol_string_table_index[slot], &expected, (bm_uint16) (table_offset + 1))) {
+            return;
+        }
+
+        slot = (slot + 1) & (BM_CONFIG_STRING_TABLE_INDEX_SIZE - 1);
+    }
+
+    /* no free slots; from now on misses must fall back to searching the table */
+    barman_atomic_store(&bm_protocol_string_table_index_full, BM_TRUE);
+}
+
+#endif
+
 /**
  * @brief   Insert an item into the string table
+ * @details When {@link BM_CONFIG_STRING_TABLE_INDEX_SIZE} is non-zero, exact matches are found using the hash index and the
+ *          linear search of the table (which can also match a suffix of an existing string) is only performed once the index is
+ *          full or the string no longer fits in the table.
  * @param   string_table
  * @param   string
  * @param   max_length
@@ -516,6 +637,9 @@ static bm_uint32 barman_protocol_string_table_insert(struct bm_protocol_header_s
     bm_uint32 table_length = barman_atomic_load(&string_table->string_table_length);
     bm_uint32 table_offset, restart_offset, string_length = 0, longest_match;
     bm_bool table_full = BM_FALSE;
+#if BM_CONFIG_STRING_TABLE_INDEX_SIZE > 0
+    bm_uint32 hash;
+#endif
 
     /* null pointer becomes empty string */
     if (string == BM_NULL) {
@@ -533,10 +657,23 @@ static bm_uint32 barman_protocol_string_table_insert(struct bm_protocol_header_s
 
     /* use atomic RMW to update string_table_length length */
     do {
+        bm_bool search_table = BM_TRUE;
+
         longest_match = 0;
 
+#if BM_CONFIG_STRING_TABLE_INDEX_SIZE > 0
+        /* look the string up in the index; a miss is authoritative unless the index overflowed, or we may need to truncate */
+        hash = barman_protocol_string_hash(string, string_length);
+        table_offset = barman_protocol_string_table_index_find(string_table, hash, string, string_length);
+        if (table_offset != BM_PROTOCOL_STRING_NOT_INDEXED) {
+            return table_offset;
+        }
+
+        search_table = barman_atomic_load(&bm_protocol_string_table_index_full) || ((table_length + string_length + 1) > BM_PROTOCOL_STRING_TABLE_LENGTH);
+#endif
+
         /* search the table to find the string */
-        for (table_offset = 0; table_offset < table_length; table_offset = restart_offset) {
+        for (table_offset = 0; search_table && (table_offset < table_length); table_offset = restart_offset) {
             bm_uint32 string_offset;
             bm_bool failed = BM_FALSE;
 
@@ -604,6 +741,11 @@ static bm_uint32 barman_protocol_string_table_insert(struct bm_protocol_header_s
             }
             string_table->string_table[table_length + string_length] = 0;
 
+#if BM_CONFIG_STRING_TABLE_INDEX_SIZE > 0
+            /* publish it in the index only once the string is complete */
+            barman_protocol_string_table_index_add(hash, table_length);
+#endif
+
             if (table_full) {
                 BM_WARNING("String table full, truncating to %d characters: %s", string_length, string);
             }
@@ -853,6 +995,9 @@ bm_bool barman_protocol_initialize(bm_datastore_config datastore_config,
     header_ptr->clock_info.timestamp_multiplier = clock_info->timestamp_multiplier;
     header_ptr->clock_info.unix_base_ns = clock_info->unix_base_ns;
     header_ptr->string_table.string_table_length = 0;
+#if BM_CONFIG_STRING_TABLE_INDEX_SIZE > 0
+    barman_protocol_string_table_index_clear();
+#endif
     header_ptr->target_name_ptr = barman_protocol_string_table_insert(&header_ptr->string_table, target_name, 255);
 
 #if BM_CONFIG_MAX_TASK_INFOS > 0
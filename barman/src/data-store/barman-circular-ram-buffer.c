@@ -26,6 +26,10 @@
  *          `reserved_tail_offset[core]` to some marker value (`BM_NO_RESERVED_TAIL`) indicating that it is not reserving any space. The algorithm is free to
  *          overwrite the data in the buffer previously reserved by the block at this point.
  *
+ *          Each core's `reserved_tail_offset` lives in its own cache line so that cores reserving and committing blocks do not contend with each other.
+ *          Where `BM_CONFIG_MAX_CORES` allows, a bitmap of the cores that currently hold a reservation is also maintained, so that finding the lowest
+ *          reserved tail only visits the cores that are actually writing rather than scanning every core.
+ *
  * @note    `barman_circular_ram_buffer_get_block` is free to fail if it cannot find enough free space for a block. This will usually happen if
  *          `MIN(reserved_tail_offset[0] ... reserved_tail_offset[MAX_CORES - 1], tail_offset)` is such a value that it cannot free enough space. The rate of
  *          failure is therefore a function of the number of cores accessing the buffer concurrently, the rate at which the blocks are requested and then
@@ -47,30 +51,67 @@
 
 /* *********************************** */
 
+/**
+ * @def     BM_CIRCULAR_RAM_BUFFER_RESERVATION_ALIGNMENT
+ * @brief   The alignment of each core's reservation slot; the (maximum) data cache line size for A/R profile targets
+ *
+ * @def     BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK
+ * @brief   True when the set of reserving cores can be tracked in a single 32-bit bitmap
+ */
+#if BM_ARM_ARCH_PROFILE == 'M'
+#define BM_CIRCULAR_RAM_BUFFER_RESERVATION_ALIGNMENT    8
+#else
+#define BM_CIRCULAR_RAM_BUFFER_RESERVATION_ALIGNMENT    64
+#endif
+#define BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK            ((BM_CONFIG_MAX_CORES > 1) && (BM_CONFIG_MAX_CORES <= 32))
+
+/**
+ * @brief   Per-core reservation slot
+ * @ingroup bm_data_store_circular_ram_buffer
+ */
+struct barman_circular_ram_buffer_reservation
+{
+    /** Current commited write offset for the core */
+    bm_atomic_uint64 reserved_tail_offset;
+} BM_ALIGN(BM_CIRCULAR_RAM_BUFFER_RESERVATION_ALIGNMENT);
+
 /**
  * @brief   Defines the data
  * @ingroup bm_data_store_circular_ram_buffer
  */
 struct barman_circular_ram_buffer_configuration
 {
+    /** Reservation slot for each core */
+    struct barman_circular_ram_buffer_reservation reservations[BM_CONFIG_MAX_CORES];
     /** Header data */
     struct bm_datastore_header_data * header_data;
-    /** Current commited write offset for each core */
-    bm_atomic_uint64 reserved_tail_offset[BM_CONFIG_MAX_CORES];
     /** Buffer read offset */
     bm_atomic_uint64 head_offset;
     /** Buffer write offset */
     bm_atomic_uint64 tail_offset;
+#if BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK
+    /** Bitmap of the cores that currently hold a reservation */
+    bm_atomic_uint32 reserved_cores;
+#endif
     /** Closed flag */
     bm_atomic_bool closed;
 };
 
 /** The configuration settings */
-static struct barman_circular_ram_buffer_configuration barman_circular_ram_buffer_configuration = { BM_NULL, { 0 }, 0, 0, BM_TRUE };
+static struct barman_circular_ram_buffer_configuration barman_circular_ram_buffer_configuration = {
+    { { 0 } }, BM_NULL, 0, 0,
+#if BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK
+    0,
+#endif
+    BM_TRUE
+};
 
 /** Marker to indicate that no data is reserved */
 #define BM_NO_RESERVED_TAIL     (~0ul)
 
+/** Access the reserved tail offset for a core */
+#define BM_RESERVED_TAIL_OFFSET(core)   (barman_circular_ram_buffer_configuration.reservations[(core)].reserved_tail_offset)
+
 /* *********************************** */
 
 /**
@@ -93,10 +134,17 @@ static BM_INLINE bm_datastore_header_length barman_circular_ram_buffer_get_reser
 {
     bm_uint32 core;
     bm_atomic_uint64 result = tail_offset;
+#if BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK
+    bm_uint32 reserved_cores = barman_atomic_load(&barman_circular_ram_buffer_configuration.reserved_cores);
 
+    /* only visit the cores that have a reservation */
+    for (core = 0; reserved_cores != 0; ++core, reserved_cores >>= 1) {
+        if (((reserved_cores & 1) != 0) && (core != excluding_core)) {
+#else
     for (core = 0; core < BM_CONFIG_MAX_CORES; ++core) {
         if (core != excluding_core) {
-            const bm_atomic_uint64 offset = barman_atomic_load(&(barman_circular_ram_buffer_configuration.reserved_tail_offset[core]));
+#endif
+            const bm_atomic_uint64 offset = barman_atomic_load(&BM_RESERVED_TAIL_OFFSET(core));
 
             if (offset != BM_NO_RESERVED_TAIL) {
                 result = BM_MIN(result, offset);
@@ -107,6 +155,38 @@ static BM_INLINE bm_datastore_header_length barman_circular_ram_buffer_get_reser
     return result;
 }
 
+/**
+ * @brief   Claim the reservation slot for a core, marking `tail_offset` as reserved
+ * @param   core            The core
+ * @param   tail_offset     The current tail offset
+ * @return  BM_TRUE if the slot was claimed, BM_FALSE if the core already holds an uncommited block
+ */
+static BM_INLINE bm_bool barman_circular_ram_buffer_claim_reservation(bm_uint32 core, bm_atomic_uint64 tail_offset)
+{
+    if (!barman_atomic_cmp_ex_strong_value(&BM_RESERVED_TAIL_OFFSET(core), BM_NO_RESERVED_TAIL, tail_offset)) {
+        return BM_FALSE;
+    }
+
+#if BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK
+    barman_atomic_fetch_or(&barman_circular_ram_buffer_configuration.reserved_cores, (BM_UINT32(1) << core));
+#endif
+
+    return BM_TRUE;
+}
+
+/**
+ * @brief   Release the reservation slot for a core
+ * @param   core    The core
+ */
+static BM_INLINE void barman_circular_ram_buffer_release_reservation(bm_uint32 core)
+{
+    barman_atomic_store(&BM_RESERVED_TAIL_OFFSET(core), BM_NO_RESERVED_TAIL);
+
+#if BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK
+    barman_atomic_fetch_and(&barman_circular_ram_buffer_configuration.reserved_cores, ~(BM_UINT32(1) << core));
+#endif
+}
+
 /**
  * @brief   Free a single previously allocated block
  * @param   base_pointer    The base address of the buffer
@@ -231,7 +311,7 @@ static void barman_circular_ram_buffer_write_commit(bm_uint32 core, bm_uint8 * b
     barman_cache_clean(barman_circular_ram_buffer_configuration.header_data, sizeof(*barman_circular_ram_buffer_configuration.header_data));
 
     /* Clear the commit offset */
-    barman_atomic_store(&(barman_circular_ram_buffer_configuration.reserved_tail_offset[core]), BM_NO_RESERVED_TAIL);
+    barman_circular_ram_buffer_release_reservation(core);
 }
 
 /* *********************************** */
@@ -253,8 +333,11 @@ bm_bool barman_circular_ram_buffer_initialize(struct bm_datastore_header_data *
     barman_circular_ram_buffer_configuration.header_data->write_offset = 0;
     barman_circular_ram_buffer_configuration.header_data->total_written = 0;
     for (i = 0; i < BM_CONFIG_MAX_CORES; ++i) {
-        barman_circular_ram_buffer_configuration.reserved_tail_offset[i] = BM_NO_RESERVED_TAIL;
+        BM_RESERVED_TAIL_OFFSET(i) = BM_NO_RESERVED_TAIL;
     }
+#if BM_CIRCULAR_RAM_BUFFER_USE_CORE_MASK
+    barman_circular_ram_buffer_configuration.reserved_cores = 0;
+#endif
 
     /* make sure length is aligned to multiple of sizeof(bm_datastore_block_length) */
     barman_circular_ram_buffer_configuration.header_data->buffer_length &= ~((bm_datastore_header_length) (sizeof(bm_datastore_block_length) - 1));
@@ -299,7 +382,7 @@ bm_uint8 * barman_circular_ram_buffer_get_block(bm_uint32 core, bm_datastore_blo
     tail_offset = barman_atomic_load(&barman_circular_ram_buffer_configuration.tail_offset);
 
     /* check not already got uncommited block */
-    if (!barman_atomic_cmp_ex_strong_value(&(barman_circular_ram_buffer_configuration.reserved_tail_offset[core]), BM_NO_RESERVED_TAIL, tail_offset) != 0) {
+    if (!barman_circular_ram_buffer_claim_reservation(core, tail_offset)) {
         return BM_NULL;
     }
 
@@ -321,14 +404,14 @@ bm_uint8 * barman_circular_ram_buffer_get_block(bm_uint32 core, bm_datastore_blo
         bm_datastore_block_length * length_pointer;
 
         /* mark the reserved tail */
-        barman_atomic_store(&(barman_circular_ram_buffer_configuration.reserved_tail_offset[core]), tail_offset);
+        barman_atomic_store(&BM_RESERVED_TAIL_OFFSET(core), tail_offset);
 
         /* if we need to align to the wrap point, then do that first and 'commit' it as if it were a complete block */
         if (alignment_size > 0) {
             /* just align up if necessary so that (head % buffer_length) is not between [real_tail_offset, buffer_length) */
             if (!barman_circular_ram_buffer_free_to_tail(buffer_length, base_pointer, tail_offset - real_tail_offset)) {
                 /* reserved limit met; cannot free enough items */
-                barman_atomic_store(&(barman_circular_ram_buffer_configuration.reserved_tail_offset[core]), BM_NO_RESERVED_TAIL);
+                barman_circular_ram_buffer_release_reservation(core);
                 return BM_NULL;
             }
 
@@ -361,7 +444,7 @@ bm_uint8 * barman_circular_ram_buffer_get_block(bm_uint32 core, bm_datastore_blo
             /* ensure we have enough free space */
             if (!barman_circular_ram_buffer_ensure_free(buffer_length, base_pointer, &head_offset, tail_offset, required_length)) {
                 /* reserved limit met; cannot free enough items */
-                barman_atomic_store(&(barman_circular_ram_buffer_configuration.reserved_tail_offset[core]), BM_NO_RESERVED_TAIL);
+                barman_circular_ram_buffer_release_reservation(core);
                 return BM_NULL;
             }
 
@@ -401,7 +484,7 @@ void barman_circular_ram_buffer_commit_block(bm_uint32 core, bm_uint8 * user_poi
         bm_uint8 * const block_pointer = user_pointer - sizeof(bm_datastore_block_length);
         bm_uint8 * const buffer_end = base_pointer + buffer_length;
         bm_datastore_block_length * length_pointer = BM_ASSUME_ALIGNED_CAST(bm_datastore_block_length, block_pointer);
-        const bm_atomic_uint64 reserved_tail = barman_atomic_load(&(barman_circular_ram_buffer_configuration.reserved_tail_offset[core]));
+        const bm_atomic_uint64 reserved_tail = barman_atomic_load(&BM_RESERVED_TAIL_OFFSET(core));
         bm_datastore_block_length user_length;
         bm_datastore_block_length required_length;
 
@@ -0,0 +1,13 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/** @file */
+
+#include "barman-cache.h"
+
+/* Hosted builds run on cache coherent systems where the data is read back by the same process, so there is nothing to clean */
+void barman_cache_clean(void * pointer, bm_uintptr length)
+{
+    (void) pointer;
+    (void) length;
+}
@@ -0,0 +1,19 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/** @file */
+
+#include "barman-external-dependencies.h"
+#include "barman-types.h"
+
+/* There is no way to mask interrupts from user space on a hosted target; these are no-ops that may be overridden */
+
+BM_WEAK bm_uintptr barman_ext_disable_interrupts_local(void)
+{
+    return 0;
+}
+
+BM_WEAK void barman_ext_enable_interrupts_local(bm_uintptr previous_state)
+{
+    (void) previous_state;
+}
@@ -0,0 +1,20 @@
+/* Copyright (C) 2023 by Arm Limited. */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/** @file */
+
+#include "barman-intrinsics-public.h"
+
+#include <sched.h>
+
+/* User space cannot wait for an interrupt or event; give up the time slice instead */
+
+void barman_wfi_intrinsic(void)
+{
+    sched_yield();
+}
+
+void barman_wfe_intrinsic(void)
+{
+    sched_yield();
+}
@@ -14,6 +14,7 @@
 #include "barman-public-functions.h"
 #include "barman-external-dependencies.h"
 #include "barman-atomics.h"
+#include "pmu/barman-select-pmu.h"
 
 /** @{ */
 #define MPIDR_M_BIT         (BM_UINTPTR(1) << 31)
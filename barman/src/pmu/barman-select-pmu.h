@@ -14,6 +14,8 @@
 /* Select the appropriate PMU device */
 /** @{ */
 #if BM_CONFIG_USER_SUPPLIED_PMU_DRIVER
+extern bm_uint32 barman_ext_midr(void);
+extern bm_uintptr barman_ext_mpidr(void);
 #   define barman_pmu_init(ne, et)          barman_ext_init(ne, et)
 #   define barman_pmu_start()               barman_ext_start()
 #   define barman_pmu_stop()                barman_ext_stop()
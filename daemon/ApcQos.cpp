@@ -0,0 +1,149 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "ApcQos.h"
+
+#include "Logging.h"
+#include "Protocol.h"
+#include "lib/Syscall.h"
+
+#include <cinttypes>
+
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+namespace {
+    constexpr int PERCENT = 100;
+
+    /** Frame types below this are packed into a single byte */
+    constexpr unsigned char SINGLE_BYTE_PACKED_LIMIT = 0x40;
+
+    ApcClass classifyFrameType(FrameType frameType)
+    {
+        switch (frameType) {
+            case FrameType::COUNTER:
+            case FrameType::BLOCK_COUNTER:
+            case FrameType::SCHED_TRACE:
+            case FrameType::PERF_DATA:
+            case FrameType::ACTIVITY_TRACE:
+            case FrameType::PERF_CALLCHAINS:
+            case FrameType::PERF_AGGREGATE:
+                return ApcClass::COUNTERS;
+            case FrameType::EXTERNAL:
+            case FrameType::PERF_AUX:
+                return ApcClass::BULK;
+            case FrameType::SUMMARY:
+            case FrameType::NAME:
+            case FrameType::PERF_ATTRS:
+            case FrameType::PERF_SYNC:
+            default:
+                return ApcClass::CONTROL;
+        }
+    }
+}
+
+ApcClass ApcQos::classify(lib::Span<const lib::Span<const char, int>> dataParts, ResponseType type)
+{
+    // the raw contents of a buffer are classified by their source, by the caller
+    if (type == ResponseType::RAW) {
+        return ApcClass::COUNTERS;
+    }
+
+    if (type != ResponseType::APC_DATA) {
+        return ApcClass::CONTROL;
+    }
+
+    for (const auto & data : dataParts) {
+        if (data.size() > 0) {
+            const auto packed = static_cast<unsigned char>(*data.data());
+            if (packed >= SINGLE_BYTE_PACKED_LIMIT) {
+                return ApcClass::CONTROL;
+            }
+            return classifyFrameType(static_cast<FrameType>(packed));
+        }
+    }
+
+    // the end of capture marker
+    return ApcClass::CONTROL;
+}
+
+bool ApcQos::isCongested() const
+{
+    if (fd < 0) {
+        return false;
+    }
+
+    int unsent = 0;
+    int sendBufferSize = 0;
+    socklen_t optionSize = sizeof(sendBufferSize);
+    if ((lib::ioctl(fd, SIOCOUTQ, reinterpret_cast<unsigned long>(&unsent)) != 0)
+        || (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBufferSize, &optionSize) != 0)) {
+        return false;
+    }
+
+    const auto bulkLimit = (static_cast<long long>(sendBufferSize) * (PERCENT - config.reserved_percent)) / PERCENT;
+    return unsent > bulkLimit;
+}
+
+bool ApcQos::isSheddable(lib::Span<const lib::Span<const char, int>> dataParts) const
+{
+    for (const auto & data : dataParts) {
+        if (data.size() > 0) {
+            // unfiltered aux frames are not cut on record boundaries
+            return (static_cast<FrameType>(*data.data()) != FrameType::PERF_AUX) || speRecordFilter.isEnabled();
+        }
+    }
+    return false;
+}
+
+bool ApcQos::shouldDeferBulk()
+{
+    if ((config.bulk_policy == ApcBulkPolicy::BLOCK) || !isCongested()) {
+        return false;
+    }
+
+    deferrals.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ApcQos::shouldSend(lib::Span<const lib::Span<const char, int>> dataParts, ResponseType type)
+{
+    const bool mayShed =
+        (config.bulk_policy == ApcBulkPolicy::DROP) || (config.bulk_policy == ApcBulkPolicy::DOWNSAMPLE);
+    if (!mayShed || (type != ResponseType::APC_DATA) || (classify(dataParts, type) != ApcClass::BULK)
+        || !isSheddable(dataParts) || !isCongested()) {
+        return true;
+    }
+
+    // when downsampling, the first of every downsample_ratio frames is kept
+    const auto index = bulkFramesWhileCongested.fetch_add(1, std::memory_order_relaxed);
+    if ((config.bulk_policy == ApcBulkPolicy::DOWNSAMPLE)
+        && ((index % static_cast<std::uint64_t>(config.downsample_ratio)) == 0)) {
+        return true;
+    }
+
+    std::uint64_t bytes = 0;
+    for (const auto & data : dataParts) {
+        bytes += data.size();
+    }
+    droppedFrames.fetch_add(1, std::memory_order_relaxed);
+    droppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    return false;
+}
+
+void ApcQos::logStatistics() const
+{
+    const auto frames = droppedFrames.load(std::memory_order_relaxed);
+    if (frames != 0) {
+        LOG_WARNING("The connection to the host was congested, so %" PRIu64 " bulk frames (%" PRIu64
+                    " bytes) were dropped",
+                    frames,
+                    droppedBytes.load(std::memory_order_relaxed));
+    }
+
+    const auto deferred = deferrals.load(std::memory_order_relaxed);
+    if (deferred != 0) {
+        LOG_DEBUG("Buffered bulk sources were deferred %" PRIu64 " times because the connection was congested",
+                  deferred);
+    }
+}
@@ -0,0 +1,70 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "Configuration.h"
+#include "ISender.h"
+#include "lib/Span.h"
+
+#include <atomic>
+#include <cstdint>
+
+/** The classes of APC data, for sharing the link to the host between them */
+enum class ApcClass {
+    /** Responses, and the frames needed to decode everything else (summary, names, attributes, sync) */
+    CONTROL,
+    /** Counter values, samples and scheduling */
+    COUNTERS,
+    /** High volume data that can wait, or be shed (SPE aux data and external sources) */
+    BULK,
+};
+
+/**
+ * Decides what bulk data may be sent to the host, according to the ApcQosConfiguration and how congested the link is.
+ *
+ * The link is congested when the data still unsent in the socket send buffer exceeds the share of the buffer that
+ * bulk data may use. Control and counter data are always sent, so the reserved share of the buffer is kept for them.
+ * A buffered bulk source is deferred while the link is congested (the sender writes the other sources, and its own
+ * buffer fills up and blocks it instead), while the bulk frames that are sent individually are sent or shed as they
+ * arrive, as they share an ordered stream with other data.
+ *
+ * Perf aux frames are only shed when the SPE record filter is on, as it is only then that each frame holds whole
+ * records. Otherwise a frame ends wherever the aux buffer was read up to, and the host decodes the aux stream of each
+ * cpu as one sequence of packets, so dropping a frame would leave it decoding from the middle of a record.
+ */
+class ApcQos {
+public:
+    /**
+     * @param fd The socket to the host, or -1 when capturing locally, which is never congested
+     * @param config The configuration, which is read as data is sent so may be set after this is constructed
+     * @param speRecordFilter The SPE record filter configuration, which is read in the same way
+     */
+    ApcQos(int fd, const ApcQosConfiguration & config, const SpeRecordFilterConfiguration & speRecordFilter)
+        : config(config), speRecordFilter(speRecordFilter), fd(fd)
+    {
+    }
+
+    /** @return The class of some data, which for an APC_DATA response is taken from its frame type */
+    [[nodiscard]] static ApcClass classify(lib::Span<const lib::Span<const char, int>> dataParts, ResponseType type);
+
+    /** @return True if a buffered bulk source should not be written yet */
+    [[nodiscard]] bool shouldDeferBulk();
+
+    /** @return False if the data (a whole response) is to be shed rather than sent */
+    [[nodiscard]] bool shouldSend(lib::Span<const lib::Span<const char, int>> dataParts, ResponseType type);
+
+    /** Log how much bulk data was deferred or shed */
+    void logStatistics() const;
+
+private:
+    const ApcQosConfiguration & config;
+    const SpeRecordFilterConfiguration & speRecordFilter;
+    int fd;
+    std::atomic<std::uint64_t> deferrals {0};
+    std::atomic<std::uint64_t> bulkFramesWhileCongested {0};
+    std::atomic<std::uint64_t> droppedFrames {0};
+    std::atomic<std::uint64_t> droppedBytes {0};
+
+    [[nodiscard]] bool isCongested() const;
+    [[nodiscard]] bool isSheddable(lib::Span<const lib::Span<const char, int>> dataParts) const;
+};
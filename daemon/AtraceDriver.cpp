@@ -6,6 +6,7 @@
 #include "Logging.h"
 #include "OlyUtility.h"
 #include "lib/String.h"
+#include "xml/EventsXML.h"
 
 #include <unistd.h>
 
@@ -34,7 +35,7 @@ AtraceDriver::AtraceDriver(const FtraceDriver & ftraceDriver)
 {
 }
 
-void AtraceDriver::readEvents(mxml_node_t * const xml)
+void AtraceDriver::readEvents(lib::Span<const events_xml::StaticEvent> events)
 {
     if (access("/system/bin/setprop", X_OK) != 0) {
         // Reduce warning noise
@@ -56,22 +57,14 @@ void AtraceDriver::readEvents(mxml_node_t * const xml)
 
     mSupported = true;
 
-    mxml_node_t * node = xml;
-    while (true) {
-        node = mxmlFindElement(node, xml, "event", nullptr, nullptr, MXML_DESCEND);
-        if (node == nullptr) {
-            break;
-        }
-        const char * counter = mxmlElementGetAttr(node, "counter");
-        if (counter == nullptr) {
-            continue;
-        }
+    for (const auto & event : events) {
+        const char * counter = event.counter;
 
         if (strncmp(counter, "atrace_", 7) != 0) {
             continue;
         }
 
-        const char * flagStr = mxmlElementGetAttr(node, "flag");
+        const char * flagStr = event.flag;
         if (flagStr == nullptr) {
             LOG_ERROR("The atrace counter %s is missing the required flag attribute", counter);
             handleException();
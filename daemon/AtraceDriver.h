@@ -18,7 +18,7 @@ public:
     AtraceDriver(AtraceDriver &&) = delete;
     AtraceDriver & operator=(AtraceDriver &&) = delete;
 
-    void readEvents(mxml_node_t * xml) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
 
     void start();
     void stop();
@@ -1,4 +1,4 @@
-/* Copyright (C) 2020-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2020-2023 by Arm Limited. All rights reserved. */
 
 #include "BlockCounterFrameBuilder.h"
 
@@ -8,12 +8,13 @@
 
 BlockCounterFrameBuilder::~BlockCounterFrameBuilder()
 {
+    writeDerivedMetrics();
     endFrame();
 }
 
 bool BlockCounterFrameBuilder::eventHeader(uint64_t time)
 {
-    if (!ensureFrameStarted()) {
+    if (!writeDerivedMetrics() || !ensureFrameStarted()) {
         return false;
     }
 
@@ -30,7 +31,7 @@ bool BlockCounterFrameBuilder::eventHeader(uint64_t time)
 
 bool BlockCounterFrameBuilder::eventCore(int core)
 {
-    if (!ensureFrameStarted()) {
+    if (!writeDerivedMetrics() || !ensureFrameStarted()) {
         return false;
     }
 
@@ -47,7 +48,7 @@ bool BlockCounterFrameBuilder::eventCore(int core)
 
 bool BlockCounterFrameBuilder::eventTid(int tid)
 {
-    if (!ensureFrameStarted()) {
+    if (!writeDerivedMetrics() || !ensureFrameStarted()) {
         return false;
     }
 
@@ -63,6 +64,19 @@ bool BlockCounterFrameBuilder::eventTid(int tid)
 }
 
 bool BlockCounterFrameBuilder::event64(int key, int64_t value)
+{
+    if (!writeEvent64(key, value)) {
+        return false;
+    }
+
+    if (derivedMetricEvaluator) {
+        derivedMetricEvaluator->record(key, value);
+    }
+
+    return true;
+}
+
+bool BlockCounterFrameBuilder::writeEvent64(int key, int64_t value)
 {
     if (!ensureFrameStarted()) {
         return false;
@@ -80,6 +94,9 @@ bool BlockCounterFrameBuilder::event64(int key, int64_t value)
 
 bool BlockCounterFrameBuilder::check(const uint64_t time)
 {
+    // the metrics must be in the same frame as the values they are derived from
+    writeDerivedMetrics();
+
     if ((flushIsNeeded != nullptr) && ((*flushIsNeeded)(time, rawBuilder.needsFlush()))) {
         return flush();
     }
@@ -88,6 +105,8 @@ bool BlockCounterFrameBuilder::check(const uint64_t time)
 
 bool BlockCounterFrameBuilder::flush()
 {
+    writeDerivedMetrics();
+
     const bool shouldEndFrame = endFrame();
     rawBuilder.flush();
     return shouldEndFrame;
@@ -123,3 +142,12 @@ bool BlockCounterFrameBuilder::endFrame()
     }
     return shouldEndFrame;
 }
+
+bool BlockCounterFrameBuilder::writeDerivedMetrics()
+{
+    if (!derivedMetricEvaluator) {
+        return true;
+    }
+
+    return derivedMetricEvaluator->evaluate([this](int key, int64_t value) { return writeEvent64(key, value); });
+}
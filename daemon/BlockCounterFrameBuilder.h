@@ -1,11 +1,13 @@
-/* Copyright (C) 2020-2021 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2020-2023 by Arm Limited. All rights reserved. */
 
 #pragma once
 
 #include "CommitTimeChecker.h"
+#include "DerivedMetric.h"
 #include "IBlockCounterFrameBuilder.h"
 
 #include <memory>
+#include <optional>
 #include <utility>
 
 class IRawFrameBuilder;
@@ -14,16 +16,27 @@ class IRawFrameBuilder;
  * Builds block counter frames
  *
  * Creates and splits frames as needed
+ *
+ * If any derived metrics are given, they are evaluated for each block of values (those with the same timestamp, core
+ * and tid) and written at the end of the block.
  */
 class BlockCounterFrameBuilder : public IBlockCounterFrameBuilder {
 public:
-    BlockCounterFrameBuilder(IRawFrameBuilder & rawBuilder, std::uint64_t commitRate)
-        : rawBuilder(rawBuilder), flushIsNeeded(std::make_shared<CommitTimeChecker>(commitRate))
+    BlockCounterFrameBuilder(IRawFrameBuilder & rawBuilder,
+                             std::uint64_t commitRate,
+                             const std::shared_ptr<const DerivedMetrics> & derivedMetrics = {})
+        : rawBuilder(rawBuilder),
+          flushIsNeeded(std::make_shared<CommitTimeChecker>(commitRate)),
+          derivedMetricEvaluator(makeDerivedMetricEvaluator(derivedMetrics))
     {
     }
 
-    BlockCounterFrameBuilder(IRawFrameBuilder & rawBuilder, std::shared_ptr<CommitTimeChecker> checker)
-        : rawBuilder(rawBuilder), flushIsNeeded(std::move(checker))
+    BlockCounterFrameBuilder(IRawFrameBuilder & rawBuilder,
+                             std::shared_ptr<CommitTimeChecker> checker,
+                             const std::shared_ptr<const DerivedMetrics> & derivedMetrics = {})
+        : rawBuilder(rawBuilder),
+          flushIsNeeded(std::move(checker)),
+          derivedMetricEvaluator(makeDerivedMetricEvaluator(derivedMetrics))
     {
     }
 
@@ -44,9 +57,21 @@ public:
 private:
     IRawFrameBuilder & rawBuilder;
     std::shared_ptr<CommitTimeChecker> flushIsNeeded;
+    std::optional<DerivedMetricEvaluator> derivedMetricEvaluator;
     bool isFrameStarted = false;
 
+    static std::optional<DerivedMetricEvaluator> makeDerivedMetricEvaluator(
+        const std::shared_ptr<const DerivedMetrics> & derivedMetrics)
+    {
+        if ((derivedMetrics == nullptr) || derivedMetrics->empty()) {
+            return {};
+        }
+        return DerivedMetricEvaluator {derivedMetrics};
+    }
+
     bool ensureFrameStarted();
     bool endFrame();
     bool checkSpace(const int bytes);
+    bool writeEvent64(int key, int64_t value);
+    bool writeDerivedMetrics();
 };
@@ -18,9 +18,9 @@
 // if less than that is free we should send
 constexpr int FRACTION_TO_KEEP_FREE = 4;
 
-Buffer::Buffer(const int size, sem_t & readerSem, bool includeResponseType)
+Buffer::Buffer(const int size, lib::ReadySignal readerSignal, bool includeResponseType)
     : mBuf(new char[size]),
-      mReaderSem(readerSem),
+      mReaderSignal(readerSignal),
       mWriterSem(),
       mSize(size),
       mReadPos(0),
@@ -111,6 +111,11 @@ void Buffer::waitForSpace(int bytes)
         handleException();
     }
 
+    if (bytesAvailable() < bytes) {
+        // the sender only reads a buffer once it is flushed, so committed data would otherwise never free its space
+        flush();
+    }
+
     while (bytesAvailable() < bytes) {
         sem_wait(&mWriterSem);
     }
@@ -135,7 +140,7 @@ void Buffer::flush()
 {
     if (mCommitPos.load(std::memory_order_relaxed) != mReadPos.load(std::memory_order_acquire)) {
         // send a notification that data is ready
-        sem_post(&mReaderSem);
+        mReaderSignal.notify();
     }
 }
 
@@ -243,7 +248,7 @@ void Buffer::setDone()
     // notify sender we're done (EOF).
     // need to do this even if no new data
     // as sender waits for new data *and* EOF
-    sem_post(&mReaderSem);
+    mReaderSignal.notify();
 }
 
 int Buffer::getWriteIndex() const
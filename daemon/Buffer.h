@@ -9,6 +9,7 @@
 
 #include "IBufferControl.h"
 #include "IRawFrameBuilder.h"
+#include "lib/ReadyBitmap.h"
 
 #include <atomic>
 #include <cstdint>
@@ -18,10 +19,10 @@
 
 class Buffer : public IBufferControl, public IRawFrameBuilderWithDirectAccess {
 public:
-    Buffer(int size, sem_t & readerSem, bool includeResponseType);
+    Buffer(int size, lib::ReadySignal readerSignal, bool includeResponseType);
 #ifdef BUFFER_USE_SESSION_DATA
     // include SessionData.h first to get access to this constructor
-    Buffer(const int size, sem_t & readerSem) : Buffer(size, readerSem, !gSessionData.mLocalCapture) {}
+    Buffer(const int size, lib::ReadySignal readerSignal) : Buffer(size, readerSignal, !gSessionData.mLocalCapture) {}
 #endif
 
     // Intentionally unimplemented
@@ -70,7 +71,7 @@ public:
 
 private:
     char * const mBuf;
-    sem_t & mReaderSem;
+    lib::ReadySignal mReaderSignal;
     sem_t mWriterSem;
     const int mSize;
     std::atomic_int mReadPos;
@@ -180,7 +180,7 @@ void CCNDriver::setupCounter(Counter & /*counter*/)
     // Handled by PerfDriver
 }
 
-void CCNDriver::readEvents(mxml_node_t * const /*unused*/)
+void CCNDriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
 {
     struct stat st;
     if (stat("/sys/bus/event_source/devices/ccn", &st) != 0) {
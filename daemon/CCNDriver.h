@@ -22,7 +22,7 @@ public:
     void resetCounters() override;
     void setupCounter(Counter & counter) override;
 
-    void readEvents(mxml_node_t * const /*unused*/) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/) override;
     int writeCounters(mxml_node_t * root) const override;
     void writeEvents(mxml_node_t * const /*unused*/) const override;
 
@@ -9,6 +9,7 @@
 #include "Drivers.h"
 #include "ExitStatus.h"
 #include "ExternalSource.h"
+#include "FlightRecorder.h"
 #include "ICpuInfo.h"
 #include "LocalCapture.h"
 #include "Logging.h"
@@ -36,14 +37,17 @@
 #include "xml/EventsXML.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <optional>
 #include <thread>
 #include <utility>
 
 #include <boost/asio/detached.hpp>
 
+#include <strings.h>
 #include <sys/eventfd.h>
 #include <sys/prctl.h>
 #include <sys/wait.h>
@@ -51,6 +55,33 @@
 
 std::atomic<Child *> Child::gSingleton = ATOMIC_VAR_INIT(nullptr);
 
+namespace {
+    /** How long a deferred bulk source waits before the sender checks the link again */
+    constexpr std::chrono::milliseconds BULK_DEFER_RETRY_INTERVAL {10};
+    /** The longest that data committed to a buffer waits for the sender, when its source has not signalled it */
+    constexpr std::chrono::milliseconds UNSIGNALLED_DATA_INTERVAL {100};
+    constexpr std::size_t MEGABYTES = 1024 * 1024;
+
+    /** @return The counter value that triggers the flight recorder, if one was requested and its counter is enabled */
+    std::optional<FlightRecorder::Threshold> getFlightThreshold()
+    {
+        if (gSessionData.mFlightThresholdCounter.empty()) {
+            return std::nullopt;
+        }
+
+        for (const auto & counter : gSessionData.mCounters) {
+            if (counter.isEnabled()
+                && (strcasecmp(counter.getType(), gSessionData.mFlightThresholdCounter.c_str()) == 0)) {
+                return FlightRecorder::Threshold {counter.getKey(), gSessionData.mFlightThresholdValue};
+            }
+        }
+
+        LOG_WARNING("The --flight-threshold counter %s is not enabled, so cannot trigger the flight recorder",
+                    gSessionData.mFlightThresholdCounter.c_str());
+        return std::nullopt;
+    }
+}
+
 extern void cleanUp();
 
 void handleException()
@@ -87,6 +118,7 @@ std::unique_ptr<Child> Child::createLocal(agents::i_agent_spawner_t & hi_priv_sp
                                             lo_priv_spawner,
                                             drivers,
                                             nullptr,
+                                            false,
                                             config,
                                             event_listener,
                                             std::move(last_error_supplier),
@@ -105,6 +137,25 @@ std::unique_ptr<Child> Child::createLive(agents::i_agent_spawner_t & hi_priv_spa
                                             lo_priv_spawner,
                                             drivers,
                                             &sock,
+                                            false,
+                                            {},
+                                            event_listener,
+                                            std::move(last_error_supplier),
+                                            std::move(log_setup_supplier)));
+}
+
+std::unique_ptr<Child> Child::createStandby(agents::i_agent_spawner_t & hi_priv_spawner,
+                                            agents::i_agent_spawner_t & lo_priv_spawner,
+                                            Drivers & drivers,
+                                            capture::capture_process_event_listener_t & event_listener,
+                                            logging::last_log_error_supplier_t last_error_supplier,
+                                            logging::log_setup_supplier_t log_setup_supplier)
+{
+    return std::unique_ptr<Child>(new Child(hi_priv_spawner,
+                                            lo_priv_spawner,
+                                            drivers,
+                                            nullptr,
+                                            true,
                                             {},
                                             event_listener,
                                             std::move(last_error_supplier),
@@ -132,15 +183,16 @@ Child::Child(agents::i_agent_spawner_t & hi_priv_spawner,
              agents::i_agent_spawner_t & lo_priv_spawner,
              Drivers & drivers,
              OlySocket * sock,
+             bool awaitingConnection,
              Child::Config config,
              capture::capture_process_event_listener_t & event_listener,
              logging::last_log_error_supplier_t last_error_supplier,
              logging::log_setup_supplier_t log_setup_supplier)
     : haltPipeline(),
-      senderSem(),
       sender(),
       drivers(drivers),
       socket(sock),
+      awaitingConnection(awaitingConnection),
       event_listener(event_listener),
       numExceptions(0),
       sessionEnded(),
@@ -161,9 +213,6 @@ Child::Child(agents::i_agent_spawner_t & hi_priv_spawner,
     const Child * const prevSingleton = gSingleton.exchange(this, std::memory_order_acq_rel);
     runtime_assert(prevSingleton == nullptr, "Two Child instances active concurrently");
 
-    // Initialize semaphores
-    sem_init(&senderSem, 0, 0);
-
     sessionEnded = false;
 }
 
@@ -174,9 +223,12 @@ Child::~Child()
     runtime_assert(prevSingleton == this, "Exchanged Child::gSingleton with something other than this");
 }
 
-void Child::run()
+void Child::prepare()
 {
-    prctl(PR_SET_NAME, reinterpret_cast<unsigned long>(&"gatord-child"), 0, 0, 0);
+    if (prepared) {
+        return;
+    }
+    prepared = true;
 
     // TODO: better place for this
     agent_workers_process.start();
@@ -184,9 +236,6 @@ void Child::run()
     // Disable line wrapping when generating xml files; carriage returns and indentation to be added manually
     mxmlSetWrapMargin(0);
 
-    // Instantiate the Sender - must be done first, after which error messages can be sent
-    sender = std::make_unique<Sender>(socket);
-
     auto & primarySourceProvider = drivers.getPrimarySourceProvider();
     // Populate gSessionData with the configuration
 
@@ -238,7 +287,7 @@ void Child::run()
         }
     }
 
-    std::vector<CapturedSpe> capturedSpes;
+    capturedSpes.clear();
     for (const auto & speConfig : speConfigs) {
         bool claimed = false;
 
@@ -256,6 +305,33 @@ void Child::run()
         }
     }
 
+    // Streamline asks for these first, and they only depend on the configuration that was just read
+    if (!gSessionData.mLocalCapture) {
+        StreamlineSetup::prepareXmlResponses(drivers, log_setup_supplier);
+    }
+}
+
+void Child::attachConnection(OlySocket & sock)
+{
+    runtime_assert(awaitingConnection, "Only a standby child can have its connection attached");
+
+    socket = &sock;
+    awaitingConnection = false;
+}
+
+void Child::run()
+{
+    runtime_assert(!awaitingConnection, "The standby child was run without a connection");
+
+    prctl(PR_SET_NAME, reinterpret_cast<unsigned long>(&"gatord-child"), 0, 0, 0);
+
+    // Instantiate the Sender - must be done first, after which error messages can be sent
+    sender = std::make_unique<Sender>(socket);
+
+    prepare();
+
+    auto & primarySourceProvider = drivers.getPrimarySourceProvider();
+
     // Start up and parse session xml
     if (socket != nullptr) {
         // Respond to Streamline requests
@@ -277,6 +353,17 @@ void Child::run()
         local_capture::createAPCDirectory(gSessionData.mTargetPath);
         local_capture::copyImages(gSessionData.mImages);
         sender->createDataFile(gSessionData.mAPCDir);
+        if (gSessionData.mFlightRecorderSeconds > 0) {
+            // the flight recorder keeps the newest data, so the buffers must stream to it rather than stop the
+            // capture once they have filled
+            gSessionData.mOneShot = false;
+            sender->startFlightRecorder(std::make_unique<FlightRecorder>(
+                static_cast<std::size_t>(gSessionData.mTotalBufferSize) * MEGABYTES,
+                std::chrono::nanoseconds(std::chrono::seconds(gSessionData.mFlightRecorderSeconds)).count(),
+                (gSessionData.mFlightTrigger != nullptr) ? gSessionData.mFlightTrigger : "",
+                getFlightThreshold(),
+                [this]() { endSession(); }));
+        }
         // Write events XML
         events_xml::write(gSessionData.mAPCDir,
                           drivers.getAllConst(),
@@ -310,7 +397,10 @@ void Child::run()
     // Initialize ftrace source before child as it's slow and depends on nothing else
     // If initialized later, us gator with ftrace has time sync issues
     // Must be initialized before senderThread is started as senderThread checks externalSource
-    if (!addSource(createExternalSource(senderSem, drivers),
+    auto const externalSourceSignal = senderReady.addProducer();
+    if (!addSource(createExternalSource(externalSourceSignal, drivers),
+                   externalSourceSignal,
+                   ApcClass::BULK,
                    [this, &waitForExternalSourceAgent, &waitForPerfettoAgent, enablePerfettoAgent](auto & source) {
                        this->agent_workers_process.async_add_external_source(
                            source,
@@ -358,9 +448,15 @@ void Child::run()
         LOG_DEBUG("Waiting for agents complete");
     }
 
+    // the derived counters are computed from the values of the other counters as the sources write them
+    auto const derivedMetrics = drivers.getDerivedMetricDriver().createDerivedMetrics(
+        gSessionData.mCounters,
+        primarySourceProvider.getPrimaryDriver());
+
     // create the primary source last as it will launch the process, which may lead to a race receiving external messages
+    auto const primarySourceSignal = senderReady.addProducer();
     auto newPrimarySource = primarySourceProvider.createPrimarySource(
-        senderSem,
+        primarySourceSignal,
         *sender,
         [this]() -> bool { return sessionEnded; },
         execTargetCallback,
@@ -368,6 +464,7 @@ void Child::run()
         gSessionData.mPids,
         drivers.getFtraceDriver(),
         !gSessionData.mCaptureCommand.empty(),
+        derivedMetrics.primarySource,
         agent_workers_process);
     if (newPrimarySource == nullptr) {
         LOG_ERROR("%s", primarySourceProvider.getPrepareFailedMessage());
@@ -375,11 +472,15 @@ void Child::run()
     }
 
     auto & primarySource = *newPrimarySource;
-    addSource(std::move(newPrimarySource));
+    addSource(std::move(newPrimarySource), primarySourceSignal);
 
     // initialize midgard hardware counters
     if (drivers.getMaliHwCntrs().countersEnabled()) {
-        if (!addSource(mali_userspace::createMaliHwCntrSource(senderSem, drivers.getMaliHwCntrs()))) {
+        auto const maliSourceSignal = senderReady.addProducer();
+        if (!addSource(mali_userspace::createMaliHwCntrSource(maliSourceSignal,
+                                                              drivers.getMaliHwCntrs(),
+                                                              derivedMetrics.block),
+                       maliSourceSignal)) {
             LOG_ERROR("Unable to prepare midgard hardware counters source for capture");
             handleException();
         }
@@ -397,13 +498,17 @@ void Child::run()
     }
 
     if (shouldStartUserSpaceSource(drivers.getAllPolledConst())) {
-        if (!addSource(createUserSpaceSource(senderSem, drivers.getAllPolled()))) {
+        auto const userSpaceSourceSignal = senderReady.addProducer();
+        if (!addSource(createUserSpaceSource(userSpaceSourceSignal, drivers.getAllPolled(), derivedMetrics.block),
+                       userSpaceSourceSignal)) {
             LOG_ERROR("Unable to prepare userspace source for capture");
             handleException();
         }
     }
 
-    if (!addSource(armnn::createSource(drivers.getArmnnDriver().getCaptureController(), senderSem))) {
+    auto const armnnSourceSignal = senderReady.addProducer();
+    if (!addSource(armnn::createSource(drivers.getArmnnDriver().getCaptureController(), armnnSourceSignal),
+                   armnnSourceSignal)) {
         LOG_ERROR("Unable to prepare ArmNN source for capture");
         handleException();
     }
@@ -440,6 +545,8 @@ void Child::run()
 
     // Write the captured xml file
     if (gSessionData.mLocalCapture) {
+        sender->stopFlightRecorder();
+
         auto & maliCntrDriver = drivers.getMaliHwCntrs();
         captured_xml::write(gSessionData.mAPCDir,
                             capturedSpes,
@@ -462,13 +569,13 @@ void Child::run()
 }
 
 template<typename S>
-bool Child::addSource(std::shared_ptr<S> source)
+bool Child::addSource(std::shared_ptr<S> source, lib::ReadySignal signal, ApcClass apcClass)
 {
-    return addSource(std::move(source), [](auto const & /*source*/) {});
+    return addSource(std::move(source), signal, apcClass, [](auto const & /*source*/) {});
 }
 
 template<typename S, typename Callback>
-bool Child::addSource(std::shared_ptr<S> source, Callback callback)
+bool Child::addSource(std::shared_ptr<S> source, lib::ReadySignal signal, ApcClass apcClass, Callback callback)
 {
     if (!source) {
         return false;
@@ -477,6 +584,7 @@ bool Child::addSource(std::shared_ptr<S> source, Callback callback)
     if (!sessionEnded) {
         callback(*source);
         sources.push_back(std::move(source));
+        senderSourceInfo.push_back(SenderSourceInfo {signal.mask(), apcClass});
     }
     return true;
 }
@@ -661,12 +769,23 @@ void Child::stopThreadEntryPoint()
     LOG_DEBUG("Exit stop thread");
 }
 
-bool Child::sendAllSources()
+bool Child::sendReadySources(std::uint64_t readyMask, std::vector<bool> & sourceDone, std::uint64_t & deferredMask)
 {
     bool done = true;
-    for (auto & source : sources) {
-        // bitwise &, no short circuit
-        done &= source->write(*sender);
+    deferredMask = 0;
+    for (std::size_t index = 0; index < sources.size(); ++index) {
+        const auto & info = senderSourceInfo[index];
+        if ((info.readyMask & readyMask) != 0) {
+            // leave the data in a bulk source's buffer while the link is congested, so that it fills and blocks
+            // that source rather than the other sources
+            if ((info.apcClass == ApcClass::BULK) && sender->shouldDeferBulk()) {
+                deferredMask |= info.readyMask;
+            }
+            else {
+                sourceDone[index] = sources[index]->write(*sender);
+            }
+        }
+        done = done && sourceDone[index];
     }
     return !done;
 }
@@ -676,17 +795,38 @@ void Child::senderThreadEntryPoint()
     prctl(PR_SET_NAME, reinterpret_cast<unsigned long>(&"gatord-sender"), 0, 0, 0);
     sem_wait(&haltPipeline);
 
-    do {
-        if (sem_wait(&senderSem) != 0) {
-            LOG_ERROR("wait failed: %d, (%s)", errno, strerror(errno));
+    // write every source once to start with, as one may have finished (or had data) before the sender started
+    std::vector<bool> sourceDone(sources.size(), false);
+    std::uint64_t readyMask = ~std::uint64_t(0);
+    std::uint64_t deferredMask = 0;
+    auto nextFullPass = std::chrono::steady_clock::now() + UNSIGNALLED_DATA_INTERVAL;
+    while (sendReadySources(readyMask, sourceDone, deferredMask)) {
+        // only the sources that have signalled since the last pass have anything new, other than any that were
+        // deferred, which are retried once the link has had time to drain, and any that committed a little data
+        // without filling enough of their buffer to signal, which are picked up by a periodic pass over every source
+        auto now = std::chrono::steady_clock::now();
+        readyMask = deferredMask;
+        if (now < nextFullPass) {
+            std::chrono::nanoseconds timeout = nextFullPass - now;
+            if (deferredMask != 0) {
+                timeout = std::min<std::chrono::nanoseconds>(timeout, BULK_DEFER_RETRY_INTERVAL);
+            }
+            readyMask |= senderReady.waitFor(timeout);
+            now = std::chrono::steady_clock::now();
         }
-    } while (sendAllSources());
+        if (now >= nextFullPass) {
+            readyMask = ~std::uint64_t(0);
+            nextFullPass = now + UNSIGNALLED_DATA_INTERVAL;
+        }
+    }
 
     // write end-of-capture sequence
     if (!gSessionData.mLocalCapture) {
         sender->writeData(nullptr, 0, ResponseType::APC_DATA);
     }
 
+    sender->logQosStatistics();
+
     LOG_DEBUG("Exit sender thread");
 }
 
@@ -723,6 +863,17 @@ void Child::on_terminal_signal(int signo)
     endSession(signo);
 }
 
+void Child::on_trigger_signal(int signo)
+{
+    if (gSessionData.mFlightRecorderSeconds > 0) {
+        LOG_INFO("Flight recorder triggered by signal: %s", strsignal(signo));
+        endSession();
+    }
+    else {
+        LOG_DEBUG("Ignoring signal %d, as there is no flight recorder to trigger", signo);
+    }
+}
+
 void Child::on_agent_thread_terminated()
 {
     endSession();
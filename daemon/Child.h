@@ -3,14 +3,18 @@
 #ifndef __CHILD_H__
 #define __CHILD_H__
 
+#include "ApcQos.h"
+#include "CapturedSpe.h"
 #include "Configuration.h"
 #include "Source.h"
 #include "agents/agent_workers_process.h"
 #include "capture/CaptureProcess.h"
 #include "lib/AutoClosingFd.h"
+#include "lib/ReadyBitmap.h"
 #include "logging/suppliers.h"
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -50,6 +54,16 @@ public:
                                              capture::capture_process_event_listener_t & event_listener,
                                              logging::last_log_error_supplier_t last_error_supplier,
                                              logging::log_setup_supplier_t log_setup_supplier);
+    /**
+     * Create the child for a live capture before the connection arrives, so that it can be prepared ahead of time.
+     * The connection must be attached before the child is run.
+     */
+    static std::unique_ptr<Child> createStandby(agents::i_agent_spawner_t & hi_priv_spawner,
+                                                agents::i_agent_spawner_t & lo_priv_spawner,
+                                                Drivers & drivers,
+                                                capture::capture_process_event_listener_t & event_listener,
+                                                logging::last_log_error_supplier_t last_error_supplier,
+                                                logging::log_setup_supplier_t log_setup_supplier);
 
     ~Child();
 
@@ -59,6 +73,19 @@ public:
     Child(Child &&) = delete;
     Child & operator=(Child &&) = delete;
 
+    /**
+     * Does the setup that does not depend on the connection: starts the agent workers, reads the configuration and sets
+     * up the counters, and (for a live capture) builds the XML responses that Streamline requests first.
+     * Called by run() if it was not already called; a standby child calls it before the connection arrives. Errors
+     * exit the process through handleException() either way, so a standby child that fails here is reaped by
+     * gator-main, which then stops using standby children and starts each capture with a fresh gator-child (where the
+     * same error is reported to Streamline).
+     */
+    void prepare();
+
+    /** Attach the connection to a child that was created by createStandby */
+    void attachConnection(OlySocket & sock);
+
     /**
      * @brief Runs the capture process
      */
@@ -76,12 +103,26 @@ private:
     static void signalHandler(int signum);
     static void childSignalHandler(int signum);
 
+    /** How the sender treats one of the sources */
+    struct SenderSourceInfo {
+        /** The ReadySignal mask of the source */
+        std::uint64_t readyMask;
+        ApcClass apcClass;
+    };
+
     sem_t haltPipeline;
-    sem_t senderSem;
+    /** Tells the sender which of the sources have something to send */
+    lib::ReadyBitmap senderReady {};
     std::vector<std::shared_ptr<Source>> sources {};
+    /** Parallel to sources */
+    std::vector<SenderSourceInfo> senderSourceInfo {};
     std::unique_ptr<Sender> sender;
     Drivers & drivers;
     OlySocket * socket;
+    /** True until a child that was created by createStandby has its connection attached */
+    bool awaitingConnection;
+    bool prepared {false};
+    std::vector<CapturedSpe> capturedSpes {};
     capture::capture_process_event_listener_t & event_listener;
     int numExceptions;
     std::mutex sessionEndedMutex {};
@@ -98,6 +139,7 @@ private:
           agents::i_agent_spawner_t & lo_priv_spawner,
           Drivers & drivers,
           OlySocket * sock,
+          bool awaitingConnection,
           Config config,
           capture::capture_process_event_listener_t & event_listener,
           logging::last_log_error_supplier_t last_error_supplier,
@@ -106,28 +148,35 @@ private:
     /**
      * Adds to sources if non empty
      * return true if not empty
+     *
+     * @param signal The signal (from senderReady) that the source notifies when it has data
+     * @param apcClass The class of all the data that the source writes
      */
     template<typename S>
-    bool addSource(std::shared_ptr<S> source);
+    bool addSource(std::shared_ptr<S> source, lib::ReadySignal signal, ApcClass apcClass = ApcClass::COUNTERS);
 
     template<typename S, typename Callback>
-    bool addSource(std::shared_ptr<S> source, Callback callback);
+    bool addSource(std::shared_ptr<S> source, lib::ReadySignal signal, ApcClass apcClass, Callback callback);
 
     void cleanupException();
     void durationThreadEntryPoint(const lib::Waiter & waitTillStart, const lib::Waiter & waitTillEnd);
     void stopThreadEntryPoint();
     void senderThreadEntryPoint();
     /**
-     * Writes data to the sender.
+     * Writes data to the sender from the sources that are ready.
      *
+     * @param readyMask The ready bits of the sources to write
+     * @param sourceDone Whether each source has reached EOF, updated for those that are written
+     * @param deferredMask Set to the ready bits of the bulk sources that were not written because the link is congested
      * @return true if there will be more to send again on at least one source, false otherwise (EOF)
      */
-    bool sendAllSources();
+    bool sendReadySources(std::uint64_t readyMask, std::vector<bool> & sourceDone, std::uint64_t & deferredMask);
     void watchPidsThreadEntryPoint(std::set<int> &, const lib::Waiter & waiter);
     void doEndSession();
 
     // for agent_workers_process_t
     void on_terminal_signal(int signo);
+    void on_trigger_signal(int signo);
     void on_agent_thread_terminated();
 };
 
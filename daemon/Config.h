@@ -52,6 +52,12 @@
 #define CONFIG_DISABLE_CONTINUATION_TRACING 0
 #endif
 
+// reuse the freed type erased state of polymorphic continuations, rather than returning it to the global allocator;
+// this only exists so that hosted/benchmark-continuations.cpp can measure the saving, and should always be left on
+#ifndef CONFIG_RECYCLE_CONTINUATION_STATE
+#define CONFIG_RECYCLE_CONTINUATION_STATE 1
+#endif
+
 #ifndef CONFIG_ASSERTIONS
 #if (!defined(NDEBUG) || (defined(GATOR_UNIT_TESTS) && GATOR_UNIT_TESTS))
 #define CONFIG_ASSERTIONS 1
@@ -24,6 +24,41 @@ struct SpeConfiguration {
     int min_latency = 0;
 };
 
+/** Filters applied in the agent to the SPE records, after any hardware filtering specified by SpeConfiguration */
+struct SpeRecordFilterConfiguration {
+    uint64_t any_event_mask {}; // if 0 filtering is disabled, else records with any of these events are kept
+    std::set<SpeOps> ops {};
+    int min_total_latency = 0;
+    int min_issue_latency = 0;
+    int min_translation_latency = 0;
+
+    /** @return True if any filtering is configured */
+    [[nodiscard]] bool isEnabled() const
+    {
+        return (any_event_mask != 0) || !ops.empty() || (min_total_latency != 0) || (min_issue_latency != 0)
+            || (min_translation_latency != 0);
+    }
+};
+
+/**
+ * What the sender does with bulk APC data (SPE aux data and external sources) while the host link is congested. Perf
+ * aux frames are only dropped when the SPE record filter is on, as only then does each frame hold whole records.
+ */
+enum class ApcBulkPolicy {
+    BLOCK,     // send it anyway, competing with everything else for the link (the default)
+    DEFER,     // hold back the buffered bulk sources until the link drains; nothing is lost
+    DROP,      // as DEFER, and also drop the bulk frames that are sent individually (perf aux frames)
+    DOWNSAMPLE // as DEFER, and also drop all but one in downsample_ratio of the individually sent bulk frames
+};
+
+/** How the link to the host is shared between the classes of APC data, from the session.xml */
+struct ApcQosConfiguration {
+    ApcBulkPolicy bulk_policy = ApcBulkPolicy::BLOCK;
+    // the link is congested when more than (100 - this) percent of the socket send buffer is still unsent
+    int reserved_percent = 50;
+    int downsample_ratio = 4;
+};
+
 inline bool operator==(const SpeConfiguration & lhs, const SpeConfiguration & rhs)
 {
     return lhs.id == rhs.id;
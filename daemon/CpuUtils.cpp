@@ -1,25 +1,37 @@
-/* Copyright (C) 2013-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2013-2023 by Arm Limited. All rights reserved. */
 
 #include "CpuUtils.h"
 
 #include "CpuUtils_Topology.h"
 #include "Logging.h"
 #include "OlyUtility.h"
+#include "lib/AutoClosingFd.h"
 #include "lib/File.h"
+#include "lib/FileDescriptor.h"
+#include "lib/FsEntry.h"
+#include "lib/Syscall.h"
 #include "linux/PerCoreIdentificationThread.h"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cerrno>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace cpu_utils {
@@ -213,18 +225,78 @@ namespace cpu_utils {
         return hardwareName;
     }
 
-    std::string readCpuInfo(bool ignoreOffline, bool wantsHardwareName, lib::Span<int> cpuIds)
-    {
-        std::map<unsigned, unsigned> cpuToCluster;
-        std::map<unsigned, std::set<unsigned>> clusterToCpuIds;
-        std::map<unsigned, unsigned> cpuToCpuIds;
+    namespace {
+        using CoreProperties = std::map<unsigned, PerCoreIdentificationThread::properties_t>;
+
+        /** What was learnt about the cores from their properties */
+        struct CoreIdentification {
+            std::map<unsigned, unsigned> cpuToCluster {};
+            std::map<unsigned, std::set<unsigned>> clusterToCpuIds {};
+            std::map<unsigned, unsigned> cpuToCpuIds {};
+        };
+
+        /**
+         * The world writable directories that hold gatord's private cache directory (one per user, named
+         * gatord-<euid>), which the identification result is cached in. The first usable directory is used.
+         */
+        constexpr std::array<const char *, 2> CPU_ID_CACHE_PARENT_DIRS {{
+            "/tmp",
+            "/data/local/tmp",
+        }};
+
+        constexpr const char * CPU_ID_CACHE_FILE_NAME = "cpu-ids";
+
+        /**
+         * Open (creating it if necessary) gatord's private cache directory in some parent directory. As the parent is
+         * world writable, the directory is only used if it is owned by this user and no one else can write to it.
+         *
+         * @return The directory fd, or an invalid fd if it cannot be used
+         */
+        lib::AutoClosingFd openCacheDirectory(const char * parentDir, bool create)
+        {
+            const std::string path = std::string(parentDir) + "/gatord-" + std::to_string(lib::geteuid());
+
+            if (create && (mkdir(path.c_str(), S_IRWXU) != 0) && (errno != EEXIST)) {
+                return {};
+            }
+
+            lib::AutoClosingFd fd {lib::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW)};
+            if (fd.get() < 0) {
+                return {};
+            }
+
+            struct stat st;
+            if ((fstat(fd.get(), &st) != 0) || (st.st_uid != lib::geteuid()) || !S_ISDIR(st.st_mode)
+                || ((st.st_mode & (S_IRWXG | S_IRWXO)) != 0)) {
+                LOG_DEBUG("Ignoring the cache directory %s as it is not private to this user", path.c_str());
+                return {};
+            }
+
+            return fd;
+        }
 
-        // first collect the detailed state using the identifier if available
+        /**
+         * Read the properties of each core from sysfs. The cores are not onlined, so the properties are only read for
+         * the cores that are online.
+         */
+        CoreProperties detectWithoutOnlining(std::size_t numberOfCores)
+        {
+            CoreProperties collectedProperties {};
+            for (unsigned cpu = 0; cpu < numberOfCores; ++cpu) {
+                collectedProperties.emplace(cpu, PerCoreIdentificationThread::detectFor(cpu));
+            }
+            return collectedProperties;
+        }
+
+        /**
+         * Online every core and read its properties
+         */
+        CoreProperties detectByOnlining(std::size_t numberOfCores)
         {
             std::mutex mutex;
             std::condition_variable cv;
             std::size_t identificationThreadCallbackCounter = 0;
-            std::map<unsigned, PerCoreIdentificationThread::properties_t> collected_properties {};
+            CoreProperties collectedProperties {};
             std::vector<std::unique_ptr<PerCoreIdentificationThread>> perCoreThreads {};
 
             // wake all cores; this ensures the contents of /proc/cpuinfo reflect the full range of cores in the system.
@@ -233,48 +305,43 @@ namespace cpu_utils {
             // - once all cores are online and affined, *and* have read the data they are required to read, then they callback here to notify this method to continue
             // - the threads remain online until this function finishes (they are disposed of / terminated by destructor); this is so as
             //   to ensure that the cores remain online until cpuinfo is read
-            if (!ignoreOffline) {
-                for (unsigned cpu = 0; cpu < cpuIds.size(); ++cpu) {
-                    perCoreThreads.emplace_back(new PerCoreIdentificationThread(
-                        false,
-                        cpu,
-                        [&](unsigned c, PerCoreIdentificationThread::properties_t && properties) -> void {
-                            std::lock_guard<std::mutex> guard {mutex};
-
-                            // store it for later processing
-                            collected_properties.emplace(c, std::move(properties));
-
-                            // update completed count
-                            identificationThreadCallbackCounter += 1;
-                            cv.notify_one();
-                        }));
-                }
-
-                // wait until all threads are online
-                std::unique_lock<std::mutex> lock {mutex};
-                auto succeeded = cv.wait_for(lock, std::chrono::seconds(10), [&] {
-                    return identificationThreadCallbackCounter >= cpuIds.size();
-                });
-                if (!succeeded) {
-                    LOG_DEBUG("Could not identify all CPU cores within the timeout period. Activated %zu of %zu",
-                              identificationThreadCallbackCounter,
-                              cpuIds.size());
-                }
+            for (unsigned cpu = 0; cpu < numberOfCores; ++cpu) {
+                perCoreThreads.emplace_back(new PerCoreIdentificationThread(
+                    false,
+                    cpu,
+                    [&](unsigned c, PerCoreIdentificationThread::properties_t && properties) -> void {
+                        std::lock_guard<std::mutex> guard {mutex};
+
+                        // store it for later processing
+                        collectedProperties.emplace(c, std::move(properties));
+
+                        // update completed count
+                        identificationThreadCallbackCounter += 1;
+                        cv.notify_one();
+                    }));
             }
-            //
-            // when we don't care about onlining the cores, just read them directly, one by one, any that are offline will be ignored anyway
-            //
-            else {
-                for (unsigned cpu = 0; cpu < cpuIds.size(); ++cpu) {
-                    collected_properties.emplace(cpu, PerCoreIdentificationThread::detectFor(cpu));
-                }
+
+            // wait until all threads are online
+            std::unique_lock<std::mutex> lock {mutex};
+            auto succeeded = cv.wait_for(lock, std::chrono::seconds(10), [&] {
+                return identificationThreadCallbackCounter >= numberOfCores;
+            });
+            if (!succeeded) {
+                LOG_DEBUG("Could not identify all CPU cores within the timeout period. Activated %zu of %zu",
+                          identificationThreadCallbackCounter,
+                          numberOfCores);
             }
 
-            // lock to prevent concurrent access to maps if one of the threads stalls
-            std::lock_guard<std::mutex> lock(mutex);
+            // copy while locked, as a thread that stalled may still add to the map until the threads are joined
+            CoreProperties result {collectedProperties};
+            return result;
+        }
 
-            // process the collected properties
-            for (auto const & entry : collected_properties) {
+        CoreIdentification identify(const CoreProperties & collectedProperties)
+        {
+            CoreIdentification result {};
+
+            for (auto const & entry : collectedProperties) {
                 auto c = entry.first;
                 auto const & properties = entry.second;
 
@@ -282,29 +349,188 @@ namespace cpu_utils {
 
                 // store the cluster / core mappings to allow us to fill in any gaps by assuming the same core type per cluster
                 if (properties.physical_package_id != PerCoreIdentificationThread::INVALID_PACKAGE_ID) {
-                    cpuToCluster[c] = properties.physical_package_id;
+                    result.cpuToCluster[c] = properties.physical_package_id;
 
                     // also map cluster to MIDR value if read
                     if (properties.midr_el1 != PerCoreIdentificationThread::INVALID_MIDR_EL1) {
-                        clusterToCpuIds[properties.physical_package_id].insert(cpuId);
+                        result.clusterToCpuIds[properties.physical_package_id].insert(cpuId);
                     }
 
                     for (int sibling : properties.core_siblings) {
                         const unsigned sibling_cpu = sibling;
 
-                        if (cpuToCluster.count(sibling_cpu) == 0) {
-                            cpuToCluster[sibling_cpu] = properties.physical_package_id;
+                        if (result.cpuToCluster.count(sibling_cpu) == 0) {
+                            result.cpuToCluster[sibling_cpu] = properties.physical_package_id;
                         }
                     }
                 }
 
                 // map cpu to MIDR value if read
                 if (properties.midr_el1 != PerCoreIdentificationThread::INVALID_MIDR_EL1) {
-                    cpuToCpuIds[c] = cpuId;
+                    result.cpuToCpuIds[c] = cpuId;
                 }
             }
+
+            return result;
         }
 
+        /**
+         * @return True if the type of every core is known, either from its own MIDR value or because it is in a
+         * cluster where all the cores that could be read have the same type
+         */
+        bool identifiesAllCores(std::size_t numberOfCores, const CoreIdentification & identification)
+        {
+            for (unsigned cpu = 0; cpu < numberOfCores; ++cpu) {
+                if (identification.cpuToCpuIds.count(cpu) > 0) {
+                    continue;
+                }
+
+                const auto cluster = identification.cpuToCluster.find(cpu);
+                if (cluster == identification.cpuToCluster.end()) {
+                    return false;
+                }
+
+                const auto cpuIds = identification.clusterToCpuIds.find(cluster->second);
+                if ((cpuIds == identification.clusterToCpuIds.end()) || (cpuIds->second.size() != 1)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        std::string readBootId()
+        {
+            return lib::FsEntry::create("/proc/sys/kernel/random/boot_id").readFileContentsSingleLine();
+        }
+
+        /**
+         * Read the CPUIDs stored by an earlier identification during this boot
+         *
+         * @return True if the cache was valid and all of cpuIds was filled in
+         */
+        bool readCachedCpuIds(const std::string & bootId, lib::Span<int> cpuIds)
+        {
+            if (bootId.empty()) {
+                return false;
+            }
+
+            for (const char * parentDir : CPU_ID_CACHE_PARENT_DIRS) {
+                const auto dirFd = openCacheDirectory(parentDir, false);
+                if (dirFd.get() < 0) {
+                    continue;
+                }
+
+                lib::AutoClosingFd fd {openat(dirFd.get(), CPU_ID_CACHE_FILE_NAME, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)};
+                if (fd.get() < 0) {
+                    continue;
+                }
+
+                // the directory is private, but check anyway that the file was written by this user
+                struct stat st;
+                if ((fstat(fd.get(), &st) != 0) || (st.st_uid != lib::geteuid()) || !S_ISREG(st.st_mode)) {
+                    LOG_DEBUG("Ignoring the CPU identification cache in %s", parentDir);
+                    continue;
+                }
+
+                std::string contents(st.st_size, '\0');
+                if (!lib::readAll(fd.get(), contents.data(), contents.size())) {
+                    return false;
+                }
+
+                std::istringstream stream {contents};
+                std::string cachedBootId;
+                std::size_t numberOfCores = 0;
+                if (!(stream >> cachedBootId >> numberOfCores) || (cachedBootId != bootId)
+                    || (numberOfCores != cpuIds.size())) {
+                    return false;
+                }
+
+                std::vector<int> cachedCpuIds(numberOfCores, -1);
+                for (auto & cpuId : cachedCpuIds) {
+                    if (!(stream >> cpuId) || (cpuId == -1)) {
+                        return false;
+                    }
+                }
+
+                std::copy(cachedCpuIds.begin(), cachedCpuIds.end(), cpuIds.begin());
+                return true;
+            }
+
+            return false;
+        }
+
+        /** Store the CPUIDs so that the cores need not be identified again until the next boot */
+        void writeCachedCpuIds(const std::string & bootId, lib::Span<const int> cpuIds)
+        {
+            if (bootId.empty()) {
+                return;
+            }
+
+            std::ostringstream stream;
+            stream << bootId << '\n' << cpuIds.size() << '\n';
+            for (int cpuId : cpuIds) {
+                stream << cpuId << '\n';
+            }
+            const std::string contents = stream.str();
+
+            for (const char * parentDir : CPU_ID_CACHE_PARENT_DIRS) {
+                const auto dirFd = openCacheDirectory(parentDir, true);
+                if (dirFd.get() < 0) {
+                    continue;
+                }
+
+                // write to a temporary file and then rename it, so that a reader never sees a partial file
+                const std::string tempName = std::string(CPU_ID_CACHE_FILE_NAME) + "." + std::to_string(getpid());
+                lib::AutoClosingFd fd {openat(dirFd.get(),
+                                              tempName.c_str(),
+                                              O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW,
+                                              0600)};
+                if (fd.get() < 0) {
+                    continue;
+                }
+
+                const bool written = lib::writeAll(fd.get(), contents.data(), contents.size());
+                fd.close();
+
+                if (written
+                    && (renameat(dirFd.get(), tempName.c_str(), dirFd.get(), CPU_ID_CACHE_FILE_NAME) == 0)) {
+                    LOG_DEBUG("Stored the CPU identification in %s", parentDir);
+                    return;
+                }
+
+                unlinkat(dirFd.get(), tempName.c_str(), 0);
+            }
+        }
+    }
+
+    std::string readCpuInfo(bool ignoreOffline, bool wantsHardwareName, lib::Span<int> cpuIds)
+    {
+        const std::string bootId = readBootId();
+
+        // the cores do not change while the system is running, so reuse the result from earlier in this boot if there is one
+        if (readCachedCpuIds(bootId, cpuIds)) {
+            LOG_DEBUG("Read the CPUIDs from the CPU identification cache");
+            if (!wantsHardwareName) {
+                return "";
+            }
+            std::vector<int> ignored(cpuIds.size(), -1);
+            return parseProcCpuInfo(/* justGetHardwareName = */ true, ignored);
+        }
+
+        // first try to identify the cores from sysfs, which does not need them to be online
+        CoreIdentification identification = identify(detectWithoutOnlining(cpuIds.size()));
+
+        // otherwise wake all the cores to read their properties and /proc/cpuinfo
+        if ((!ignoreOffline) && !identifiesAllCores(cpuIds.size(), identification)) {
+            LOG_DEBUG("Could not identify all the CPU cores from sysfs, onlining them");
+            identification = identify(detectByOnlining(cpuIds.size()));
+        }
+
+        const auto & cpuToCluster = identification.cpuToCluster;
+        const auto & clusterToCpuIds = identification.clusterToCpuIds;
+        const auto & cpuToCpuIds = identification.cpuToCpuIds;
+
         // log what we learnt
         for (const auto & pair : cpuToCpuIds) {
             LOG_DEBUG("Read CPU %u CPUID from MIDR_EL1 -> 0x%05x", pair.first, pair.second);
@@ -330,6 +556,11 @@ namespace cpu_utils {
         // update/set known items from MIDR map and topology information. This will override anything read from /proc/cpuinfo
         updateCpuIdsFromTopologyInformation(cpuIds, cpuToCpuIds, cpuToCluster, clusterToCpuIds);
 
+        // only a complete result is worth keeping
+        if (std::none_of(cpuIds.begin(), cpuIds.end(), [](int cpuId) { return cpuId == -1; })) {
+            writeCachedCpuIds(bootId, cpuIds);
+        }
+
         return hardwareName;
     }
 }
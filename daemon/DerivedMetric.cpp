@@ -0,0 +1,232 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "DerivedMetric.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+/** Recursive descent parser, that writes the instructions in postfix order as each term is parsed */
+class DerivedMetricProgram::Compiler {
+public:
+    Compiler(std::string_view expression, DerivedMetricProgram & program) : mExpression(expression), mProgram(program)
+    {
+    }
+
+    bool compile(std::string & error)
+    {
+        if (!parseExpression()) {
+            error = std::move(mError);
+            return false;
+        }
+
+        skipSpace();
+        if (mPosition != mExpression.size()) {
+            error = "unexpected '" + std::string(1, mExpression[mPosition]) + "' at position "
+                  + std::to_string(mPosition);
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+    std::string_view mExpression;
+    DerivedMetricProgram & mProgram;
+    std::size_t mPosition {0};
+    std::size_t mDepth {0};
+    std::string mError {};
+
+    bool fail(const char * message)
+    {
+        mError = std::string(message) + " at position " + std::to_string(mPosition);
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while ((mPosition < mExpression.size())
+               && (std::isspace(static_cast<unsigned char>(mExpression[mPosition])) != 0)) {
+            ++mPosition;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if ((mPosition < mExpression.size()) && (mExpression[mPosition] == c)) {
+            ++mPosition;
+            return true;
+        }
+        return false;
+    }
+
+    bool push(Opcode opcode, std::size_t index)
+    {
+        if (++mDepth > MAX_STACK_DEPTH) {
+            return fail("expression is too deeply nested");
+        }
+        mProgram.mInstructions.push_back({opcode, std::uint32_t(index)});
+        return true;
+    }
+
+    void apply(Opcode opcode)
+    {
+        if (opcode != Opcode::NEGATE) {
+            --mDepth;
+        }
+        mProgram.mInstructions.push_back({opcode, 0});
+    }
+
+    // mExpression := term (('+' | '-') term)*
+    bool parseExpression()
+    {
+        if (!parseTerm()) {
+            return false;
+        }
+
+        while (true) {
+            Opcode opcode;
+            if (consume('+')) {
+                opcode = Opcode::ADD;
+            }
+            else if (consume('-')) {
+                opcode = Opcode::SUBTRACT;
+            }
+            else {
+                return true;
+            }
+
+            if (!parseTerm()) {
+                return false;
+            }
+            apply(opcode);
+        }
+    }
+
+    // term := unary (('*' | '/') unary)*
+    bool parseTerm()
+    {
+        if (!parseUnary()) {
+            return false;
+        }
+
+        while (true) {
+            Opcode opcode;
+            if (consume('*')) {
+                opcode = Opcode::MULTIPLY;
+            }
+            else if (consume('/')) {
+                opcode = Opcode::DIVIDE;
+            }
+            else {
+                return true;
+            }
+
+            if (!parseUnary()) {
+                return false;
+            }
+            apply(opcode);
+        }
+    }
+
+    // unary := '-' unary | primary
+    bool parseUnary()
+    {
+        if (consume('-')) {
+            if (!parseUnary()) {
+                return false;
+            }
+            apply(Opcode::NEGATE);
+            return true;
+        }
+
+        return parsePrimary();
+    }
+
+    // primary := number | '[' counter ']' | '(' mExpression ')'
+    bool parsePrimary()
+    {
+        if (consume('(')) {
+            if (!parseExpression()) {
+                return false;
+            }
+            if (!consume(')')) {
+                return fail("expected ')'");
+            }
+            return true;
+        }
+
+        if (consume('[')) {
+            const auto end = mExpression.find(']', mPosition);
+            if (end == std::string_view::npos) {
+                return fail("expected ']'");
+            }
+
+            std::string name {mExpression.substr(mPosition, end - mPosition)};
+            if (name.empty()) {
+                return fail("expected a counter name");
+            }
+            mPosition = end + 1;
+
+            auto & operands = mProgram.mOperands;
+            const auto it = std::find(operands.begin(), operands.end(), name);
+            const auto index = std::size_t(it - operands.begin());
+            if (it == operands.end()) {
+                operands.emplace_back(std::move(name));
+            }
+
+            return push(Opcode::OPERAND, index);
+        }
+
+        skipSpace();
+        if (mPosition >= mExpression.size()) {
+            return fail("unexpected end of expression");
+        }
+
+        // strtod needs a terminated string
+        const std::string rest {mExpression.substr(mPosition)};
+        char * end = nullptr;
+        const double value = std::strtod(rest.c_str(), &end);
+        if (end == rest.c_str()) {
+            return fail("expected a number, counter or '('");
+        }
+        mPosition += std::size_t(end - rest.c_str());
+
+        mProgram.mConstants.push_back(value);
+        return push(Opcode::CONSTANT, mProgram.mConstants.size() - 1);
+    }
+};
+
+std::optional<DerivedMetricProgram> DerivedMetricProgram::compile(std::string_view expression, std::string & error)
+{
+    DerivedMetricProgram program {};
+
+    if (!Compiler {expression, program}.compile(error)) {
+        return {};
+    }
+
+    program.mExpression = std::string(expression);
+
+    return program;
+}
+
+void DerivedMetrics::add(int key,
+                         std::shared_ptr<const DerivedMetricProgram> program,
+                         lib::Span<const int> operandKeys)
+{
+    Metric metric {key, std::move(program), {operandKeys.begin(), operandKeys.end()}, {}};
+
+    for (const int operandKey : operandKeys) {
+        if (std::size_t(operandKey) >= mSlotByKey.size()) {
+            mSlotByKey.resize(std::size_t(operandKey) + 1, -1);
+        }
+        if (mSlotByKey[operandKey] < 0) {
+            mSlotByKey[operandKey] = int(mNumberOfSlots++);
+        }
+        metric.operandSlots.push_back(std::size_t(mSlotByKey[operandKey]));
+    }
+
+    mMetrics.push_back(std::move(metric));
+}
@@ -0,0 +1,248 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef DERIVED_METRIC_H
+#define DERIVED_METRIC_H
+
+#include "lib/Span.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * An arithmetic expression over counter values, as given by the 'expression' attribute of an event in events.xml.
+ *
+ * The expression may contain numbers, counters written as [counter_name], the operators + - * / (and unary -), and
+ * parentheses. For example "1000 * [ARM_Mali-G78_GPU_ACTIVE] / [ARM_Mali-G78_GPU_CYCLES]".
+ *
+ * It is compiled once into a flat list of stack operations, so that it can be evaluated for every sample without
+ * parsing or allocating.
+ */
+class DerivedMetricProgram {
+public:
+    /** The most values that evaluating an expression may need to hold at once */
+    static constexpr std::size_t MAX_STACK_DEPTH = 16;
+
+    /**
+     * Compile an expression
+     *
+     * @param expression The expression
+     * @param error Set to a description of the problem if the expression is invalid
+     * @return The program, or nothing if the expression is invalid
+     */
+    static std::optional<DerivedMetricProgram> compile(std::string_view expression, std::string & error);
+
+    /** @return The source of the expression, as passed to compile */
+    const std::string & getExpression() const { return mExpression; }
+
+    /** @return The names of the counters used by the expression, which are numbered in this order */
+    const std::vector<std::string> & getOperands() const { return mOperands; }
+
+    /**
+     * Evaluate the expression
+     *
+     * @param getOperand Called with the number of an operand, to get its value
+     * @return The value, or nothing if it is undefined (e.g. a division by zero)
+     */
+    template<typename OperandGetter>
+    std::optional<double> evaluate(OperandGetter && getOperand) const
+    {
+        std::array<double, MAX_STACK_DEPTH> stack;
+        std::size_t depth = 0;
+
+        for (const auto & instruction : mInstructions) {
+            switch (instruction.opcode) {
+                case Opcode::CONSTANT:
+                    stack[depth++] = mConstants[instruction.index];
+                    break;
+                case Opcode::OPERAND:
+                    stack[depth++] = getOperand(std::size_t(instruction.index));
+                    break;
+                case Opcode::NEGATE:
+                    stack[depth - 1] = -stack[depth - 1];
+                    break;
+                case Opcode::ADD:
+                    --depth;
+                    stack[depth - 1] += stack[depth];
+                    break;
+                case Opcode::SUBTRACT:
+                    --depth;
+                    stack[depth - 1] -= stack[depth];
+                    break;
+                case Opcode::MULTIPLY:
+                    --depth;
+                    stack[depth - 1] *= stack[depth];
+                    break;
+                case Opcode::DIVIDE:
+                    --depth;
+                    if (stack[depth] == 0) {
+                        return {};
+                    }
+                    stack[depth - 1] /= stack[depth];
+                    break;
+            }
+        }
+
+        if (!std::isfinite(stack[0])) {
+            return {};
+        }
+
+        return stack[0];
+    }
+
+private:
+    enum class Opcode : std::uint8_t {
+        CONSTANT,
+        OPERAND,
+        NEGATE,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+    };
+
+    struct Instruction {
+        Opcode opcode;
+        /** The index of the constant or operand */
+        std::uint32_t index;
+    };
+
+    class Compiler;
+
+    DerivedMetricProgram() = default;
+
+    std::string mExpression {};
+    std::vector<Instruction> mInstructions {};
+    std::vector<double> mConstants {};
+    std::vector<std::string> mOperands {};
+};
+
+/**
+ * The derived metrics that are enabled for a capture, with their operands resolved to the keys of the counters that
+ * provide them
+ */
+class DerivedMetrics {
+public:
+    struct Metric {
+        int key;
+        std::shared_ptr<const DerivedMetricProgram> program;
+        /** The key of the counter for each operand of the program */
+        std::vector<int> operandKeys;
+        /** The slot that holds the value of each operand of the program */
+        std::vector<std::size_t> operandSlots;
+    };
+
+    /**
+     * Add a metric
+     *
+     * @param key The key of the derived counter
+     * @param program The expression
+     * @param operandKeys The key of the counter for each operand of the expression
+     */
+    void add(int key, std::shared_ptr<const DerivedMetricProgram> program, lib::Span<const int> operandKeys);
+
+    bool empty() const { return mMetrics.empty(); }
+
+    const std::vector<Metric> & getMetrics() const { return mMetrics; }
+
+    std::size_t getNumberOfSlots() const { return mNumberOfSlots; }
+
+    /** @return The slot that holds the value of some counter, or nothing if it is not an operand of any metric */
+    std::optional<std::size_t> findSlot(int key) const
+    {
+        if ((key < 0) || (std::size_t(key) >= mSlotByKey.size()) || (mSlotByKey[key] < 0)) {
+            return {};
+        }
+        return std::size_t(mSlotByKey[key]);
+    }
+
+private:
+    std::vector<Metric> mMetrics {};
+    /** Indexed by key, -1 where the key is not an operand */
+    std::vector<int> mSlotByKey {};
+    std::size_t mNumberOfSlots {0};
+};
+
+/**
+ * Collects the operand values from one block of counter values (i.e. those with the same timestamp, core and tid), then
+ * evaluates the metrics whose operands all had a value in that block
+ */
+class DerivedMetricEvaluator {
+public:
+    explicit DerivedMetricEvaluator(std::shared_ptr<const DerivedMetrics> metrics)
+        : mMetrics(std::move(metrics)),
+          mValues(mMetrics->getNumberOfSlots(), 0),
+          mHasValue(mMetrics->getNumberOfSlots(), false)
+    {
+    }
+
+    /** Record the value of a counter, if it is an operand */
+    void record(int key, std::int64_t value)
+    {
+        if (auto slot = mMetrics->findSlot(key)) {
+            mValues[*slot] = value;
+            mHasValue[*slot] = true;
+            mAnyValue = true;
+        }
+    }
+
+    /**
+     * Evaluate the metrics for the current block, and start a new block
+     *
+     * @param consumer Called with the key and value of each metric, returning false if it could not be written
+     * @return False if the consumer failed, otherwise true
+     */
+    template<typename Consumer>
+    bool evaluate(Consumer && consumer)
+    {
+        if (!mAnyValue) {
+            return true;
+        }
+
+        bool result = true;
+
+        for (const auto & metric : mMetrics->getMetrics()) {
+            const bool complete = std::all_of(metric.operandSlots.begin(),
+                                              metric.operandSlots.end(),
+                                              [this](std::size_t slot) { return bool(mHasValue[slot]); });
+            if (!complete) {
+                continue;
+            }
+
+            const auto value = metric.program->evaluate(
+                [this, &metric](std::size_t operand) { return double(mValues[metric.operandSlots[operand]]); });
+
+            if ((!value) || (*value <= double(std::numeric_limits<std::int64_t>::min()))
+                || (*value >= double(std::numeric_limits<std::int64_t>::max()))) {
+                continue;
+            }
+
+            if (!consumer(metric.key, std::int64_t(std::llround(*value)))) {
+                result = false;
+                break;
+            }
+        }
+
+        std::fill(mHasValue.begin(), mHasValue.end(), false);
+        mAnyValue = false;
+
+        return result;
+    }
+
+private:
+    std::shared_ptr<const DerivedMetrics> mMetrics;
+    std::vector<std::int64_t> mValues;
+    std::vector<bool> mHasValue;
+    bool mAnyValue {false};
+};
+
+#endif // DERIVED_METRIC_H
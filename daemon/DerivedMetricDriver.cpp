@@ -0,0 +1,159 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "DerivedMetricDriver.h"
+
+#include "Counter.h"
+#include "Logging.h"
+#include "xml/EventsXML.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <strings.h>
+
+namespace {
+    class DerivedMetricCounter : public DriverCounter {
+    public:
+        DerivedMetricCounter(DriverCounter * next,
+                             const char * name,
+                             std::shared_ptr<const DerivedMetricProgram> program)
+            : DriverCounter(next, name), mProgram(std::move(program))
+        {
+        }
+
+        // Intentionally unimplemented
+        DerivedMetricCounter(const DerivedMetricCounter &) = delete;
+        DerivedMetricCounter & operator=(const DerivedMetricCounter &) = delete;
+        DerivedMetricCounter(DerivedMetricCounter &&) = delete;
+        DerivedMetricCounter & operator=(DerivedMetricCounter &&) = delete;
+
+        const std::shared_ptr<const DerivedMetricProgram> & getProgram() const { return mProgram; }
+
+    private:
+        std::shared_ptr<const DerivedMetricProgram> mProgram;
+    };
+
+    /** @return True if type is the counter set followed by a slot number, e.g. ARMv8_Cortex_A76_cnt3 */
+    bool isCounterSetSlot(const char * type, const std::string & counterSet)
+    {
+        if (strncasecmp(type, counterSet.c_str(), counterSet.size()) != 0) {
+            return false;
+        }
+        const char * slot = type + counterSet.size();
+        return (*slot != '\0') && (strspn(slot, "0123456789") == strlen(slot));
+    }
+
+    /**
+     * Find the enabled counter for some operand, which is either the name of a counter, or for a counter that is
+     * allocated from a counter set, the name of the counter set and the event, e.g. ARMv8_Cortex_A76_cnt:0x08
+     */
+    const Counter * findEnabledCounter(lib::Span<const Counter> counters, const std::string & operand)
+    {
+        const auto separator = operand.find(':');
+        const std::string name = operand.substr(0, separator);
+        std::optional<std::uint64_t> event {};
+        if (separator != std::string::npos) {
+            event = strtoull(operand.c_str() + separator + 1, nullptr, 0);
+        }
+
+        for (const Counter & counter : counters) {
+            if (!counter.isEnabled()) {
+                continue;
+            }
+            if (!event) {
+                if (strcasecmp(counter.getType(), name.c_str()) == 0) {
+                    return &counter;
+                }
+            }
+            else if (isCounterSetSlot(counter.getType(), name) && counter.getEventCode().isValid()
+                     && (counter.getEventCode().asU64() == *event)) {
+                return &counter;
+            }
+        }
+        return nullptr;
+    }
+}
+
+void DerivedMetricDriver::readEvents(lib::Span<const events_xml::StaticEvent> events)
+{
+    for (const auto & event : events) {
+        if (event.expression == nullptr) {
+            continue;
+        }
+
+        std::string error;
+        auto program = DerivedMetricProgram::compile(event.expression, error);
+        if (!program) {
+            LOG_WARNING("The expression for counter %s is invalid: %s", event.counter, error.c_str());
+            continue;
+        }
+
+        setCounters(new DerivedMetricCounter(getCounters(),
+                                             event.counter,
+                                             std::make_shared<const DerivedMetricProgram>(std::move(*program))));
+    }
+}
+
+DerivedMetricDriver::CaptureMetrics DerivedMetricDriver::createDerivedMetrics(lib::Span<const Counter> counters,
+                                                                             const Driver & primaryDriver) const
+{
+    auto block = std::make_shared<DerivedMetrics>();
+    auto primarySource = std::make_shared<DerivedMetrics>();
+
+    for (DriverCounter * driverCounter = getCounters(); driverCounter != nullptr;
+         driverCounter = driverCounter->getNext()) {
+        if (!driverCounter->isEnabled()) {
+            continue;
+        }
+
+        const auto & program = static_cast<DerivedMetricCounter *>(driverCounter)->getProgram();
+
+        std::vector<int> operandKeys {};
+        std::size_t primarySourceOperands = 0;
+        for (const auto & operand : program->getOperands()) {
+            const Counter * counter = findEnabledCounter(counters, operand);
+            if (counter == nullptr) {
+                LOG_WARNING("Counter %s will not be captured as it uses %s, which is not selected",
+                            driverCounter->getName(),
+                            operand.c_str());
+                break;
+            }
+            // the derived values are not themselves recorded as operands
+            if (counter->getDriver() == this) {
+                LOG_WARNING("Counter %s will not be captured as it uses %s, which is also derived",
+                            driverCounter->getName(),
+                            operand.c_str());
+                break;
+            }
+            if (counter->getDriver() == &primaryDriver) {
+                ++primarySourceOperands;
+            }
+            operandKeys.push_back(counter->getKey());
+        }
+
+        if (operandKeys.size() != program->getOperands().size()) {
+            continue;
+        }
+
+        // the two kinds of counter are computed in different processes, so are never in the same block
+        if ((primarySourceOperands != 0) && (primarySourceOperands != operandKeys.size())) {
+            LOG_WARNING("Counter %s will not be captured as it uses both %s counters and other counters",
+                        driverCounter->getName(),
+                        primaryDriver.getName());
+            continue;
+        }
+
+        auto & metrics = (primarySourceOperands != 0 ? *primarySource : *block);
+        metrics.add(driverCounter->getKey(), program, operandKeys);
+    }
+
+    return {
+        block->empty() ? nullptr : std::move(block),
+        primarySource->empty() ? nullptr : std::move(primarySource),
+    };
+}
@@ -0,0 +1,55 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef DERIVED_METRIC_DRIVER_H
+#define DERIVED_METRIC_DRIVER_H
+
+#include "DerivedMetric.h"
+#include "SimpleDriver.h"
+
+#include <memory>
+
+class Counter;
+
+/**
+ * Provides the counters defined in events.xml by an 'expression' attribute, whose values are computed from the other
+ * counters that are captured in the same block (see DerivedMetricProgram).
+ *
+ * The operands of an expression must all be selected for the capture, and must either all be counters that are written
+ * by a BlockCounterFrameBuilder (the polled counters and the Mali hardware counters), or all be counters of the primary
+ * source. For perf, the metric is computed by the perf agent from the deltas of the counters that are read with each
+ * sample of their group, so the operands should be in the same group as (i.e. on the same PMU as) a sampled counter.
+ *
+ * A perf counter that is allocated from a counter set is named in an expression by the counter set and its event, e.g.
+ * "1000 * [ARMv8_Cortex_A76_cnt:0x08] / [ARMv8_Cortex_A76_ccnt]" for the instructions per thousand cycles.
+ */
+class DerivedMetricDriver : public SimpleDriver {
+public:
+    DerivedMetricDriver() : SimpleDriver("DerivedMetric") {}
+
+    // Intentionally unimplemented
+    DerivedMetricDriver(const DerivedMetricDriver &) = delete;
+    DerivedMetricDriver & operator=(const DerivedMetricDriver &) = delete;
+    DerivedMetricDriver(DerivedMetricDriver &&) = delete;
+    DerivedMetricDriver & operator=(DerivedMetricDriver &&) = delete;
+
+    /** The enabled metrics, split by which counters they are computed from */
+    struct CaptureMetrics {
+        /** The metrics over counters written by a BlockCounterFrameBuilder, or nullptr if there are none */
+        std::shared_ptr<const DerivedMetrics> block;
+        /** The metrics over counters of the primary source, or nullptr if there are none */
+        std::shared_ptr<const DerivedMetrics> primarySource;
+    };
+
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
+
+    /**
+     * Resolve the operands of the enabled metrics against the enabled counters. Call after the counters are set up.
+     *
+     * @param counters All the counters for the capture
+     * @param primaryDriver The driver of the primary source
+     * @return The metrics
+     */
+    CaptureMetrics createDerivedMetrics(lib::Span<const Counter> counters, const Driver & primaryDriver) const;
+};
+
+#endif // DERIVED_METRIC_DRIVER_H
@@ -42,7 +42,7 @@ int64_t DiskIOCounter::read()
     return result << 9;
 }
 
-void DiskIODriver::readEvents(mxml_node_t * const /*unused*/)
+void DiskIODriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
 {
     if (access("/proc/diskstats", R_OK) == 0) {
         setCounters(new DiskIOCounter(getCounters(), "Linux_block_rq_rd", &mReadBytes));
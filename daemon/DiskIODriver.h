@@ -19,7 +19,7 @@ public:
     DiskIODriver(DiskIODriver &&) = delete;
     DiskIODriver & operator=(DiskIODriver &&) = delete;
 
-    void readEvents(mxml_node_t * root) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
     void start() override;
     void read(IBlockCounterFrameBuilder & buffer) override;
 
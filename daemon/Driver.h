@@ -5,6 +5,8 @@
 
 #include "CapturedSpe.h"
 #include "Constant.h"
+#include "lib/Span.h"
+
 #include <mxml.h>
 
 #include <cstdint>
@@ -16,6 +18,10 @@
 class Counter;
 struct SpeConfiguration;
 
+namespace events_xml {
+    struct StaticEvent;
+}
+
 class Driver {
 public:
     /// @param name held by reference, not copied
@@ -42,7 +48,7 @@ public:
     }
 
     // Performs any actions needed for setup or based on eventsXML
-    virtual void readEvents(mxml_node_t * const /*unused*/) {}
+    virtual void readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/) {}
 
     // Emits available counters
     // @return number of counters added
@@ -61,6 +67,10 @@ public:
     virtual void postChildForkInChild() {}
     /// Called in the parent after the gator-child process exits
     virtual void postChildExitInParent() {}
+    /// Called in the parent while it waits for a connection; returns true if it must also be called periodically
+    virtual bool idleInParent() { return false; }
+    /// Changes whenever the state that a forked gator-child inherits from the parent is released or replaced
+    virtual std::uint64_t getChildInheritedStateGeneration() const { return 0; }
     //Any warning messages to be displayed in Streamline post analysis of a capture.
     virtual std::vector<std::string> get_other_warnings() const { return {}; }
 
@@ -68,10 +68,11 @@ Drivers::Drivers(bool systemWide,
     all.push_back(&mCcnDriver);
     all.push_back(&mArmnnDriver);
     all.push_back(&mPerfettoDriver);
+    all.push_back(&mDerivedMetricDriver);
 
-    auto staticEventsXml = events_xml::getStaticTree(mPrimarySourceProvider->getCpuInfo().getClusters(),
-                                                     mPrimarySourceProvider->getDetectedUncorePmus());
+    auto const staticEvents = events_xml::getStaticEvents(mPrimarySourceProvider->getCpuInfo().getClusters(),
+                                                          mPrimarySourceProvider->getDetectedUncorePmus());
     for (Driver * driver : all) {
-        driver->readEvents(staticEventsXml.get());
+        driver->readEvents(staticEvents.getEvents());
     }
 }
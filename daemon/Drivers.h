@@ -5,6 +5,7 @@
 
 #include "AtraceDriver.h"
 #include "CCNDriver.h"
+#include "DerivedMetricDriver.h"
 #include "ExternalDriver.h"
 #include "FtraceDriver.h"
 #include "MidgardDriver.h"
@@ -53,6 +54,8 @@ public:
 
     mali_userspace::MaliHwCntrDriver & getMaliHwCntrs() { return mMaliHwCntrs; }
 
+    DerivedMetricDriver & getDerivedMetricDriver() { return mDerivedMetricDriver; }
+
     lib::Span<Driver * const> getAll() { return all; }
 
     lib::Span<const Driver * const> getAllConst() const { return all; }
@@ -73,6 +76,7 @@ private:
     AtraceDriver mAtraceDriver;
     TtraceDriver mTtraceDriver;
     agents::perfetto::perfetto_driver_t mPerfettoDriver;
+    DerivedMetricDriver mDerivedMetricDriver {};
     std::vector<Driver *> all {};
     std::vector<PolledDriver *> allPolled {};
 };
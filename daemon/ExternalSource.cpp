@@ -40,11 +40,11 @@ static constexpr int MEGABYTE = 1024 * 1024;
 
 class ExternalSourceImpl : public ExternalSource {
 public:
-    ExternalSourceImpl(sem_t & senderSem, Drivers & mDrivers, std::function<uint64_t()> getMonotonicTime)
+    ExternalSourceImpl(lib::ReadySignal senderSignal, Drivers & mDrivers, std::function<uint64_t()> getMonotonicTime)
         : mGetMonotonicTime(std::move(getMonotonicTime)),
           mCommitChecker(gSessionData.mLiveRate),
           mBufferSize(gSessionData.mTotalBufferSize * MEGABYTE),
-          mBuffer(mBufferSize, senderSem),
+          mBuffer(mBufferSize, senderSignal),
 
           mMidgardStartupUds(MALI_GRAPHICS_STARTUP, sizeof(MALI_GRAPHICS_STARTUP)),
           mUtgardStartupUds(MALI_UTGARD_STARTUP, sizeof(MALI_UTGARD_STARTUP)),
@@ -61,6 +61,8 @@ public:
                 LOG_DEBUG("One shot (external)");
                 endSession();
             }
+            // the sender only reads buffers that have signalled
+            mBuffer.flush();
             sem_wait(&mBufferSem);
         }
     }
@@ -440,9 +442,9 @@ private:
     }
 };
 
-std::shared_ptr<ExternalSource> createExternalSource(sem_t & senderSem, Drivers & drivers)
+std::shared_ptr<ExternalSource> createExternalSource(lib::ReadySignal senderSignal, Drivers & drivers)
 {
-    auto source = std::make_shared<ExternalSourceImpl>(senderSem, drivers, &getTime);
+    auto source = std::make_shared<ExternalSourceImpl>(senderSignal, drivers, &getTime);
     if (!source->prepare()) {
         return {};
     }
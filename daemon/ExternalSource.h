@@ -5,11 +5,10 @@
 #include "Source.h"
 #include "agents/ext_source/ext_source_connection.h"
 #include "lib/AutoClosingFd.h"
+#include "lib/ReadyBitmap.h"
 
 #include <memory>
 
-#include <semaphore.h>
-
 class Drivers;
 
 class ExternalSource : public Source {
@@ -19,4 +18,4 @@ public:
 };
 
 /// Counters from external sources like graphics drivers and annotations
-std::shared_ptr<ExternalSource> createExternalSource(sem_t & senderSem, Drivers & drivers);
+std::shared_ptr<ExternalSource> createExternalSource(lib::ReadySignal senderSignal, Drivers & drivers);
@@ -4,6 +4,7 @@
 
 #include "Logging.h"
 #include "lib/Utils.h"
+#include "xml/EventsXML.h"
 
 #include <fcntl.h>
 #include <regex.h>
@@ -112,18 +113,10 @@ FSDriver::FSDriver() : PolledDriver("FS")
 {
 }
 
-void FSDriver::readEvents(mxml_node_t * const xml)
+void FSDriver::readEvents(lib::Span<const events_xml::StaticEvent> events)
 {
-    mxml_node_t * node = xml;
-    while (true) {
-        node = mxmlFindElement(node, xml, "event", nullptr, nullptr, MXML_DESCEND);
-        if (node == nullptr) {
-            break;
-        }
-        const char * counter = mxmlElementGetAttr(node, "counter");
-        if (counter == nullptr) {
-            continue;
-        }
+    for (const auto & event : events) {
+        const char * counter = event.counter;
 
         if (counter[0] == '/') {
             LOG_ERROR("Old style filesystem counter (%s) detected, please create a new unique counter value and "
@@ -136,12 +129,12 @@ void FSDriver::readEvents(mxml_node_t * const xml)
             continue;
         }
 
-        const char * path = mxmlElementGetAttr(node, "path");
+        const char * path = event.path;
         if (path == nullptr) {
             LOG_ERROR("The filesystem counter %s is missing the required path attribute", counter);
             handleException();
         }
-        const char * regex = mxmlElementGetAttr(node, "regex");
+        const char * regex = event.regex;
         setCounters(new FSCounter(getCounters(), counter, strdup(path), regex));
     }
 }
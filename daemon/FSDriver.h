@@ -14,7 +14,7 @@ public:
     FSDriver(FSDriver &&) = delete;
     FSDriver & operator=(FSDriver &&) = delete;
 
-    void readEvents(mxml_node_t * xml) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
 
     int writeCounters(mxml_node_t * root) const override;
 };
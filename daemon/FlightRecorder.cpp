@@ -0,0 +1,357 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "FlightRecorder.h"
+
+#include "BufferUtils.h"
+#include "Logging.h"
+#include "Protocol.h"
+#include "k/perf_event.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <utility>
+
+namespace {
+    constexpr std::size_t LENGTH_SIZE = sizeof(std::uint32_t);
+    constexpr std::uint64_t NS_PER_MS = 1000000;
+
+    /** Read a packed value, returning false if it runs past the end of the data */
+    bool readPacked(lib::Span<const char> data, std::size_t & pos, std::uint64_t & value)
+    {
+        value = 0;
+        for (unsigned shift = 0; pos < data.size(); shift += 7) {
+            const auto byte = static_cast<std::uint8_t>(data[pos++]);
+            if (shift < 64) {
+                value |= std::uint64_t(byte & 0x7f) << shift;
+            }
+            if ((byte & 0x80) == 0) {
+                // the values are packed signed, so sign extend
+                if (((shift + 7) < 64) && ((byte & 0x40) != 0)) {
+                    value |= ~std::uint64_t(0) << (shift + 7);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @return True if the frame only holds data sampled or counted over time, so may be dropped once it is old */
+    bool isWindowed(lib::Span<const char> payload)
+    {
+        if (payload.size() == 0) {
+            return false;
+        }
+
+        // frame types that are packed into more than one byte never match
+        switch (static_cast<FrameType>(payload[0])) {
+            case FrameType::COUNTER:
+            case FrameType::BLOCK_COUNTER:
+            case FrameType::SCHED_TRACE:
+            case FrameType::ACTIVITY_TRACE:
+            case FrameType::PERF_AUX:
+            case FrameType::PERF_AGGREGATE:
+                return true;
+            case FrameType::PERF_ATTRS: {
+                // only the counter values are over time, the rest describe the capture
+                std::size_t pos = 1;
+                std::uint64_t legacyCore;
+                std::uint64_t code;
+                return readPacked(payload, pos, legacyCore) && readPacked(payload, pos, code)
+                    && (code == static_cast<std::uint64_t>(CodeType::COUNTERS));
+            }
+            case FrameType::PERF_DATA:       // split by splitPerfData instead
+            case FrameType::PERF_CALLCHAINS: // interned call stacks are referred to by all the samples after them
+            default:
+                return false;
+        }
+    }
+
+    /** @return True if the perf record describes the processes and mappings that the records after it refer to, so
+     * must be kept for the whole capture, rather than being one of the records ordered in time (samples, switches, aux,
+     * itrace start, lost, throttle and the like) */
+    bool isPinnedRecord(std::uint32_t type)
+    {
+        switch (type) {
+            case PERF_RECORD_MMAP:
+            case PERF_RECORD_MMAP2:
+            case PERF_RECORD_COMM:
+            case PERF_RECORD_FORK:
+            case PERF_RECORD_EXIT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /** Append a PERF_DATA frame holding some records to the data, if there are any */
+    void appendPerfDataFrame(std::vector<char> & data, lib::Span<const char> header, const std::vector<char> & records)
+    {
+        if (records.empty()) {
+            return;
+        }
+
+        char length[LENGTH_SIZE];
+        buffer_utils::writeLEInt(length, header.size() + LENGTH_SIZE + records.size());
+        data.insert(data.end(), length, length + LENGTH_SIZE);
+        data.insert(data.end(), header.begin(), header.end());
+        buffer_utils::writeLEInt(length, records.size());
+        data.insert(data.end(), length, length + LENGTH_SIZE);
+        data.insert(data.end(), records.begin(), records.end());
+    }
+
+    /**
+     * Split the payload of a PERF_DATA frame into a frame of its records that are ordered in time, which may be dropped
+     * once they are old, and a frame of its mmap, mmap2, comm, fork and exit records, which must be kept for the records
+     * after them to be decoded. The payload is the frame type, the packed cpu, the length of the records, then the
+     * records with each of their words packed.
+     *
+     * @return False if the payload could not be parsed, in which case the frame should be kept whole
+     */
+    bool splitPerfData(lib::Span<const char> payload,
+                       std::vector<char> & samples,
+                       std::vector<char> & others,
+                       std::vector<char> & sampleRecords,
+                       std::vector<char> & otherRecords)
+    {
+        std::size_t pos = 1;
+        std::uint64_t value;
+        if (!readPacked(payload, pos, value) || ((payload.size() - pos) < LENGTH_SIZE)) {
+            return false;
+        }
+        const lib::Span<const char> header {payload.data(), pos};
+        const std::size_t length = buffer_utils::readLEInt(&payload[pos]);
+        pos += LENGTH_SIZE;
+        if (length != (payload.size() - pos)) {
+            return false;
+        }
+
+        sampleRecords.clear();
+        otherRecords.clear();
+        while (pos < payload.size()) {
+            const std::size_t start = pos;
+            std::uint64_t recordHeader;
+            if (!readPacked(payload, pos, recordHeader)) {
+                return false;
+            }
+            // the header word is a perf_event_header, so holds the type in the low bits and the size in the top bits
+            const auto type = static_cast<std::uint32_t>(recordHeader);
+            const std::size_t words = std::max<std::size_t>(1, ((recordHeader >> 48) + sizeof(std::uint64_t) - 1)
+                                                                   / sizeof(std::uint64_t));
+            for (std::size_t word = 1; word < words; ++word) {
+                if (!readPacked(payload, pos, value)) {
+                    return false;
+                }
+            }
+
+            auto & records = (isPinnedRecord(type) ? otherRecords : sampleRecords);
+            records.insert(records.end(), payload.begin() + start, payload.begin() + pos);
+        }
+
+        samples.clear();
+        appendPerfDataFrame(samples, header, sampleRecords);
+        appendPerfDataFrame(others, header, otherRecords);
+        return true;
+    }
+}
+
+FlightRecorder::FlightRecorder(std::size_t capacity,
+                               std::uint64_t windowNs,
+                               std::string triggerAnnotation,
+                               std::optional<Threshold> triggerThreshold,
+                               std::function<void()> trigger)
+    : triggerAnnotation(std::move(triggerAnnotation)),
+      triggerThreshold(triggerThreshold),
+      trigger(std::move(trigger)),
+      capacity(capacity),
+      windowNs(windowNs)
+{
+}
+
+void FlightRecorder::add(lib::Span<const lib::Span<const char, int>> dataParts,
+                         ResponseType type,
+                         std::uint64_t timeNs)
+{
+    // only the data that would have been written to the data file is kept
+    if ((type != ResponseType::APC_DATA) && (type != ResponseType::RAW)) {
+        return;
+    }
+
+    std::vector<char> bytes = std::move(spare);
+    bytes.clear();
+
+    if (type != ResponseType::RAW) {
+        int length = 0;
+        for (const auto & data : dataParts) {
+            length += data.size();
+        }
+        char header[LENGTH_SIZE];
+        buffer_utils::writeLEInt(header, length);
+        bytes.insert(bytes.end(), header, header + LENGTH_SIZE);
+    }
+    for (const auto & data : dataParts) {
+        bytes.insert(bytes.end(), data.begin(), data.end());
+    }
+
+    // move the pinned frames out, and close up the windowed frames that are left
+    std::size_t readPos = 0;
+    std::size_t writePos = 0;
+    while (readPos < bytes.size()) {
+        const std::size_t remaining = bytes.size() - readPos;
+        const std::size_t length = (remaining < LENGTH_SIZE) ? 0 : buffer_utils::readLEInt(&bytes[readPos]);
+        if ((remaining < LENGTH_SIZE) || (length > (remaining - LENGTH_SIZE))) {
+            LOG_ERROR("Truncated frame in flight recording (%zu bytes remaining)", remaining);
+            handleException();
+        }
+
+        const std::size_t frameSize = LENGTH_SIZE + length;
+        const lib::Span<const char> payload {&bytes[readPos + LENGTH_SIZE], length};
+        if ((length > 0) && (static_cast<FrameType>(payload[0]) == FrameType::PERF_DATA)
+            && splitPerfData(payload, perfSamples, pinned, perfSampleRecords, perfOtherRecords)) {
+            // the frame of samples is no bigger than the frame it came from, so fits in its place
+            if (!perfSamples.empty()) {
+                std::memcpy(&bytes[writePos], perfSamples.data(), perfSamples.size());
+            }
+            writePos += perfSamples.size();
+        }
+        else if (isWindowed(payload)) {
+            if (isOverThreshold(payload)) {
+                LOG_INFO("Flight recorder triggered by a counter value of at least %" PRId64, triggerThreshold->value);
+                fire();
+            }
+            if (writePos != readPos) {
+                std::memmove(&bytes[writePos], &bytes[readPos], frameSize);
+            }
+            writePos += frameSize;
+        }
+        else {
+            pinned.insert(pinned.end(), bytes.begin() + readPos, bytes.begin() + readPos + frameSize);
+            if (isTriggerAnnotation(payload)) {
+                LOG_INFO("Flight recorder triggered by annotation '%s'", triggerAnnotation.c_str());
+                fire();
+            }
+        }
+        readPos += frameSize;
+    }
+    bytes.resize(writePos);
+
+    if (bytes.empty()) {
+        spare = std::move(bytes);
+    }
+    else {
+        windowBytes += bytes.size();
+        window.push_back(Run {std::move(bytes), timeNs});
+    }
+
+    // drop the oldest windowed frames, reusing the storage of the last one dropped for the next call
+    while (!window.empty()
+           && (((pinned.size() + windowBytes) > capacity) || ((window.front().timeNs + windowNs) < timeNs))) {
+        auto & oldest = window.front();
+        windowBytes -= oldest.bytes.size();
+        droppedBytes += oldest.bytes.size();
+        spare = std::move(oldest.bytes);
+        window.pop_front();
+    }
+
+    // the capture can only be bounded by ending it, once there is nothing left to drop
+    if (pinned.size() > capacity) {
+        if (!triggered) {
+            LOG_WARNING("The flight recording is full of data that cannot be dropped, so the capture is ending. "
+                        "Increase the buffer size to record for longer");
+        }
+        fire();
+    }
+}
+
+bool FlightRecorder::isTriggerAnnotation(lib::Span<const char> payload) const
+{
+    if (triggerAnnotation.empty() || (payload.size() == 0)
+        || (static_cast<FrameType>(payload[0]) != FrameType::EXTERNAL)) {
+        return false;
+    }
+
+    return std::search(payload.begin(), payload.end(), triggerAnnotation.begin(), triggerAnnotation.end())
+        != payload.end();
+}
+
+bool FlightRecorder::isOverThreshold(lib::Span<const char> payload) const
+{
+    if ((!triggerThreshold) || triggered || (payload.size() == 0)) {
+        return false;
+    }
+
+    const auto isOver = [this](std::uint64_t key, std::uint64_t value) {
+        return (static_cast<std::int64_t>(key) == triggerThreshold->key)
+            && (static_cast<std::int64_t>(value) >= triggerThreshold->value);
+    };
+
+    std::size_t pos = 1;
+    std::uint64_t ignored;
+    std::uint64_t core;
+    std::uint64_t key;
+    std::uint64_t value;
+    switch (static_cast<FrameType>(payload[0])) {
+        case FrameType::COUNTER:
+            // time, core, key, value
+            return readPacked(payload, pos, ignored) && readPacked(payload, pos, core) && readPacked(payload, pos, key)
+                && readPacked(payload, pos, value) && isOver(key, value);
+        case FrameType::BLOCK_COUNTER:
+            // core, then key value pairs, where the keys below 3 set the time, thread and core of the values after them
+            if (!readPacked(payload, pos, ignored)) {
+                return false;
+            }
+            while (readPacked(payload, pos, key) && readPacked(payload, pos, value)) {
+                if (isOver(key, value)) {
+                    return true;
+                }
+            }
+            return false;
+        case FrameType::PERF_ATTRS:
+            // legacy core, code (only COUNTERS frames are windowed), time, then core key value triples ending at -1
+            if (!(readPacked(payload, pos, ignored) && readPacked(payload, pos, ignored)
+                  && readPacked(payload, pos, ignored))) {
+                return false;
+            }
+            while (readPacked(payload, pos, core) && (static_cast<std::int64_t>(core) != -1)
+                   && readPacked(payload, pos, key) && readPacked(payload, pos, value)) {
+                if (isOver(key, value)) {
+                    return true;
+                }
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+void FlightRecorder::fire()
+{
+    if (!triggered) {
+        triggered = true;
+        trigger();
+    }
+}
+
+bool FlightRecorder::writeTo(FILE * file) const
+{
+    if (fwrite(pinned.data(), 1, pinned.size(), file) != pinned.size()) {
+        return false;
+    }
+    for (const auto & run : window) {
+        if (fwrite(run.bytes.data(), 1, run.bytes.size(), file) != run.bytes.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FlightRecorder::logStatistics() const
+{
+    const auto windowNsKept = window.empty() ? 0 : (window.back().timeNs - window.front().timeNs);
+    LOG_INFO("Flight recording kept %zu bytes, of which %zu bytes cover the last %" PRIu64
+             "ms, and dropped %" PRIu64 " older bytes",
+             pinned.size() + windowBytes,
+             windowBytes,
+             windowNsKept / NS_PER_MS,
+             droppedBytes);
+}
@@ -0,0 +1,100 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "ISender.h"
+#include "lib/Span.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Keeps the most recent part of a local capture in memory, rather than writing it to the data file as it arrives, so
+ * that gatord can capture continuously in bounded memory and only keep the data from just before some event.
+ *
+ * The data is taken in the format of the data file, as a sequence of frames that are each preceded by their length.
+ * Frames of the types that are sampled or counted over time (counters, perf samples, scheduling, aux data) are kept in
+ * the order they arrive, and the oldest are dropped once they are older than the window, or once everything kept
+ * takes more than the capacity. Every other frame is pinned for the whole capture, as the frames after it cannot be
+ * decoded without it; this includes external data (annotations and the like), which is a byte stream that cannot be
+ * cut at an arbitrary frame. Perf data frames are split, so that only their mmap, mmap2, comm, fork and exit records
+ * are pinned, and every other record (samples, context switches, aux, lost, throttling and the like) is dropped with
+ * the rest of the window.
+ *
+ * This is the opposite of one-shot mode, which keeps the oldest data by ending the capture once the buffers are full.
+ * Here the capture ends when it is triggered, by a signal, an annotation, or a counter value reaching a threshold, and
+ * then the pinned frames followed by the window are written out.
+ */
+class FlightRecorder {
+public:
+    /** A counter value that triggers the recorder */
+    struct Threshold {
+        /** The key of the counter */
+        int key;
+        /** The recorder is triggered once a value of the counter is at least this */
+        std::int64_t value;
+    };
+
+    /**
+     * @param capacity The maximum number of bytes to keep
+     * @param windowNs How long to keep the windowed frames for
+     * @param triggerAnnotation If not empty, the text that triggers the recorder when it is seen in external data
+     * @param triggerThreshold If set, the counter value that triggers the recorder when it is seen in counter frames
+     * @param trigger Called (once) to end the capture when the recorder is triggered, or when it is full of pinned
+     * frames
+     */
+    FlightRecorder(std::size_t capacity,
+                   std::uint64_t windowNs,
+                   std::string triggerAnnotation,
+                   std::optional<Threshold> triggerThreshold,
+                   std::function<void()> trigger);
+
+    /**
+     * Keep some data
+     *
+     * @param dataParts The data, which for RAW is a sequence of frames, and otherwise is one frame
+     * @param type The response type of the data
+     * @param timeNs The monotonic time that the data arrived at, which is soon after it was captured as the sender
+     * passes over every buffer periodically, and perf data is polled at the live rate while the recorder is on
+     */
+    void add(lib::Span<const lib::Span<const char, int>> dataParts, ResponseType type, std::uint64_t timeNs);
+
+    /** Write everything that is kept to the data file, pinned frames first, returning false if that failed */
+    [[nodiscard]] bool writeTo(FILE * file) const;
+
+    /** Log how much was kept and dropped */
+    void logStatistics() const;
+
+private:
+    /** The windowed frames from one call to add */
+    struct Run {
+        std::vector<char> bytes;
+        std::uint64_t timeNs;
+    };
+
+    std::vector<char> pinned {};
+    std::deque<Run> window {};
+    /** The storage of the most recently dropped run, which is reused by the next */
+    std::vector<char> spare {};
+    /** Scratch space for splitting perf data frames */
+    std::vector<char> perfSamples {};
+    std::vector<char> perfSampleRecords {};
+    std::vector<char> perfOtherRecords {};
+    std::string triggerAnnotation;
+    std::optional<Threshold> triggerThreshold;
+    std::function<void()> trigger;
+    std::size_t capacity;
+    std::size_t windowBytes {0};
+    std::uint64_t windowNs;
+    std::uint64_t droppedBytes {0};
+    bool triggered {false};
+
+    void fire();
+    [[nodiscard]] bool isTriggerAnnotation(lib::Span<const char> payload) const;
+    [[nodiscard]] bool isOverThreshold(lib::Span<const char> payload) const;
+};
@@ -12,6 +12,7 @@
 #include "lib/Utils.h"
 #include "linux/Tracepoints.h"
 #include "linux/perf/IPerfAttrsConsumer.h"
+#include "xml/EventsXML.h"
 
 #include <array>
 #include <atomic>
@@ -377,7 +378,7 @@ FtraceDriver::FtraceDriver(const TraceFsConstants & traceFsConstants,
 {
 }
 
-void FtraceDriver::readEvents(mxml_node_t * const xml)
+void FtraceDriver::readEvents(lib::Span<const events_xml::StaticEvent> events)
 {
     // Check the kernel version
     struct utsname utsname;
@@ -413,24 +414,16 @@ void FtraceDriver::readEvents(mxml_node_t * const xml)
 
     mSupported = true;
 
-    mxml_node_t * node = xml;
-    while (true) {
-        node = mxmlFindElement(node, xml, "event", nullptr, nullptr, MXML_DESCEND);
-        if (node == nullptr) {
-            break;
-        }
-        const char * counter = mxmlElementGetAttr(node, "counter");
-        if (counter == nullptr) {
-            continue;
-        }
+    for (const auto & event : events) {
+        const char * counter = event.counter;
 
         if (strncmp(counter, "ftrace_", 7) != 0) {
             continue;
         }
 
-        const char * regex = mxmlElementGetAttr(node, "regex");
-        const char * tracepoint = mxmlElementGetAttr(node, "tracepoint");
-        const char * enable = mxmlElementGetAttr(node, "enable");
+        const char * regex = event.regex;
+        const char * tracepoint = event.tracepoint;
+        const char * enable = event.enable;
         if (enable == nullptr) {
             enable = tracepoint;
         }
@@ -43,7 +43,7 @@ public:
     FtraceDriver(FtraceDriver &&) = delete;
     FtraceDriver & operator=(FtraceDriver &&) = delete;
 
-    void readEvents(mxml_node_t * xml) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
 
     std::pair<std::vector<int>, bool> prepare();
     void start(std::function<void(int, int, std::int64_t)> initialValuesConsumer);
@@ -51,6 +51,13 @@ namespace {
         {"disable-kernel-annotations", no_argument, /***/ nullptr, 'D'}, //
         {"append-events-xml", /******/ required_argument, nullptr, 'E'}, //
         {"spe-sample-rate", /********/ required_argument, nullptr, 'F'}, //
+        {"aggregate-samples", /******/ required_argument, nullptr, 'G'}, //
+        {"spe-filter", /*************/ required_argument, nullptr, 'H'}, //
+        {"intern-call-stacks", /*****/ required_argument, nullptr, 'I'}, //
+        {"warm-standby", /***********/ required_argument, nullptr, 'J'}, //
+        {"hotplug-debounce", /*******/ required_argument, nullptr, 'K'}, //
+        {"multiplex-quantum", /******/ required_argument, nullptr, 'L'}, //
+        {"flight-recorder", /********/ required_argument, nullptr, 'M'}, //
         /********************************************************* 'N' ***/
         {"disable-cpu-onlining", /***/ required_argument, nullptr, 'O'}, //
         {"pmus-xml", /***************/ required_argument, nullptr, 'P'}, //
@@ -58,7 +65,9 @@ namespace {
         {"print", /******************/ required_argument, nullptr, 'R'}, //
         {"system-wide", /************/ required_argument, nullptr, 'S'}, //
         {"trace", /******************/ no_argument, /***/ nullptr, 'T'}, //
+        {"flight-trigger", /*********/ required_argument, nullptr, 'U'}, //
         {"version", /****************/ no_argument, /***/ nullptr, 'V'}, //
+        {"flight-threshold", /*******/ required_argument, nullptr, 'W'}, //
         {"spe", /********************/ required_argument, nullptr, 'X'}, //
         {"mmap-pages", /*************/ required_argument, nullptr, 'Z'}, //
         {nullptr, 0, nullptr, 0}};
@@ -75,6 +84,8 @@ namespace {
     const char * SPE_MIN_LATENCY_KEY = "min_latency";
     const char * SPE_EVENTS_KEY = "events";
     const char * SPE_OPS_KEY = "ops";
+    const char * SPE_MIN_ISSUE_LATENCY_KEY = "min_issue_latency";
+    const char * SPE_MIN_TRANSLATION_LATENCY_KEY = "min_translation_latency";
 }
 
 using ExecutionMode = ParserResult::ExecutionMode;
@@ -302,6 +313,85 @@ void GatorCLIParser::parseAndUpdateSpe()
     }
 }
 
+void GatorCLIParser::parseAndUpdateSpeRecordFilter()
+{
+    std::vector<std::string> filter_data;
+    split(std::string(optarg), SPE_DATA_DELIMITER, filter_data);
+
+    SpeRecordFilterConfiguration data;
+    for (const auto & filter_data_it : filter_data) {
+        std::vector<std::string> filter;
+        split(filter_data_it, SPE_KEY_VALUE_DELIMITER, filter);
+        if (filter.size() != 2) {
+            LOG_ERROR("--spe-filter arguments not in correct format %s ", filter_data_it.c_str());
+            result.parsingFailed();
+            return;
+        }
+
+        if ((filter[0] == SPE_MIN_LATENCY_KEY) || (filter[0] == SPE_MIN_ISSUE_LATENCY_KEY)
+            || (filter[0] == SPE_MIN_TRANSLATION_LATENCY_KEY)) {
+            int & latency = (filter[0] == SPE_MIN_LATENCY_KEY       ? data.min_total_latency
+                             : filter[0] == SPE_MIN_ISSUE_LATENCY_KEY ? data.min_issue_latency
+                                                                      : data.min_translation_latency);
+            if (!stringToInt(&latency, filter[1].c_str(), 0)) {
+                LOG_ERROR("--spe-filter %s not an integer (%s)", filter[0].c_str(), filter[1].c_str());
+                result.parsingFailed();
+                return;
+            }
+            if (latency < 0 || latency >= MIN_LATENCY) {
+                LOG_ERROR("Invalid --spe-filter %s (%d)", filter[0].c_str(), latency);
+                result.parsingFailed();
+                return;
+            }
+        }
+        else if (filter[0] == SPE_EVENTS_KEY) {
+            std::vector<std::string> filter_events;
+            split(filter[1], SPES_KEY_VALUE_DELIMITER, filter_events);
+            for (const std::string & filter_event : filter_events) {
+                int event;
+                if (!stringToInt(&event, filter_event.c_str(), DECIMAL_BASE)) {
+                    LOG_ERROR("Event filter cannot be a non integer , failed for %s ", filter_event.c_str());
+                    result.parsingFailed();
+                    return;
+                }
+                if ((event < 0 || event > MAX_EVENT_BIT_POSITION)) {
+                    LOG_ERROR("Event filter should be a bit position from 0 - 63 , failed for %d ", event);
+                    result.parsingFailed();
+                    return;
+                }
+                data.any_event_mask |= (uint64_t(1) << event);
+            }
+        }
+        else if (filter[0] == SPE_OPS_KEY) {
+            std::vector<std::string> filter_ops;
+            split(filter[1], SPES_KEY_VALUE_DELIMITER, filter_ops);
+            for (const auto & filter_ops_it : filter_ops) {
+                if (strcasecmp(filter_ops_it.c_str(), LOAD_OPS) == 0) {
+                    data.ops.insert(SpeOps::LOAD);
+                }
+                else if (strcasecmp(filter_ops_it.c_str(), STORE_OPS) == 0) {
+                    data.ops.insert(SpeOps::STORE);
+                }
+                else if (strcasecmp(filter_ops_it.c_str(), BRANCH_OPS) == 0) {
+                    data.ops.insert(SpeOps::BRANCH);
+                }
+                else {
+                    LOG_ERROR("Not a valid Ops %s", filter_ops_it.c_str());
+                    result.parsingFailed();
+                    return;
+                }
+            }
+        }
+        else { // invalid key
+            LOG_ERROR("--spe-filter arguments not in correct format %s ", filter_data_it.c_str());
+            result.parsingFailed();
+            return;
+        }
+    }
+
+    result.mSpeRecordFilter = data;
+}
+
 void GatorCLIParser::parseCLIArguments(int argc,
                                        char * argv[],
                                        const char * version_string,
@@ -449,6 +539,74 @@ void GatorCLIParser::parseCLIArguments(int argc,
                 }
                 result.mStopGator = optionInt == 1;
                 break;
+            case 'G': // aggregate-samples
+                if ((!stringToInt(&result.mAggregateSamplesIntervalMs, optarg, 10))
+                    || (result.mAggregateSamplesIntervalMs < 0)) {
+                    LOG_ERROR("Invalid value for --aggregate-samples (%s), interval in milliseconds expected.", optarg);
+                    result.parsingFailed();
+                    return;
+                }
+                break;
+            case 'H': // spe-filter
+                parseAndUpdateSpeRecordFilter();
+                if (result.mode == ExecutionMode::EXIT) {
+                    return;
+                }
+                break;
+            case 'I': // intern-call-stacks
+                if (optionInt < 0) {
+                    LOG_ERROR("Invalid value for --intern-call-stacks (%s), 'yes' or 'no' expected.", optarg);
+                    result.parsingFailed();
+                    return;
+                }
+                result.mInternCallStacks = optionInt == 1;
+                break;
+            case 'J': // warm-standby
+                if (optionInt < 0) {
+                    LOG_ERROR("Invalid value for --warm-standby (%s), 'yes' or 'no' expected.", optarg);
+                    result.parsingFailed();
+                    return;
+                }
+                result.mWarmStandby = optionInt == 1;
+                break;
+            case 'K': // hotplug-debounce
+                if ((!stringToInt(&result.mHotplugDebounceMs, optarg, 10)) || (result.mHotplugDebounceMs < 0)) {
+                    LOG_ERROR("Invalid value for --hotplug-debounce (%s), interval in milliseconds expected.", optarg);
+                    result.parsingFailed();
+                    return;
+                }
+                break;
+            case 'L': // multiplex-quantum
+                if ((!stringToInt(&result.mMultiplexQuantumMs, optarg, 10)) || (result.mMultiplexQuantumMs < 0)) {
+                    LOG_ERROR("Invalid value for --multiplex-quantum (%s), interval in milliseconds expected.", optarg);
+                    result.parsingFailed();
+                    return;
+                }
+                break;
+            case 'M': // flight-recorder
+                if ((!stringToInt(&result.mFlightRecorderSeconds, optarg, 10))
+                    || (result.mFlightRecorderSeconds <= 0)) {
+                    LOG_ERROR("Invalid value for --flight-recorder (%s), number of seconds expected.", optarg);
+                    result.parsingFailed();
+                    return;
+                }
+                break;
+            case 'U': // flight-trigger
+                result.mFlightTrigger = optarg;
+                break;
+            case 'W': { // flight-threshold
+                const auto * const separator = std::strrchr(optarg, '=');
+                long long threshold = 0;
+                if ((separator == nullptr) || (separator == optarg)
+                    || (!stringToLongLong(&threshold, separator + 1, 10))) {
+                    LOG_ERROR("Invalid value for --flight-threshold (%s), <counter>=<value> expected.", optarg);
+                    result.parsingFailed();
+                    return;
+                }
+                result.mFlightThresholdCounter.assign(optarg, separator - optarg);
+                result.mFlightThresholdValue = threshold;
+                break;
+            }
             case 'z':
                 if (optarg != nullptr) {
                     auto args = std::string_view(optarg);
@@ -602,6 +760,47 @@ void GatorCLIParser::parseCLIArguments(int argc,
                     "                                        model's IIDR number  either\n"
                     "                                        fully (e.g., 4832243b) or\n"
                     "                                        partially (e.g., 483_43b).\n"
+                    "  --aggregate-samples <ms>              Count samples on the target per\n"
+                    "                                        process, thread, pc and event in\n"
+                    "                                        intervals of <ms> milliseconds, and\n"
+                    "                                        send only the counts. Requires a version\n"
+                    "                                        of Streamline that understands\n"
+                    "                                        aggregated samples (defaults to '0',\n"
+                    "                                        which sends every sample).\n"
+                    "  --intern-call-stacks (yes|no)         Send each unique call stack once per\n"
+                    "                                        core and refer to it by id in later\n"
+                    "                                        samples. Requires a version of\n"
+                    "                                        Streamline that understands interned\n"
+                    "                                        call stacks (defaults to 'no').\n"
+                    "  --warm-standby (yes|no)               Keep a gator-child process forked while\n"
+                    "                                        waiting for Streamline to connect, with\n"
+                    "                                        its counters set up and its agents\n"
+                    "                                        started, so that the capture starts\n"
+                    "                                        sooner. It is replaced when the\n"
+                    "                                        configuration changes (defaults to\n"
+                    "                                        'no').\n"
+                    "  --hotplug-debounce <ms>               Apply the online/offline changes of each\n"
+                    "                                        core at most once every <ms>\n"
+                    "                                        milliseconds, so that a core that keeps\n"
+                    "                                        going offline and online is not\n"
+                    "                                        reactivated each time (defaults to '0',\n"
+                    "                                        which applies each change immediately).\n"
+                    "  --multiplex-quantum <ms>              When more CPU PMU counters are selected\n"
+                    "                                        than a core has, rotate through them,\n"
+                    "                                        counting each subset for <ms>\n"
+                    "                                        milliseconds, and send their values\n"
+                    "                                        scaled by the time counted. Only\n"
+                    "                                        supported in system-wide mode (defaults\n"
+                    "                                        to '0', which leaves them in one group).\n"
+                    "  --spe-filter <filters>                Filter the SPE records on the target,\n"
+                    "                                        after any hardware filtering, so that\n"
+                    "                                        only the matching records are sent.\n"
+                    "                                        <filters> is a ':' separated list of\n"
+                    "                                        min_latency=<n>, min_issue_latency=<n>,\n"
+                    "                                        min_translation_latency=<n>,\n"
+                    "                                        ops=<ops> (as for --spe) and\n"
+                    "                                        events=<bit>,... where a record is kept\n"
+                    "                                        if it has any of the listed events.\n"
                     "\n"
                     "* Arguments available only on Android targets:\n"
                     "\n"
@@ -646,6 +845,19 @@ void GatorCLIParser::parseCLIArguments(int argc,
                     "                                        apc will be at /data/data/<pkg>/test.apc\n"
                     "                                        and copied to -o path \n"
                     "                                        after capture finished.\n"
+                    "  --flight-recorder <seconds>           Keep capturing, but only keep the last\n"
+                    "                                        <seconds> seconds of the counters and\n"
+                    "                                        samples, in at most the total buffer\n"
+                    "                                        size. They are written out when the\n"
+                    "                                        capture ends, which sending SIGUSR2 to\n"
+                    "                                        gatord, or the --flight-trigger\n"
+                    "                                        annotation, also does.\n"
+                    "  --flight-trigger <text>               End a --flight-recorder capture when an\n"
+                    "                                        annotation containing <text> is seen.\n"
+                    "  --flight-threshold <counter>=<value>  End a --flight-recorder capture when a\n"
+                    "                                        value of <counter> (e.g.\n"
+                    "                                        ARMv8_Cortex_A76_IPC) is at least\n"
+                    "                                        <value>, as it is sent by gatord.\n"
                     "  -i|--pid <pids...>                    Comma separated list of process IDs to\n"
                     "                                        profile\n"
                     "  -C|--counters <counters>              A comma separated list of counters to\n"
@@ -852,6 +1064,23 @@ void GatorCLIParser::parseCLIArguments(int argc,
             result.parsingFailed();
             return;
         }
+        if (result.mFlightRecorderSeconds != 0) {
+            LOG_ERROR("--flight-recorder is not applicable in daemon mode.");
+            result.parsingFailed();
+            return;
+        }
+    }
+
+    if ((result.mFlightTrigger != nullptr) && (result.mFlightRecorderSeconds == 0)) {
+        LOG_ERROR("--flight-recorder must be specified when supplying --flight-trigger.");
+        result.parsingFailed();
+        return;
+    }
+
+    if ((!result.mFlightThresholdCounter.empty()) && (result.mFlightRecorderSeconds == 0)) {
+        LOG_ERROR("--flight-recorder must be specified when supplying --flight-threshold.");
+        result.parsingFailed();
+        return;
     }
 
     if ((result.mAndroidActivity != nullptr) && (result.mAndroidPackage == nullptr)) {
@@ -52,6 +52,7 @@ private:
     void addCounter(int startpos, int pos, std::string & counters);
     int findAndUpdateCmndLineCmnd(int argc, char ** argv);
     void parseAndUpdateSpe();
+    void parseAndUpdateSpeRecordFilter();
 };
 
 #endif /* GATORCLIPARSER_H_ */
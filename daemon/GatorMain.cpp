@@ -120,6 +120,15 @@ void updateSessionData(const ParserResult & result)
     gSessionData.mAllowCommands = result.mAllowCommands;
     gSessionData.parameterSetFlag = result.parameterSetFlag;
     gSessionData.mStopOnExit = result.mStopGator;
+    gSessionData.mInternCallStacks = result.mInternCallStacks;
+    gSessionData.mAggregateSamplesIntervalMs = result.mAggregateSamplesIntervalMs;
+    gSessionData.mHotplugDebounceMs = result.mHotplugDebounceMs;
+    gSessionData.mMultiplexQuantumMs = result.mMultiplexQuantumMs;
+    gSessionData.mFlightRecorderSeconds = result.mFlightRecorderSeconds;
+    gSessionData.mFlightTrigger = result.mFlightTrigger;
+    gSessionData.mFlightThresholdCounter = result.mFlightThresholdCounter;
+    gSessionData.mFlightThresholdValue = result.mFlightThresholdValue;
+    gSessionData.mSpeRecordFilter = result.mSpeRecordFilter;
     gSessionData.mPerfMmapSizeInPages = result.mPerfMmapSizeInPages;
     gSessionData.mSpeSampleRate = result.mSpeSampleRate;
     gSessionData.mAndroidPackage = result.mAndroidPackage;
@@ -284,6 +293,7 @@ int gator_main(int argc, char ** argv)
     (void) signal(SIGABRT, handler);
     (void) signal(SIGHUP, handler);
     (void) signal(SIGUSR1, handler);
+    (void) signal(SIGUSR2, handler);
     gator::process::set_parent_death_signal(SIGKILL);
 
     prctl(PR_SET_NAME, reinterpret_cast<unsigned long>(&"gatord-main"), 0, 0, 0);
@@ -200,7 +200,7 @@ HwmonDriver::~HwmonDriver()
     sensors_cleanup();
 }
 
-void HwmonDriver::readEvents(mxml_node_t * const /*unused*/)
+void HwmonDriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
 {
     int err = sensors_init(nullptr);
     if (err != 0) {
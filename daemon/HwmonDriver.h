@@ -16,7 +16,7 @@ public:
     HwmonDriver(HwmonDriver &&) = delete;
     HwmonDriver & operator=(HwmonDriver &&) = delete;
 
-    void readEvents(mxml_node_t * root) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
 
     void writeEvents(mxml_node_t * root) const override;
 
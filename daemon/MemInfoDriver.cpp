@@ -33,7 +33,7 @@ int64_t MemInfoCounter::read()
     return *mValue;
 }
 
-void MemInfoDriver::readEvents(mxml_node_t * const /*unused*/)
+void MemInfoDriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
 {
     if (access("/proc/meminfo", R_OK) == 0) {
         setCounters(new MemInfoCounter(getCounters(), "Linux_meminfo_memused2", &mMemUsed));
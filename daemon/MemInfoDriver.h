@@ -19,7 +19,7 @@ public:
     MemInfoDriver(MemInfoDriver &&) = delete;
     MemInfoDriver & operator=(MemInfoDriver &&) = delete;
 
-    void readEvents(mxml_node_t * root) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
     void read(IBlockCounterFrameBuilder & buffer) override;
 
 private:
@@ -41,7 +41,7 @@ int64_t NetCounter::read()
     return result;
 }
 
-void NetDriver::readEvents(mxml_node_t * const /*unused*/)
+void NetDriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
 {
     if (access("/proc/net/dev", R_OK) == 0) {
         setCounters(new NetCounter(getCounters(), "Linux_net_rx", &mReceiveBytes));
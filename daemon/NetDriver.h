@@ -19,7 +19,7 @@ public:
     NetDriver(NetDriver &&) = delete;
     NetDriver & operator=(NetDriver &&) = delete;
 
-    void readEvents(mxml_node_t * root) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
     void start() override;
     void read(IBlockCounterFrameBuilder & buffer) override;
 
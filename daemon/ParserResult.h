@@ -7,6 +7,7 @@
 #include "ParserResult.h"
 #include "linux/smmu_identifier.h"
 
+#include <cstdint>
 #include <map>
 #include <optional>
 #include <set>
@@ -33,12 +34,15 @@ public:
     };
 
     std::vector<SpeConfiguration> mSpeConfigs {};
+    SpeRecordFilterConfiguration mSpeRecordFilter {};
     std::vector<std::string> mCaptureCommand {};
     std::set<int> mPids {};
     std::map<std::string, EventCode> events {};
     std::set<Printable> printables {};
+    std::string mFlightThresholdCounter {};
 
     std::uint64_t parameterSetFlag {0};
+    std::int64_t mFlightThresholdValue {0};
 
     ExecutionMode mode {ExecutionMode::DAEMON};
 
@@ -52,6 +56,7 @@ public:
     const char * pmuPath {nullptr};
     const char * mAndroidPackage {nullptr};
     const char * mAndroidActivity {nullptr};
+    const char * mFlightTrigger {nullptr};
     gator::smmuv3::default_identifiers_t smmu_identifiers;
 
     int mBacktraceDepth {0};
@@ -60,6 +65,10 @@ public:
     int mAndroidApiLevel {0};
     int mPerfMmapSizeInPages {-1};
     int mSpeSampleRate {-1};
+    int mAggregateSamplesIntervalMs {0};
+    int mHotplugDebounceMs {0};
+    int mMultiplexQuantumMs {0};
+    int mFlightRecorderSeconds {0};
     int port {DEFAULT_PORT};
 
     bool mFtraceRaw {false};
@@ -69,6 +78,8 @@ public:
     bool mDisableCpuOnlining {false};
     bool mDisableKernelAnnotations {false};
     bool mExcludeKernelEvents {false};
+    bool mInternCallStacks {false};
+    bool mWarmStandby {false};
 
     /**
      * @return - a list of argument-value pairs
@@ -14,6 +14,7 @@
 #include "MemInfoDriver.h"
 #include "NetDriver.h"
 #include "SessionData.h"
+#include "agents/spawn_agent.h"
 #include "lib/FsEntry.h"
 #include "lib/Utils.h"
 #include "xml/PmuXML.h"
@@ -157,6 +158,10 @@ namespace {
 
         [[nodiscard]] bool supportsMultiEbs() const override { return true; }
 
+        [[nodiscard]] std::string_view getAgentProcessId() const override { return agents::agent_id_perf; }
+
+        [[nodiscard]] std::vector<int> getAgentInheritedFds() const override { return driver.getAgentInheritedFds(); }
+
         [[nodiscard]] const char * getPrepareFailedMessage() const override
         {
             return "Unable to communicate with the perf API, please ensure that CONFIG_TRACING and "
@@ -175,7 +180,7 @@ namespace {
         [[nodiscard]] lib::Span<const UncorePmu> getDetectedUncorePmus() const override { return uncorePmus; }
 
         std::shared_ptr<PrimarySource> createPrimarySource(
-            sem_t & senderSem,
+            lib::ReadySignal senderSignal,
             ISender & sender,
             std::function<bool()> session_ended_callback,
             std::function<void()> execTargetAppCallback,
@@ -183,9 +188,10 @@ namespace {
             const std::set<int> & appTids,
             FtraceDriver & ftraceDriver,
             bool enableOnCommandExec,
+            std::shared_ptr<const DerivedMetrics> derivedMetrics,
             agents::agent_workers_process_t<Child> & agent_workers_process) override
         {
-            return driver.create_source(senderSem,
+            return driver.create_source(senderSignal,
                                         sender,
                                         std::move(session_ended_callback),
                                         std::move(execTargetAppCallback),
@@ -193,6 +199,7 @@ namespace {
                                         appTids,
                                         ftraceDriver,
                                         enableOnCommandExec,
+                                        std::move(derivedMetrics),
                                         cpuInfo,
                                         uncorePmus,
                                         agent_workers_process);
@@ -311,7 +318,7 @@ namespace {
         [[nodiscard]] lib::Span<const UncorePmu> getDetectedUncorePmus() const override { return {}; }
 
         std::unique_ptr<PrimarySource> createPrimarySource(
-            sem_t & senderSem,
+            lib::ReadySignal senderSignal,
             ISender & /*sender*/,
             std::function<bool()> /*session_ended_callback*/,
             std::function<void()> execTargetAppCallback,
@@ -319,10 +326,11 @@ namespace {
             const std::set<int> & /*appTids*/,
             FtraceDriver & /*ftraceDriver*/,
             bool /*enableOnCommandExec*/,
+            std::shared_ptr<const DerivedMetrics> /*derivedMetrics*/,
             agents::agent_workers_process_t<Child> & /*agent_workers_process*/) override
         {
             return std::unique_ptr<PrimarySource>(new non_root::NonRootSource(driver,
-                                                                              senderSem,
+                                                                              senderSignal,
                                                                               std::move(execTargetAppCallback),
                                                                               std::move(profilingStartedCallback),
                                                                               cpuInfo));
@@ -365,6 +373,16 @@ const std::vector<PolledDriver *> & PrimarySourceProvider::getAdditionalPolledDr
     return polledDrivers;
 }
 
+std::string_view PrimarySourceProvider::getAgentProcessId() const
+{
+    return {};
+}
+
+std::vector<int> PrimarySourceProvider::getAgentInheritedFds() const
+{
+    return {};
+}
+
 std::unique_ptr<PrimarySourceProvider> PrimarySourceProvider::detect(bool systemWide,
                                                                      const TraceFsConstants & traceFsConstants,
                                                                      PmuXML && pmuXml,
@@ -5,6 +5,7 @@
 
 #include "ISender.h"
 #include "agents/agent_workers_process.h"
+#include "lib/ReadyBitmap.h"
 #include "lib/Span.h"
 #include "linux/perf/PerfEventGroupIdentifier.h"
 
@@ -12,11 +13,11 @@
 #include <functional>
 #include <memory>
 #include <set>
+#include <string_view>
 #include <vector>
 
-#include <semaphore.h>
-
 class Child;
+class DerivedMetrics;
 class Driver;
 class PolledDriver;
 class FtraceDriver;
@@ -70,6 +71,12 @@ public:
     /** Return list of additional polled drivers required for source */
     [[nodiscard]] virtual const std::vector<PolledDriver *> & getAdditionalPolledDrivers() const;
 
+    /** Return the id of the agent process that the primary source captures in, or empty if it runs in gator-child */
+    [[nodiscard]] virtual std::string_view getAgentProcessId() const;
+
+    /** Return the file descriptors that the primary source's agent process must inherit */
+    [[nodiscard]] virtual std::vector<int> getAgentInheritedFds() const;
+
     /** Some driver specific message to show if prepare failed */
     [[nodiscard]] virtual const char * getPrepareFailedMessage() const = 0;
 
@@ -79,9 +86,13 @@ public:
     /** Return the primary driver object */
     [[nodiscard]] virtual Driver & getPrimaryDriver() = 0;
 
-    /** Create the primary Source instance */
+    /**
+     * Create the primary Source instance
+     *
+     * @param derivedMetrics The metrics to compute from the primary source's counters, or nullptr if there are none
+     */
     [[nodiscard]] virtual std::shared_ptr<PrimarySource> createPrimarySource(
-        sem_t & senderSem,
+        lib::ReadySignal senderSignal,
         ISender & sender,
         std::function<bool()> session_ended_callback,
         std::function<void()> execTargetAppCallback,
@@ -89,6 +100,7 @@ public:
         const std::set<int> & appTids,
         FtraceDriver & ftraceDriver,
         bool enableOnCommandExec,
+        std::shared_ptr<const DerivedMetrics> derivedMetrics,
         agents::agent_workers_process_t<Child> & agent_workers_process) = 0;
 
     [[nodiscard]] virtual const ICpuInfo & getCpuInfo() const = 0;
@@ -20,6 +20,8 @@ enum class FrameType : char {
     PERF_SYNC = 15,
     // METADATA = 16,
     // ARMNN = 17, not released
+    PERF_CALLCHAINS = 18,
+    PERF_AGGREGATE = 19,
 };
 
 // PERF_ATTR messages
@@ -14,11 +14,17 @@
 #include <climits>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 
 #include <unistd.h>
 
 Sender::Sender(OlySocket * socket)
-    : mDataSocket(socket), mDataFile(nullptr, fclose), mDataFileName(nullptr), mSendMutex()
+    : mDataSocket(socket),
+      mDataFile(nullptr, fclose),
+      mDataFileName(nullptr),
+      mSendMutex(),
+      mQos(socket != nullptr ? socket->getFd() : -1, gSessionData.mApcQos, gSessionData.mSpeRecordFilter),
+      mFlightRecorder()
 {
     // Set up the socket connection
     if (socket != nullptr) {
@@ -74,6 +80,39 @@ void Sender::createDataFile(const char * apcDir)
     }
 }
 
+void Sender::startFlightRecorder(std::unique_ptr<FlightRecorder> recorder)
+{
+    if (pthread_mutex_lock(&mSendMutex) != 0) {
+        LOG_ERROR("pthread_mutex_lock failed");
+        handleException();
+    }
+    mFlightRecorder = std::move(recorder);
+    if (pthread_mutex_unlock(&mSendMutex) != 0) {
+        LOG_ERROR("pthread_mutex_unlock failed");
+        handleException();
+    }
+}
+
+void Sender::stopFlightRecorder()
+{
+    if (pthread_mutex_lock(&mSendMutex) != 0) {
+        LOG_ERROR("pthread_mutex_lock failed");
+        handleException();
+    }
+    if (mFlightRecorder && mDataFile) {
+        mFlightRecorder->logStatistics();
+        if (!mFlightRecorder->writeTo(mDataFile.get())) {
+            LOG_ERROR("Failed writing binary file %s", mDataFileName.get());
+            handleException();
+        }
+    }
+    mFlightRecorder.reset();
+    if (pthread_mutex_unlock(&mSendMutex) != 0) {
+        LOG_ERROR("pthread_mutex_unlock failed");
+        handleException();
+    }
+}
+
 void Sender::writeDataParts(lib::Span<const lib::Span<const char, int>> dataParts,
                             ResponseType type,
                             bool ignoreLockErrors)
@@ -97,6 +136,10 @@ void Sender::writeDataParts(lib::Span<const lib::Span<const char, int>> dataPart
         handleException();
     }
 
+    if (!mQos.shouldSend(dataParts, type)) {
+        return;
+    }
+
     // Multiple threads call writeData()
     if (pthread_mutex_lock(&mSendMutex) != 0) {
         if (ignoreLockErrors) {
@@ -152,8 +195,12 @@ void Sender::writeDataParts(lib::Span<const lib::Span<const char, int>> dataPart
         LOG_DEBUG("Sender bandwidth %lluB/s", static_cast<unsigned long long>(bandwidth));
     }
 
+    // Keep the newest data in memory, until the flight recorder is triggered
+    if (mFlightRecorder) {
+        mFlightRecorder->add(dataParts, type, getTime());
+    }
     // Write data to disk as long as it is not meta data
-    if (mDataFile && (type == ResponseType::APC_DATA || type == ResponseType::RAW)) {
+    else if (mDataFile && (type == ResponseType::APC_DATA || type == ResponseType::RAW)) {
         LOG_DEBUG("Writing data with length %d", length);
         // Send data to the data file
         auto writeData = [this](lib::Span<const char, int> data) {
@@ -3,6 +3,8 @@
 #ifndef __SENDER_H__
 #define __SENDER_H__
 
+#include "ApcQos.h"
+#include "FlightRecorder.h"
 #include "ISender.h"
 
 #include <cstdio>
@@ -28,11 +30,25 @@ public:
                         bool ignoreLockErrors = false) override;
     void createDataFile(const char * apcDir);
 
+    /** Keep the data that would be written to the data file in a flight recorder instead */
+    void startFlightRecorder(std::unique_ptr<FlightRecorder> recorder);
+
+    /** Write what the flight recorder kept to the data file, and write the data file directly from then on */
+    void stopFlightRecorder();
+
+    /** @return True if a buffered bulk source should not be written yet, to leave the link for other data */
+    [[nodiscard]] bool shouldDeferBulk() { return mQos.shouldDeferBulk(); }
+
+    /** Log how much bulk data was deferred or shed */
+    void logQosStatistics() const { mQos.logStatistics(); }
+
 private:
     OlySocket * mDataSocket;
     std::unique_ptr<FILE, int (*)(FILE *)> mDataFile;
     std::unique_ptr<char[]> mDataFileName;
     pthread_mutex_t mSendMutex;
+    ApcQos mQos;
+    std::unique_ptr<FlightRecorder> mFlightRecorder;
 };
 
 #endif //__SENDER_H__
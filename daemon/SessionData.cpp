@@ -31,6 +31,7 @@ SessionData gSessionData;
 void SessionData::initialize()
 {
     mSharedData = shared_memory::make_unique<SharedData>();
+    mXmlResponseCache = shared_memory::make_unique<XmlResponseCache>();
     mWaitingOnCommand = false;
     mLocalCapture = false;
     mOneShot = false;
@@ -9,6 +9,7 @@
 #include "Counter.h"
 #include "GatorCLIFlags.h"
 #include "Time.h"
+#include "XmlResponseCache.h"
 #include "lib/SharedMemory.h"
 #include "linux/smmu_identifier.h"
 #include <mxml.h>
@@ -57,6 +58,7 @@ public:
     void parseSessionXML(char * xmlString);
 
     shared_memory::unique_ptr<SharedData> mSharedData {};
+    shared_memory::unique_ptr<XmlResponseCache> mXmlResponseCache {};
 
     std::list<std::string> mImages {};
     std::vector<std::string> mCaptureCommand {};
@@ -86,6 +88,19 @@ public:
     int mAnnotateStart {0};
     int mPerfMmapSizeInPages {0};
     int mSpeSampleRate {-1};
+    // when non-zero, samples are aggregated on target into histograms of this many milliseconds
+    int mAggregateSamplesIntervalMs {0};
+    // when non-zero, the online/offline changes for each core are applied at most once per this many milliseconds
+    int mHotplugDebounceMs {0};
+    // when non-zero, oversubscribed cpu pmu counters are rotated through, each subset counting for this many milliseconds
+    int mMultiplexQuantumMs {0};
+    // when non-zero, a local capture only keeps (in memory) the last this many seconds, until it is triggered
+    int mFlightRecorderSeconds {0};
+    // when set, the flight recorder is triggered by an annotation containing this text
+    const char * mFlightTrigger {nullptr};
+    // when not empty, the flight recorder is triggered once a value of this counter is at least mFlightThresholdValue
+    std::string mFlightThresholdCounter {};
+    std::int64_t mFlightThresholdValue {0};
     bool mStopOnExit {false};
     bool mWaitingOnCommand {false};
     bool mLocalCapture {false};
@@ -96,6 +111,14 @@ public:
     bool mFtraceRaw {false};
     bool mSystemWide {false};
     bool mExcludeKernelEvents {false};
+    // send each unique perf callchain once, referring to it by id thereafter
+    bool mInternCallStacks {false};
+
+    // records that fail these filters are dropped from the SPE aux data before it is sent
+    SpeRecordFilterConfiguration mSpeRecordFilter {};
+
+    // the share of the link kept for control and counter data, and what happens to bulk data when it is congested
+    ApcQosConfiguration mApcQos {};
 
     gator::smmuv3::default_identifiers_t smmu_identifiers;
 
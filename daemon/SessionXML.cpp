@@ -28,6 +28,11 @@ namespace {
     constexpr const char * ATTR_STOP_GATOR = "stop_gator";
     constexpr const char * ATTR_CAPTURE_USER = "capture_user";
     constexpr const char * ATTR_EXCLUDE_KERNEL_EVENTS = "exclude_kernel_events";
+    constexpr const char * ATTR_BULK_DATA_POLICY = "bulk_data_policy";
+    constexpr const char * ATTR_BULK_DATA_DOWNSAMPLE = "bulk_data_downsample";
+    constexpr const char * ATTR_RESERVED_BANDWIDTH = "reserved_bandwidth";
+
+    constexpr int MAX_RESERVED_BANDWIDTH_PERCENT = 90;
 }
 
 SessionXML::SessionXML(const char * str) : mSessionXML(str)
@@ -133,6 +138,7 @@ void SessionXML::sessionTag(mxml_node_t * tree, mxml_node_t * node)
     if ((gSessionData.parameterSetFlag & USE_CMDLINE_ARG_EXCLUDE_KERNEL) == 0) {
         gSessionData.mExcludeKernelEvents = stringToBool(mxmlElementGetAttr(node, ATTR_EXCLUDE_KERNEL_EVENTS), false);
     }
+    sessionApcQos(node);
 
     // parse subtags
     node = mxmlGetFirstChild(node);
@@ -148,6 +154,48 @@ void SessionXML::sessionTag(mxml_node_t * tree, mxml_node_t * node)
     }
 }
 
+void SessionXML::sessionApcQos(mxml_node_t * node)
+{
+    auto & qos = gSessionData.mApcQos;
+
+    const char * const policy = mxmlElementGetAttr(node, ATTR_BULK_DATA_POLICY);
+    if (policy != nullptr) {
+        if (strcmp(policy, "block") == 0) {
+            qos.bulk_policy = ApcBulkPolicy::BLOCK;
+        }
+        else if (strcmp(policy, "defer") == 0) {
+            qos.bulk_policy = ApcBulkPolicy::DEFER;
+        }
+        else if (strcmp(policy, "drop") == 0) {
+            qos.bulk_policy = ApcBulkPolicy::DROP;
+        }
+        else if (strcmp(policy, "downsample") == 0) {
+            qos.bulk_policy = ApcBulkPolicy::DOWNSAMPLE;
+        }
+        else {
+            LOG_ERROR("Invalid session.xml bulk_data_policy must be one of block, defer, drop or downsample");
+            handleException();
+        }
+    }
+
+    if (mxmlElementGetAttr(node, ATTR_BULK_DATA_DOWNSAMPLE) != nullptr) {
+        if (!stringToInt(&qos.downsample_ratio, mxmlElementGetAttr(node, ATTR_BULK_DATA_DOWNSAMPLE), 10)
+            || (qos.downsample_ratio < 1)) {
+            LOG_ERROR("Invalid session.xml bulk_data_downsample must be a positive integer");
+            handleException();
+        }
+    }
+
+    if (mxmlElementGetAttr(node, ATTR_RESERVED_BANDWIDTH) != nullptr) {
+        if (!stringToInt(&qos.reserved_percent, mxmlElementGetAttr(node, ATTR_RESERVED_BANDWIDTH), 10)
+            || (qos.reserved_percent < 0) || (qos.reserved_percent > MAX_RESERVED_BANDWIDTH_PERCENT)) {
+            LOG_ERROR("Invalid session.xml reserved_bandwidth must be a percentage between 0 and %d",
+                      MAX_RESERVED_BANDWIDTH_PERCENT);
+            handleException();
+        }
+    }
+}
+
 void SessionXML::sessionImage(mxml_node_t * node)
 {
     gSessionData.mImages.emplace_back(mxmlElementGetAttr(node, ATTR_PATH));
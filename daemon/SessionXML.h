@@ -41,6 +41,7 @@ private:
     const char * mSessionXML;
 
     static void sessionImage(mxml_node_t * node);
+    static void sessionApcQos(mxml_node_t * node);
 
     void sessionTag(mxml_node_t * tree, mxml_node_t * node);
 };
@@ -15,9 +15,11 @@
 #include "OlyUtility.h"
 #include "Sender.h"
 #include "SessionData.h"
+#include "XmlResponseCache.h"
 #include "lib/Syscall.h"
 #include "xml/CurrentConfigXML.h"
 #include "xml/EventsXML.h"
+#include "xml/PmuXML.h"
 
 static const char TAG_SESSION[] = "session";
 static const char TAG_REQUEST[] = "request";
@@ -92,24 +94,15 @@ IStreamlineCommandHandler::State StreamlineSetup::handleRequest(char * xml)
         attr = mxmlElementGetAttr(node, ATTR_TYPE);
     }
     if ((attr != nullptr) && strcmp(attr, VALUE_EVENTS) == 0) {
-        const auto xml = events_xml::getDynamicXML(mDrivers.getAllConst(),
-                                                   mDrivers.getPrimarySourceProvider().getCpuInfo().getClusters(),
-                                                   mDrivers.getPrimarySourceProvider().getDetectedUncorePmus());
-        sendString(xml.get(), ResponseType::XML);
+        sendCachedXml(XmlResponseCache::Type::EVENTS);
         LOG_DEBUG("Sent events xml response");
     }
     else if ((attr != nullptr) && strcmp(attr, VALUE_CONFIGURATION) == 0) {
-        const auto & xml =
-            configuration_xml::getConfigurationXML(mDrivers.getPrimarySourceProvider().getCpuInfo().getClusters());
-        sendString(xml.raw.get(), ResponseType::XML);
+        sendCachedXml(XmlResponseCache::Type::CONFIGURATION);
         LOG_DEBUG("Sent configuration xml response");
     }
     else if ((attr != nullptr) && strcmp(attr, VALUE_COUNTERS) == 0) {
-        const auto xml = counters_xml::getXML(mDrivers.getPrimarySourceProvider().supportsMultiEbs(),
-                                              mDrivers.getAllConst(),
-                                              mDrivers.getPrimarySourceProvider().getCpuInfo(),
-                                              log_setup_supplier);
-        sendString(xml.get(), ResponseType::XML);
+        sendCachedXml(XmlResponseCache::Type::COUNTERS);
         LOG_DEBUG("Sent counters xml response");
     }
     else if ((attr != nullptr) && strcmp(attr, VALUE_CAPTURED) == 0) {
@@ -187,6 +180,117 @@ void StreamlineSetup::sendData(const char * data, uint32_t length, ResponseType
     mSocket.send(data, length);
 }
 
+std::uint64_t StreamlineSetup::getCacheKey(XmlResponseCache::Type type,
+                                           Drivers & drivers,
+                                           const logging::log_setup_supplier_t & log_setup_supplier)
+{
+    auto & primarySourceProvider = drivers.getPrimarySourceProvider();
+    const auto & cpuInfo = primarySourceProvider.getCpuInfo();
+
+    // The cpu and cluster ids change on hotplug, so they are included for all the responses
+    XmlResponseCache::Key key;
+    key.add(std::uint64_t(type)).add(cpuInfo.getCpuIds()).add(cpuInfo.getClusterIds());
+    for (const auto & cluster : cpuInfo.getClusters()) {
+        key.add(cluster.getId()).add(cluster.getCoreName());
+    }
+    for (const auto & uncore : primarySourceProvider.getDetectedUncorePmus()) {
+        key.add(uncore.getId()).add(uncore.getDeviceInstance());
+    }
+
+    switch (type) {
+        case XmlResponseCache::Type::EVENTS:
+            key.addFile(gSessionData.mEventsXMLPath).addFile(gSessionData.mEventsXMLAppend);
+            break;
+        case XmlResponseCache::Type::COUNTERS:
+            key.add(std::uint64_t(primarySourceProvider.supportsMultiEbs())).add(log_setup_supplier());
+            for (const auto * driver : drivers.getAllConst()) {
+                for (const auto & warning : driver->get_other_warnings()) {
+                    key.add(std::string_view(warning));
+                }
+            }
+            break;
+        case XmlResponseCache::Type::CONFIGURATION: {
+            char path[PATH_MAX];
+            configuration_xml::getPath(path, sizeof(path));
+            key.addFile(path);
+            break;
+        }
+        case XmlResponseCache::Type::COUNT:
+        default:
+            break;
+    }
+
+    return key.get();
+}
+
+std::unique_ptr<char, void (*)(void *)> StreamlineSetup::buildXml(
+    XmlResponseCache::Type type,
+    Drivers & drivers,
+    const logging::log_setup_supplier_t & log_setup_supplier)
+{
+    auto & primarySourceProvider = drivers.getPrimarySourceProvider();
+
+    switch (type) {
+        case XmlResponseCache::Type::EVENTS:
+            return events_xml::getDynamicXML(drivers.getAllConst(),
+                                             primarySourceProvider.getCpuInfo().getClusters(),
+                                             primarySourceProvider.getDetectedUncorePmus());
+        case XmlResponseCache::Type::CONFIGURATION:
+            return configuration_xml::getConfigurationXML(primarySourceProvider.getCpuInfo().getClusters()).raw;
+        case XmlResponseCache::Type::COUNTERS:
+            return counters_xml::getXML(primarySourceProvider.supportsMultiEbs(),
+                                        drivers.getAllConst(),
+                                        primarySourceProvider.getCpuInfo(),
+                                        log_setup_supplier);
+        case XmlResponseCache::Type::COUNT:
+        default:
+            break;
+    }
+
+    return {nullptr, free};
+}
+
+void StreamlineSetup::prepareXmlResponses(Drivers & drivers, const logging::log_setup_supplier_t & log_setup_supplier)
+{
+    auto * const cache = gSessionData.mXmlResponseCache.get();
+    if (cache == nullptr) {
+        return;
+    }
+
+    std::string response;
+    for (auto type :
+         {XmlResponseCache::Type::EVENTS, XmlResponseCache::Type::CONFIGURATION, XmlResponseCache::Type::COUNTERS}) {
+        const auto key = getCacheKey(type, drivers, log_setup_supplier);
+        if (!cache->find(type, key, response)) {
+            const auto xml = buildXml(type, drivers, log_setup_supplier);
+            cache->store(type, key, xml.get());
+        }
+    }
+}
+
+void StreamlineSetup::sendCachedXml(XmlResponseCache::Type type)
+{
+    auto * const cache = gSessionData.mXmlResponseCache.get();
+    if (cache == nullptr) {
+        const auto xml = buildXml(type, mDrivers, log_setup_supplier);
+        sendString(xml.get(), ResponseType::XML);
+        return;
+    }
+
+    const auto key = getCacheKey(type, mDrivers, log_setup_supplier);
+
+    std::string response;
+    if (cache->find(type, key, response)) {
+        LOG_DEBUG("Using cached xml response");
+        sendString(response, ResponseType::XML);
+        return;
+    }
+
+    const auto xml = buildXml(type, mDrivers, log_setup_supplier);
+    cache->store(type, key, xml.get());
+    sendString(xml.get(), ResponseType::XML);
+}
+
 void StreamlineSetup::sendDefaults()
 {
     // Send the config built into the binary
@@ -214,6 +318,11 @@ void StreamlineSetup::writeConfiguration(char * xml)
         handleException();
     }
 
+    // Anything generated from the previous configuration is now stale
+    if (gSessionData.mXmlResponseCache) {
+        gSessionData.mXmlResponseCache->invalidate();
+    }
+
     // Re-populate gSessionData with the configuration, as it has now changed
     auto checkError = [](const std::string & error) {
         if (!error.empty()) {
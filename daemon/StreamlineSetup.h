@@ -5,11 +5,13 @@
 
 #include "ISender.h"
 #include "StreamlineSetupLoop.h"
+#include "XmlResponseCache.h"
 #include "lib/Span.h"
 #include "logging/suppliers.h"
 
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <string>
 
 class OlySocket;
@@ -24,6 +26,12 @@ public:
                     lib::Span<const CapturedSpe> capturedSpes,
                     logging::log_setup_supplier_t log_setup_supplier);
 
+    /**
+     * Build and cache the XML responses that do not depend on the connection (events, configuration and counters),
+     * so that they are ready when Streamline requests them
+     */
+    static void prepareXmlResponses(Drivers & drivers, const logging::log_setup_supplier_t & log_setup_supplier);
+
     // Intentionally unimplemented
     StreamlineSetup(const StreamlineSetup &) = delete;
     StreamlineSetup & operator=(const StreamlineSetup &) = delete;
@@ -49,6 +57,17 @@ private:
     void sendString(const char * string, ResponseType type) { sendData(string, strlen(string), type); }
     void sendString(std::string & string, ResponseType type) { sendData(string.c_str(), string.size(), type); }
     void sendDefaults();
+
+    /** Hash the inputs that the response of this type is generated from */
+    static std::uint64_t getCacheKey(XmlResponseCache::Type type,
+                                     Drivers & drivers,
+                                     const logging::log_setup_supplier_t & log_setup_supplier);
+    /** Build the response of this type */
+    static std::unique_ptr<char, void (*)(void *)> buildXml(XmlResponseCache::Type type,
+                                                           Drivers & drivers,
+                                                           const logging::log_setup_supplier_t & log_setup_supplier);
+    /** Send the cached response of this type if it is still current, otherwise build, cache and send it */
+    void sendCachedXml(XmlResponseCache::Type type);
     void writeConfiguration(char * xml);
 };
 
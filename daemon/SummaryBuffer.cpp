@@ -10,7 +10,7 @@
 
 #include <cstring>
 
-SummaryBuffer::SummaryBuffer(const int size, sem_t & readerSem) : buffer(size, readerSem)
+SummaryBuffer::SummaryBuffer(const int size, lib::ReadySignal readerSignal) : buffer(size, readerSignal)
 {
     // fresh buffer will always have room for header
     // so no need to check space
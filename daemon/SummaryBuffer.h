@@ -8,7 +8,7 @@
 
 class SummaryBuffer : public ISummaryConsumer {
 public:
-    SummaryBuffer(int size, sem_t & readerSem);
+    SummaryBuffer(int size, lib::ReadySignal readerSignal);
 
     void write(ISender & sender);
 
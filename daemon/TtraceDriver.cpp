@@ -5,6 +5,7 @@
 #include "FtraceDriver.h"
 #include "Logging.h"
 #include "OlyUtility.h"
+#include "xml/EventsXML.h"
 
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -37,7 +38,7 @@ TtraceDriver::TtraceDriver(const FtraceDriver & ftraceDriver)
 {
 }
 
-void TtraceDriver::readEvents(mxml_node_t * const xml)
+void TtraceDriver::readEvents(lib::Span<const events_xml::StaticEvent> events)
 {
     if (access("/etc/tizen-release", R_OK) != 0) {
         // Reduce warning noise
@@ -51,22 +52,14 @@ void TtraceDriver::readEvents(mxml_node_t * const xml)
 
     mSupported = true;
 
-    mxml_node_t * node = xml;
-    while (true) {
-        node = mxmlFindElement(node, xml, "event", nullptr, nullptr, MXML_DESCEND);
-        if (node == nullptr) {
-            break;
-        }
-        const char * counter = mxmlElementGetAttr(node, "counter");
-        if (counter == nullptr) {
-            continue;
-        }
+    for (const auto & event : events) {
+        const char * counter = event.counter;
 
         if (strncmp(counter, "ttrace_", 7) != 0) {
             continue;
         }
 
-        const char * flagStr = mxmlElementGetAttr(node, "flag");
+        const char * flagStr = event.flag;
         if (flagStr == nullptr) {
             LOG_ERROR("The ttrace counter %s is missing the required flag attribute", counter);
             handleException();
@@ -17,7 +17,7 @@ public:
     TtraceDriver(TtraceDriver &&) = delete;
     TtraceDriver & operator=(TtraceDriver &&) = delete;
 
-    void readEvents(mxml_node_t * xml) override;
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
 
     void start();
     void stop();
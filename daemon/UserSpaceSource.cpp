@@ -1,4 +1,4 @@
-/* Copyright (C) 2010-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2010-2023 by Arm Limited. All rights reserved. */
 
 #define __STDC_FORMAT_MACROS
 #define BUFFER_USE_SESSION_DATA
@@ -16,6 +16,7 @@
 #include "SessionData.h"
 #include "Source.h"
 #include "lib/Memory.h"
+#include "lib/PeriodicScheduler.h"
 #include "lib/Span.h"
 
 #include <atomic>
@@ -23,12 +24,15 @@
 #include <utility>
 
 #include <sys/prctl.h>
-#include <unistd.h>
 
 class UserSpaceSource : public Source {
 public:
-    UserSpaceSource(sem_t & senderSem, lib::Span<PolledDriver * const> drivers)
-        : mBuffer(gSessionData.mTotalBufferSize * 1024 * 1024, senderSem), mDrivers(drivers)
+    UserSpaceSource(lib::ReadySignal senderSignal,
+                    lib::Span<PolledDriver * const> drivers,
+                    std::shared_ptr<const DerivedMetrics> derivedMetrics)
+        : mBuffer(gSessionData.mTotalBufferSize * 1024 * 1024, senderSignal),
+          mDrivers(drivers),
+          mDerivedMetrics(std::move(derivedMetrics))
     {
     }
 
@@ -45,22 +49,20 @@ public:
             }
         }
 
-        uint64_t nextTime = 0;
-        while (mSessionIsActive) {
-            const uint64_t currTime = getTime() - monotonicStart;
-            // Sample ten times a second ignoring gSessionData.mSampleRate
-            nextTime += NS_PER_S / 10; //gSessionData.mSampleRate;
-            if (nextTime < currTime) {
-                LOG_DEBUG("Too slow, currTime: %" PRIi64 " nextTime: %" PRIi64, currTime, nextTime);
-                nextTime = currTime;
+        // Sample ten times a second ignoring gSessionData.mSampleRate, at multiples of 100ms from the capture start so
+        // that the samples are evenly spaced even if some are late
+        mScheduler.addTask(NS_PER_S / 10, [&](std::uint64_t currTime, std::uint64_t missedTicks) {
+            if (missedTicks > 0) {
+                LOG_DEBUG("Too slow, missed %" PRIu64 " samples before %" PRIu64, missedTicks, currTime);
             }
 
-            BlockCounterFrameBuilder builder {mBuffer, gSessionData.mLiveRate};
+            BlockCounterFrameBuilder builder {mBuffer, gSessionData.mLiveRate, mDerivedMetrics};
             if (builder.eventHeader(currTime)) {
                 for (PolledDriver * usDriver : allUserspaceDrivers) {
                     usDriver->read(builder);
                 }
-                // Only check after writing all counters so that time and corresponding counters appear in the same frame
+                // Only check after writing all counters so that time and corresponding counters appear in the same
+                // frame
                 builder.check(currTime);
             }
 
@@ -68,21 +70,27 @@ public:
                 LOG_DEBUG("One shot (counters)");
                 endSession();
             }
+        });
 
-            usleep((nextTime - currTime) / NS_PER_US);
-        }
+        mScheduler.run(monotonicStart);
 
         mBuffer.setDone();
     }
 
-    void interrupt() override { mSessionIsActive = false; }
+    void interrupt() override
+    {
+        mSessionIsActive = false;
+        mScheduler.stop();
+    }
 
     bool write(ISender & sender) override { return mBuffer.write(sender); }
 
 private:
     Buffer mBuffer;
     lib::Span<PolledDriver * const> mDrivers;
+    std::shared_ptr<const DerivedMetrics> mDerivedMetrics;
     std::atomic_bool mSessionIsActive {true};
+    lib::PeriodicScheduler mScheduler {};
 };
 
 bool shouldStartUserSpaceSource(lib::Span<const PolledDriver * const> drivers)
@@ -95,7 +103,9 @@ bool shouldStartUserSpaceSource(lib::Span<const PolledDriver * const> drivers)
     return false;
 }
 
-std::shared_ptr<Source> createUserSpaceSource(sem_t & senderSem, lib::Span<PolledDriver * const> drivers)
+std::shared_ptr<Source> createUserSpaceSource(lib::ReadySignal senderSignal,
+                                              lib::Span<PolledDriver * const> drivers,
+                                              std::shared_ptr<const DerivedMetrics> derivedMetrics)
 {
-    return std::make_shared<UserSpaceSource>(senderSem, drivers);
+    return std::make_shared<UserSpaceSource>(senderSignal, drivers, std::move(derivedMetrics));
 }
@@ -2,16 +2,18 @@
 
 #pragma once
 
+#include "lib/ReadyBitmap.h"
 #include "lib/Span.h"
 
 #include <memory>
 
-#include <semaphore.h>
-
+class DerivedMetrics;
 class PolledDriver;
 class Source;
 
 /// User space counters
-std::shared_ptr<Source> createUserSpaceSource(sem_t & senderSem, lib::Span<PolledDriver * const> drivers);
+std::shared_ptr<Source> createUserSpaceSource(lib::ReadySignal senderSignal,
+                                              lib::Span<PolledDriver * const> drivers,
+                                              std::shared_ptr<const DerivedMetrics> derivedMetrics);
 
 bool shouldStartUserSpaceSource(lib::Span<const PolledDriver * const>);
@@ -0,0 +1,145 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "XmlResponseCache.h"
+
+#include "Logging.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/stat.h>
+
+XmlResponseCache::Key & XmlResponseCache::Key::add(std::string_view value)
+{
+    addBytes(value.data(), value.size());
+    // separate consecutive strings so that {"ab", "c"} and {"a", "bc"} differ
+    return add(std::uint64_t(value.size()));
+}
+
+XmlResponseCache::Key & XmlResponseCache::Key::add(std::uint64_t value)
+{
+    addBytes(&value, sizeof(value));
+    return *this;
+}
+
+XmlResponseCache::Key & XmlResponseCache::Key::add(lib::Span<const int> values)
+{
+    addBytes(values.data(), values.size() * sizeof(int));
+    return add(std::uint64_t(values.size()));
+}
+
+XmlResponseCache::Key & XmlResponseCache::Key::addFile(const char * path)
+{
+    add(path);
+
+    struct stat st;
+    if ((path == nullptr) || (::stat(path, &st) != 0)) {
+        return add(std::uint64_t(0));
+    }
+
+    return add(std::uint64_t(st.st_dev))
+        .add(std::uint64_t(st.st_ino))
+        .add(std::uint64_t(st.st_size))
+        .add(std::uint64_t(st.st_mtim.tv_sec))
+        .add(std::uint64_t(st.st_mtim.tv_nsec));
+}
+
+void XmlResponseCache::Key::addBytes(const void * data, std::size_t length)
+{
+    const auto * bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init,hicpp-member-init)
+XmlResponseCache::XmlResponseCache() : mGeneration(1)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&mMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    for (auto & entry : mEntries) {
+        entry.valid = false;
+    }
+}
+
+XmlResponseCache::~XmlResponseCache()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool XmlResponseCache::lock()
+{
+    const int result = pthread_mutex_lock(&mMutex);
+    if (result == EOWNERDEAD) {
+        // a gator-child died while holding the lock, so the entries may be partially written
+        for (auto & entry : mEntries) {
+            entry.valid = false;
+        }
+        pthread_mutex_consistent(&mMutex);
+        return true;
+    }
+    if (result != 0) {
+        LOG_DEBUG("Unable to lock the XML response cache (%s)", strerror(result));
+        return false;
+    }
+    return true;
+}
+
+void XmlResponseCache::unlock()
+{
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool XmlResponseCache::find(Type type, std::uint64_t key, std::string & response)
+{
+    if (!lock()) {
+        return false;
+    }
+
+    const auto & entry = mEntries[static_cast<std::size_t>(type)];
+    const bool found = entry.valid && (entry.generation == mGeneration) && (entry.key == key);
+    if (found) {
+        response.assign(entry.data, entry.length);
+    }
+
+    unlock();
+    return found;
+}
+
+void XmlResponseCache::store(Type type, std::uint64_t key, std::string_view response)
+{
+    if (response.size() > MAX_RESPONSE_SIZE) {
+        LOG_DEBUG("Not caching XML response of %zu bytes", response.size());
+        return;
+    }
+
+    if (!lock()) {
+        return;
+    }
+
+    auto & entry = mEntries[static_cast<std::size_t>(type)];
+    entry.valid = false;
+    std::memcpy(entry.data, response.data(), response.size());
+    entry.length = response.size();
+    entry.key = key;
+    entry.generation = mGeneration;
+    entry.valid = true;
+
+    unlock();
+}
+
+void XmlResponseCache::invalidate()
+{
+    if (!lock()) {
+        return;
+    }
+
+    ++mGeneration;
+
+    unlock();
+}
@@ -0,0 +1,97 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef XML_RESPONSE_CACHE_H
+#define XML_RESPONSE_CACHE_H
+
+#include "lib/Span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <pthread.h>
+
+/**
+ * Caches the generated XML responses sent by StreamlineSetup, so that repeated requests (e.g. when Streamline
+ * reconnects) are not rebuilt each time.
+ *
+ * Each response is stored with a key that is the hash of the inputs it was generated from, and with the generation
+ * of the cache when it was stored. Calling invalidate() increments the generation, discarding all the responses.
+ *
+ * The cache is intended to be allocated in shared memory by gator-main, so that it is shared by all the gator-child
+ * processes that handle the connections. Storage is only committed for the responses that are actually stored.
+ */
+class XmlResponseCache {
+public:
+    enum class Type { EVENTS, COUNTERS, CONFIGURATION, COUNT };
+
+    /** Responses larger than this are not cached */
+    static constexpr std::size_t MAX_RESPONSE_SIZE = 4 * 1024 * 1024;
+
+    /** Builds the key for a response */
+    class Key {
+    public:
+        Key & add(std::string_view value);
+        Key & add(const char * value) { return add(std::string_view(value != nullptr ? value : "")); }
+        Key & add(std::uint64_t value);
+        Key & add(lib::Span<const int> values);
+
+        /** Add the identity, size and modification time of a file, or just that it is missing */
+        Key & addFile(const char * path);
+
+        [[nodiscard]] std::uint64_t get() const { return hash; }
+
+    private:
+        static constexpr std::uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+        static constexpr std::uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+        std::uint64_t hash = FNV_OFFSET_BASIS;
+
+        void addBytes(const void * data, std::size_t length);
+    };
+
+    XmlResponseCache();
+    ~XmlResponseCache();
+
+    // Intentionally unimplemented
+    XmlResponseCache(const XmlResponseCache &) = delete;
+    XmlResponseCache & operator=(const XmlResponseCache &) = delete;
+    XmlResponseCache(XmlResponseCache &&) = delete;
+    XmlResponseCache & operator=(XmlResponseCache &&) = delete;
+
+    /**
+     * Find a response
+     *
+     * @param type The type of response
+     * @param key The key for the current inputs
+     * @param response Receives the response, if found
+     * @return True if the response was found
+     */
+    bool find(Type type, std::uint64_t key, std::string & response);
+
+    /** Store a response that was built from the inputs identified by `key` */
+    void store(Type type, std::uint64_t key, std::string_view response);
+
+    /** Discard all the stored responses, e.g. because the configuration changed */
+    void invalidate();
+
+private:
+    struct Entry {
+        std::uint64_t generation;
+        std::uint64_t key;
+        std::size_t length;
+        bool valid;
+        char data[MAX_RESPONSE_SIZE];
+    };
+
+    pthread_mutex_t mMutex;
+    std::uint64_t mGeneration;
+    // not value-initialized, so that the storage is only touched when a response is stored
+    Entry mEntries[static_cast<std::size_t>(Type::COUNT)];
+
+    bool lock();
+    void unlock();
+};
+
+#endif // XML_RESPONSE_CACHE_H
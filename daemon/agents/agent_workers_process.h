@@ -64,6 +64,7 @@ namespace agents {
             signal_set.add(SIGABRT);
             signal_set.add(SIGCHLD);
             signal_set.add(SIGALRM);
+            signal_set.add(SIGUSR2);
         }
 
         /** Start the worker. Agents must be spawned separately once the worker has started */
@@ -244,6 +245,10 @@ namespace agents {
                 LOG_DEBUG("Received signal %d", signo);
                 parent.on_terminal_signal(signo);
             }
+            else if (signo == SIGUSR2) {
+                LOG_DEBUG("Received signal %d", signo);
+                parent.on_trigger_signal(signo);
+            }
             else if (signo == SIGALRM) {
                 if (sigalarm_counter == 0) {
                     LOG_WARNING("alarm received, sender running slowly, possible bottleneck in transmission path");
@@ -1,4 +1,4 @@
-/* Copyright (C) 2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2022-2023 by Arm Limited. All rights reserved. */
 
 #pragma once
 
@@ -8,9 +8,14 @@
 #include "async/continuations/stored_continuation.h"
 #include "async/continuations/use_continuation.h"
 #include "lib/Assert.h"
+#include "lib/AutoClosingFd.h"
 #include "lib/FsEntry.h"
+#include "lib/Syscall.h"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdlib>
 #include <deque>
 #include <set>
 #include <stdexcept>
@@ -24,9 +29,15 @@
 #include <boost/asio/steady_timer.hpp>
 #include <boost/system/error_code.hpp>
 
+#include <fcntl.h>
+
 namespace agents {
     /**
      * Monitors CPU online state by polling one or more files in sysfs (specifically the /sys/devices/system/cpu<n>/online)
+     *
+     * The files are kept open and reread with pread in a single pass. The interval between passes starts short and
+     * doubles each time nothing changed, up to some limit, and is reset whenever a change is seen or a recheck is
+     * requested (e.g. because activating a core found that it was not online).
      */
     class polling_cpu_monitor_t : public std::enable_shared_from_this<polling_cpu_monitor_t> {
     public:
@@ -79,12 +90,6 @@ namespace agents {
         void start()
         {
             using namespace async::continuations;
-            using namespace std::chrono_literals;
-
-            // short interval to catch case where core onlines
-            static constexpr auto short_poll_interval = 200us;
-            // longer interval for when all cores are on and we assume they are likely to stay on (or it doesnt matter if they go offline and we miss the event slightly)
-            static constexpr auto long_poll_interval = 1000us;
 
             auto st = shared_from_this();
 
@@ -98,15 +103,19 @@ namespace agents {
                     [st]() {
                         return start_on(st->strand)                             //
                              | then([st]() { return st->on_strand_do_poll(); }) //
-                             | then([st](bool any_offline) {
-                                   st->timer.expires_from_now(any_offline ? short_poll_interval : long_poll_interval);
+                             | then([st](std::chrono::microseconds interval) {
+                                   st->timer.expires_from_now(interval);
                                })                                     //
                              | st->timer.async_wait(use_continuation) //
                              | post_on(st->strand)                    //
                              | then([st](auto ec) {
-                                   // swallow cancel event, mark as terminated instead
                                    if (ec
                                        == boost::asio::error::make_error_code(boost::asio::error::operation_aborted)) {
+                                       // woken early to poll again now
+                                       if (std::exchange(st->recheck_requested, false) && !st->terminated) {
+                                           return boost::system::error_code {};
+                                       }
+                                       // swallow cancel event, mark as terminated instead
                                        LOG_DEBUG("Polling CPU monitor is now terminated");
                                        if (!std::exchange(st->terminated, true)) {
                                            st->enqueue_event(-1, false);
@@ -144,6 +153,23 @@ namespace agents {
                         }));
         }
 
+        /** Poll again immediately, as some other event suggests that a cpu may have changed state */
+        void request_recheck()
+        {
+            using namespace async::continuations;
+
+            auto st = shared_from_this();
+
+            spawn("recheck raw cpu event monitor",
+                  start_on(strand) //
+                      | then([st]() {
+                            if (!st->terminated) {
+                                st->recheck_requested = true;
+                                st->timer.cancel();
+                            }
+                        }));
+        }
+
         template<typename CompletionToken>
         auto async_receive_one(CompletionToken && token)
         {
@@ -163,14 +189,29 @@ namespace agents {
     private:
         using completion_handler_t = async::continuations::stored_continuation_t<event_t>;
 
+        /** The shortest interval, used when some core is offline so as to catch it coming online quickly */
+        static constexpr std::chrono::microseconds min_offline_poll_interval {200};
+        static constexpr std::chrono::microseconds max_offline_poll_interval {4000};
+        /** The interval when all the cores are online, as it doesnt matter so much if the offline event is late */
+        static constexpr std::chrono::microseconds min_online_poll_interval {1000};
+        static constexpr std::chrono::microseconds max_online_poll_interval {16000};
+
+        struct online_file_t {
+            lib::AutoClosingFd fd;
+            int cpu_no;
+        };
+
         boost::asio::steady_timer timer;
         boost::asio::io_context::strand strand;
         std::vector<std::pair<lib::FsEntry, int>> monitor_paths;
+        std::vector<online_file_t> online_files {};
         completion_handler_t pending_handler {};
         std::set<unsigned> online_cpu_nos {};
         std::deque<event_t> pending_events {};
+        std::chrono::microseconds poll_interval {0};
         bool terminated {false};
         bool first_pass {true};
+        bool recheck_requested {false};
 
         /** Trigger the handler asynchronously */
         template<typename Handler>
@@ -219,49 +260,74 @@ namespace agents {
             return event;
         }
 
-        /** Check for some state change, return true if any are offline */
-        [[nodiscard]] bool on_strand_do_poll()
+        /** Open the online files (once), skipping any that do not exist, such as for cpu0 on some systems */
+        void open_online_files()
+        {
+            for (auto const & entry : monitor_paths) {
+                lib::AutoClosingFd fd {lib::open(entry.first.path().c_str(), O_RDONLY | O_CLOEXEC)};
+                if (fd) {
+                    online_files.push_back(online_file_t {std::move(fd), entry.second});
+                }
+            }
+        }
+
+        /** Check for some state change, return the interval until the next check */
+        [[nodiscard]] std::chrono::microseconds on_strand_do_poll()
         {
             if (terminated) {
-                return false;
+                return min_online_poll_interval;
+            }
+
+            if (first_pass) {
+                open_online_files();
             }
 
             bool any_offline = false;
+            bool any_changed = std::exchange(recheck_requested, false);
 
-            for (auto const & entry : monitor_paths) {
-                const std::string contents = entry.first.readFileContentsSingleLine();
-                if (!contents.empty()) {
-                    const unsigned online_value = strtoul(contents.c_str(), nullptr, 0);
+            for (auto const & file : online_files) {
+                std::array<char, 16> buffer {};
+                auto const n = lib::pread(file.fd.get(), buffer.data(), buffer.size() - 1, 0);
+                if (n > 0) {
+                    const unsigned online_value = strtoul(buffer.data(), nullptr, 0);
                     const bool is_online = (online_value != 0);
                     any_offline |= !is_online;
 
                     // process it
-                    process_one(entry.second, is_online);
+                    any_changed |= process_one(file.cpu_no, is_online);
                 }
             }
 
             // not first pass any more
             first_pass = false;
 
-            return any_offline;
+            auto const min_interval = (any_offline ? min_offline_poll_interval : min_online_poll_interval);
+            auto const max_interval = (any_offline ? max_offline_poll_interval : max_online_poll_interval);
+
+            poll_interval = (any_changed ? min_interval : std::clamp(poll_interval * 2, min_interval, max_interval));
+
+            return poll_interval;
         }
 
-        /** Process one polled value */
-        void process_one(int cpu, bool online)
+        /** Process one polled value, returning true if it changed */
+        bool process_one(int cpu, bool online)
         {
             if (online) {
                 auto [it, inserted] = online_cpu_nos.insert(cpu);
+                (void) it; // gcc7
                 if (inserted || first_pass) {
                     enqueue_event(cpu, true);
+                    return true;
                 }
-                (void) it; // gcc7
             }
             else {
                 auto count = online_cpu_nos.erase(cpu);
                 if ((count > 0) || first_pass) {
                     enqueue_event(cpu, false);
+                    return true;
                 }
             }
+            return false;
         }
 
         /** Emit one event */
@@ -0,0 +1,82 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "agents/perf/apc_buffer_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace agents::perf {
+
+    namespace {
+        /** @return The smallest shift such that (1 << shift) >= size */
+        [[nodiscard]] constexpr std::size_t ceil_shift(std::size_t size)
+        {
+            std::size_t shift = 0;
+            while ((std::size_t(1) << shift) < size) {
+                ++shift;
+            }
+            return shift;
+        }
+
+        /** @return The largest shift such that (1 << shift) <= size, for non-zero size */
+        [[nodiscard]] constexpr std::size_t floor_shift(std::size_t size)
+        {
+            std::size_t shift = 0;
+            while ((size >> (shift + 1)) != 0) {
+                ++shift;
+            }
+            return shift;
+        }
+    }
+
+    std::vector<char> apc_buffer_pool_t::acquire(std::size_t min_capacity)
+    {
+        auto const shift = std::max(min_class_shift, ceil_shift(min_capacity));
+
+        // too large to have been kept, so just allocate exactly
+        if (shift > max_class_shift) {
+            std::vector<char> buffer {};
+            buffer.reserve(min_capacity);
+            return buffer;
+        }
+
+        // every buffer in a class is at least as large as its class size; only the exact class is used, so that a
+        // small frame never holds on to a large buffer
+        {
+            std::lock_guard lock {mutex};
+
+            auto & buffers = free_buffers[shift - min_class_shift];
+            if (!buffers.empty()) {
+                auto buffer = std::move(buffers.back());
+                buffers.pop_back();
+                return buffer;
+            }
+        }
+
+        std::vector<char> buffer {};
+        buffer.reserve(std::size_t(1) << shift);
+        return buffer;
+    }
+
+    void apc_buffer_pool_t::release(std::vector<char> buffer)
+    {
+        auto const capacity = buffer.capacity();
+        if (capacity < (std::size_t(1) << min_class_shift)) {
+            return;
+        }
+
+        auto const shift = floor_shift(capacity);
+        if (shift > max_class_shift) {
+            return;
+        }
+
+        buffer.clear();
+
+        std::lock_guard lock {mutex};
+
+        auto & buffers = free_buffers[shift - min_class_shift];
+        if (buffers.size() < max_free_buffers_per_class) {
+            buffers.emplace_back(std::move(buffer));
+        }
+    }
+}
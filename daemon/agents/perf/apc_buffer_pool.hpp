@@ -0,0 +1,54 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace agents::perf {
+
+    /**
+     * A pool of apc_frame buffers, so that the storage of a frame that has been sent can be reused for a later frame
+     * rather than freed.
+     *
+     * Buffers are kept in power of two size classes by capacity, and a buffer is only taken from the class of the
+     * requested size, so that a small frame does not take (and pin) a large buffer. A new buffer is allocated with its
+     * capacity rounded up to its class so that it returns to the same class when released. Each class keeps a bounded
+     * number of buffers, and buffers larger than the largest class are just freed. Reusing a buffer also avoids
+     * faulting in fresh pages as the frame is written.
+     *
+     * When every class is full the pool holds max_free_buffers_per_class * (2^(max_class_shift + 1) - 2^min_class_shift)
+     * bytes, which is just under 32MiB with the values below; in practice only the classes that the capture's frame
+     * sizes fall in are populated.
+     *
+     * The pool may be used from any thread.
+     */
+    class apc_buffer_pool_t {
+    public:
+        /** The capacity of the smallest class, as a power of two */
+        static constexpr std::size_t min_class_shift = 8;
+        /** The capacity of the largest class, as a power of two, which fits a whole perf data frame */
+        static constexpr std::size_t max_class_shift = 20;
+        /** The maximum number of free buffers kept in each class */
+        static constexpr std::size_t max_free_buffers_per_class = 16;
+
+        /**
+         * Take an empty buffer with at least some capacity
+         *
+         * @param min_capacity The number of bytes that the caller expects to write
+         * @return A previously released buffer, or a newly allocated one if there is none that is large enough
+         */
+        [[nodiscard]] std::vector<char> acquire(std::size_t min_capacity);
+
+        /** Return a buffer (typically once its frame is sent) so that its storage can be reused */
+        void release(std::vector<char> buffer);
+
+    private:
+        static constexpr std::size_t class_count = max_class_shift - min_class_shift + 1;
+
+        std::mutex mutex {};
+        std::array<std::vector<std::vector<char>>, class_count> free_buffers {};
+    };
+}
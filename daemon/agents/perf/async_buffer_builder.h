@@ -33,6 +33,9 @@ namespace agents::perf {
      *      - increases or decreases the buffer's size. I.e. the result of calling
      *        the size() method will change.
      * @endcode
+     *
+     * Writing starts at the beginning of the buffer, so a std::vector<char> taken from an apc_buffer_pool_t is written
+     * into directly, using the storage that it already has.
      */
     template<typename BufferType>
     class apc_buffer_builder_t {
@@ -2,9 +2,14 @@
 
 #pragma once
 
+#include "agents/perf/apc_buffer_pool.hpp"
 #include "agents/perf/events/perf_ringbuffer_mmap.hpp"
 #include "agents/perf/events/types.hpp"
+#include "agents/perf/perf_callchain_interner.hpp"
+#include "agents/perf/perf_derived_metrics.hpp"
+#include "agents/perf/perf_sample_aggregator.hpp"
 #include "agents/perf/record_types.h"
+#include "agents/perf/spe_record_filter.hpp"
 #include "async/continuations/async_initiate.h"
 #include "async/continuations/continuation.h"
 #include "async/continuations/operations.h"
@@ -55,11 +60,23 @@ namespace agents::perf {
                                         std::shared_ptr<ipc::raw_ipc_channel_sink_t> const & ipc_sink,
                                         std::shared_ptr<perf_activator_t> const & perf_activator,
                                         bool live_mode,
-                                        std::size_t one_shot_mode_limit)
+                                        std::size_t one_shot_mode_limit,
+                                        std::shared_ptr<apc_buffer_pool_t> buffer_pool,
+                                        std::shared_ptr<perf_callchain_interner_t> callchain_interner = {},
+                                        std::shared_ptr<perf_sample_aggregator_t> sample_aggregator = {},
+                                        std::shared_ptr<spe_record_filter_t> spe_filter = {},
+                                        std::shared_ptr<perf_derived_metrics_t> derived_metrics = {})
             : timer(context),
               strand(context),
               perf_activator(perf_activator),
-              perf_buffer_consumer(std::make_shared<perf_buffer_consumer_t>(context, ipc_sink, one_shot_mode_limit)),
+              perf_buffer_consumer(std::make_shared<perf_buffer_consumer_t>(context,
+                                                                            ipc_sink,
+                                                                            one_shot_mode_limit,
+                                                                            std::move(buffer_pool),
+                                                                            std::move(callchain_interner),
+                                                                            std::move(sample_aggregator),
+                                                                            std::move(spe_filter),
+                                                                            std::move(derived_metrics))),
               live_mode(live_mode)
         {
         }
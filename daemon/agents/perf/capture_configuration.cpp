@@ -12,6 +12,8 @@
 
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace agents::perf {
     namespace {
@@ -26,6 +28,21 @@ namespace agents::perf {
             msg.set_one_shot(session_data.mOneShot);
             msg.set_exclude_kernel_events(session_data.mExcludeKernelEvents);
             msg.set_stop_on_exit(session_data.mStopOnExit);
+            msg.set_intern_call_stacks(session_data.mInternCallStacks);
+            msg.set_aggregate_samples_interval_ms(session_data.mAggregateSamplesIntervalMs);
+            msg.set_hotplug_debounce_ms(session_data.mHotplugDebounceMs);
+            msg.set_multiplex_quantum_ms(session_data.mMultiplexQuantumMs);
+            msg.set_flight_recorder(session_data.mFlightRecorderSeconds > 0);
+
+            auto const & spe_record_filter = session_data.mSpeRecordFilter;
+            auto & spe_record_filter_msg = *msg.mutable_spe_record_filter();
+            spe_record_filter_msg.set_any_event_mask(spe_record_filter.any_event_mask);
+            spe_record_filter_msg.set_ops_load(spe_record_filter.ops.count(SpeOps::LOAD) > 0);
+            spe_record_filter_msg.set_ops_store(spe_record_filter.ops.count(SpeOps::STORE) > 0);
+            spe_record_filter_msg.set_ops_branch(spe_record_filter.ops.count(SpeOps::BRANCH) > 0);
+            spe_record_filter_msg.set_min_total_latency(spe_record_filter.min_total_latency);
+            spe_record_filter_msg.set_min_issue_latency(spe_record_filter.min_issue_latency);
+            spe_record_filter_msg.set_min_translation_latency(spe_record_filter.min_translation_latency);
         }
 
         void add_perf_config(ipc::proto::shell::perf::capture_configuration_t::perf_config_t & msg,
@@ -284,6 +301,21 @@ namespace agents::perf {
             session_data.one_shot = msg.one_shot();
             session_data.exclude_kernel_events = msg.exclude_kernel_events();
             session_data.stop_on_exit = msg.stop_on_exit();
+            session_data.intern_call_stacks = msg.intern_call_stacks();
+            session_data.aggregate_samples_interval_ms = msg.aggregate_samples_interval_ms();
+            session_data.hotplug_debounce_ms = msg.hotplug_debounce_ms();
+            session_data.multiplex_quantum_ms = msg.multiplex_quantum_ms();
+            session_data.flight_recorder = msg.flight_recorder();
+
+            auto const & spe_record_filter_msg = msg.spe_record_filter();
+            auto & spe_record_filter = session_data.spe_record_filter;
+            spe_record_filter.any_event_mask = spe_record_filter_msg.any_event_mask();
+            spe_record_filter.ops = (spe_record_filter_msg.ops_load() ? spe_record_filter_config_t::ops_load : 0)
+                                  | (spe_record_filter_msg.ops_store() ? spe_record_filter_config_t::ops_store : 0)
+                                  | (spe_record_filter_msg.ops_branch() ? spe_record_filter_config_t::ops_branch : 0);
+            spe_record_filter.min_total_latency = spe_record_filter_msg.min_total_latency();
+            spe_record_filter.min_issue_latency = spe_record_filter_msg.min_issue_latency();
+            spe_record_filter.min_translation_latency = spe_record_filter_msg.min_translation_latency();
         }
 
         void extract_perf_config(ipc::proto::shell::perf::capture_configuration_t::perf_config_t const & msg,
@@ -533,6 +565,51 @@ namespace agents::perf {
                 perf_pmu_type_to_name.emplace(entry.first, std::move(entry.second));
             }
         }
+
+        void extract_ringbuffer_carriers(
+            google::protobuf::Map<::google::protobuf::uint32,
+                                  ipc::proto::shell::perf::capture_configuration_t::ringbuffer_carrier_t> const & msg,
+            std::map<core_no_t, perf_capture_configuration_t::ringbuffer_carrier_t> & ringbuffer_carriers)
+        {
+            for (auto const & entry : msg) {
+                ringbuffer_carriers.emplace(core_no_t(entry.first),
+                                            perf_capture_configuration_t::ringbuffer_carrier_t {
+                                                entry.second.fd(),
+                                                perf_event_id_t(entry.second.id()),
+                                            });
+            }
+        }
+
+        void extract_derived_metrics(
+            google::protobuf::RepeatedPtrField<ipc::proto::shell::perf::capture_configuration_t::derived_metric_t> const &
+                msg,
+            std::shared_ptr<DerivedMetrics const> & derived_metrics)
+        {
+            if (msg.empty()) {
+                return;
+            }
+
+            auto result = std::make_shared<DerivedMetrics>();
+
+            for (auto const & metric : msg) {
+                // the expression was already validated by gator-main, so this only fails on a malformed message
+                std::string error;
+                auto program = DerivedMetricProgram::compile(metric.expression(), error);
+                if (!program) {
+                    throw std::runtime_error("Invalid derived metric expression: " + error);
+                }
+                if (std::size_t(metric.operand_keys_size()) != program->getOperands().size()) {
+                    throw std::runtime_error("Unexpected number of derived metric operands");
+                }
+
+                std::vector<int> operand_keys {metric.operand_keys().begin(), metric.operand_keys().end()};
+                result->add(metric.key(),
+                            std::make_shared<DerivedMetricProgram const>(std::move(*program)),
+                            operand_keys);
+            }
+
+            derived_metrics = std::move(result);
+        }
     }
 
     /* create the message */
@@ -603,6 +680,29 @@ namespace agents::perf {
         }
     }
 
+    void add_ringbuffer_carriers(ipc::msg_capture_configuration_t & msg,
+                                 std::map<int, PerfRingbufferReserve::Carrier> const & carriers)
+    {
+        auto & msg_carriers = *msg.suffix.mutable_ringbuffer_carriers();
+        for (auto const & [cpu, carrier] : carriers) {
+            auto & msg_carrier = msg_carriers[cpu];
+            msg_carrier.set_fd(carrier.fd);
+            msg_carrier.set_id(carrier.id);
+        }
+    }
+
+    void add_derived_metrics(ipc::msg_capture_configuration_t & msg, DerivedMetrics const & derived_metrics)
+    {
+        for (auto const & metric : derived_metrics.getMetrics()) {
+            auto * msg_metric = msg.suffix.add_derived_metrics();
+            msg_metric->set_key(metric.key);
+            msg_metric->set_expression(metric.program->getExpression());
+            for (auto key : metric.operandKeys) {
+                msg_metric->add_operand_keys(key);
+            }
+        }
+    }
+
     std::shared_ptr<perf_capture_configuration_t> parse_capture_configuration_msg(ipc::msg_capture_configuration_t msg)
     {
         auto result = std::make_shared<perf_capture_configuration_t>();
@@ -629,10 +729,12 @@ namespace agents::perf {
                                     result->uncore_pmus,
                                     result->num_cpu_cores);
         extract_ringbuffer_config(msg.suffix.ringbuffer_config(), result->ringbuffer_config);
+        extract_ringbuffer_carriers(msg.suffix.ringbuffer_carriers(), result->ringbuffer_carriers);
         extract_command(*msg.suffix.mutable_command(), result->command);
         extract_wait_process(*msg.suffix.mutable_wait_process(), result->wait_process);
         extract_pids(msg.suffix.pids(), result->pids);
         extract_perf_pmu_type_to_name(*msg.suffix.mutable_perf_pmu_type_to_name(), result->perf_pmu_type_to_name);
+        extract_derived_metrics(msg.suffix.derived_metrics(), result->derived_metrics);
 
         return result;
     }
@@ -2,11 +2,13 @@
 
 #pragma once
 
+#include "DerivedMetric.h"
 #include "ICpuInfo.h"
 #include "SessionData.h"
 #include "agents/perf/events/event_configuration.hpp"
 #include "agents/perf/events/types.hpp"
 #include "agents/perf/record_types.h"
+#include "agents/perf/spe_record_filter.hpp"
 #include "ipc/messages.h"
 #include "k/perf_event.h"
 #include "lib/Assert.h"
@@ -14,6 +16,7 @@
 #include "linux/perf/PerfEventGroup.h"
 #include "linux/perf/PerfEventGroupIdentifier.h"
 #include "linux/perf/PerfGroups.h"
+#include "linux/perf/PerfRingbufferReserve.h"
 #include "xml/PmuXML.h"
 
 namespace agents::perf {
@@ -31,6 +34,12 @@ namespace agents::perf {
             bool one_shot;
             bool exclude_kernel_events;
             bool stop_on_exit;
+            bool intern_call_stacks;
+            std::int32_t aggregate_samples_interval_ms;
+            spe_record_filter_config_t spe_record_filter;
+            std::int32_t hotplug_debounce_ms;
+            std::int32_t multiplex_quantum_ms;
+            bool flight_recorder;
         };
 
         struct command_t {
@@ -41,6 +50,12 @@ namespace agents::perf {
             gid_t gid;
         };
 
+        /** A ring buffer carrier event that gator-main reserved, whose fd the agent inherits */
+        struct ringbuffer_carrier_t {
+            int fd;
+            perf_event_id_t id;
+        };
+
         struct cpu_freq_properties_t {
             std::int32_t key;
             bool use_cpuinfo;
@@ -58,12 +73,15 @@ namespace agents::perf {
         std::map<std::uint32_t, std::string> perf_pmu_type_to_name {};
         event_configuration_t event_configuration {};
         buffer_config_t ringbuffer_config {};
+        std::map<core_no_t, ringbuffer_carrier_t> ringbuffer_carriers {};
         std::optional<command_t> command {};
         std::string wait_process {};
         std::set<pid_t> pids {};
         std::uint32_t num_cpu_cores {};
         bool enable_on_exec {};
         bool stop_pids {};
+        /** The metrics to compute from the counters read with each sample, or nullptr if there are none */
+        std::shared_ptr<DerivedMetrics const> derived_metrics {};
     };
 
     /**
@@ -96,6 +114,13 @@ namespace agents::perf {
     /** Add the pids for --pids */
     void add_pids(ipc::msg_capture_configuration_t & msg, std::set<int> const & pids);
 
+    /** Add the ring buffer carriers (by cpu) that gator-main reserved */
+    void add_ringbuffer_carriers(ipc::msg_capture_configuration_t & msg,
+                                 std::map<int, PerfRingbufferReserve::Carrier> const & carriers);
+
+    /** Add the derived metrics whose operands are perf counters */
+    void add_derived_metrics(ipc::msg_capture_configuration_t & msg, DerivedMetrics const & derived_metrics);
+
     /** Extract and validate the fields from the received msg. (Passed by value to allow moving out strings, rather than copying) */
     [[nodiscard]] std::shared_ptr<perf_capture_configuration_t> parse_capture_configuration_msg(
         ipc::msg_capture_configuration_t msg);
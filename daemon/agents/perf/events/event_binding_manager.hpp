@@ -6,17 +6,22 @@
 #include "agents/perf/events/event_bindings.hpp"
 #include "agents/perf/events/event_configuration.hpp"
 #include "agents/perf/events/perf_activator.hpp"
+#include "agents/perf/events/perf_multiplex_scheduler.hpp"
 #include "agents/perf/events/perf_ringbuffer_mmap.hpp"
+#include "agents/perf/events/perf_ringbuffer_pool.hpp"
 #include "agents/perf/events/types.hpp"
 #include "lib/Assert.h"
 #include "lib/EnumUtils.h"
+#include "lib/Span.h"
 #include "linux/perf/PerfUtils.h"
 
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <stdexcept>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -35,6 +40,9 @@ namespace agents::perf {
      * online and track events are split into two calls; a 'xxx_prepare' method which prepares the events with appropriate calls to perf_event_open.
      * The set of opened items is returned as id->key mappings, allowing the caller to serialize them into the APC capture. This may then
      * be followed by a call to 'xxx_start' method which will activate the perf event group.
+     *
+     * In system-wide mode, core_online_prepare may be called concurrently for different cores. The state that is shared between
+     * cores is guarded by `state_mutex`; the per-core properties are only accessed by the activation of that core.
      */
     template<typename PerfActivator = perf_activator_t>
     class event_binding_manager_t {
@@ -126,14 +134,32 @@ namespace agents::perf {
          * @param core_no_to_spe_type The mapping from core no to SPE pmu type value
          * @param is_system_wide True for system-wide captures, false for app captures
          * @param enable_on_exec True for enable-on-exec with app captures
+         * @param ringbuffer_carriers The ring buffer carriers that gator-main reserved, by core
+         * @param clusters The cluster PMUs, indexed by cluster id
+         * @param multiplex_pmu_counters True to rotate the counters of any cluster that has more selected than it has
+         * counters (system-wide only)
          */
         event_binding_manager_t(std::shared_ptr<perf_activator_t> perf_activator,
                                 event_configuration_t const & configuration,
                                 std::vector<perf_capture_configuration_t::uncore_pmu_t> const & uncore_pmus,
                                 std::map<core_no_t, std::uint32_t> const & core_no_to_spe_type,
                                 bool is_system_wide,
-                                bool enable_on_exec)
+                                bool enable_on_exec,
+                                std::map<core_no_t, perf_capture_configuration_t::ringbuffer_carrier_t> const &
+                                    ringbuffer_carriers,
+                                lib::Span<GatorCpu const> clusters = {},
+                                bool multiplex_pmu_counters = false)
             : perf_activator(std::move(perf_activator)),
+              ringbuffer_pool(std::make_unique<perf_ringbuffer_pool_t<perf_activator_t>>(
+                  this->perf_activator,
+                  configuration.header_event,
+                  (is_system_wide ? system_wide_pid : self_pid),
+                  ringbuffer_carriers)),
+              multiplex_scheduler(std::make_unique<perf_multiplex_scheduler_t<perf_activator_t>>(
+                  this->perf_activator,
+                  configuration,
+                  clusters,
+                  multiplex_pmu_counters && is_system_wide)),
               configuration(configuration),
               uncore_pmus(uncore_pmus),
               core_no_to_spe_type(core_no_to_spe_type),
@@ -143,10 +169,31 @@ namespace agents::perf {
         }
 
         /** @return True if capture started, false otherwise */
-        [[nodiscard]] bool is_capture_started() const { return capture_started; }
+        [[nodiscard]] bool is_capture_started() const
+        {
+            std::lock_guard lock {*state_mutex};
+            return capture_started;
+        }
 
         /** Mark the capture as having started */
-        void set_capture_started() { capture_started = true; }
+        void set_capture_started()
+        {
+            std::lock_guard lock {*state_mutex};
+            capture_started = true;
+        }
+
+        /** @return true if any of the cluster counters are multiplexed */
+        [[nodiscard]] bool has_multiplexed_events() const { return multiplex_scheduler->is_active(); }
+
+        /**
+         * Rotate the multiplexed counters on each core
+         *
+         * @return The scaled values of the counters that were enabled until now
+         */
+        [[nodiscard]] std::vector<apc::perf_counter_t> rotate_multiplexed_events()
+        {
+            return multiplex_scheduler->rotate();
+        }
 
         /** @return true if there are any SPE counters active on any core */
         [[nodiscard]] bool has_spe() const
@@ -180,11 +227,17 @@ namespace agents::perf {
 
             LOG_DEBUG("Core online prepare %d 0x%x", lib::toEnumValue(no), lib::toEnumValue(cluster_id));
 
-            // update the set of tracked pids
-            tracked_pids.insert(additional_tids.begin(), additional_tids.end());
+            typename std::map<core_no_t, core_properties_t>::iterator it;
+            bool inserted;
+            {
+                std::lock_guard lock {*state_mutex};
+
+                // update the set of tracked pids
+                tracked_pids.insert(additional_tids.begin(), additional_tids.end());
 
-            // update the core type map
-            auto [it, inserted] = core_properties.try_emplace(no, core_properties_t {no, cluster_id});
+                // update the core type map
+                std::tie(it, inserted) = core_properties.try_emplace(no, core_properties_t {no, cluster_id});
+            }
 
             // if the core was already online, then fail
             if (!inserted) {
@@ -208,9 +261,12 @@ namespace agents::perf {
             id_to_key_mappings.emplace_back(header_result.id, configuration.header_event.key);
             // store the fd
             it->second.header_event_fd = header_result.fd;
-            // mmap the header event
-            mmap_ptr = std::make_shared<perf_ringbuffer_mmap_t>(
-                perf_activator->mmap_data(no, header_result.fd->native_handle()));
+            // redirect the header event into the core's pooled buffer, or failing that mmap the header event itself
+            mmap_ptr = ringbuffer_pool->acquire(no, header_result.fd->native_handle());
+            if (mmap_ptr == nullptr) {
+                mmap_ptr = std::make_shared<perf_ringbuffer_mmap_t>(
+                    perf_activator->mmap_data(no, header_result.fd->native_handle()));
+            }
             if (!mmap_ptr->has_data()) {
                 LOG_DEBUG("Core online prepare %d 0x%x failed due to data mmap error",
                           lib::toEnumValue(no),
@@ -240,6 +296,11 @@ namespace agents::perf {
                     }),
                 it->second);
 
+            // create the multiplexed counters, which are not part of any binding set
+            if (result == aggregate_state_t::usable) {
+                result = multiplex_scheduler->core_online_prepare(no, cluster_id, system_wide_pid);
+            }
+
             switch (result) {
                 case aggregate_state_t::usable: {
                     LOG_DEBUG("Core online prepare %d 0x%x succeeded",
@@ -295,10 +356,10 @@ namespace agents::perf {
          */
         [[nodiscard]] core_online_start_result_t core_online_start(core_no_t no)
         {
-            runtime_assert(capture_started, "core_online_start called before capture started");
+            runtime_assert(is_capture_started(), "core_online_start called before capture started");
 
             // no operation required if the core is already offline
-            auto it = core_properties.find(no);
+            auto it = find_core_properties(no);
             if (it == core_properties.end()) {
                 LOG_DEBUG("Core online start %d called, but core offline", lib::toEnumValue(no));
                 return {aggregate_state_t::offline, {}};
@@ -358,6 +419,8 @@ namespace agents::perf {
                 pid_untrack(pid);
             }
 
+            multiplex_scheduler->core_online_start(no);
+
             return {(all_terminated ? aggregate_state_t::terminated //
                                     : aggregate_state_t::usable),
                     std::move(terminated_pids)};
@@ -373,7 +436,7 @@ namespace agents::perf {
             LOG_DEBUG("Core offline %d", lib::toEnumValue(no));
 
             // no opperation required if the core is already offline
-            auto it = core_properties.find(no);
+            auto it = find_core_properties(no);
             if (it == core_properties.end()) {
                 return;
             }
@@ -451,7 +514,7 @@ namespace agents::perf {
         [[nodiscard]] pid_track_start_result_t pid_track_start(pid_t pid)
         {
             runtime_assert(!is_system_wide, "pid_track_start is only valid when !system-wide");
-            runtime_assert(capture_started, "pid_track_start called before capture started");
+            runtime_assert(is_capture_started(), "pid_track_start called before capture started");
 
             // check pid is tracked
             if (tracked_pids.count(pid) == 0) {
@@ -610,6 +673,8 @@ namespace agents::perf {
         };
 
         std::shared_ptr<perf_activator_t> perf_activator;
+        std::unique_ptr<perf_ringbuffer_pool_t<perf_activator_t>> ringbuffer_pool;
+        std::unique_ptr<perf_multiplex_scheduler_t<perf_activator_t>> multiplex_scheduler;
         event_configuration_t const & configuration;
         std::vector<perf_capture_configuration_t::uncore_pmu_t> const & uncore_pmus;
         std::map<core_no_t, std::uint32_t> const & core_no_to_spe_type;
@@ -620,6 +685,45 @@ namespace agents::perf {
         bool capture_started {false};
         std::set<pid_t> tracked_pids {};
         std::set<uncore_pmu_id_t> all_active_uncore_pmu_ids {};
+        // guards the structure of core_properties, all_active_uncore_pmu_ids and spe_event_definitions_retyped which are shared by
+        // concurrent calls to core_online_prepare (a pointer so that this object remains movable), and capture_started which is set
+        // on the capture's strand while activations run on the worker pool. tracked_pids is only modified in app mode, where
+        // activation is not concurrent.
+        std::unique_ptr<std::mutex> state_mutex = std::make_unique<std::mutex>();
+
+        /** Find the properties for some core */
+        [[nodiscard]] typename std::map<core_no_t, core_properties_t>::iterator find_core_properties(core_no_t no)
+        {
+            std::lock_guard lock {*state_mutex};
+            return core_properties.find(no);
+        }
+
+        /** Remove the properties for some core */
+        void erase_core_properties(typename std::map<core_no_t, core_properties_t>::iterator it)
+        {
+            std::lock_guard lock {*state_mutex};
+            core_properties.erase(it);
+        }
+
+        /**
+         * Mark an uncore pmu as active
+         *
+         * @return True if the pmu was claimed, false if it was already active on another core
+         */
+        [[nodiscard]] bool claim_uncore_pmu(uncore_pmu_id_t id)
+        {
+            std::lock_guard lock {*state_mutex};
+            return all_active_uncore_pmu_ids.insert(id).second;
+        }
+
+        /** Mark some uncore pmus as inactive */
+        void release_uncore_pmus(std::set<uncore_pmu_id_t> const & ids)
+        {
+            std::lock_guard lock {*state_mutex};
+            for (auto id : ids) {
+                all_active_uncore_pmu_ids.erase(id);
+            }
+        }
 
         /**
          * Create the binding sets for some core.
@@ -711,10 +815,13 @@ namespace agents::perf {
             runtime_assert(properties.mmap != nullptr, "Invalid mmap value");
             runtime_assert(properties.header_event_fd != nullptr, "Invalid header_event_fd value");
 
-            // find the set of cluster events
-            auto cluster_it = configuration.cluster_specific_events.find(properties.cluster_id);
-            auto const * cluster_events =
-                (cluster_it != configuration.cluster_specific_events.end() ? &(cluster_it->second) : nullptr);
+            // find the set of cluster events (less any that are multiplexed)
+            auto const * cluster_events = multiplex_scheduler->find_group_events(properties.cluster_id);
+            if (cluster_events == nullptr) {
+                auto cluster_it = configuration.cluster_specific_events.find(properties.cluster_id);
+                cluster_events =
+                    (cluster_it != configuration.cluster_specific_events.end() ? &(cluster_it->second) : nullptr);
+            }
 
             // and core specific events
             auto core_it = configuration.cpu_specific_events.find(properties.no);
@@ -736,6 +843,7 @@ namespace agents::perf {
 
             if (has_no_events) {
                 LOG_DEBUG("No events configured for cpu=%d, pid=%d", lib::toEnumValue(properties.no), pid);
+                release_uncore_pmus(uncore_ids);
                 return aggregate_state_t::terminated;
             }
 
@@ -784,13 +892,13 @@ namespace agents::perf {
                 // this should be impossible since the group is new
                 runtime_assert(result,
                                "Failed to add an uncore event configuration, perhaps the binding set is not offline");
+                // already claimed by find_all_uncore_ids_for
                 properties.active_uncore_pmu_ids.insert(id);
-                all_active_uncore_pmu_ids.insert(id);
             }
 
             // now all the bindings are created, now create the events
             auto result = binding_set.create_events(
-                enable_on_exec && !capture_started,
+                enable_on_exec && !is_capture_started(),
                 id_to_key_mapping_tracker,
                 [pid, &mmap_tracker](std::shared_ptr<stream_descriptor_t> fd, bool requires_aux) {
                     return mmap_tracker(pid, std::move(fd), requires_aux);
@@ -839,12 +947,6 @@ namespace agents::perf {
 
             // iterate each uncore pmu and check for inactive uncores that are associated with the cpu
             for (auto const & [id, events] : configuration.uncore_specific_events) {
-                // already active on another core?
-                if (all_active_uncore_pmu_ids.count(id) > 0) {
-                    LOG_DEBUG("Ignoring uncore %d on %d as already active", lib::toEnumValue(id), lib::toEnumValue(no));
-                    continue;
-                }
-
                 auto const cpu_no = lib::toEnumValue(no);
                 auto const index = lib::toEnumValue(id);
                 runtime_assert((index >= 0) && (std::size_t(index) < uncore_pmus.size()), "Invalid uncore pmu id");
@@ -864,6 +966,12 @@ namespace agents::perf {
                     continue;
                 }
 
+                // already active on another core? (otherwise it is now claimed for this core)
+                if (!claim_uncore_pmu(id)) {
+                    LOG_DEBUG("Ignoring uncore %d on %d as already active", lib::toEnumValue(id), lib::toEnumValue(no));
+                    continue;
+                }
+
                 // found one
                 LOG_DEBUG("Selecting uncore %d on %d", lib::toEnumValue(id), lib::toEnumValue(no));
                 result.first.insert(id);
@@ -963,6 +1071,8 @@ namespace agents::perf {
          */
         std::vector<event_definition_t> const & get_retyped_spe_definitions(std::uint32_t type)
         {
+            std::lock_guard lock {*state_mutex};
+
             auto & result = spe_event_definitions_retyped[type];
 
             if (result.empty()) {
@@ -986,9 +1096,7 @@ namespace agents::perf {
             }
 
             // make sure to mark any uncores as inactive
-            for (auto id : it->second.active_uncore_pmu_ids) {
-                all_active_uncore_pmu_ids.erase(id);
-            }
+            release_uncore_pmus(it->second.active_uncore_pmu_ids);
 
             // finally, close the header event explicitly (so that any thing waiting on it will be cancelled)
             auto fd = it->second.header_event_fd;
@@ -996,8 +1104,13 @@ namespace agents::perf {
                 fd->close();
             }
 
+            multiplex_scheduler->core_offline(it->first);
+
+            // keep the buffer for when the core comes back online
+            ringbuffer_pool->release(it->first);
+
             // finally, erase it, freeing up the entry in the map
-            core_properties.erase(it);
+            erase_core_properties(it);
         }
 
         /** returned by core_online_prepare_header */
@@ -1033,14 +1146,14 @@ namespace agents::perf {
                     LOG_DEBUG("Creating core header %d 0x%x failed.",
                               lib::toEnumValue(no),
                               lib::toEnumValue(cluster_id));
-                    core_properties.erase(it);
+                    erase_core_properties(it);
                     return {aggregate_state_t::failed};
                 }
                 case event_creation_status_t::failed_offline: {
                     LOG_DEBUG("Creating core header %d 0x%x was offline.",
                               lib::toEnumValue(no),
                               lib::toEnumValue(cluster_id));
-                    core_properties.erase(it);
+                    erase_core_properties(it);
                     return {aggregate_state_t::offline};
                 }
                 case event_creation_status_t::success: {
@@ -1055,14 +1168,14 @@ namespace agents::perf {
                                 LOG_DEBUG("Creating core header %d 0x%x failed to read id.",
                                           lib::toEnumValue(no),
                                           lib::toEnumValue(cluster_id));
-                                core_properties.erase(it);
+                                erase_core_properties(it);
                                 return {aggregate_state_t::failed};
                             }
                             case read_ids_status_t::failed_offline: {
                                 LOG_DEBUG("Creating core header %d 0x%x failed to read id as offline.",
                                           lib::toEnumValue(no),
                                           lib::toEnumValue(cluster_id));
-                                core_properties.erase(it);
+                                erase_core_properties(it);
                                 return {aggregate_state_t::offline};
                             }
                             case read_ids_status_t::success: {
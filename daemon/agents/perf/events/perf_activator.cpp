@@ -16,10 +16,13 @@
 #include "lib/error_code_or.hpp"
 #include "linux/perf/PerfUtils.h"
 
+#include <array>
 #include <cerrno>
 #include <cstring>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 
 #include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/system/errc.hpp>
@@ -392,6 +395,40 @@ namespace agents::perf {
                                         std::make_shared<boost::asio::posix::stream_descriptor>(context, fd.release())};
     }
 
+    std::shared_ptr<perf_activator_t::stream_descriptor_t> perf_activator_t::adopt_event(int fd,
+                                                                                        perf_event_id_t perf_id)
+    {
+        constexpr std::string_view perf_event_link {"anon_inode:[perf_event]"};
+
+        if ((fd < 0) || (perf_id == perf_event_id_t::invalid)
+            || !capture_configuration->perf_config.has_ioctl_read_id) {
+            return {};
+        }
+
+        // only use perf ioctls on it once it is known to be a perf event
+        auto const fd_path = "/proc/self/fd/" + std::to_string(fd);
+        std::array<char, perf_event_link.size() + 1> link {};
+        auto const n = ::readlink(fd_path.c_str(), link.data(), link.size());
+        if ((n < 0) || (std::string_view(link.data(), n) != perf_event_link)) {
+            LOG_DEBUG("Inherited fd %d is not a perf event", fd);
+            return {};
+        }
+
+        if (read_perf_id(fd) != perf_id) {
+            LOG_DEBUG("Inherited fd %d is not the expected perf event %" PRIu64, fd, lib::toEnumValue(perf_id));
+            return {};
+        }
+
+        // it was inherited, so must not be inherited again by anything the agent runs
+        int fdf = lib::fcntl(fd, F_GETFD);
+        //NOLINTNEXTLINE(hicpp-signed-bitwise) - FD_CLOEXEC
+        if (lib::fcntl(fd, F_SETFD, fdf | FD_CLOEXEC) != 0) {
+            LOG_DEBUG("failed to set CLOEXEC on inherited perf event due to %d", errno);
+        }
+
+        return std::make_shared<boost::asio::posix::stream_descriptor>(context, fd);
+    }
+
     //NOLINTNEXTLINE(readability-convert-member-functions-to-static)
     bool perf_activator_t::set_output(int fd, int output_fd)
     {
@@ -473,4 +510,19 @@ namespace agents::perf {
         //NOLINTNEXTLINE(hicpp-signed-bitwise) - PERF_EVENT_IOC_ENABLE
         return (lib::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0) == 0);
     }
+
+    //NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    std::optional<perf_activator_t::read_counter_result_t> perf_activator_t::read_counter(int fd)
+    {
+        // value, time_enabled, time_running, id
+        std::array<std::uint64_t, 4> buffer {};
+
+        auto const bytes = lib::read(fd, reinterpret_cast<char *>(buffer.data()), sizeof(buffer));
+        if (bytes != ssize_t(sizeof(buffer))) {
+            LOG_DEBUG("read failed for counter fd %d (%zd)", fd, bytes);
+            return {};
+        }
+
+        return read_counter_result_t {buffer[0], buffer[1], buffer[2]};
+    }
 }
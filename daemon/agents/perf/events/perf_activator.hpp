@@ -66,6 +66,16 @@ namespace agents::perf {
         /** The stream type */
         using stream_descriptor_t = boost::asio::posix::stream_descriptor;
 
+        /** The value and times read from a counting event by read_counter */
+        struct read_counter_result_t {
+            /** The counter value */
+            std::uint64_t value;
+            /** The total time that the event was enabled (in ns) */
+            std::uint64_t time_enabled;
+            /** The total time that the event was counting (in ns) */
+            std::uint64_t time_running;
+        };
+
         /** Event creation result tuple returned by the create_event function */
         struct event_creation_result_t {
             /** The event ID, or invalid. Only meaningful when (failed == false) */
@@ -144,6 +154,16 @@ namespace agents::perf {
                                                            pid_t pid,
                                                            int group_fd);
 
+        /**
+         * Take ownership of an event that the agent inherited from gator-main (i.e. a ring buffer carrier event)
+         *
+         * @param fd The inherited file descriptor
+         * @param perf_id The id the event was created with, which is checked so that an fd number that was not actually
+         * inherited is never mistaken for the event
+         * @return The event's file descriptor, or nullptr if the fd is not that event
+         */
+        [[nodiscard]] std::shared_ptr<stream_descriptor_t> adopt_event(int fd, perf_event_id_t perf_id);
+
         /**
          * Redirect mmap output from one fd to another
          *
@@ -203,6 +223,15 @@ namespace agents::perf {
          */
         bool re_enable(int fd);
 
+        /**
+         * Read the value of a single (not grouped) counting event
+         *
+         * @param fd The event file descriptor, whose read_format must be
+         * PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+         * @return The value, or nothing if it could not be read
+         */
+        [[nodiscard]] std::optional<read_counter_result_t> read_counter(int fd);
+
     private:
         std::shared_ptr<perf_capture_configuration_t> capture_configuration;
         boost::asio::io_context & context;
@@ -0,0 +1,363 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "Logging.h"
+#include "agents/perf/events/event_bindings.hpp"
+#include "agents/perf/events/event_configuration.hpp"
+#include "agents/perf/events/types.hpp"
+#include "apc/perf_counter.h"
+#include "k/perf_event.h"
+#include "lib/EnumUtils.h"
+#include "lib/Span.h"
+#include "xml/PmuXML.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace agents::perf {
+
+    /**
+     * Time-division scheduler for the CPU PMU counters of a cluster, when more are selected than the cores of that
+     * cluster have.
+     *
+     * Normally all the counters of a cluster are members of the cluster's group, which cannot be scheduled if it needs
+     * more counters than there are. Instead, the counters of an oversubscribed cluster are removed from the group and
+     * opened as separate counting events on each core. At most as many as the core has counters are enabled at once,
+     * and every quantum the enabled subset is disabled and the next subset is enabled.
+     *
+     * Each time a counter is disabled its value is read along with the time it was counting, and the change since it
+     * was last read is scaled by (time since last read / time counting) to give an estimate for the whole period. The
+     * scaled values are sent as per-core counter values, so these counters are not attributed to threads.
+     *
+     * Counters that use event based sampling are never multiplexed, as a counting event cannot sample. They stay in the
+     * cluster's group, and only the other counters are rotated through the PMU counters that are left.
+     */
+    template<typename PerfActivator>
+    class perf_multiplex_scheduler_t {
+    public:
+        using perf_activator_t = PerfActivator;
+        using stream_descriptor_t = typename perf_activator_t::stream_descriptor_t;
+
+        /**
+         * Constructor
+         *
+         * @param perf_activator The perf activator
+         * @param configuration The event configuration
+         * @param clusters The cluster PMUs, indexed by cluster id
+         * @param enabled True to multiplex any oversubscribed cluster, false to leave all the counters in their groups
+         */
+        perf_multiplex_scheduler_t(std::shared_ptr<perf_activator_t> perf_activator,
+                                   event_configuration_t const & configuration,
+                                   lib::Span<GatorCpu const> clusters,
+                                   bool enabled)
+            : perf_activator(std::move(perf_activator))
+        {
+            if (!enabled) {
+                return;
+            }
+
+            for (auto const & [cluster_id, events] : configuration.cluster_specific_events) {
+                auto const index = std::size_t(lib::toEnumValue(cluster_id));
+                if (index >= clusters.size()) {
+                    continue;
+                }
+
+                auto const capacity = std::size_t(std::max(clusters[index].getPmncCounters(), 0));
+
+                std::vector<event_definition_t> remaining {};
+                std::vector<event_definition_t> multiplexed {};
+                std::size_t sampling_count = 0;
+
+                for (auto const & event : events) {
+                    if (!uses_pmu_counter(event)) {
+                        remaining.emplace_back(event);
+                    }
+                    else if (is_sampling(event)) {
+                        remaining.emplace_back(event);
+                        ++sampling_count;
+                    }
+                    else {
+                        multiplexed.emplace_back(make_counting_event(event));
+                    }
+                }
+
+                if ((capacity == 0) || ((multiplexed.size() + sampling_count) <= capacity)) {
+                    continue;
+                }
+
+                if (sampling_count > 0) {
+                    LOG_WARNING("%zu counters of cluster %s use event based sampling, so will not be multiplexed",
+                                sampling_count,
+                                clusters[index].getCoreName());
+                }
+
+                if (sampling_count >= capacity) {
+                    LOG_WARNING("Not multiplexing the counters of cluster %s, as the event based sampling counters "
+                                "need all %zu of its counters",
+                                clusters[index].getCoreName(),
+                                capacity);
+                    continue;
+                }
+
+                LOG_DEBUG("Multiplexing %zu counters for cluster %d, which has %zu counters (%zu used for sampling)",
+                          multiplexed.size(),
+                          lib::toEnumValue(cluster_id),
+                          capacity,
+                          sampling_count);
+
+                group_events.emplace(cluster_id, std::move(remaining));
+                multiplexed_events.emplace(cluster_id,
+                                           multiplexed_cluster_t {std::move(multiplexed), capacity - sampling_count});
+            }
+        }
+
+        /** @return True if any cluster is multiplexed */
+        [[nodiscard]] bool is_active() const { return !multiplexed_events.empty(); }
+
+        /**
+         * Get the events that remain in the group for some cluster
+         *
+         * @param cluster_id The cluster id
+         * @return The events to use instead of the configured events, or nullptr if the cluster is not multiplexed
+         */
+        [[nodiscard]] std::vector<event_definition_t> const * find_group_events(cpu_cluster_id_t cluster_id) const
+        {
+            auto it = group_events.find(cluster_id);
+            return (it != group_events.end() ? &(it->second) : nullptr);
+        }
+
+        /**
+         * Create the (disabled) multiplexed counting events for some core
+         *
+         * @param no The core no
+         * @param cluster_id The core's cluster id
+         * @param pid The pid to create the events for
+         * @return usable if the events were created (or there are none), otherwise offline or failed
+         */
+        [[nodiscard]] aggregate_state_t core_online_prepare(core_no_t no, cpu_cluster_id_t cluster_id, pid_t pid)
+        {
+            using enable_state_t = typename perf_activator_t::enable_state_t;
+            using event_creation_status_t = typename perf_activator_t::event_creation_status_t;
+
+            auto cluster_it = multiplexed_events.find(cluster_id);
+            if (cluster_it == multiplexed_events.end()) {
+                return aggregate_state_t::usable;
+            }
+
+            core_state_t core_state {{}, cluster_it->second.capacity};
+
+            for (auto const & event : cluster_it->second.events) {
+                auto result = perf_activator->create_event(event, enable_state_t::disabled, no, pid, -1);
+
+                switch (result.status) {
+                    case event_creation_status_t::success: {
+                        core_state.counters.emplace_back(counter_t {event.key, std::move(result.fd)});
+                        break;
+                    }
+                    case event_creation_status_t::failed_invalid_device: {
+                        LOG_DEBUG("Multiplexed counter %d is not supported on core %d",
+                                  lib::toEnumValue(event.key),
+                                  lib::toEnumValue(no));
+                        break;
+                    }
+                    case event_creation_status_t::failed_offline: {
+                        return aggregate_state_t::offline;
+                    }
+                    case event_creation_status_t::failed_invalid_pid:
+                    case event_creation_status_t::failed_fatal:
+                    default: {
+                        return aggregate_state_t::failed;
+                    }
+                }
+            }
+
+            std::lock_guard lock {mutex};
+
+            cores.insert_or_assign(no, std::move(core_state));
+
+            return aggregate_state_t::usable;
+        }
+
+        /** Enable the first subset of the multiplexed counters for some core */
+        void core_online_start(core_no_t no)
+        {
+            std::lock_guard lock {mutex};
+
+            auto it = cores.find(no);
+            if (it == cores.end()) {
+                return;
+            }
+
+            auto & core_state = it->second;
+            auto const now = std::chrono::steady_clock::now();
+
+            for (auto & counter : core_state.counters) {
+                counter.last_read_time = now;
+            }
+
+            core_state.started = true;
+            enable_subset(core_state, true);
+        }
+
+        /** Remove the multiplexed counters for some core */
+        void core_offline(core_no_t no)
+        {
+            std::lock_guard lock {mutex};
+
+            cores.erase(no);
+        }
+
+        /**
+         * Read the counters that are enabled on each core, and rotate to the next subset
+         *
+         * @return The scaled values of the counters that were read
+         */
+        [[nodiscard]] std::vector<apc::perf_counter_t> rotate()
+        {
+            std::vector<apc::perf_counter_t> result {};
+
+            std::lock_guard lock {mutex};
+
+            auto const now = std::chrono::steady_clock::now();
+
+            for (auto & [no, core_state] : cores) {
+                if ((!core_state.started) || core_state.counters.empty()) {
+                    continue;
+                }
+
+                enable_subset(core_state, false);
+
+                for_each_in_subset(core_state, [&, no = no](counter_t & counter) {
+                    auto value = perf_activator->read_counter(counter.fd->native_handle());
+                    if (!value) {
+                        return;
+                    }
+
+                    auto const delta_value = value->value - counter.last_value;
+                    auto const delta_running = value->time_running - counter.last_running;
+                    auto const elapsed =
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(now - counter.last_read_time).count();
+
+                    counter.last_value = value->value;
+                    counter.last_running = value->time_running;
+                    counter.last_read_time = now;
+
+                    if (delta_running == 0) {
+                        return;
+                    }
+
+                    auto const scaled = (double(delta_value) * double(elapsed)) / double(delta_running);
+
+                    result.emplace_back(apc::perf_counter_t {lib::toEnumValue(no),
+                                                             lib::toEnumValue(counter.key),
+                                                             std::int64_t(scaled)});
+                });
+
+                core_state.next = (core_state.next + core_state.capacity) % core_state.counters.size();
+
+                enable_subset(core_state, true);
+            }
+
+            return result;
+        }
+
+    private:
+        struct counter_t {
+            gator_key_t key;
+            std::shared_ptr<stream_descriptor_t> fd;
+            std::uint64_t last_value {0};
+            std::uint64_t last_running {0};
+            std::chrono::steady_clock::time_point last_read_time {};
+        };
+
+        struct core_state_t {
+            std::vector<counter_t> counters;
+            std::size_t capacity;
+            // the index of the first counter in the enabled subset
+            std::size_t next {0};
+            bool started {false};
+        };
+
+        struct multiplexed_cluster_t {
+            std::vector<event_definition_t> events;
+            std::size_t capacity;
+        };
+
+        std::shared_ptr<perf_activator_t> perf_activator;
+        std::map<cpu_cluster_id_t, std::vector<event_definition_t>> group_events {};
+        std::map<cpu_cluster_id_t, multiplexed_cluster_t> multiplexed_events {};
+        std::mutex mutex {};
+        std::map<core_no_t, core_state_t> cores {};
+
+        /** @return True if the event is a group member that needs a PMU counter */
+        [[nodiscard]] static bool uses_pmu_counter(event_definition_t const & event)
+        {
+            // the group leader, and any stand alone events, are pinned
+            if (event.attr.pinned) {
+                return false;
+            }
+
+            switch (event.attr.type) {
+                case PERF_TYPE_SOFTWARE:
+                case PERF_TYPE_TRACEPOINT:
+                case PERF_TYPE_BREAKPOINT:
+                    return false;
+                default:
+                    return true;
+            }
+        }
+
+        /** @return True if the event samples (either by period or by frequency), rather than just counting */
+        [[nodiscard]] static bool is_sampling(event_definition_t const & event)
+        {
+            // sample_freq shares its storage with sample_period
+            return (event.attr.sample_period != 0);
+        }
+
+        /** Convert a group member (that does not sample) into a stand alone counting event */
+        [[nodiscard]] static event_definition_t make_counting_event(event_definition_t const & event)
+        {
+            auto result = event;
+
+            result.attr.pinned = 0;
+            result.attr.sample_type = 0;
+            result.attr.read_format = PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            return result;
+        }
+
+        template<typename Op>
+        static void for_each_in_subset(core_state_t & core_state, Op && op)
+        {
+            auto const count = core_state.counters.size();
+            auto const subset_size = std::min(core_state.capacity, count);
+
+            for (std::size_t n = 0; n < subset_size; ++n) {
+                op(core_state.counters[(core_state.next + n) % count]);
+            }
+        }
+
+        void enable_subset(core_state_t & core_state, bool enable)
+        {
+            for_each_in_subset(core_state, [this, enable](counter_t & counter) {
+                auto const fd = counter.fd->native_handle();
+                if (enable) {
+                    (void) perf_activator->start(fd);
+                }
+                else {
+                    perf_activator->stop(fd);
+                }
+            });
+        }
+    };
+}
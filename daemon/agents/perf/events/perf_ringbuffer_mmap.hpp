@@ -117,6 +117,8 @@ namespace agents::perf {
             aux_mapping = std::move(mapping);
         }
 
+        void reset_aux_mapping() { aux_mapping = {}; }
+
     private:
         std::size_t page_size = 0;
         mmap_ptr_t data_mapping {};
@@ -0,0 +1,271 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "Logging.h"
+#include "agents/perf/capture_configuration.h"
+#include "agents/perf/events/event_configuration.hpp"
+#include "agents/perf/events/perf_ringbuffer_mmap.hpp"
+#include "agents/perf/events/types.hpp"
+#include "lib/EnumUtils.h"
+#include "lib/Utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <sys/types.h>
+
+namespace agents::perf {
+
+    /**
+     * Keeps the per-core ring buffers, so that the header event of each activation reuses an existing (already
+     * allocated and locked) buffer rather than mapping a new one.
+     *
+     * The kernel removes a core's events when it goes offline, so the buffer cannot be owned by the header event (which
+     * must be recreated). Instead, each buffer is owned by a disabled event (the carrier), which never produces any
+     * records, and the header event of each activation redirects its output into it.
+     *
+     * The buffers come from two places. gator-main keeps a reserve of carriers between captures (see
+     * PerfRingbufferReserve), which the agent inherits; mapping one of those shares the buffer gator-main already
+     * allocated. Otherwise the carrier is a disabled copy of the header event, created the first time the core comes
+     * online, which is then reused if the core goes offline and comes back.
+     *
+     * Buffers for offline cores are 'parked'. The parked buffers are released (oldest first) when they would use more than
+     * a quarter of the memory that is currently available.
+     */
+    template<typename PerfActivator>
+    class perf_ringbuffer_pool_t {
+    public:
+        using perf_activator_t = PerfActivator;
+        using stream_descriptor_t = typename perf_activator_t::stream_descriptor_t;
+
+        /** The parked buffers may use at most 1/N of the available memory */
+        static constexpr std::uint64_t available_memory_fraction = 4;
+
+        /**
+         * Constructor
+         *
+         * @param perf_activator The perf activator
+         * @param carrier_event The event to copy for the carrier event (normally the header event)
+         * @param pid The pid value to create the carrier event with, which must match the header event
+         * @param inherited_carriers The carriers that gator-main reserved, by core
+         */
+        perf_ringbuffer_pool_t(
+            std::shared_ptr<perf_activator_t> perf_activator,
+            event_definition_t const & carrier_event,
+            pid_t pid,
+            std::map<core_no_t, perf_capture_configuration_t::ringbuffer_carrier_t> const & inherited_carriers)
+            : perf_activator(std::move(perf_activator)), carrier_event(carrier_event), pid(pid)
+        {
+            // adopt them straight away, so that nothing the agent runs inherits them
+            for (auto const & [no, carrier] : inherited_carriers) {
+                auto fd = this->perf_activator->adopt_event(carrier.fd, carrier.id);
+                if (fd == nullptr) {
+                    continue;
+                }
+
+                LOG_DEBUG("Adopted reserved ring buffer carrier for core %d", lib::toEnumValue(no));
+                entries.insert_or_assign(no, entry_t {std::move(fd), {}, ++last_parked_sequence});
+            }
+        }
+
+        /**
+         * Get the ring buffer for some core, and redirect the output of its header event into it.
+         *
+         * @param no The core no
+         * @param header_fd The header event for the core
+         * @return The ring buffer, or nullptr if none could be provided, in which case the header event is unchanged
+         * and the caller should map the header event directly.
+         */
+        [[nodiscard]] std::shared_ptr<perf_ringbuffer_mmap_t> acquire(core_no_t no, int header_fd)
+        {
+            if (auto result = acquire_parked(no, header_fd)) {
+                return result;
+            }
+
+            // reclaim space before allocating a new buffer
+            release_parked_under_pressure();
+
+            return acquire_new(no, header_fd);
+        }
+
+        /**
+         * Park the ring buffer for some core, once the core is offline.
+         *
+         * @param no The core no
+         */
+        void release(core_no_t no)
+        {
+            {
+                std::lock_guard lock {mutex};
+
+                auto it = entries.find(no);
+                if (it == entries.end()) {
+                    return;
+                }
+
+                it->second.parked_sequence = ++last_parked_sequence;
+            }
+
+            release_parked_under_pressure();
+        }
+
+    private:
+        struct entry_t {
+            /** The carrier event, which owns the buffer */
+            std::shared_ptr<stream_descriptor_t> carrier_fd;
+            /** The buffer, or nullptr for an inherited carrier that is not mapped yet */
+            std::shared_ptr<perf_ringbuffer_mmap_t> mmap;
+            /** Non-zero when the buffer is parked, and gives the order in which the buffers were parked */
+            std::uint64_t parked_sequence {0};
+        };
+
+        std::shared_ptr<perf_activator_t> perf_activator;
+        event_definition_t carrier_event;
+        pid_t pid;
+        std::mutex mutex {};
+        std::map<core_no_t, entry_t> entries {};
+        std::uint64_t last_parked_sequence {0};
+
+        /** @return The size of some buffer in bytes (an inherited buffer that is not mapped is held by gator-main) */
+        [[nodiscard]] static std::size_t buffer_size(std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap)
+        {
+            return (mmap != nullptr ? mmap->data_span().size() + mmap->aux_span().size() : 0);
+        }
+
+        /** Reuse the parked buffer for some core */
+        [[nodiscard]] std::shared_ptr<perf_ringbuffer_mmap_t> acquire_parked(core_no_t no, int header_fd)
+        {
+            std::unique_lock lock {mutex};
+
+            auto it = entries.find(no);
+            if (it == entries.end()) {
+                return {};
+            }
+
+            auto entry = std::move(it->second);
+            entries.erase(it);
+
+            // it must have been fully drained and removed from the consumer before it can be reused
+            if ((entry.parked_sequence == 0) || ((entry.mmap != nullptr) && (entry.mmap.use_count() != 1))) {
+                LOG_DEBUG("Not reusing ring buffer for core %d as it is still in use", lib::toEnumValue(no));
+                return {};
+            }
+
+            lock.unlock();
+
+            if (entry.mmap == nullptr) {
+                // the kernel shares the buffer gator-main already allocated, as long as the size is the same
+                entry.mmap = std::make_shared<perf_ringbuffer_mmap_t>(
+                    perf_activator->mmap_data(no, entry.carrier_fd->native_handle()));
+                if (!entry.mmap->has_data()) {
+                    LOG_DEBUG("Could not map the reserved ring buffer for core %d", lib::toEnumValue(no));
+                    return {};
+                }
+
+                // anything left in it is from a previous capture
+                auto * const header = entry.mmap->header();
+                auto const head = __atomic_load_n(&header->data_head, __ATOMIC_ACQUIRE);
+                __atomic_store_n(&header->data_tail, head, __ATOMIC_RELEASE);
+            }
+            else {
+                // the aux region belongs to the previous SPE event, so must be remapped by the new one
+                entry.mmap->reset_aux_mapping();
+            }
+
+            if (!perf_activator->set_output(header_fd, entry.carrier_fd->native_handle())) {
+                LOG_DEBUG("Could not redirect header to the parked ring buffer for core %d", lib::toEnumValue(no));
+                return {};
+            }
+
+            LOG_DEBUG("Reusing parked ring buffer for core %d", lib::toEnumValue(no));
+
+            entry.parked_sequence = 0;
+            auto result = entry.mmap;
+
+            lock.lock();
+            entries.emplace(no, std::move(entry));
+
+            return result;
+        }
+
+        /** Create a new carrier event and buffer for some core */
+        [[nodiscard]] std::shared_ptr<perf_ringbuffer_mmap_t> acquire_new(core_no_t no, int header_fd)
+        {
+            using enable_state_t = typename perf_activator_t::enable_state_t;
+            using event_creation_status_t = typename perf_activator_t::event_creation_status_t;
+
+            auto carrier = perf_activator->create_event(carrier_event, enable_state_t::disabled, no, pid, -1);
+            if (carrier.status != event_creation_status_t::success) {
+                LOG_DEBUG("Could not create the ring buffer carrier event for core %d", lib::toEnumValue(no));
+                return {};
+            }
+
+            auto mmap = std::make_shared<perf_ringbuffer_mmap_t>(
+                perf_activator->mmap_data(no, carrier.fd->native_handle()));
+            if (!mmap->has_data()) {
+                return {};
+            }
+
+            if (!perf_activator->set_output(header_fd, carrier.fd->native_handle())) {
+                LOG_DEBUG("Could not redirect header to the ring buffer carrier for core %d", lib::toEnumValue(no));
+                return {};
+            }
+
+            std::lock_guard lock {mutex};
+
+            entries.insert_or_assign(no, entry_t {std::move(carrier.fd), mmap});
+
+            return mmap;
+        }
+
+        /** Release the oldest parked buffers until they fit within the available memory limit */
+        void release_parked_under_pressure()
+        {
+            std::lock_guard lock {mutex};
+
+            std::size_t parked_bytes = 0;
+            for (auto const & entry : entries) {
+                if (entry.second.parked_sequence != 0) {
+                    parked_bytes += buffer_size(entry.second.mmap);
+                }
+            }
+
+            if (parked_bytes == 0) {
+                return;
+            }
+
+            auto const available = lib::readMemAvailable();
+            if (!available) {
+                return;
+            }
+
+            auto const limit = *available / available_memory_fraction;
+
+            while (parked_bytes > limit) {
+                auto oldest = entries.end();
+                for (auto it = entries.begin(); it != entries.end(); ++it) {
+                    if ((it->second.parked_sequence != 0)
+                        && ((oldest == entries.end())
+                            || (it->second.parked_sequence < oldest->second.parked_sequence))) {
+                        oldest = it;
+                    }
+                }
+
+                if (oldest == entries.end()) {
+                    break;
+                }
+
+                LOG_DEBUG("Releasing parked ring buffer for core %d due to memory pressure",
+                          lib::toEnumValue(oldest->first));
+
+                parked_bytes -= buffer_size(oldest->second.mmap);
+                entries.erase(oldest);
+            }
+        }
+    };
+}
@@ -13,6 +13,8 @@
 #include "lib/Assert.h"
 #include "lib/error_code_or.hpp"
 
+#include <algorithm>
+
 #include <boost/system/error_code.hpp>
 
 namespace agents::perf {
@@ -62,14 +64,55 @@ namespace agents::perf {
 
         // send the message
         return st->ipc_sink->async_send_message(ipc::msg_apc_frame_data_t {std::move(buffer)}, use_continuation) //
-             | then([head, tail](auto ec, auto /*msg*/) {
+             | then([st, head, tail](auto ec, auto msg) {
                    LOG_TRACE("... sent, ec=%s , head=%" PRIu64 " , tail=%" PRIu64, ec.message().c_str(), head, tail);
 
+                   // the write is complete, so the buffer can be reused
+                   st->buffer_pool->release(std::move(msg.suffix));
+
                    return std::make_tuple(head, tail, ec);
                })
              | unpack_tuple();
     }
 
+    async::continuations::polymorphic_continuation_t<std::uint64_t, std::uint64_t, boost::system::error_code>
+    perf_buffer_consumer_t::do_send_msgs(std::shared_ptr<perf_buffer_consumer_t> const & st,
+                                         int cpu,
+                                         std::deque<std::vector<char>> buffers,
+                                         std::uint64_t head,
+                                         std::uint64_t old_tail,
+                                         std::uint64_t new_tail)
+    {
+        using namespace async::continuations;
+
+        while ((!buffers.empty()) && buffers.front().empty()) {
+            buffers.pop_front();
+        }
+
+        if (buffers.empty()) {
+            return start_with(head, new_tail, boost::system::error_code {});
+        }
+
+        auto buffer = std::move(buffers.front());
+        buffers.pop_front();
+
+        if (buffers.empty()) {
+            return do_send_msg(st, cpu, std::move(buffer), head, new_tail);
+        }
+
+        // the tail must not move until the last message is sent
+        return do_send_msg(st, cpu, std::move(buffer), head, old_tail)
+             | then([st, cpu, buffers = std::move(buffers), new_tail](std::uint64_t head,
+                                                                      std::uint64_t tail,
+                                                                      boost::system::error_code ec) mutable
+                    -> polymorphic_continuation_t<std::uint64_t, std::uint64_t, boost::system::error_code> {
+                   if (ec) {
+                       return start_with(head, tail, ec);
+                   }
+                   return do_send_msgs(st, cpu, std::move(buffers), head, tail, new_tail);
+               });
+    }
+
     template<__u64 perf_event_mmap_page::*HeadField, __u64 perf_event_mmap_page::*TailField, typename Op>
     async::continuations::polymorphic_continuation_t<boost::system::error_code, bool>
     perf_buffer_consumer_t::do_send_common(std::shared_ptr<perf_buffer_consumer_t> const & st,
@@ -121,9 +164,65 @@ namespace agents::perf {
                });
     }
 
+    perf_buffer_consumer_t::aux_chunk_t perf_buffer_consumer_t::encode_aux_chunk(perf_ringbuffer_mmap_t const & mmap,
+                                                                                 int cpu,
+                                                                                 std::uint64_t header_head,
+                                                                                 std::uint64_t header_tail)
+    {
+        auto const aux_buffer = mmap.aux_span();
+
+        // find the data to send
+        auto [first_span, second_span] =
+            extract_one_perf_aux_apc_frame_data_span_pair(aux_buffer, header_head, header_tail);
+
+        // if the producer has lapped the consumer then the oldest data is already overwritten, and the chunk starts later
+        auto const chunk_offset =
+            header_head - std::min<std::uint64_t>(header_head - header_tail, aux_buffer.size());
+        auto const combined_size = first_span.size() + second_span.size();
+
+        aux_chunk_t chunk {{}, chunk_offset + combined_size};
+
+        if (!spe_filter) {
+            // encode the message
+            auto [new_tail, buffer] =
+                encode_one_perf_aux_apc_frame(cpu, first_span, second_span, chunk_offset, *buffer_pool);
+            (void) new_tail;
+
+            runtime_assert(!buffer.empty(), "Expected some apc frame data");
+
+            chunk.buffers.emplace_back(std::move(buffer));
+            return chunk;
+        }
+
+        // filter the records on target, then send each run of kept records at the offset that it was read from, so that
+        // the gaps between the frames are exactly the records that were dropped
+        auto records = buffer_pool->acquire(combined_size);
+        std::vector<spe_record_run_t> runs {};
+
+        spe_filter->filter(cpu, chunk_offset, first_span, second_span, records, runs);
+
+        std::size_t position = 0;
+        for (auto const & run : runs) {
+            auto [unused_tail, buffer] = encode_one_perf_aux_apc_frame(cpu,
+                                                                       {records.data() + position, run.size},
+                                                                       {},
+                                                                       run.offset,
+                                                                       *buffer_pool);
+            (void) unused_tail;
+
+            chunk.buffers.emplace_back(std::move(buffer));
+            position += run.size;
+        }
+
+        buffer_pool->release(std::move(records));
+
+        return chunk;
+    }
+
     async::continuations::polymorphic_continuation_t<boost::system::error_code, bool>
     perf_buffer_consumer_t::do_send_aux_section(std::shared_ptr<perf_buffer_consumer_t> const & st,
                                                 std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
+                                                std::shared_ptr<aux_drain_strand_t> const & aux_strand,
                                                 int cpu,
                                                 boost::system::error_code ec_from_data,
                                                 bool modified_from_data)
@@ -140,15 +239,17 @@ namespace agents::perf {
             return start_with(boost::system::error_code {}, modified_from_data);
         }
 
+        runtime_assert(aux_strand != nullptr, "Expected an aux drain worker for the cpu");
+
         LOG_TRACE("Sending aux data for %d", cpu);
 
         return do_send_common<&perf_event_mmap_page::aux_head, &perf_event_mmap_page::aux_tail>(
             st,
             mmap,
             cpu,
-            [st, mmap, cpu](std::uint64_t const header_head,
-                            std::uint64_t const header_tail,
-                            boost::system::error_code ec)
+            [st, mmap, aux_strand, cpu](std::uint64_t const header_head,
+                                        std::uint64_t const header_tail,
+                                        boost::system::error_code ec)
                 -> polymorphic_continuation_t<std::uint64_t, std::uint64_t, boost::system::error_code> {
                 //
                 LOG_TRACE("Sending aux chunk for cpu=%d , head=%" PRIu64 " , tail=%" PRIu64,
@@ -156,24 +257,40 @@ namespace agents::perf {
                           header_head,
                           header_tail);
 
-                auto const aux_buffer = mmap->aux_span();
-
                 if (header_head <= header_tail) {
                     return start_with(header_head, header_head, ec);
                 }
 
-                // find the data to send
-                auto [first_span, second_span] =
-                    extract_one_perf_aux_apc_frame_data_span_pair(aux_buffer, header_head, header_tail);
+                // copy the data out of the ringbuffer on the cpu's own worker, then send it
+                return async_encode_aux_chunk(st, mmap, aux_strand, cpu, header_head, header_tail, use_continuation) //
+                     | then([st, cpu, header_head, header_tail](std::shared_ptr<aux_chunk_t> const & chunk) {
+                           return do_send_msgs(st,
+                                               cpu,
+                                               std::move(chunk->buffers),
+                                               header_head,
+                                               header_tail,
+                                               chunk->new_tail);
+                       });
+            });
+    }
 
-                // encode the message
-                auto [new_tail, buffer] = encode_one_perf_aux_apc_frame(cpu, first_span, second_span, header_tail);
+    void perf_buffer_consumer_t::append_derived_metric_frames(std::shared_ptr<perf_buffer_consumer_t> const & st,
+                                                              std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
+                                                              int cpu,
+                                                              std::uint64_t new_tail,
+                                                              std::uint64_t header_tail,
+                                                              std::deque<std::vector<char>> & buffers)
+    {
+        if (!st->derived_metrics) {
+            return;
+        }
 
-                runtime_assert(!buffer.empty(), "Expected some apc frame data");
+        auto metric_buffers =
+            extract_perf_derived_metric_apc_frames(cpu, mmap->data_span(), new_tail, header_tail, *st->derived_metrics);
 
-                // send it
-                return do_send_msg(st, cpu, std::move(buffer), header_head, new_tail);
-            });
+        buffers.insert(buffers.end(),
+                       std::make_move_iterator(metric_buffers.begin()),
+                       std::make_move_iterator(metric_buffers.end()));
     }
 
     async::continuations::polymorphic_continuation_t<boost::system::error_code, bool>
@@ -203,13 +320,61 @@ namespace agents::perf {
                     return start_with(header_head, header_head, ec);
                 }
 
+                // aggregate the samples, sending any completed histograms before the remaining records
+                if (st->sample_aggregator) {
+                    auto [new_tail, aggregate_buffers, buffer] =
+                        extract_one_perf_data_apc_frame(cpu,
+                                                        mmap->data_span(),
+                                                        header_head,
+                                                        header_tail,
+                                                        *st->sample_aggregator,
+                                                        *st->buffer_pool);
+
+                    std::deque<std::vector<char>> buffers {std::make_move_iterator(aggregate_buffers.begin()),
+                                                           std::make_move_iterator(aggregate_buffers.end())};
+                    buffers.emplace_back(std::move(buffer));
+                    append_derived_metric_frames(st, mmap, cpu, new_tail, header_tail, buffers);
+
+                    // the samples are already counted in the aggregator, so the tail moves past them even if a send
+                    // fails, otherwise the next poll would read them again and count them twice
+                    return do_send_msgs(st, cpu, std::move(buffers), header_head, new_tail, new_tail);
+                }
+
+                // encode the data into an apc frame, preceded by any newly interned callchains
+                if (st->callchain_interner) {
+                    auto [new_tail, dictionary_buffer, buffer] =
+                        extract_one_perf_data_apc_frame(cpu,
+                                                        mmap->data_span(),
+                                                        header_head,
+                                                        header_tail,
+                                                        *st->callchain_interner,
+                                                        *st->buffer_pool);
+
+                    runtime_assert(!buffer.empty(), "Expected some apc frame data");
+
+                    std::deque<std::vector<char>> buffers {};
+                    buffers.emplace_back(std::move(dictionary_buffer));
+                    buffers.emplace_back(std::move(buffer));
+                    append_derived_metric_frames(st, mmap, cpu, new_tail, header_tail, buffers);
+
+                    return do_send_msgs(st, cpu, std::move(buffers), header_head, header_tail, new_tail);
+                }
+
                 // encode the data into an apc frame
                 auto [new_tail, buffer] =
-                    extract_one_perf_data_apc_frame(cpu, mmap->data_span(), header_head, header_tail);
+                    extract_one_perf_data_apc_frame(cpu, mmap->data_span(), header_head, header_tail, *st->buffer_pool);
 
                 runtime_assert(!buffer.empty(), "Expected some apc frame data");
 
-                // send it
+                // send it, followed by the values of any metrics computed from its samples
+                if (st->derived_metrics) {
+                    std::deque<std::vector<char>> buffers {};
+                    buffers.emplace_back(std::move(buffer));
+                    append_derived_metric_frames(st, mmap, cpu, new_tail, header_tail, buffers);
+
+                    return do_send_msgs(st, cpu, std::move(buffers), header_head, header_tail, new_tail);
+                }
+
                 return do_send_msg(st, cpu, std::move(buffer), header_head, new_tail);
             });
     }
@@ -217,6 +382,7 @@ namespace agents::perf {
     [[nodiscard]] async::continuations::polymorphic_continuation_t<boost::system::error_code>
     perf_buffer_consumer_t::do_poll(std::shared_ptr<perf_buffer_consumer_t> const & st,
                                     std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
+                                    std::shared_ptr<aux_drain_strand_t> const & aux_strand,
                                     int cpu)
     {
         using namespace async::continuations;
@@ -224,12 +390,12 @@ namespace agents::perf {
         // SDDAP-11384, read data before aux
 
         return do_send_data_section(st, mmap, cpu) //
-             | then([st, mmap, cpu](boost::system::error_code const & ec, bool modified) {
-                   return do_send_aux_section(st, mmap, cpu, ec, modified);
+             | then([st, mmap, aux_strand, cpu](boost::system::error_code const & ec, bool modified) {
+                   return do_send_aux_section(st, mmap, aux_strand, cpu, ec, modified);
                })                  //
              | post_on(st->strand) //
-             | then([st, mmap, cpu](boost::system::error_code const & ec,
-                                    bool modified) mutable -> polymorphic_continuation_t<boost::system::error_code> {
+             | then([st, mmap, aux_strand, cpu](boost::system::error_code const & ec, bool modified) mutable
+                    -> polymorphic_continuation_t<boost::system::error_code> {
                    // not removed / error path
                    if ((ec) || (st->removed_cpus.count(cpu) <= 0)) {
                        // mark it as no longer busy
@@ -249,12 +415,37 @@ namespace agents::perf {
                                   // only continue to iterate if no error and last iteration indicates modified ringbuffer data
                                   return start_with(modified && !ec, ec, modified);
                               },
-                              [st, mmap, cpu](boost::system::error_code const & /*ec*/, bool /*modified*/) {
+                              [st, mmap, aux_strand, cpu](boost::system::error_code const & /*ec*/,
+                                                          bool /*modified*/) {
                                   return do_send_data_section(st, mmap, cpu) //
-                                       | then([st, mmap, cpu](boost::system::error_code e, bool m) {
-                                             return do_send_aux_section(st, mmap, cpu, e, m);
+                                       | then([st, mmap, aux_strand, cpu](boost::system::error_code e, bool m) {
+                                             return do_send_aux_section(st, mmap, aux_strand, cpu, e, m);
                                          });
                               })
+                        | then([st, cpu](boost::system::error_code const & ec, bool modified)
+                                   -> polymorphic_continuation_t<boost::system::error_code, bool> {
+                              if (ec || !st->sample_aggregator) {
+                                  return start_with(ec, modified);
+                              }
+
+                              // send the partial histogram for the last interval
+                              auto aggregate_buffers = encode_perf_aggregate_apc_frames(
+                                  cpu,
+                                  st->sample_aggregator->get_interval_ns(),
+                                  st->sample_aggregator->flush(cpu),
+                                  *st->buffer_pool);
+
+                              return do_send_msgs(st,
+                                                  cpu,
+                                                  {std::make_move_iterator(aggregate_buffers.begin()),
+                                                   std::make_move_iterator(aggregate_buffers.end())},
+                                                  0,
+                                                  0,
+                                                  0)
+                                   | then([modified](std::uint64_t /*head*/,
+                                                     std::uint64_t /*tail*/,
+                                                     boost::system::error_code ec) { return start_with(ec, modified); });
+                          })
                         | post_on(st->strand) //
                         | then([st, cpu](boost::system::error_code const & ec, bool /*modified*/) {
                               LOG_TRACE("Remove mmap completed for %d (poll ec =%s)", cpu, ec.message().c_str());
@@ -262,6 +453,10 @@ namespace agents::perf {
                               st->busy_cpus.erase(cpu);
                               // remove it
                               st->per_cpu_mmaps.erase(cpu);
+                              st->aux_drain_strands.erase(cpu);
+                              if (st->derived_metrics) {
+                                  st->derived_metrics->reset(cpu);
+                              }
                               return ec;
                           });
                });
@@ -3,8 +3,13 @@
 #pragma once
 
 #include "Logging.h"
+#include "agents/perf/apc_buffer_pool.hpp"
 #include "agents/perf/events/perf_ringbuffer_mmap.hpp"
+#include "agents/perf/perf_callchain_interner.hpp"
+#include "agents/perf/perf_derived_metrics.hpp"
+#include "agents/perf/perf_sample_aggregator.hpp"
 #include "agents/perf/record_types.h"
+#include "agents/perf/spe_record_filter.hpp"
 #include "async/continuations/async_initiate.h"
 #include "async/continuations/continuation.h"
 #include "async/continuations/continuation_of.h"
@@ -13,28 +18,65 @@
 #include "async/continuations/use_continuation.h"
 #include "ipc/raw_ipc_channel_sink.h"
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
+#include <map>
 #include <memory>
 #include <set>
+#include <thread>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/system/errc.hpp>
 #include <boost/system/error_code.hpp>
 
 namespace agents::perf {
+    namespace detail {
+        /** The most threads that aux data is drained on in parallel */
+        constexpr std::size_t max_aux_drain_threads = 8;
+
+        /**
+         * @return The pool that the aux data of every cpu is drained on. It is shared by all captures in the process,
+         * and is not owned by the consumer so that it is never destroyed by one of its own threads.
+         */
+        inline boost::asio::thread_pool & get_aux_drain_pool()
+        {
+            static boost::asio::thread_pool pool {
+                std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, max_aux_drain_threads)};
+            return pool;
+        }
+    }
+
     /**
      * This class consumes the contents of the perf mmap ringbuffers, outputing perf data apc frames and perf aux apc frames.
      * It is not responsible for monitoring of the perf file descriptors / periodic timer (these are handled elsewhere), but it provides
      * an interface where some other caller can trigger the data in the ringbuffer(s) to be consumed.
+     *
+     * The aux data of each cpu is copied (and filtered) by a worker for that cpu, being a strand on the aux drain pool,
+     * so that the aux data of several cpus is drained in parallel and off the io context's threads.
      */
     class perf_buffer_consumer_t : public std::enable_shared_from_this<perf_buffer_consumer_t> {
     public:
         perf_buffer_consumer_t(boost::asio::io_context & context,
                                std::shared_ptr<ipc::raw_ipc_channel_sink_t> ipc_sink,
-                               std::size_t one_shot_mode_limit)
-            : one_shot_mode_limit(one_shot_mode_limit), ipc_sink(std::move(ipc_sink)), strand(context)
+                               std::size_t one_shot_mode_limit,
+                               std::shared_ptr<apc_buffer_pool_t> buffer_pool,
+                               std::shared_ptr<perf_callchain_interner_t> callchain_interner = {},
+                               std::shared_ptr<perf_sample_aggregator_t> sample_aggregator = {},
+                               std::shared_ptr<spe_record_filter_t> spe_filter = {},
+                               std::shared_ptr<perf_derived_metrics_t> derived_metrics = {})
+            : one_shot_mode_limit(one_shot_mode_limit),
+              buffer_pool(std::move(buffer_pool)),
+              callchain_interner(std::move(callchain_interner)),
+              sample_aggregator(std::move(sample_aggregator)),
+              spe_filter(std::move(spe_filter)),
+              derived_metrics(std::move(derived_metrics)),
+              ipc_sink(std::move(ipc_sink)),
+              strand(context)
         {
         }
 
@@ -64,7 +106,6 @@ namespace agents::perf {
 
                                // insert it into the map
                                auto [it, inserted] = st->per_cpu_mmaps.try_emplace(cpu, std::move(mmap));
-                               (void) it;
 
                                if (!inserted) {
                                    LOG_DEBUG("... failed, as already has mmap");
@@ -72,6 +113,13 @@ namespace agents::perf {
                                        boost::system::errc::device_or_resource_busy);
                                }
 
+                               if (it->second->has_aux()) {
+                                   st->aux_drain_strands.try_emplace(
+                                       cpu,
+                                       std::make_shared<aux_drain_strand_t>(
+                                           detail::get_aux_drain_pool().get_executor()));
+                               }
+
                                // success
                                return boost::system::error_code {};
                            });
@@ -113,7 +161,12 @@ namespace agents::perf {
                                }
 
                                // ok, poll it
-                               return do_poll(st, mmap_it->second, cpu);
+                               auto const aux_strand_it = st->aux_drain_strands.find(cpu);
+                               return do_poll(st,
+                                              mmap_it->second,
+                                              (aux_strand_it != st->aux_drain_strands.end() ? aux_strand_it->second
+                                                                                           : nullptr),
+                                              cpu);
                            });
                 },
                 token);
@@ -246,6 +299,16 @@ namespace agents::perf {
         }
 
     private:
+        using aux_drain_strand_t = boost::asio::strand<boost::asio::thread_pool::executor_type>;
+
+        /** The frames that one chunk of aux data is encoded into */
+        struct aux_chunk_t {
+            /** The encoded frames, which are sent in order; there are none if no records were kept */
+            std::deque<std::vector<char>> buffers;
+            /** The new value for aux_tail once the frames are sent */
+            std::uint64_t new_tail;
+        };
+
         /**
          * Send one apc_frame IPC message, returns the head, new-tail and error code as required at the end of each send loop iteration
          *
@@ -263,6 +326,25 @@ namespace agents::perf {
                     std::uint64_t head,
                     std::uint64_t tail);
 
+        /**
+         * Send a sequence of apc_frame IPC messages in order, stopping at the first error
+         *
+         * @param st The this pointer for the perf_buffer_consumer_t that made the request
+         * @param cpu The cpu associated with the request
+         * @param buffers The apc_frame data buffers; any empty buffers are skipped
+         * @param head The aux_head or data_head value
+         * @param old_tail The aux_tail or data_tail value, which is produced if any message other than the last fails
+         * @param new_tail The new value for aux_tail or data_tail after the last send completes
+         * @return A continuation producing the head, new-tail and error code values
+         */
+        static async::continuations::polymorphic_continuation_t<std::uint64_t, std::uint64_t, boost::system::error_code>
+        do_send_msgs(std::shared_ptr<perf_buffer_consumer_t> const & st,
+                     int cpu,
+                     std::deque<std::vector<char>> buffers,
+                     std::uint64_t head,
+                     std::uint64_t old_tail,
+                     std::uint64_t new_tail);
+
         /**
          * Common to both aux and data send loops, this function will extract the head and tail field, then iterate over the buffer until tail == head, sending some chunk and then moving tail
          *
@@ -281,12 +363,63 @@ namespace agents::perf {
             int cpu,
             Op && op);
 
+        /**
+         * Copy one chunk of aux data into apc_frame messages, keeping only the records that pass the SPE filter (if
+         * there is one)
+         *
+         * @param mmap The mmap object
+         * @param cpu The cpu associated with the mmap
+         * @param header_head The aux_head value
+         * @param header_tail The aux_tail value
+         */
+        [[nodiscard]] aux_chunk_t encode_aux_chunk(perf_ringbuffer_mmap_t const & mmap,
+                                                   int cpu,
+                                                   std::uint64_t header_head,
+                                                   std::uint64_t header_tail);
+
+        /**
+         * Encode one chunk of aux data on the cpu's aux drain worker, completing on the io context
+         *
+         * @return A continuation producing the encoded chunk
+         */
+        template<typename CompletionToken>
+        static auto async_encode_aux_chunk(std::shared_ptr<perf_buffer_consumer_t> const & st,
+                                           std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
+                                           std::shared_ptr<aux_drain_strand_t> const & aux_strand,
+                                           int cpu,
+                                           std::uint64_t header_head,
+                                           std::uint64_t header_tail,
+                                           CompletionToken && token)
+        {
+            using namespace async::continuations;
+
+            return async_initiate_explicit<void(std::shared_ptr<aux_chunk_t>)>(
+                [st, mmap, aux_strand, cpu, header_head, header_tail](auto && sc) {
+                    boost::asio::post(
+                        *aux_strand,
+                        [st, mmap, cpu, header_head, header_tail, sc = sc.move()]() mutable {
+                            std::shared_ptr<aux_chunk_t> chunk;
+                            try {
+                                chunk = std::make_shared<aux_chunk_t>(
+                                    st->encode_aux_chunk(*mmap, cpu, header_head, header_tail));
+                            }
+                            catch (...) {
+                                sc.get_exceptionally()(std::current_exception());
+                                return;
+                            }
+                            resume_continuation(st->strand.context(), std::move(sc), std::move(chunk));
+                        });
+                },
+                std::forward<CompletionToken>(token));
+        }
+
         /**
          * Read and send the aux section
          */
         static async::continuations::polymorphic_continuation_t<boost::system::error_code, bool> do_send_aux_section(
             std::shared_ptr<perf_buffer_consumer_t> const & st,
             std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
+            std::shared_ptr<aux_drain_strand_t> const & aux_strand,
             int cpu,
             boost::system::error_code ec_from_data,
             bool modified_from_data);
@@ -299,23 +432,42 @@ namespace agents::perf {
             std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
             int cpu);
 
+        /**
+         * Append the COUNTERS frames for any derived metrics computed from the samples in [header_tail, new_tail) to
+         * the buffers that are about to be sent
+         */
+        static void append_derived_metric_frames(std::shared_ptr<perf_buffer_consumer_t> const & st,
+                                                 std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
+                                                 int cpu,
+                                                 std::uint64_t new_tail,
+                                                 std::uint64_t header_tail,
+                                                 std::deque<std::vector<char>> & buffers);
+
         /**
          * Construct the poll operation for one cpu
          *
          * @param st The shared this
          * @param mmap The mmap being read from
+         * @param aux_strand The cpu's aux drain worker, if the mmap has an aux section
          * @param cpu The cpu to poll
          */
         [[nodiscard]] static async::continuations::polymorphic_continuation_t<boost::system::error_code> do_poll(
             std::shared_ptr<perf_buffer_consumer_t> const & st,
             std::shared_ptr<perf_ringbuffer_mmap_t> const & mmap,
+            std::shared_ptr<aux_drain_strand_t> const & aux_strand,
             int cpu);
 
         std::atomic_size_t cumulative_bytes_sent_apc_frames {0};
         std::size_t one_shot_mode_limit {0};
+        std::shared_ptr<apc_buffer_pool_t> buffer_pool;
+        std::shared_ptr<perf_callchain_interner_t> callchain_interner;
+        std::shared_ptr<perf_sample_aggregator_t> sample_aggregator;
+        std::shared_ptr<spe_record_filter_t> spe_filter;
+        std::shared_ptr<perf_derived_metrics_t> derived_metrics;
         std::set<int> busy_cpus {};
         std::set<int> removed_cpus {};
         std::map<int, std::shared_ptr<perf_ringbuffer_mmap_t>> per_cpu_mmaps {};
+        std::map<int, std::shared_ptr<aux_drain_strand_t>> aux_drain_strands {};
         std::shared_ptr<ipc::raw_ipc_channel_sink_t> ipc_sink;
         async::continuations::stored_continuation_t<> one_shot_mode_observer {};
         boost::asio::io_context::strand strand;
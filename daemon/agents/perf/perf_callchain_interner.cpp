@@ -0,0 +1,119 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "agents/perf/perf_callchain_interner.hpp"
+
+#include "Logging.h"
+#include "k/perf_event.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace agents::perf {
+
+    namespace {
+        constexpr std::uint64_t fnv_offset_basis = 0xcbf29ce484222325ULL;
+        constexpr std::uint64_t fnv_prime = 0x100000001b3ULL;
+
+        /** FNV-1a over whole words; collisions are resolved by comparing the stored callchains */
+        [[nodiscard]] std::uint64_t hash_callchain(lib::Span<data_word_t const> callchain)
+        {
+            std::uint64_t hash = fnv_offset_basis;
+            for (auto word : callchain) {
+                hash = (hash ^ word) * fnv_prime;
+            }
+            return hash;
+        }
+    }
+
+    perf_callchain_interner_t::frame_context_t perf_callchain_interner_t::begin_frame(int cpu,
+                                                                                      std::size_t max_dictionary_words)
+    {
+        auto layouts = sample_layouts->snapshot();
+
+        std::lock_guard lock {mutex};
+
+        return {std::move(layouts), per_cpu_states[cpu], max_dictionary_words};
+    }
+
+    bool perf_callchain_interner_t::frame_context_t::intern(lib::Span<data_word_t const> record,
+                                                            std::vector<data_word_t> & rewritten)
+    {
+        auto const * layout = perf_sample_layouts_t::find(*layouts, record);
+        if (layout == nullptr) {
+            return false;
+        }
+
+        perf_sample_field_indexes_t indexes {};
+        if (!find_perf_sample_field_indexes(*layout, record, indexes) || (indexes.callchain == 0)) {
+            return false;
+        }
+
+        auto const index = indexes.callchain;
+        auto const nr = record[index];
+        if (nr < min_callchain_length) {
+            return false;
+        }
+
+        auto const id = find_or_insert(record.subspan(index, nr + 1));
+        if (id == 0) {
+            return false;
+        }
+
+        auto const * const callchain_end = record.data() + index + 1 + nr;
+
+        rewritten.clear();
+        rewritten.insert(rewritten.end(), record.data(), record.data() + index);
+        rewritten.push_back(2);
+        rewritten.push_back(interned_callchain_context);
+        rewritten.push_back(id);
+        rewritten.insert(rewritten.end(), callchain_end, record.data() + record.size());
+
+        perf_event_header header;
+        std::memcpy(&header, record.data(), sizeof(header));
+        header.size = rewritten.size() * sizeof(data_word_t);
+        std::memcpy(rewritten.data(), &header, sizeof(header));
+
+        return true;
+    }
+
+    std::uint32_t perf_callchain_interner_t::frame_context_t::find_or_insert(lib::Span<data_word_t const> callchain)
+    {
+        auto const hash = hash_callchain(callchain);
+        auto & ids = state.ids_by_hash[hash];
+
+        for (auto id : ids) {
+            auto const offset = state.callchain_offsets[id - 1];
+            auto const * const stored = state.callchain_words.data() + offset;
+            if (std::equal(callchain.begin(), callchain.end(), stored, stored + callchain.size())) {
+                return id;
+            }
+        }
+
+        // new callchain; check it can be stored and sent
+        if ((state.callchain_offsets.size() >= max_callchains_per_cpu)
+            || (state.pending_dictionary_words.size() + callchain.size() + 1 > max_dictionary_words)) {
+            if (ids.empty()) {
+                state.ids_by_hash.erase(hash);
+            }
+            return 0;
+        }
+
+        auto const id = std::uint32_t(state.callchain_offsets.size() + 1);
+
+        state.callchain_offsets.push_back(state.callchain_words.size());
+        state.callchain_words.insert(state.callchain_words.end(), callchain.begin(), callchain.end());
+        ids.push_back(id);
+
+        state.pending_dictionary_words.push_back(id);
+        state.pending_dictionary_words.insert(state.pending_dictionary_words.end(), callchain.begin(), callchain.end());
+        state.pending_dictionary_count += 1;
+
+        return id;
+    }
+
+    std::pair<std::size_t, std::vector<data_word_t>> perf_callchain_interner_t::frame_context_t::take_pending_dictionary()
+    {
+        auto const count = std::exchange(state.pending_dictionary_count, 0);
+        return {count, std::exchange(state.pending_dictionary_words, {})};
+    }
+}
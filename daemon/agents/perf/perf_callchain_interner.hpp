@@ -0,0 +1,112 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "agents/perf/perf_sample_layout.hpp"
+#include "agents/perf/record_types.h"
+#include "lib/Span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace agents::perf {
+
+    /**
+     * Replaces repeated PERF_SAMPLE_CALLCHAIN sections of sample records with a reference to a previously sent copy.
+     *
+     * Each unique callchain seen on a cpu is assigned an id (unique per cpu, starting at 1) and is emitted once in a
+     * PERF_CALLCHAINS apc frame, which is always sent before the PERF_DATA frame that first references it. In the
+     * sample record the callchain `{ nr, ips[nr] }` is then rewritten as `{ 2, interned_callchain_context, id }` and
+     * the record header size adjusted to match; all other fields are left unchanged.
+     *
+     * Samples that cannot be decoded (see perf_sample_layouts_t) are passed through unmodified, as are samples once
+     * the per-cpu table is full.
+     */
+    class perf_callchain_interner_t {
+    public:
+        /** Marks an interned callchain. Lies in the range reserved for PERF_CONTEXT_* markers, but is not used by the kernel */
+        static constexpr data_word_t interned_callchain_context = static_cast<data_word_t>(-4000);
+        /** The maximum number of unique callchains to store per cpu */
+        static constexpr std::size_t max_callchains_per_cpu = 65536;
+        /** Callchains shorter than this are not worth interning */
+        static constexpr std::size_t min_callchain_length = 3;
+
+        /** Per cpu state; only accessed by the thread currently consuming that cpu's ringbuffer */
+        struct per_cpu_state_t {
+            /** Map from callchain hash to the ids with that hash */
+            std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> ids_by_hash {};
+            /** For each id - 1, the offset into `callchain_words` of its `nr` word */
+            std::vector<std::size_t> callchain_offsets {};
+            /** The stored callchains, each as `nr, ips[nr]` */
+            std::vector<data_word_t> callchain_words {};
+            /** The dictionary entries not yet sent, each as `id, nr, ips[nr]` */
+            std::vector<data_word_t> pending_dictionary_words {};
+            /** The number of entries in `pending_dictionary_words` */
+            std::size_t pending_dictionary_count {};
+        };
+
+        /** Interns the records for one frame on one cpu */
+        class frame_context_t {
+        public:
+            frame_context_t(std::shared_ptr<perf_sample_layouts_t::layout_map_t const> layouts,
+                            per_cpu_state_t & state,
+                            std::size_t max_dictionary_words)
+                : layouts(std::move(layouts)), state(state), max_dictionary_words(max_dictionary_words)
+            {
+            }
+
+            /**
+             * Intern the callchain in one record
+             *
+             * @param record The complete record, including its header, as u64 words
+             * @param rewritten Receives the rewritten record, if it was interned
+             * @return True if the record was rewritten into `rewritten`, false if it should be sent as is
+             */
+            [[nodiscard]] bool intern(lib::Span<data_word_t const> record, std::vector<data_word_t> & rewritten);
+
+            /** @return True if there are dictionary entries to send before the frame */
+            [[nodiscard]] bool has_pending_dictionary() const { return state.pending_dictionary_count > 0; }
+
+            /** Move the pending dictionary entries out, as `id, nr, ips[nr]` tuples */
+            [[nodiscard]] std::pair<std::size_t, std::vector<data_word_t>> take_pending_dictionary();
+
+        private:
+            std::shared_ptr<perf_sample_layouts_t::layout_map_t const> layouts;
+            per_cpu_state_t & state;
+            std::size_t max_dictionary_words;
+
+            /** Find or insert the callchain, returning its id, or 0 if it could not be inserted */
+            [[nodiscard]] std::uint32_t find_or_insert(lib::Span<data_word_t const> callchain);
+        };
+
+        /**
+         * Constructor
+         *
+         * @param sample_layouts The sample layouts for the capture
+         */
+        explicit perf_callchain_interner_t(std::shared_ptr<perf_sample_layouts_t> sample_layouts)
+            : sample_layouts(std::move(sample_layouts))
+        {
+        }
+
+        /**
+         * Start interning the records for one frame
+         *
+         * @param cpu The cpu the ringbuffer belongs to
+         * @param max_dictionary_words The maximum number of words that may be pending in the dictionary
+         * @return The frame context, which must not outlive this object
+         */
+        [[nodiscard]] frame_context_t begin_frame(int cpu, std::size_t max_dictionary_words);
+
+    private:
+        std::shared_ptr<perf_sample_layouts_t> sample_layouts;
+        std::mutex mutex {};
+        std::map<int, per_cpu_state_t> per_cpu_states {};
+    };
+}
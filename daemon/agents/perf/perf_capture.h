@@ -7,14 +7,21 @@
 #include "Time.h"
 #include "agents/common/nl_cpu_monitor.h"
 #include "agents/common/polling_cpu_monitor.h"
+#include "agents/perf/apc_buffer_pool.hpp"
 #include "agents/perf/capture_configuration.h"
 #include "agents/perf/cpu_info.h"
 #include "agents/perf/cpufreq_counter.h"
 #include "agents/perf/events/event_binding_manager.hpp"
 #include "agents/perf/events/perf_activator.hpp"
+#include "agents/perf/perf_callchain_interner.hpp"
+#include "agents/perf/perf_derived_metrics.hpp"
+#include "agents/perf/perf_sample_aggregator.hpp"
+#include "agents/perf/perf_sample_layout.hpp"
 #include "agents/perf/perf_capture_cpu_monitor.h"
 #include "agents/perf/perf_capture_helper.h"
 #include "agents/perf/perf_driver_summary.h"
+#include "agents/perf/perf_frame_packer.hpp"
+#include "agents/perf/spe_record_filter.hpp"
 #include "agents/perf/sync_generator.h"
 #include "apc/misc_apc_frame_ipc_sender.h"
 #include "apc/summary_apc_frame_utils.h"
@@ -28,6 +35,7 @@
 #include "lib/Assert.h"
 #include "lib/Utils.h"
 
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <set>
@@ -82,6 +90,29 @@ namespace agents::perf {
               ipc_sink(std::move(sink)),
               configuration(std::move(conf)),
               perf_activator(std::make_shared<perf_activator_t>(configuration, context)),
+              buffer_pool(std::make_shared<apc_buffer_pool_t>()),
+              sample_layouts(((configuration->session_data.aggregate_samples_interval_ms > 0)
+                              || configuration->session_data.intern_call_stacks || configuration->derived_metrics)
+                                 ? std::make_shared<perf_sample_layouts_t>(configuration->event_configuration)
+                                 : nullptr),
+              sample_aggregator((configuration->session_data.aggregate_samples_interval_ms > 0)
+                                    ? std::make_shared<perf_sample_aggregator_t>(
+                                        sample_layouts,
+                                        std::uint64_t(configuration->session_data.aggregate_samples_interval_ms)
+                                            * NS_PER_MS)
+                                    : nullptr),
+              // aggregated samples are not sent individually, so there is nothing to intern
+              callchain_interner(((!sample_aggregator) && configuration->session_data.intern_call_stacks)
+                                     ? std::make_shared<perf_callchain_interner_t>(sample_layouts)
+                                     : nullptr),
+              derived_metrics(configuration->derived_metrics
+                                  ? std::make_shared<perf_derived_metrics_t>(configuration->derived_metrics,
+                                                                             sample_layouts)
+                                  : nullptr),
+              spe_filter(configuration->session_data.spe_record_filter.is_enabled()
+                             ? std::make_shared<spe_record_filter_t>(configuration->session_data.spe_record_filter,
+                                                                     max_perf_aux_apc_frame_payload_size())
+                             : nullptr),
               perf_capture_helper(std::make_shared<perf_capture_helper_t>(
                   configuration,
                   context,
@@ -91,22 +122,36 @@ namespace agents::perf {
                       context,
                       ipc_sink,
                       perf_activator,
-                      configuration->session_data.live_rate,
+                      // the flight recorder ages data out by when it arrives, so it must arrive promptly
+                      (configuration->session_data.live_rate != 0) || configuration->session_data.flight_recorder,
                       (configuration->session_data.one_shot ? configuration->session_data.total_buffer_size * MEGABYTES
-                                                            : 0)),
+                                                            : 0),
+                      buffer_pool,
+                      callchain_interner,
+                      sample_aggregator,
+                      spe_filter,
+                      derived_metrics),
                   perf_capture_events_helper_t(configuration,
                                                event_binding_manager_t(perf_activator,
                                                                        configuration->event_configuration,
                                                                        configuration->uncore_pmus,
                                                                        configuration->per_core_spe_type,
                                                                        configuration->perf_config.is_system_wide,
-                                                                       configuration->enable_on_exec),
+                                                                       configuration->enable_on_exec,
+                                                                       configuration->ringbuffer_carriers,
+                                                                       configuration->clusters,
+                                                                       (configuration->session_data.multiplex_quantum_ms
+                                                                        > 0)),
                                                std::move(configuration->pids)),
                   std::make_shared<cpu_info_t>(configuration),
-                  ipc_sink)),
-              perf_capture_cpu_monitor(std::make_shared<perf_capture_cpu_monitor_t>(context,
-                                                                                    configuration->num_cpu_cores,
-                                                                                    perf_capture_helper))
+                  ipc_sink,
+                  buffer_pool,
+                  sample_layouts)),
+              perf_capture_cpu_monitor(std::make_shared<perf_capture_cpu_monitor_t>(
+                  context,
+                  configuration->num_cpu_cores,
+                  perf_capture_helper,
+                  std::chrono::milliseconds(configuration->session_data.hotplug_debounce_ms)))
         {
         }
 
@@ -158,6 +203,9 @@ namespace agents::perf {
                          | st->perf_capture_helper->async_send_summary_frame(monotonic_start, use_continuation)
                          // start generating sync events and set misc ready parts for the helper
                          | then([st, monotonic_start]() {
+                               if (st->derived_metrics) {
+                                   st->derived_metrics->set_monotonic_start(monotonic_start);
+                               }
                                st->perf_capture_helper->enable_counters();
                                st->perf_capture_helper->observe_one_shot_event();
                                st->start_sync_thread(monotonic_start);
@@ -169,7 +217,7 @@ namespace agents::perf {
                          // send any manually read initial counter values
                          | st->perf_capture_helper->async_read_initial_counter_values(monotonic_start, use_continuation)
                          // Spawn a separate async 'threads' to send various system-wide bits of data whilst the rest of the capture process continues
-                         | then([st]() {
+                         | then([st, monotonic_start]() {
                                // the process initial properties
                                spawn_terminator(
                                    "process properies reader",
@@ -186,6 +234,15 @@ namespace agents::perf {
                                                 st,
                                                 st->perf_capture_helper->async_read_kallsyms(use_continuation));
 
+                               // rotate any multiplexed cluster counters for the rest of the capture
+                               if (st->perf_capture_helper->has_multiplexed_events()) {
+                                   spawn_terminator("multiplex scheduler",
+                                                    st,
+                                                    st->perf_capture_helper->async_run_multiplex_scheduler(
+                                                        monotonic_start,
+                                                        use_continuation));
+                               }
+
                                // - finally, once the cores are all online, exec the child process
                                spawn_terminator(
                                    "waiting for cores to online",
@@ -252,6 +309,12 @@ namespace agents::perf {
         std::shared_ptr<perf_capture_configuration_t> configuration;
         std::shared_ptr<cpu_info_t> cpu_info {};
         std::shared_ptr<perf_activator_t> perf_activator {};
+        std::shared_ptr<apc_buffer_pool_t> buffer_pool {};
+        std::shared_ptr<perf_sample_layouts_t> sample_layouts {};
+        std::shared_ptr<perf_sample_aggregator_t> sample_aggregator {};
+        std::shared_ptr<perf_callchain_interner_t> callchain_interner {};
+        std::shared_ptr<perf_derived_metrics_t> derived_metrics {};
+        std::shared_ptr<spe_record_filter_t> spe_filter {};
         std::shared_ptr<perf_capture_helper_t> perf_capture_helper {};
         std::unique_ptr<sync_generator> sync_thread {};
         std::shared_ptr<perf_capture_cpu_monitor_t> perf_capture_cpu_monitor {};
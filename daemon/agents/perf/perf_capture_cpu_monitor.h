@@ -13,11 +13,18 @@
 #include "async/continuations/stored_continuation.h"
 #include "async/continuations/use_continuation.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
+#include <optional>
 #include <set>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
 
 namespace agents::perf {
     /**
@@ -34,14 +41,29 @@ namespace agents::perf {
         using polling_cpu_monitor_t = PollingCpuMonitor;
         using all_cores_ready_handler_t = async::continuations::stored_continuation_t<bool>;
 
+        /** Tracks the online/offline changes for one core */
+        struct cpu_hotplug_state_t {
+            // the changes that are waiting to be applied
+            std::deque<bool> pending {};
+            // the state that was last applied (or is being applied)
+            std::optional<bool> applied_state {};
+            // when the last change was applied
+            std::chrono::steady_clock::time_point last_applied_time {};
+            // true while a change is being applied, or is waiting for the debounce interval to pass
+            bool busy {false};
+        };
+
         boost::asio::io_context::strand strand;
         std::shared_ptr<perf_capture_helper_t> perf_capture_helper {};
         std::shared_ptr<coalescing_cpu_monitor_t> coalescing_cpu_monitor {};
         std::shared_ptr<nl_kobject_uevent_cpu_monitor_t> nl_kobject_uevent_cpu_monitor {};
         std::shared_ptr<polling_cpu_monitor_t> polling_cpu_monitor {};
         std::set<int> cores_having_received_initial_event {};
+        std::map<int, cpu_hotplug_state_t> cpu_hotplug_states {};
+        std::chrono::steady_clock::time_point monitoring_start_time {};
         all_cores_ready_handler_t all_cores_ready_handler {};
         std::size_t num_cpu_cores;
+        std::chrono::milliseconds hotplug_debounce;
         bool terminated {false};
         bool notified_all_cores_ready_handler {false};
 
@@ -87,6 +109,11 @@ namespace agents::perf {
                       // if it didnt come online for some reason, then send an offline event
                       if (!really_online) {
                           LOG_DEBUG("Onlining cpu # %d failed as not all cores came online", cpu_no);
+                          // the sysfs state may have changed too, so dont wait for the poll to back off
+                          auto polling_cpu_monitor = st->polling_cpu_monitor;
+                          if (polling_cpu_monitor) {
+                              polling_cpu_monitor->request_recheck();
+                          }
                           return st->co_offline_cpu(monotonic_start, cpu_no);
                       }
 
@@ -188,15 +215,9 @@ namespace agents::perf {
                       [st, coalescing_cpu_monitor, monotonic_start]() mutable {
                           return coalescing_cpu_monitor->async_receive_one(use_continuation) //
                                | map_error()                                                 //
+                               | post_on(st->strand)                                         //
                                | then([st, monotonic_start](auto event) mutable {
-                                     return st->async_update_cpu_state(monotonic_start,
-                                                                       event.cpu_no,
-                                                                       event.online,
-                                                                       use_continuation) //
-                                          | post_on(st->strand)                          //
-                                          | then([st, cpu_no = event.cpu_no]() {
-                                                st->check_cores_having_received_initial_event(cpu_no);
-                                            });
+                                     st->queue_cpu_state(st, monotonic_start, event.cpu_no, event.online);
                                  });
                       }),
                   [st](bool) {
@@ -205,6 +226,121 @@ namespace agents::perf {
                   });
         }
 
+        /**
+         * Queue a state change for some core. Different cores are activated concurrently, but the changes for any one
+         * core are applied in order.
+         *
+         * @param st The shared pointer to this
+         * @param monotonic_start The capture start timestamp (in CLOCK_MONOTONIC_RAW)
+         * @param cpu_no The core that changed state
+         * @param online True if the core was online, false if it was offline
+         */
+        static void queue_cpu_state(std::shared_ptr<basic_perf_capture_cpu_monitor_t> const & st,
+                                    std::uint64_t monotonic_start,
+                                    int cpu_no,
+                                    bool online)
+        {
+            auto & state = st->cpu_hotplug_states[cpu_no];
+            state.pending.push_back(online);
+
+            if (st->hotplug_debounce.count() > 0) {
+                coalesce_pending_cpu_states(state);
+            }
+
+            // otherwise it is applied once the current change completes
+            if (!state.busy) {
+                apply_next_cpu_state(st, monotonic_start, cpu_no);
+            }
+        }
+
+        /**
+         * Reduce the changes that are waiting for some core to the fewest that give the same result. A core that went
+         * offline must still be taken offline and brought back, as the kernel removes its events when it goes offline,
+         * but a core that was only briefly online is not activated at all.
+         */
+        static void coalesce_pending_cpu_states(cpu_hotplug_state_t & state)
+        {
+            if ((state.pending.size() < 2) || !state.applied_state) {
+                return;
+            }
+
+            auto const was_online = *state.applied_state;
+            auto const now_online = state.pending.back();
+            auto const went_offline = std::find(state.pending.begin(), state.pending.end(), false) != state.pending.end();
+
+            state.pending.clear();
+
+            if (was_online && went_offline) {
+                state.pending.push_back(false);
+            }
+            if (now_online && !(was_online && !went_offline)) {
+                state.pending.push_back(true);
+            }
+        }
+
+        /** Apply the next state change for some core, once the debounce interval has passed since the previous one */
+        static void apply_next_cpu_state(std::shared_ptr<basic_perf_capture_cpu_monitor_t> const & st,
+                                         std::uint64_t monotonic_start,
+                                         int cpu_no)
+        {
+            using namespace async::continuations;
+
+            auto & state = st->cpu_hotplug_states[cpu_no];
+
+            state.busy = !state.pending.empty();
+            if (!state.busy) {
+                return;
+            }
+
+            // hold the change back until the core has been stable for a while, so that a core that is flapping is
+            // only reactivated once for all the changes in that time (the first change is always applied immediately)
+            if ((st->hotplug_debounce.count() > 0) && state.applied_state) {
+                auto const wait_until = state.last_applied_time + st->hotplug_debounce;
+                if (wait_until > std::chrono::steady_clock::now()) {
+                    auto timer = std::make_shared<boost::asio::steady_timer>(st->strand.context(), wait_until);
+
+                    spawn("cpu hotplug debounce",
+                          timer->async_wait(use_continuation) //
+                              | post_on(st->strand)           //
+                              | then([st, monotonic_start, cpu_no, timer](boost::system::error_code const & /*ec*/) {
+                                    auto & state = st->cpu_hotplug_states[cpu_no];
+                                    if (st->is_terminated()) {
+                                        state.busy = false;
+                                        return;
+                                    }
+                                    // the changes may have cancelled each other out while waiting
+                                    state.last_applied_time = {};
+                                    apply_next_cpu_state(st, monotonic_start, cpu_no);
+                                }),
+                          [st](bool failed) {
+                              if (failed) {
+                                  st->terminate();
+                              }
+                          });
+                    return;
+                }
+            }
+
+            auto const online = state.pending.front();
+            state.pending.pop_front();
+            state.applied_state = online;
+
+            spawn("cpu state change",
+                  st->async_update_cpu_state(monotonic_start, cpu_no, online, use_continuation) //
+                      | post_on(st->strand)                                                     //
+                      | then([st, monotonic_start, cpu_no]() {
+                            st->check_cores_having_received_initial_event(cpu_no);
+
+                            st->cpu_hotplug_states[cpu_no].last_applied_time = std::chrono::steady_clock::now();
+                            apply_next_cpu_state(st, monotonic_start, cpu_no);
+                        }),
+                  [st](bool failed) {
+                      if (failed) {
+                          st->terminate();
+                      }
+                  });
+        }
+
         /**
          * Check / notify the handler when all cores have received on event
          *
@@ -224,7 +360,10 @@ namespace agents::perf {
             }
 
             if (inserted && (cores_having_received_initial_event.size() == num_cpu_cores)) {
-                LOG_DEBUG("All cores are now ready");
+                LOG_DEBUG("All cores are now ready (after %lldus)",
+                          static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                     std::chrono::steady_clock::now() - monitoring_start_time)
+                                                     .count()));
                 all_cores_ready_handler_t all_cores_ready_handler {std::move(this->all_cores_ready_handler)};
                 if (all_cores_ready_handler) {
                     LOG_DEBUG("Notifiying that all are ready");
@@ -271,13 +410,15 @@ namespace agents::perf {
     public:
         basic_perf_capture_cpu_monitor_t(boost::asio::io_context & context,
                                          std::size_t num_cpu_cores,
-                                         std::shared_ptr<perf_capture_helper_t> perf_capture_helper)
+                                         std::shared_ptr<perf_capture_helper_t> perf_capture_helper,
+                                         std::chrono::milliseconds hotplug_debounce = {})
             : strand(context),
               perf_capture_helper(std::move(perf_capture_helper)),
               coalescing_cpu_monitor(std::make_shared<coalescing_cpu_monitor_t>(context)),
               nl_kobject_uevent_cpu_monitor(std::make_shared<nl_kobject_uevent_cpu_monitor_t>(context)),
               polling_cpu_monitor(),
-              num_cpu_cores(num_cpu_cores)
+              num_cpu_cores(num_cpu_cores),
+              hotplug_debounce(hotplug_debounce)
         {
         }
 
@@ -285,13 +426,15 @@ namespace agents::perf {
                                          std::size_t num_cpu_cores,
                                          std::shared_ptr<perf_capture_helper_t> perf_capture_helper,
                                          std::shared_ptr<nl_kobject_uevent_cpu_monitor_t> nl_kobject_uevent_cpu_monitor,
-                                         std::shared_ptr<polling_cpu_monitor_t> polling_cpu_monitor)
+                                         std::shared_ptr<polling_cpu_monitor_t> polling_cpu_monitor,
+                                         std::chrono::milliseconds hotplug_debounce = {})
             : strand(context),
               perf_capture_helper(std::move(perf_capture_helper)),
               coalescing_cpu_monitor(std::make_shared<coalescing_cpu_monitor_t>(context)),
               nl_kobject_uevent_cpu_monitor(std::move(nl_kobject_uevent_cpu_monitor)),
               polling_cpu_monitor(std::move(polling_cpu_monitor)),
-              num_cpu_cores(num_cpu_cores)
+              num_cpu_cores(num_cpu_cores),
+              hotplug_debounce(hotplug_debounce)
         {
         }
 
@@ -351,6 +494,7 @@ namespace agents::perf {
                 [st = this->shared_from_this(), monotonic_start]() {
                     // monitor for cpu state changes (do this early so we don't miss anything)
                     return start_on(st->strand) //
+                         | then([st]() { st->monitoring_start_time = std::chrono::steady_clock::now(); })
                          // attempt to bring all cores online at startup by injecting an initial online event
                          | iterate(std::size_t {0},
                                    st->num_cpu_cores,
@@ -117,6 +117,15 @@ namespace agents::perf {
         /** @return True if configured counter groups include the SPE group */
         [[nodiscard]] bool has_spe() const { return event_binding_manager.has_spe(); }
 
+        /** @return True if any of the cluster counters are multiplexed */
+        [[nodiscard]] bool has_multiplexed_events() const { return event_binding_manager.has_multiplexed_events(); }
+
+        /** Rotate the multiplexed counters, returning the scaled values of those that were enabled */
+        [[nodiscard]] std::vector<apc::perf_counter_t> rotate_multiplexed_events()
+        {
+            return event_binding_manager.rotate_multiplexed_events();
+        }
+
         /** @return True if stop on exit is set */
         [[nodiscard]] bool is_stop_on_exit() const { return stop_on_exit; }
 
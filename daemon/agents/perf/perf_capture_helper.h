@@ -4,6 +4,7 @@
 
 #include "Time.h"
 #include "agents/agent_environment.h"
+#include "agents/perf/apc_buffer_pool.hpp"
 #include "agents/perf/async_perf_ringbuffer_monitor.hpp"
 #include "agents/perf/cpufreq_counter.h"
 #include "agents/perf/events/event_binding_manager.hpp"
@@ -11,6 +12,7 @@
 #include "agents/perf/events/perf_activator.hpp"
 #include "agents/perf/events/types.hpp"
 #include "agents/perf/perf_buffer_consumer.h"
+#include "agents/perf/perf_sample_layout.hpp"
 #include "agents/perf/perf_capture_events_helper.hpp"
 #include "apc/misc_apc_frame_ipc_sender.h"
 #include "async/continuations/async_initiate.h"
@@ -26,11 +28,16 @@
 #include "ipc/messages.h"
 #include "ipc/raw_ipc_channel_sink.h"
 #include "lib/FsEntry.h"
+#include "lib/LineChunkReader.h"
 #include "lib/error_code_or.hpp"
 #include "lib/forked_process.h"
 #include "linux/proc/ProcessChildren.h"
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <string_view>
+#include <thread>
 
 #include <boost/asio.hpp>
 #include <boost/asio/buffer.hpp>
@@ -38,9 +45,31 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/asio/read_until.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/system/error_code.hpp>
 
 namespace agents::perf {
+    namespace detail {
+        /** The most threads that are used to activate cores (or read /proc) in parallel */
+        constexpr std::size_t max_worker_threads = 16;
+
+        /** The size of the chunks that kallsyms is read and sent in */
+        constexpr std::size_t kallsyms_read_chunk_size = 256 * 1024;
+
+        /**
+         * @return The pool used for blocking work that may run in parallel, such as activating the events for different
+         * cores, or reading the maps files. It is shared by all captures in the process, and is not owned by the helper
+         * so that it is never destroyed by one of its own threads.
+         */
+        inline boost::asio::thread_pool & get_worker_pool()
+        {
+            static boost::asio::thread_pool pool {
+                std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, max_worker_threads)};
+            return pool;
+        }
+    }
+
     /**
      * Provides various "leaf" operations for perf_capture_t
      */
@@ -67,16 +96,22 @@ namespace agents::perf {
                               std::shared_ptr<async_perf_ringbuffer_monitor_t> aprm,
                               perf_capture_events_helper_t && pceh,
                               std::shared_ptr<ICpuInfo> cpu_info,
-                              std::shared_ptr<ipc::raw_ipc_channel_sink_t> ipc_sink)
+                              std::shared_ptr<ipc::raw_ipc_channel_sink_t> ipc_sink,
+                              std::shared_ptr<apc_buffer_pool_t> buffer_pool,
+                              std::shared_ptr<perf_sample_layouts_t> sample_layouts = {})
             : configuration(std::move(conf)),
+              // in app mode, activating a core scans for and pauses new threads, so must be done in sequence
+              parallel_activation(configuration->perf_config.is_system_wide),
               strand(context),
               process_monitor(process_monitor),
               terminator(std::move(terminator)),
               cpu_info(std::move(cpu_info)),
               ipc_sink(std::move(ipc_sink)),
-              misc_apc_frame_ipc_sender(std::make_shared<apc::misc_apc_frame_ipc_sender_t>(this->ipc_sink)),
+              misc_apc_frame_ipc_sender(
+                  std::make_shared<apc::misc_apc_frame_ipc_sender_t>(this->ipc_sink, std::move(buffer_pool))),
               async_perf_ringbuffer_monitor(std::move(aprm)),
-              perf_capture_events_helper(std::move(pceh))
+              perf_capture_events_helper(std::move(pceh)),
+              sample_layouts(std::move(sample_layouts))
         {
         }
 
@@ -86,6 +121,12 @@ namespace agents::perf {
         /** @return True if configured counter groups include the SPE group */
         [[nodiscard]] bool has_spe() const { return perf_capture_events_helper.has_spe(); }
 
+        /** @return True if any of the cluster counters are multiplexed */
+        [[nodiscard]] bool has_multiplexed_events() const
+        {
+            return perf_capture_events_helper.has_multiplexed_events();
+        }
+
         /** @return True if terminate was requested */
         [[nodiscard]] bool is_terminate_requested() const
         {
@@ -167,6 +208,11 @@ namespace agents::perf {
                                    return {};
                                }
 
+                               // the ids must be known before any samples from them are consumed
+                               if (st->sample_layouts) {
+                                   st->sample_layouts->add_mappings(result->id_to_key_mappings);
+                               }
+
                                // and send all the mappings (asynchronously)
                                spawn("process key->id mapping task",
                                      st->misc_apc_frame_ipc_sender->async_send_keys_frame(result->id_to_key_mappings,
@@ -283,6 +329,53 @@ namespace agents::perf {
                 std::forward<CompletionToken>(token));
         }
 
+        /**
+         * Rotate the multiplexed cluster counters every quantum until the capture is terminated, sending the scaled
+         * values of the counters that were enabled during each quantum.
+         *
+         * @param monotonic_start The capture start timestamp (in CLOCK_MONOTONIC_RAW)
+         * @param token The completion token for the async operation
+         */
+        template<typename CompletionToken>
+        [[nodiscard]] auto async_run_multiplex_scheduler(std::uint64_t monotonic_start, CompletionToken && token)
+        {
+            using namespace async::continuations;
+
+            return async_initiate_cont(
+                [st = this->shared_from_this(), monotonic_start]() {
+                    return start_on(st->strand) //
+                         | repeatedly([st]() { return !st->is_terminate_requested(); },
+                                      [st, monotonic_start]() {
+                                          st->multiplex_timer.expires_after(std::chrono::milliseconds(
+                                              st->configuration->session_data.multiplex_quantum_ms));
+
+                                          return st->multiplex_timer.async_wait(use_continuation) //
+                                               | post_on(st->strand)                              //
+                                               | then([st, monotonic_start](boost::system::error_code const & ec)
+                                                          -> polymorphic_continuation_t<> {
+                                                     // cancelled by terminate
+                                                     if (ec || st->is_terminate_requested()) {
+                                                         return {};
+                                                     }
+
+                                                     auto const counter_values =
+                                                         st->perf_capture_events_helper.rotate_multiplexed_events();
+                                                     if (counter_values.empty()) {
+                                                         return {};
+                                                     }
+
+                                                     return st->misc_apc_frame_ipc_sender
+                                                                ->async_send_perf_counters_frame(
+                                                                    monotonic_delta_now(monotonic_start),
+                                                                    counter_values,
+                                                                    use_continuation) //
+                                                          | map_error();
+                                                 });
+                                      });
+                },
+                std::forward<CompletionToken>(token));
+        }
+
         /**
          * Poll all currently running processes/threads in /proc and write their basic properties (pid, tid, comm, exe)
          * into the capture
@@ -326,6 +419,7 @@ namespace agents::perf {
                 [st = this->shared_from_this()]() {
                     return async::async_read_proc_maps(
                                st->strand,
+                               detail::get_worker_pool().get_executor(),
                                st->misc_apc_frame_ipc_sender,
                                [sw = st->configuration->perf_config.is_system_wide,
                                 pids = st->perf_capture_events_helper.get_monitored_pids(),
@@ -350,20 +444,27 @@ namespace agents::perf {
 
             return async_initiate_cont(
                 [st = this->shared_from_this()]() -> polymorphic_continuation_t<> {
-                    auto kallsyms = lib::FsEntry::create("/proc/kallsyms");
+                    auto reader =
+                        std::make_shared<lib::LineChunkReader>("/proc/kallsyms", detail::kallsyms_read_chunk_size);
 
-                    if ((!kallsyms.exists()) || (!kallsyms.canAccess(true, false, false))) {
+                    if (!reader->isOpen()) {
                         return {};
                     }
 
-                    auto contents = kallsyms.readFileContents();
-                    if (contents.empty()) {
-                        return {};
-                    }
-
-                    return st->misc_apc_frame_ipc_sender->async_send_kallsyms_frame(std::move(contents),
-                                                                                    use_continuation)
-                         | map_error();
+                    auto pool = detail::get_worker_pool().get_executor();
+
+                    // send each chunk as it is read, so that the whole file is never held in memory
+                    return start_on(pool) //
+                         | then([reader]() { return reader->next(); })
+                         | loop([](std::string_view chunk) { return start_with(!chunk.empty(), chunk); },
+                                [st, reader, pool](std::string_view chunk) {
+                                    return st->misc_apc_frame_ipc_sender->async_send_kallsyms_frame(chunk,
+                                                                                                    use_continuation)
+                                         | map_error()   //
+                                         | post_on(pool) //
+                                         | then([reader]() { return reader->next(); });
+                                })
+                         | then([](std::string_view /*chunk*/) {});
                 },
                 std::forward<CompletionToken>(token));
         }
@@ -533,12 +634,22 @@ namespace agents::perf {
 
             return async_initiate_cont(
                 [st = this->shared_from_this(), cpu_no]() {
+                    auto const start_time = std::chrono::steady_clock::now();
+
                     return start_on(st->strand) //
-                         | then([st, cpu_no]() -> polymorphic_continuation_t<bool> {
-                               // prepare the events
-                               auto error_or_result =
-                                   st->perf_capture_events_helper.core_online_prepare(core_no_t(cpu_no),
-                                                                                      st->get_cluster_id(cpu_no));
+                         | then([st, cpu_no]() {
+                               // prepare the events (possibly in parallel with other cores)
+                               return st->async_core_online_prepare(cpu_no,
+                                                                    st->get_cluster_id(cpu_no),
+                                                                    use_continuation);
+                           })
+                         | post_on(st->strand) //
+                         | then([st, cpu_no, start_time](
+                                    std::shared_ptr<core_online_prepare_result_t> const & prepared)
+                                    -> polymorphic_continuation_t<bool> {
+                               st->log_activation_latency(cpu_no, "prepared", start_time);
+
+                               auto & error_or_result = *prepared;
 
                                if (auto const * error = lib::get_error(error_or_result)) {
                                    return start_with(*error, false) //
@@ -547,6 +658,11 @@ namespace agents::perf {
 
                                auto result = lib::get_value(std::move(error_or_result));
 
+                               // the ids must be known before any samples from them are consumed
+                               if (st->sample_layouts) {
+                                   st->sample_layouts->add_mappings(result.mappings);
+                               }
+
                                // send all the mappings (asynchronously)
                                spawn("core key->id mapping task",
                                      st->misc_apc_frame_ipc_sender->async_send_keys_frame(result.mappings,
@@ -567,11 +683,17 @@ namespace agents::perf {
                                           use_continuation)
                                     | map_error()
                                     // now possibly start the events
-                                    | then([st, cpu_no, paused_pids = std::move(result.paused_pids)]() mutable {
+                                    | then([st,
+                                            cpu_no,
+                                            start_time,
+                                            paused_pids = std::move(result.paused_pids)]() mutable {
                                           // ensure that the pids are resumed after we return
                                           std::map<pid_t, lnx::sig_continuer_t> pp {std::move(paused_pids)};
                                           // start the core
-                                          return st->perf_capture_events_helper.core_online_start(core_no_t(cpu_no));
+                                          auto started =
+                                              st->perf_capture_events_helper.core_online_start(core_no_t(cpu_no));
+                                          st->log_activation_latency(cpu_no, "activated", start_time);
+                                          return started;
                                       })
                                     | unpack_tuple() //
                                     | map_error();
@@ -811,6 +933,8 @@ namespace agents::perf {
             boost::asio::post(strand, [st = this->shared_from_this()]() mutable {
                 LOG_DEBUG("Terminating");
 
+                st->terminate_requested = true;
+
                 auto w = st->waiter;
                 if (w) {
                     w->cancel();
@@ -825,12 +949,18 @@ namespace agents::perf {
 
                 st->async_perf_ringbuffer_monitor->terminate();
 
+                st->multiplex_timer.cancel();
+
                 st->terminator();
             });
         }
 
     private:
+        using core_online_prepare_result_t =
+            lib::error_code_or_t<typename perf_capture_events_helper_t::core_online_prepare_result_t>;
+
         std::shared_ptr<perf_capture_configuration_t> configuration;
+        bool const parallel_activation;
         boost::asio::io_context::strand strand;
         process_monitor_t & process_monitor;
         agent_environment_base_t::terminator terminator;
@@ -841,8 +971,54 @@ namespace agents::perf {
         std::shared_ptr<async_perf_ringbuffer_monitor_t> async_perf_ringbuffer_monitor;
         std::shared_ptr<async::proc::async_process_t> forked_command;
         perf_capture_events_helper_t perf_capture_events_helper;
+        std::shared_ptr<perf_sample_layouts_t> sample_layouts;
+        boost::asio::steady_timer multiplex_timer {strand.context()};
         bool terminate_requested {false};
 
+        /**
+         * Prepare the events for some core, on the activation pool when activating in parallel, otherwise on the
+         * strand. The cpu monitor serializes the changes for each core, so any one core is only activated once at a time.
+         */
+        template<typename CompletionToken>
+        [[nodiscard]] auto async_core_online_prepare(int cpu_no, cpu_cluster_id_t cluster_id, CompletionToken && token)
+        {
+            using namespace async::continuations;
+
+            return async_initiate_explicit<void(std::shared_ptr<core_online_prepare_result_t>)>(
+                [st = this->shared_from_this(), cpu_no, cluster_id](auto && sc) {
+                    auto prepare = [st, cpu_no, cluster_id, sc = sc.move()]() mutable {
+                        std::shared_ptr<core_online_prepare_result_t> result;
+                        try {
+                            result = std::make_shared<core_online_prepare_result_t>(
+                                st->perf_capture_events_helper.core_online_prepare(core_no_t(cpu_no), cluster_id));
+                        }
+                        catch (...) {
+                            sc.get_exceptionally()(std::current_exception());
+                            return;
+                        }
+                        resume_continuation(st->strand.context(), std::move(sc), std::move(result));
+                    };
+
+                    if (st->parallel_activation) {
+                        boost::asio::post(detail::get_worker_pool(), std::move(prepare));
+                    }
+                    else {
+                        boost::asio::post(st->strand, std::move(prepare));
+                    }
+                },
+                std::forward<CompletionToken>(token));
+        }
+
+        /** Report the time taken so far to activate some core */
+        static void log_activation_latency(int cpu_no,
+                                           char const * stage,
+                                           std::chrono::steady_clock::time_point start_time)
+        {
+            auto const elapsed =
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+            LOG_DEBUG("Core %d %s in %lldus", cpu_no, stage, static_cast<long long>(elapsed.count()));
+        }
+
         [[nodiscard]] cpu_cluster_id_t get_cluster_id(int cpu_no)
         {
             runtime_assert((cpu_no >= 0) && (std::size_t(cpu_no) < cpu_info->getNumberOfCores()), "Unexpected cpu no");
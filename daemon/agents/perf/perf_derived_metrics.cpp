@@ -0,0 +1,95 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "agents/perf/perf_derived_metrics.hpp"
+
+#include "Time.h"
+#include "apc/perf_apc_frame_utils.h"
+#include "k/perf_event.h"
+
+namespace agents::perf {
+
+    perf_derived_metrics_t::frame_context_t perf_derived_metrics_t::begin_frame(int cpu)
+    {
+        auto layouts = sample_layouts->snapshot();
+        auto keys = sample_layouts->snapshot_keys();
+
+        std::lock_guard lock {mutex};
+
+        auto it = per_cpu_states.try_emplace(cpu, metrics).first;
+
+        return {std::move(layouts), std::move(keys), it->second, cpu, monotonic_start.load()};
+    }
+
+    void perf_derived_metrics_t::reset(int cpu)
+    {
+        std::lock_guard lock {mutex};
+
+        per_cpu_states.erase(cpu);
+    }
+
+    void perf_derived_metrics_t::frame_context_t::process(lib::Span<data_word_t const> record)
+    {
+        // not yet started
+        if (monotonic_start == 0) {
+            return;
+        }
+
+        auto const * layout = perf_sample_layouts_t::find(*layouts, record);
+        if (layout == nullptr) {
+            return;
+        }
+
+        constexpr std::uint64_t group_read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+        if ((layout->read_format & group_read_format) != group_read_format) {
+            return;
+        }
+
+        perf_sample_field_indexes_t indexes {};
+        if (!find_perf_sample_field_indexes(*layout, record, indexes) || (indexes.time == 0) || (indexes.read == 0)) {
+            return;
+        }
+
+        auto const time = record[indexes.time];
+        if (time < monotonic_start) {
+            return;
+        }
+
+        // the group read is: nr, [time_enabled], [time_running], then {value, id} for each event in the group
+        auto const nr = std::size_t(record[indexes.read]);
+        auto const times = ((layout->read_format & PERF_FORMAT_TOTAL_TIME_ENABLED) != 0 ? 1 : 0)
+                         + ((layout->read_format & PERF_FORMAT_TOTAL_TIME_RUNNING) != 0 ? 1 : 0);
+        auto const first_value = indexes.read + 1 + times;
+        if ((first_value > record.size()) || (nr > ((record.size() - first_value) / 2))) {
+            return;
+        }
+
+        for (std::size_t n = 0; n < nr; ++n) {
+            auto const value = record[first_value + (n * 2)];
+            auto const id = perf_event_id_t(record[first_value + (n * 2) + 1]);
+
+            auto const key_it = keys->find(id);
+            if (key_it == keys->end()) {
+                continue;
+            }
+
+            // the first read of each counter only gives the baseline for the next delta
+            auto [last_it, inserted] = state.last_values.try_emplace(id, value);
+            if (inserted) {
+                continue;
+            }
+
+            auto const delta = value - std::exchange(last_it->second, value);
+            state.evaluator.record(int(key_it->second), std::int64_t(delta));
+        }
+
+        values.clear();
+        (void) state.evaluator.evaluate([this](int key, std::int64_t value) {
+            values.push_back(apc::perf_counter_t {cpu, key, value});
+            return true;
+        });
+
+        if (!values.empty()) {
+            frames.emplace_back(apc::make_perf_counters_frame(monotonic_delta_t(time - monotonic_start), values));
+        }
+    }
+}
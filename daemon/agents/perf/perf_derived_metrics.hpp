@@ -0,0 +1,118 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "DerivedMetric.h"
+#include "agents/perf/perf_sample_layout.hpp"
+#include "agents/perf/record_types.h"
+#include "apc/perf_counter.h"
+#include "lib/Span.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace agents::perf {
+
+    /**
+     * Computes the derived metrics whose operands are perf counters (see DerivedMetricDriver).
+     *
+     * Each sample that reads its group (PERF_SAMPLE_READ with PERF_FORMAT_GROUP | PERF_FORMAT_ID) gives the running
+     * totals of the counters in that group. The difference from the previous sample on the same cpu is recorded for
+     * each operand, and the metrics whose operands all changed are then sent as a COUNTERS frame, at the time of the
+     * sample. Samples that cannot be decoded (see perf_sample_layouts_t) or that do not read their group, such as
+     * those in app mode where PERF_SAMPLE_READ is not allowed with inherit, produce no values.
+     */
+    class perf_derived_metrics_t {
+    public:
+        /** Per cpu state; only accessed by the thread currently consuming that cpu's ringbuffer */
+        struct per_cpu_state_t {
+            explicit per_cpu_state_t(std::shared_ptr<DerivedMetrics const> const & metrics) : evaluator(metrics) {}
+
+            /** The value of each counter when it was last read */
+            std::map<perf_event_id_t, std::uint64_t> last_values {};
+            DerivedMetricEvaluator evaluator;
+        };
+
+        /** Evaluates the metrics for the records of one frame on one cpu */
+        class frame_context_t {
+        public:
+            frame_context_t(std::shared_ptr<perf_sample_layouts_t::layout_map_t const> layouts,
+                            std::shared_ptr<perf_sample_layouts_t::key_map_t const> keys,
+                            per_cpu_state_t & state,
+                            int cpu,
+                            std::uint64_t monotonic_start)
+                : layouts(std::move(layouts)),
+                  keys(std::move(keys)),
+                  state(state),
+                  cpu(cpu),
+                  monotonic_start(monotonic_start)
+            {
+            }
+
+            /**
+             * Process one record
+             *
+             * @param record The complete record, including its header, as u64 words
+             */
+            void process(lib::Span<data_word_t const> record);
+
+            /** Move out the COUNTERS frames for the processed records */
+            [[nodiscard]] std::vector<std::vector<char>> take_frames() { return std::exchange(frames, {}); }
+
+        private:
+            std::shared_ptr<perf_sample_layouts_t::layout_map_t const> layouts;
+            std::shared_ptr<perf_sample_layouts_t::key_map_t const> keys;
+            per_cpu_state_t & state;
+            int cpu;
+            std::uint64_t monotonic_start;
+            std::vector<apc::perf_counter_t> values {};
+            std::vector<std::vector<char>> frames {};
+        };
+
+        /**
+         * Constructor
+         *
+         * @param metrics The metrics to compute
+         * @param sample_layouts The sample layouts for the capture
+         */
+        perf_derived_metrics_t(std::shared_ptr<DerivedMetrics const> metrics,
+                               std::shared_ptr<perf_sample_layouts_t> sample_layouts)
+            : metrics(std::move(metrics)), sample_layouts(std::move(sample_layouts))
+        {
+        }
+
+        /**
+         * Set the capture start time, which the COUNTERS frame timestamps are relative to. Samples are ignored until
+         * this is set.
+         *
+         * @param monotonic_start The capture start timestamp (in CLOCK_MONOTONIC_RAW)
+         */
+        void set_monotonic_start(std::uint64_t monotonic_start) { this->monotonic_start = monotonic_start; }
+
+        /**
+         * Start evaluating the records for one frame
+         *
+         * @param cpu The cpu the ringbuffer belongs to
+         * @return The frame context, which must not outlive this object
+         */
+        [[nodiscard]] frame_context_t begin_frame(int cpu);
+
+        /**
+         * Forget the previous values for a cpu, e.g. because its ringbuffer was removed, and so its events will be
+         * reopened with new ids
+         */
+        void reset(int cpu);
+
+    private:
+        std::shared_ptr<DerivedMetrics const> metrics;
+        std::shared_ptr<perf_sample_layouts_t> sample_layouts;
+        std::atomic<std::uint64_t> monotonic_start {0};
+        std::mutex mutex {};
+        std::map<int, per_cpu_state_t> per_cpu_states {};
+    };
+}
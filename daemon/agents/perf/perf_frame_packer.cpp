@@ -20,13 +20,25 @@ namespace agents::perf {
             std::min<std::size_t>(ISender::MAX_RESPONSE_LENGTH - max_data_header_size,
                                   1024UL * 1024UL); // limit frame size
 
+        constexpr std::size_t max_aggregate_header_size = buffer_utils::MAXSIZE_PACK32  // frame type
+                                                        + buffer_utils::MAXSIZE_PACK32  // cpu
+                                                        + buffer_utils::MAXSIZE_PACK64  // start time
+                                                        + buffer_utils::MAXSIZE_PACK64  // interval
+                                                        + buffer_utils::MAXSIZE_PACK32; // count
+
         constexpr std::size_t max_aux_header_size = buffer_utils::MAXSIZE_PACK32  // frame type
                                                   + buffer_utils::MAXSIZE_PACK32  // cpu
                                                   + buffer_utils::MAXSIZE_PACK64  // tail
                                                   + buffer_utils::MAXSIZE_PACK32; // size
+        // limit frame size; the header is included in the limit so that a full frame fits a pooled buffer
         constexpr std::size_t max_aux_payload_size =
-            std::min<std::size_t>(ISender::MAX_RESPONSE_LENGTH - max_aux_header_size,
-                                  1024UL * 1024UL); // limit frame size
+            std::min<std::size_t>(ISender::MAX_RESPONSE_LENGTH, 1024UL * 1024UL) - max_aux_header_size;
+
+        constexpr std::size_t max_pooled_buffer_size = std::size_t(1) << apc_buffer_pool_t::max_class_shift;
+
+        static_assert((max_data_payload_size <= max_pooled_buffer_size)
+                          && (max_aux_header_size + max_aux_payload_size <= max_pooled_buffer_size),
+                      "A full frame must fit in a pooled buffer");
 
         [[nodiscard]] bool append_data_record(apc_buffer_builder_t<std::vector<char>> & builder,
                                               lib::Span<sample_word_type const> data)
@@ -50,33 +62,313 @@ namespace agents::perf {
             return ring_buffer_ptr<T>(base, position & size_mask);
         }
 
+        /** The maximum number of words in one PERF_CALLCHAINS frame, each of which is packed as a 64-bit varint */
+        constexpr std::size_t max_dictionary_words = (max_data_payload_size - buffer_utils::MAXSIZE_PACK32) // count
+                                                   / buffer_utils::MAXSIZE_PACK64;
+
+        /**
+         * Encode the PERF_CALLCHAINS frame
+         *
+         * Frame layout is: cpu, count, then for each entry: id, nr, ips[nr]
+         */
+        [[nodiscard]] std::vector<char> encode_perf_callchains_apc_frame(int cpu,
+                                                                         std::size_t count,
+                                                                         lib::Span<sample_word_type const> words,
+                                                                         apc_buffer_pool_t & buffer_pool)
+        {
+            auto buffer =
+                buffer_pool.acquire(max_data_header_size + (words.size() * buffer_utils::MAXSIZE_PACK64));
+            apc_buffer_builder_t builder {buffer};
+
+            builder.beginFrame(FrameType::PERF_CALLCHAINS);
+            builder.packInt(cpu);
+            builder.packIntSize(count);
+            for (auto w : words) {
+                builder.packInt64(w);
+            }
+            builder.endFrame();
+
+            return buffer;
+        }
+
+        /**
+         * Common implementation of extract_one_perf_data_apc_frame, with the encoding of each record delegated to `append_record`
+         * which is passed the builder, and the first and second parts of the record (the second being non-empty when the record
+         * wraps the ringbuffer), and must return false if the record did not fit in the frame.
+         */
+        template<typename AppendRecord>
+        [[nodiscard]] std::pair<std::uint64_t, std::vector<char>> extract_one_perf_data_apc_frame_impl(
+            int cpu,
+            lib::Span<char const> data_mmap,
+            std::uint64_t const header_head, // NOLINT(bugprone-easily-swappable-parameters)
+            std::uint64_t const header_tail,
+            apc_buffer_pool_t & buffer_pool,
+            AppendRecord && append_record)
+        {
+            auto const buffer_mask = data_mmap.size() - 1; // assumes the size is a power of two (which it should be)
+
+            // don't output an empty frame
+            if (header_tail >= header_head) {
+                return {header_tail, {}};
+            }
+
+            // size the buffer for the data that is available (each word packs to at most MAXSIZE_PACK64 bytes), so that
+            // a frame with only a few records does not need a whole payload sized buffer
+            auto const available_words = std::min<std::uint64_t>(header_head - header_tail, data_mmap.size())
+                                       / sample_word_size;
+            auto buffer = buffer_pool.acquire(
+                std::min<std::size_t>(max_data_header_size + (available_words * buffer_utils::MAXSIZE_PACK64),
+                                      max_data_payload_size));
+            apc_buffer_builder_t builder {buffer};
+
+            // add the frame header
+            builder.beginFrame(FrameType::PERF_DATA);
+            builder.packInt(cpu);
+            // skip the length field for now
+            auto const length_index = builder.getWriteIndex();
+            builder.advanceWrite(4);
+
+            // accumulate one or more records to fit into some message
+            auto current_tail = header_tail;
+            while (current_tail < header_head) {
+                auto const * record_header =
+                    ring_buffer_ptr<perf_event_header>(data_mmap.data(), current_tail, buffer_mask);
+                auto const record_size =
+                    std::max<std::size_t>(8U, (record_header->size + sample_word_size - 1) & ~(sample_word_size - 1));
+                auto const record_end = current_tail + record_size;
+                std::size_t const base_masked = (current_tail & buffer_mask);
+                std::size_t const end_masked = (record_end & buffer_mask);
+
+                // incomplete or currently written record; is it possible? lets just be defensive
+                if (record_end > header_head) {
+                    break;
+                }
+
+                auto const have_wrapped = end_masked < base_masked;
+
+                std::size_t const first_size = (have_wrapped ? (data_mmap.size() - base_masked) : record_size);
+                std::size_t const second_size = (have_wrapped ? end_masked : 0);
+
+                // encode the chunk
+                auto const current_offset = builder.getWriteIndex();
+
+                LOG_TRACE("appending record %p (%zu -> %" PRIu64 ") (%zu / %zu / %u / %zu / %zu / %zu)",
+                          record_header,
+                          record_size,
+                          record_end,
+                          base_masked,
+                          end_masked,
+                          have_wrapped,
+                          first_size,
+                          second_size,
+                          current_offset);
+
+                if (!append_record(builder,
+                                   lib::Span<sample_word_type const> {
+                                       ring_buffer_ptr<sample_word_type>(data_mmap.data(), base_masked),
+                                       first_size / sample_word_size,
+                                   },
+                                   lib::Span<sample_word_type const> {
+                                       ring_buffer_ptr<sample_word_type>(data_mmap.data(), 0),
+                                       second_size / sample_word_size,
+                                   })) {
+                    LOG_TRACE("... aborted");
+                    builder.trimTo(current_offset);
+                    break;
+                }
+
+                LOG_TRACE("current tail = %" PRIu64, record_end);
+
+                // next
+                current_tail = record_end;
+            }
+
+            // don't output an empty frame
+            if (current_tail == header_tail) {
+                buffer_pool.release(std::move(buffer));
+                return {header_tail, {}};
+            }
+
+            // all the records may have been consumed by append_record without writing anything
+            auto const bytes_written = builder.getWriteIndex() - (length_index + 4);
+            if (bytes_written == 0) {
+                buffer_pool.release(std::move(buffer));
+                return {current_tail, {}};
+            }
+
+            // now fill in the length field
+            LOG_TRACE("setting length = %zu", bytes_written);
+            builder.writeLeUint32At(length_index, bytes_written);
+
+            // commit the frame
+            builder.endFrame();
+
+            return {current_tail, std::move(buffer)};
+        }
+
     }
 
     std::pair<std::uint64_t, std::vector<char>> extract_one_perf_data_apc_frame(
         int cpu,
         lib::Span<char const> data_mmap,
         std::uint64_t const header_head, // NOLINT(bugprone-easily-swappable-parameters)
-        std::uint64_t const header_tail)
+        std::uint64_t const header_tail,
+        apc_buffer_pool_t & buffer_pool)
     {
-        auto const buffer_mask = data_mmap.size() - 1; // assumes the size is a power of two (which it should be)
+        return extract_one_perf_data_apc_frame_impl(
+            cpu,
+            data_mmap,
+            header_head,
+            header_tail,
+            buffer_pool,
+            [](apc_buffer_builder_t<std::vector<char>> & builder,
+               lib::Span<sample_word_type const> first,
+               lib::Span<sample_word_type const> second) {
+                return append_data_record(builder, first) && append_data_record(builder, second);
+            });
+    }
 
-        // don't output an empty frame
-        if (header_tail >= header_head) {
-            return {header_tail, {}};
+    std::tuple<std::uint64_t, std::vector<char>, std::vector<char>> extract_one_perf_data_apc_frame(
+        int cpu,
+        lib::Span<char const> data_mmap,
+        std::uint64_t const header_head, // NOLINT(bugprone-easily-swappable-parameters)
+        std::uint64_t const header_tail,
+        perf_callchain_interner_t & callchain_interner,
+        apc_buffer_pool_t & buffer_pool)
+    {
+        auto context = callchain_interner.begin_frame(cpu, max_dictionary_words);
+        std::vector<sample_word_type> wrapped_record {};
+        std::vector<sample_word_type> rewritten_record {};
+
+        auto [new_tail, data_frame] = extract_one_perf_data_apc_frame_impl(
+            cpu,
+            data_mmap,
+            header_head,
+            header_tail,
+            buffer_pool,
+            [&](apc_buffer_builder_t<std::vector<char>> & builder,
+                lib::Span<sample_word_type const> first,
+                lib::Span<sample_word_type const> second) {
+                lib::Span<sample_word_type const> record = first;
+
+                // make the record contiguous if it wraps
+                if (!second.empty()) {
+                    wrapped_record.assign(first.begin(), first.end());
+                    wrapped_record.insert(wrapped_record.end(), second.begin(), second.end());
+                    record = wrapped_record;
+                }
+
+                if (context.intern(record, rewritten_record)) {
+                    record = rewritten_record;
+                }
+
+                return append_data_record(builder, record);
+            });
+
+        // any new callchains must be sent first, even if the records that created them did not fit in the frame
+        std::vector<char> dictionary_frame {};
+        if (context.has_pending_dictionary()) {
+            auto [count, words] = context.take_pending_dictionary();
+            dictionary_frame = encode_perf_callchains_apc_frame(cpu, count, words, buffer_pool);
         }
 
-        std::vector<char> buffer {};
-        buffer.reserve(max_data_payload_size);
-        apc_buffer_builder_t builder {buffer};
+        return {new_tail, std::move(dictionary_frame), std::move(data_frame)};
+    }
 
-        // add the frame header
-        builder.beginFrame(FrameType::PERF_DATA);
-        builder.packInt(cpu);
-        // skip the length field for now
-        auto const length_index = builder.getWriteIndex();
-        builder.advanceWrite(4);
+    std::tuple<std::uint64_t, std::vector<std::vector<char>>, std::vector<char>> extract_one_perf_data_apc_frame(
+        int cpu,
+        lib::Span<char const> data_mmap,
+        std::uint64_t const header_head, // NOLINT(bugprone-easily-swappable-parameters)
+        std::uint64_t const header_tail,
+        perf_sample_aggregator_t & sample_aggregator,
+        apc_buffer_pool_t & buffer_pool)
+    {
+        auto context = sample_aggregator.begin_frame(cpu);
+        std::vector<sample_word_type> wrapped_record {};
+
+        auto [new_tail, data_frame] = extract_one_perf_data_apc_frame_impl(
+            cpu,
+            data_mmap,
+            header_head,
+            header_tail,
+            buffer_pool,
+            [&](apc_buffer_builder_t<std::vector<char>> & builder,
+                lib::Span<sample_word_type const> first,
+                lib::Span<sample_word_type const> second) {
+                lib::Span<sample_word_type const> record = first;
+
+                // make the record contiguous if it wraps
+                if (!second.empty()) {
+                    wrapped_record.assign(first.begin(), first.end());
+                    wrapped_record.insert(wrapped_record.end(), second.begin(), second.end());
+                    record = wrapped_record;
+                }
+
+                if (context.aggregate(record)) {
+                    return true;
+                }
+
+                return append_data_record(builder, record);
+            });
+
+        auto aggregate_frames = encode_perf_aggregate_apc_frames(cpu,
+                                                                 sample_aggregator.get_interval_ns(),
+                                                                 context.take_completed(),
+                                                                 buffer_pool);
+
+        return {new_tail, std::move(aggregate_frames), std::move(data_frame)};
+    }
+
+    std::vector<std::vector<char>> encode_perf_aggregate_apc_frames(
+        int cpu,
+        std::uint64_t interval_ns,
+        std::vector<perf_sample_aggregator_t::bucket_t> const & buckets,
+        apc_buffer_pool_t & buffer_pool)
+    {
+        static_assert(perf_sample_aggregator_t::max_table_load * 5 * buffer_utils::MAXSIZE_PACK64
+                          < ISender::MAX_RESPONSE_LENGTH - max_aggregate_header_size,
+                      "A full bucket must fit in one frame");
+
+        std::vector<std::vector<char>> result {};
+        result.reserve(buckets.size());
+
+        for (auto const & bucket : buckets) {
+            auto buffer = buffer_pool.acquire(max_aggregate_header_size
+                                              + (bucket.entries.size() * 5 * buffer_utils::MAXSIZE_PACK64));
+            apc_buffer_builder_t builder {buffer};
+
+            builder.beginFrame(FrameType::PERF_AGGREGATE);
+            builder.packInt(cpu);
+            builder.packInt64(bucket.start_time);
+            builder.packInt64(interval_ns);
+            builder.packIntSize(bucket.entries.size());
+            for (auto const & entry : bucket.entries) {
+                builder.packInt64(entry.id);
+                builder.packInt64(entry.pid_tid);
+                builder.packInt64(entry.ip);
+                builder.packInt64(entry.count);
+                builder.packInt64(entry.period);
+            }
+            builder.endFrame();
+
+            result.emplace_back(std::move(buffer));
+        }
+
+        return result;
+    }
+
+    std::vector<std::vector<char>> extract_perf_derived_metric_apc_frames(
+        int cpu,
+        lib::Span<char const> data_mmap,
+        std::uint64_t const header_head, // NOLINT(bugprone-easily-swappable-parameters)
+        std::uint64_t const header_tail,
+        perf_derived_metrics_t & derived_metrics)
+    {
+        auto const buffer_mask = data_mmap.size() - 1;
+
+        auto context = derived_metrics.begin_frame(cpu);
+        std::vector<sample_word_type> wrapped_record {};
 
-        // accumulate one or more records to fit into some message
         auto current_tail = header_tail;
         while (current_tail < header_head) {
             auto const * record_header =
@@ -87,65 +379,35 @@ namespace agents::perf {
             std::size_t const base_masked = (current_tail & buffer_mask);
             std::size_t const end_masked = (record_end & buffer_mask);
 
-            // incomplete or currently written record; is it possible? lets just be defensive
             if (record_end > header_head) {
                 break;
             }
 
-            auto const have_wrapped = end_masked < base_masked;
-
-            std::size_t const first_size = (have_wrapped ? (data_mmap.size() - base_masked) : record_size);
-            std::size_t const second_size = (have_wrapped ? end_masked : 0);
-
-            // encode the chunk
-            auto const current_offset = builder.getWriteIndex();
-
-            LOG_TRACE("appending record %p (%zu -> %" PRIu64 ") (%zu / %zu / %u / %zu / %zu / %zu)",
-                      record_header,
-                      record_size,
-                      record_end,
-                      base_masked,
-                      end_masked,
-                      have_wrapped,
-                      first_size,
-                      second_size,
-                      current_offset);
-
-            if ((!append_data_record(builder,
-                                     {
-                                         ring_buffer_ptr<sample_word_type>(data_mmap.data(), base_masked),
-                                         first_size / sample_word_size,
-                                     }))
-                || (!append_data_record(builder,
-                                        {
-                                            ring_buffer_ptr<sample_word_type>(data_mmap.data(), 0),
-                                            second_size / sample_word_size,
-                                        }))) {
-                LOG_TRACE("... aborted");
-                builder.trimTo(current_offset);
-                break;
+            lib::Span<sample_word_type const> record {
+                ring_buffer_ptr<sample_word_type>(data_mmap.data(), base_masked),
+                record_size / sample_word_size,
+            };
+
+            // make the record contiguous if it wraps
+            if (end_masked < base_masked) {
+                auto const first_words = (data_mmap.size() - base_masked) / sample_word_size;
+                auto const * second = ring_buffer_ptr<sample_word_type>(data_mmap.data(), 0);
+                wrapped_record.assign(record.begin(), record.begin() + first_words);
+                wrapped_record.insert(wrapped_record.end(), second, second + (end_masked / sample_word_size));
+                record = wrapped_record;
             }
 
-            LOG_TRACE("current tail = %" PRIu64, record_end);
+            context.process(record);
 
-            // next
             current_tail = record_end;
         }
 
-        // don't output an empty frame
-        if (current_tail == header_tail) {
-            return {header_tail, {}};
-        }
-
-        // now fill in the length field
-        auto const bytes_written = builder.getWriteIndex() - (length_index + 4);
-        LOG_TRACE("setting length = %zu", bytes_written);
-        builder.writeLeUint32At(length_index, bytes_written);
-
-        // commit the frame
-        builder.endFrame();
+        return context.take_frames();
+    }
 
-        return {current_tail, std::move(buffer)};
+    std::size_t max_perf_aux_apc_frame_payload_size()
+    {
+        return max_aux_payload_size;
     }
 
     std::pair<lib::Span<char const>, lib::Span<char const>> extract_one_perf_aux_apc_frame_data_span_pair(
@@ -195,13 +457,13 @@ namespace agents::perf {
     std::pair<std::uint64_t, std::vector<char>> encode_one_perf_aux_apc_frame(int cpu,
                                                                               lib::Span<char const> first_span,
                                                                               lib::Span<char const> second_span,
-                                                                              std::uint64_t const header_tail)
+                                                                              std::uint64_t const header_tail,
+                                                                              apc_buffer_pool_t & buffer_pool)
     {
         auto const combined_size = first_span.size() + second_span.size();
 
         // create the message data
-        std::vector<char> buffer {};
-        buffer.reserve(combined_size);
+        auto buffer = buffer_pool.acquire(max_aux_header_size + combined_size);
 
         apc_buffer_builder_t builder {buffer};
 
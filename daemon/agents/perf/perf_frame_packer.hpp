@@ -2,6 +2,10 @@
 
 #pragma once
 
+#include "agents/perf/apc_buffer_pool.hpp"
+#include "agents/perf/perf_callchain_interner.hpp"
+#include "agents/perf/perf_derived_metrics.hpp"
+#include "agents/perf/perf_sample_aggregator.hpp"
 #include "lib/Span.h"
 #include "lib/error_code_or.hpp"
 
@@ -18,13 +22,95 @@ namespace agents::perf {
      * @param data_mmap The data area within the mmap
      * @param header_head The data_head value
      * @param header_tail The data_tail value
+     * @param buffer_pool The pool that the message buffer is taken from
      * @return A pair, being the new value for data_tail, and the encoded apc_frame message
      */
     [[nodiscard]] std::pair<std::uint64_t, std::vector<char>> extract_one_perf_data_apc_frame(
         int cpu,
         lib::Span<char const> data_mmap,
         std::uint64_t header_head,
-        std::uint64_t header_tail);
+        std::uint64_t header_tail,
+        apc_buffer_pool_t & buffer_pool);
+
+    /**
+     * Given the current state of the perf data section of some mmap, extract some apc data frame from it, interning
+     * any sample callchains
+     *
+     * @param cpu The cpu associated with the mmap
+     * @param data_mmap The data area within the mmap
+     * @param header_head The data_head value
+     * @param header_tail The data_tail value
+     * @param callchain_interner The callchain interner
+     * @param buffer_pool The pool that the message buffers are taken from
+     * @return A tuple, being the new value for data_tail, the encoded PERF_CALLCHAINS apc_frame message (which may be
+     * empty and must be sent first), and the encoded PERF_DATA apc_frame message
+     */
+    [[nodiscard]] std::tuple<std::uint64_t, std::vector<char>, std::vector<char>> extract_one_perf_data_apc_frame(
+        int cpu,
+        lib::Span<char const> data_mmap,
+        std::uint64_t header_head,
+        std::uint64_t header_tail,
+        perf_callchain_interner_t & callchain_interner,
+        apc_buffer_pool_t & buffer_pool);
+
+    /**
+     * Given the current state of the perf data section of some mmap, extract some apc data frame from it, aggregating
+     * any sample records that can be aggregated rather than copying them into the frame
+     *
+     * @param cpu The cpu associated with the mmap
+     * @param data_mmap The data area within the mmap
+     * @param header_head The data_head value
+     * @param header_tail The data_tail value
+     * @param sample_aggregator The sample aggregator
+     * @param buffer_pool The pool that the message buffers are taken from
+     * @return A tuple, being the new value for data_tail, the encoded PERF_AGGREGATE apc_frame messages for any
+     * completed buckets, and the encoded PERF_DATA apc_frame message (which may be empty if every record was aggregated)
+     */
+    [[nodiscard]] std::tuple<std::uint64_t, std::vector<std::vector<char>>, std::vector<char>>
+    extract_one_perf_data_apc_frame(int cpu,
+                                    lib::Span<char const> data_mmap,
+                                    std::uint64_t header_head,
+                                    std::uint64_t header_tail,
+                                    perf_sample_aggregator_t & sample_aggregator,
+                                    apc_buffer_pool_t & buffer_pool);
+
+    /**
+     * Encode a set of aggregated sample buckets as PERF_AGGREGATE apc_frame messages, one per bucket
+     *
+     * Frame layout is: cpu, start time, interval, count, then for each entry: id, pid/tid, ip, count, total period
+     *
+     * @param cpu The cpu associated with the buckets
+     * @param interval_ns The aggregation interval
+     * @param buckets The buckets to encode
+     * @param buffer_pool The pool that the message buffers are taken from
+     * @return The encoded messages
+     */
+    [[nodiscard]] std::vector<std::vector<char>> encode_perf_aggregate_apc_frames(
+        int cpu,
+        std::uint64_t interval_ns,
+        std::vector<perf_sample_aggregator_t::bucket_t> const & buckets,
+        apc_buffer_pool_t & buffer_pool);
+
+    /**
+     * Evaluate the derived metrics for the records in some range of the perf data section of some mmap, which should be
+     * the range that was just encoded by extract_one_perf_data_apc_frame, so that each sample is evaluated once
+     *
+     * @param cpu The cpu associated with the mmap
+     * @param data_mmap The data area within the mmap
+     * @param header_head The end of the range, i.e. the new data_tail value
+     * @param header_tail The start of the range, i.e. the data_tail value
+     * @param derived_metrics The derived metrics
+     * @return The encoded COUNTERS apc_frame messages, one per sample that produced any metric values
+     */
+    [[nodiscard]] std::vector<std::vector<char>> extract_perf_derived_metric_apc_frames(
+        int cpu,
+        lib::Span<char const> data_mmap,
+        std::uint64_t header_head,
+        std::uint64_t header_tail,
+        perf_derived_metrics_t & derived_metrics);
+
+    /** @return The largest amount of aux data that one PERF_AUX apc_frame message holds */
+    [[nodiscard]] std::size_t max_perf_aux_apc_frame_payload_size();
 
     /**
      * Given the current state of the perf aux section of some mmap, extract a pair of spans (pair to account for ringbuffer wrapping) representing
@@ -49,11 +135,13 @@ namespace agents::perf {
      * @param first_span The first span returned by extract_one_perf_aux_apc_frame_data_span_pair
      * @param second_span The second span returned by extract_one_perf_aux_apc_frame_data_span_pair
      * @param header_tail The value of header_tail that was passed to extract_one_perf_aux_apc_frame_data_span_pair
+     * @param buffer_pool The pool that the message buffer is taken from
      * @return A pair, being the new value for aux_tail, and the encoded apc_frame message
      */
     [[nodiscard]] std::pair<std::uint64_t, std::vector<char>> encode_one_perf_aux_apc_frame(
         int cpu,
         lib::Span<char const> first_span,
         lib::Span<char const> second_span,
-        std::uint64_t header_tail);
+        std::uint64_t header_tail,
+        apc_buffer_pool_t & buffer_pool);
 }
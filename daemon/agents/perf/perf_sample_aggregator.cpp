@@ -0,0 +1,116 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "agents/perf/perf_sample_aggregator.hpp"
+
+namespace agents::perf {
+
+    namespace {
+        /** Mix the key fields into a table index (the finalizer from splitmix64) */
+        [[nodiscard]] std::size_t hash_key(data_word_t id, data_word_t pid_tid, data_word_t ip)
+        {
+            std::uint64_t hash = (id * 0x9e3779b97f4a7c15ULL) ^ pid_tid ^ (ip * 0xff51afd7ed558ccdULL);
+            hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+            return std::size_t(hash ^ (hash >> 31));
+        }
+    }
+
+    perf_sample_aggregator_t::frame_context_t perf_sample_aggregator_t::begin_frame(int cpu)
+    {
+        auto layouts = sample_layouts->snapshot();
+
+        std::lock_guard lock {mutex};
+
+        return {std::move(layouts), per_cpu_states[cpu], interval_ns};
+    }
+
+    std::vector<perf_sample_aggregator_t::bucket_t> perf_sample_aggregator_t::flush(int cpu)
+    {
+        std::lock_guard lock {mutex};
+
+        auto it = per_cpu_states.find(cpu);
+        if (it == per_cpu_states.end()) {
+            return {};
+        }
+
+        complete_bucket(it->second);
+
+        auto result = std::exchange(it->second.completed, {});
+
+        // the cpu may come back online later, but there is no need to keep the table until then
+        per_cpu_states.erase(it);
+
+        return result;
+    }
+
+    void perf_sample_aggregator_t::complete_bucket(per_cpu_state_t & state)
+    {
+        if (state.used == 0) {
+            return;
+        }
+
+        bucket_t bucket {state.bucket_start, {}};
+        bucket.entries.reserve(state.used);
+
+        for (auto & slot : state.slots) {
+            if (slot.count != 0) {
+                bucket.entries.push_back(slot);
+                slot = entry_t {};
+            }
+        }
+
+        state.used = 0;
+        state.completed.emplace_back(std::move(bucket));
+    }
+
+    bool perf_sample_aggregator_t::frame_context_t::aggregate(lib::Span<data_word_t const> record)
+    {
+        auto const * layout = perf_sample_layouts_t::find(*layouts, record);
+        if (layout == nullptr) {
+            return false;
+        }
+
+        perf_sample_field_indexes_t indexes {};
+        if (!find_perf_sample_field_indexes(*layout, record, indexes) || (indexes.time == 0)) {
+            return false;
+        }
+
+        auto const time = record[indexes.time];
+        auto const bucket_start = time - (time % interval_ns);
+
+        // samples are written in time order per cpu, so a later interval means the current one is complete
+        if (bucket_start > state.bucket_start) {
+            complete_bucket(state);
+            state.bucket_start = bucket_start;
+        }
+
+        auto const id = record[1];
+        auto const pid_tid = (indexes.tid != 0 ? record[indexes.tid] : 0);
+        auto const ip = (indexes.ip != 0 ? record[indexes.ip] : 0);
+        auto const period = (indexes.period != 0 ? record[indexes.period] : 1);
+
+        // linear probe; the load factor is bounded so this always terminates
+        constexpr std::size_t mask = table_size - 1;
+        for (auto index = hash_key(id, pid_tid, ip) & mask;; index = (index + 1) & mask) {
+            auto & slot = state.slots[index];
+
+            if (slot.count == 0) {
+                slot = entry_t {id, pid_tid, ip, 1, period};
+                state.used += 1;
+                break;
+            }
+
+            if ((slot.id == id) && (slot.pid_tid == pid_tid) && (slot.ip == ip)) {
+                slot.count += 1;
+                slot.period += period;
+                break;
+            }
+        }
+
+        if (state.used >= max_table_load) {
+            complete_bucket(state);
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,123 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "agents/perf/perf_sample_layout.hpp"
+#include "agents/perf/record_types.h"
+#include "lib/Span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace agents::perf {
+
+    /**
+     * Aggregates sample records into per-interval histograms, rather than sending each sample individually.
+     *
+     * Samples are counted per (event id, pid, tid, ip) in a fixed size open addressing table per cpu. The table is
+     * emitted as a bucket once a sample arrives for a later interval, once the table is three quarters full, or when
+     * the cpu's ringbuffer is removed. Only samples that can be decoded (see perf_sample_layouts_t) and that include
+     * PERF_SAMPLE_TIME are aggregated; everything else is passed through to the PERF_DATA frame.
+     */
+    class perf_sample_aggregator_t {
+    public:
+        /** The number of slots in each per-cpu table; must be a power of two */
+        static constexpr std::size_t table_size = 4096;
+        /** The bucket is emitted early once this many slots are used */
+        static constexpr std::size_t max_table_load = (table_size * 3) / 4;
+
+        /** One histogram entry. An entry with a zero count is unused */
+        struct entry_t {
+            data_word_t id;
+            data_word_t pid_tid;
+            data_word_t ip;
+            std::uint64_t count;
+            std::uint64_t period;
+        };
+
+        /** One completed interval (or part of an interval, when the table filled up) */
+        struct bucket_t {
+            std::uint64_t start_time;
+            std::vector<entry_t> entries;
+        };
+
+        /** Per cpu state; only accessed by the thread currently consuming that cpu's ringbuffer */
+        struct per_cpu_state_t {
+            std::vector<entry_t> slots = std::vector<entry_t>(table_size);
+            std::size_t used {};
+            std::uint64_t bucket_start {};
+            std::vector<bucket_t> completed {};
+        };
+
+        /** Aggregates the records for one frame on one cpu */
+        class frame_context_t {
+        public:
+            frame_context_t(std::shared_ptr<perf_sample_layouts_t::layout_map_t const> layouts,
+                            per_cpu_state_t & state,
+                            std::uint64_t interval_ns)
+                : layouts(std::move(layouts)), state(state), interval_ns(interval_ns)
+            {
+            }
+
+            /**
+             * Aggregate one record
+             *
+             * @param record The complete record, including its header, as u64 words
+             * @return True if the record was aggregated, false if it should be sent as is
+             */
+            [[nodiscard]] bool aggregate(lib::Span<data_word_t const> record);
+
+            /** Move out any buckets that were completed */
+            [[nodiscard]] std::vector<bucket_t> take_completed() { return std::exchange(state.completed, {}); }
+
+        private:
+            std::shared_ptr<perf_sample_layouts_t::layout_map_t const> layouts;
+            per_cpu_state_t & state;
+            std::uint64_t interval_ns;
+        };
+
+        /**
+         * Constructor
+         *
+         * @param sample_layouts The sample layouts for the capture
+         * @param interval_ns The length of each histogram interval
+         */
+        perf_sample_aggregator_t(std::shared_ptr<perf_sample_layouts_t> sample_layouts, std::uint64_t interval_ns)
+            : sample_layouts(std::move(sample_layouts)), interval_ns(interval_ns)
+        {
+        }
+
+        /**
+         * Start aggregating the records for one frame
+         *
+         * @param cpu The cpu the ringbuffer belongs to
+         * @return The frame context, which must not outlive this object
+         */
+        [[nodiscard]] frame_context_t begin_frame(int cpu);
+
+        /** @return The length of each histogram interval */
+        [[nodiscard]] std::uint64_t get_interval_ns() const { return interval_ns; }
+
+        /**
+         * Complete the current bucket for a cpu, e.g. because its ringbuffer was removed
+         *
+         * @param cpu The cpu
+         * @return All the completed buckets, including the current one
+         */
+        [[nodiscard]] std::vector<bucket_t> flush(int cpu);
+
+        /** Move the occupied entries of the current table into a completed bucket */
+        static void complete_bucket(per_cpu_state_t & state);
+
+    private:
+        std::shared_ptr<perf_sample_layouts_t> sample_layouts;
+        std::uint64_t interval_ns;
+        std::mutex mutex {};
+        std::map<int, per_cpu_state_t> per_cpu_states {};
+    };
+}
@@ -0,0 +1,178 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "agents/perf/perf_sample_layout.hpp"
+
+#include "k/perf_event.h"
+
+#include <cstring>
+
+namespace agents::perf {
+
+    namespace {
+        void add_layouts(std::map<gator_key_t, perf_sample_layout_t> & layouts,
+                         std::vector<event_definition_t> const & events)
+        {
+            for (auto const & event : events) {
+                if ((event.attr.sample_type & PERF_SAMPLE_IDENTIFIER) != 0) {
+                    layouts.emplace(event.key, perf_sample_layout_t {event.attr.sample_type, event.attr.read_format});
+                }
+            }
+        }
+
+        template<typename K>
+        void add_layouts(std::map<gator_key_t, perf_sample_layout_t> & layouts,
+                         std::map<K, std::vector<event_definition_t>> const & events)
+        {
+            for (auto const & [k, e] : events) {
+                (void) k;
+                add_layouts(layouts, e);
+            }
+        }
+
+        [[nodiscard]] std::size_t take_if(std::uint64_t sample_type, std::uint64_t field, std::size_t & index)
+        {
+            if ((sample_type & field) == 0) {
+                return 0;
+            }
+            return index++;
+        }
+    }
+
+    bool find_perf_sample_field_indexes(perf_sample_layout_t const & layout,
+                                        lib::Span<data_word_t const> record,
+                                        perf_sample_field_indexes_t & indexes)
+    {
+        auto const sample_type = layout.sample_type;
+        auto const read_format = layout.read_format;
+
+        // skip the header
+        std::size_t index = 1;
+
+        (void) take_if(sample_type, PERF_SAMPLE_IDENTIFIER, index);
+        indexes.ip = take_if(sample_type, PERF_SAMPLE_IP, index);
+        indexes.tid = take_if(sample_type, PERF_SAMPLE_TID, index);
+        indexes.time = take_if(sample_type, PERF_SAMPLE_TIME, index);
+        (void) take_if(sample_type, PERF_SAMPLE_ADDR, index);
+        (void) take_if(sample_type, PERF_SAMPLE_ID, index);
+        (void) take_if(sample_type, PERF_SAMPLE_STREAM_ID, index);
+        (void) take_if(sample_type, PERF_SAMPLE_CPU, index);
+        indexes.period = take_if(sample_type, PERF_SAMPLE_PERIOD, index);
+
+        if ((sample_type & PERF_SAMPLE_READ) != 0) {
+            indexes.read = index;
+
+            std::size_t const times = ((read_format & PERF_FORMAT_TOTAL_TIME_ENABLED) != 0 ? 1 : 0)
+                                    + ((read_format & PERF_FORMAT_TOTAL_TIME_RUNNING) != 0 ? 1 : 0);
+            std::size_t const value_size = ((read_format & PERF_FORMAT_ID) != 0 ? 2 : 1);
+
+            if ((read_format & PERF_FORMAT_GROUP) != 0) {
+                if (index >= record.size()) {
+                    return false;
+                }
+                auto const nr = record[index];
+                if (nr > record.size()) {
+                    return false;
+                }
+                index += 1 + times + (nr * value_size);
+            }
+            else {
+                index += times + value_size;
+            }
+        }
+        else {
+            indexes.read = 0;
+        }
+
+        indexes.callchain = take_if(sample_type, PERF_SAMPLE_CALLCHAIN, index);
+
+        if (index > record.size()) {
+            return false;
+        }
+
+        // validate the callchain fits within the record
+        if (indexes.callchain != 0) {
+            auto const nr = record[indexes.callchain];
+            if (nr >= record.size() - indexes.callchain) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    perf_sample_layouts_t::perf_sample_layouts_t(event_configuration_t const & configuration)
+        : layouts_by_id(std::make_shared<layout_map_t>()), keys_by_id(std::make_shared<key_map_t>())
+    {
+        add_layouts(layouts_by_key, configuration.global_events);
+        add_layouts(layouts_by_key, configuration.cluster_specific_events);
+        add_layouts(layouts_by_key, configuration.cpu_specific_events);
+    }
+
+    void perf_sample_layouts_t::add_mappings(id_to_key_mappings_t const & mappings)
+    {
+        std::lock_guard lock {mutex};
+
+        // copy on write so that any reader keeps a consistent view
+        auto new_layouts = std::make_shared<layout_map_t>(*layouts_by_id);
+        auto new_keys = std::make_shared<key_map_t>(*keys_by_id);
+        bool modified = false;
+
+        for (auto const & [id, key] : mappings) {
+            (*new_keys)[id] = key;
+
+            auto it = layouts_by_key.find(key);
+            if (it != layouts_by_key.end()) {
+                (*new_layouts)[id] = it->second;
+                modified = true;
+            }
+        }
+
+        if (modified) {
+            layouts_by_id = std::move(new_layouts);
+        }
+
+        if (!mappings.empty()) {
+            keys_by_id = std::move(new_keys);
+        }
+    }
+
+    std::shared_ptr<perf_sample_layouts_t::layout_map_t const> perf_sample_layouts_t::snapshot() const
+    {
+        std::lock_guard lock {mutex};
+
+        return layouts_by_id;
+    }
+
+    std::shared_ptr<perf_sample_layouts_t::key_map_t const> perf_sample_layouts_t::snapshot_keys() const
+    {
+        std::lock_guard lock {mutex};
+
+        return keys_by_id;
+    }
+
+    perf_sample_layout_t const * perf_sample_layouts_t::find(layout_map_t const & layouts,
+                                                             lib::Span<data_word_t const> record)
+    {
+        static_assert(sizeof(perf_event_header) == sizeof(data_word_t));
+
+        // need at least the header and the sample id
+        if (record.size() < 2) {
+            return nullptr;
+        }
+
+        perf_event_header header;
+        std::memcpy(&header, record.data(), sizeof(header));
+
+        if (header.type != PERF_RECORD_SAMPLE) {
+            return nullptr;
+        }
+
+        // PERF_SAMPLE_IDENTIFIER is always the first word after the header
+        auto const it = layouts.find(perf_event_id_t(record[1]));
+        if (it == layouts.end()) {
+            return nullptr;
+        }
+
+        return &(it->second);
+    }
+}
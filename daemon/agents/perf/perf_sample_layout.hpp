@@ -0,0 +1,102 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "agents/perf/events/event_configuration.hpp"
+#include "agents/perf/events/types.hpp"
+#include "agents/perf/record_types.h"
+#include "lib/Span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace agents::perf {
+
+    /** The set of attr fields that determine where each field is within a PERF_RECORD_SAMPLE */
+    struct perf_sample_layout_t {
+        std::uint64_t sample_type;
+        std::uint64_t read_format;
+    };
+
+    /** The word index of selected fields within a PERF_RECORD_SAMPLE, or zero where the field is not sampled */
+    struct perf_sample_field_indexes_t {
+        std::size_t ip;
+        std::size_t tid;
+        std::size_t time;
+        std::size_t period;
+        /** The index of the first word of the read_format values */
+        std::size_t read;
+        /** The index of the callchain `nr` word */
+        std::size_t callchain;
+    };
+
+    /**
+     * Find the index of the fields within a sample record
+     *
+     * @param layout The sample layout for the record
+     * @param record The record words, including the header
+     * @param indexes Receives the field indexes
+     * @return False if the record is too short for the layout
+     */
+    [[nodiscard]] bool find_perf_sample_field_indexes(perf_sample_layout_t const & layout,
+                                                      lib::Span<data_word_t const> record,
+                                                      perf_sample_field_indexes_t & indexes);
+
+    /**
+     * Maps the perf event ids opened during capture to the layout of the samples they produce, so that samples can be
+     * decoded on target.
+     *
+     * Only events that sample PERF_SAMPLE_IDENTIFIER can be decoded, since that is the only field at a fixed offset
+     * in every sample.
+     */
+    class perf_sample_layouts_t {
+    public:
+        using id_to_key_mappings_t = std::vector<std::pair<perf_event_id_t, gator_key_t>>;
+        using layout_map_t = std::map<perf_event_id_t, perf_sample_layout_t>;
+        using key_map_t = std::map<perf_event_id_t, gator_key_t>;
+
+        /**
+         * Constructor
+         *
+         * @param configuration The event configuration for the capture, used to map keys to sample layouts
+         */
+        explicit perf_sample_layouts_t(event_configuration_t const & configuration);
+
+        /**
+         * Record the ids of newly opened events so that their samples can be decoded
+         *
+         * @param mappings The id->key mappings, as sent in the KEYS frame
+         */
+        void add_mappings(id_to_key_mappings_t const & mappings);
+
+        /** @return The current id->layout map; the map is never modified once returned */
+        [[nodiscard]] std::shared_ptr<layout_map_t const> snapshot() const;
+
+        /**
+         * @return The current id->key map, which unlike the layouts includes every event (e.g. the group members whose
+         * values are read with their leader's samples); the map is never modified once returned
+         */
+        [[nodiscard]] std::shared_ptr<key_map_t const> snapshot_keys() const;
+
+        /**
+         * Find the layout for some record
+         *
+         * @param layouts The id->layout map
+         * @param record The record words, including the header
+         * @return The layout, or nullptr if the record is not a sample, or is not from a known event
+         */
+        [[nodiscard]] static perf_sample_layout_t const * find(layout_map_t const & layouts,
+                                                               lib::Span<data_word_t const> record);
+
+    private:
+        mutable std::mutex mutex {};
+        std::map<gator_key_t, perf_sample_layout_t> layouts_by_key {};
+        std::shared_ptr<layout_map_t const> layouts_by_id;
+        std::shared_ptr<key_map_t const> keys_by_id;
+    };
+}
@@ -11,12 +11,12 @@
 #include <boost/asio/use_future.hpp>
 
 namespace agents::perf {
-    perf_source_adapter_t::perf_source_adapter_t(sem_t & sender_sem,
+    perf_source_adapter_t::perf_source_adapter_t(lib::ReadySignal sender_signal,
                                                  ISender & sender,
                                                  std::function<void(bool, std::vector<pid_t>)> agent_started_callback,
                                                  std::function<void()> exec_target_app_callback,
                                                  std::function<void()> profiling_started_callback)
-        : sender_sem(sender_sem),
+        : sender_signal(sender_signal),
           sender(sender),
           agent_started_callback(std::move(agent_started_callback)),
           exec_target_app_callback(std::move(exec_target_app_callback)),
@@ -123,9 +123,9 @@ namespace agents::perf {
         if (local_end_session) {
             local_end_session();
         }
-        else {
-            sem_post(&sender_sem);
-        }
+
+        // the sender only visits sources that have signalled, so must be told that this one is done either way
+        sender_signal.notify();
     }
 
     void perf_source_adapter_t::on_apc_frame_received(const std::vector<char> & frame)
@@ -8,19 +8,18 @@
 #include "Source.h"
 #include "agents/perf/perf_agent_worker.h"
 #include "ipc/messages.h"
+#include "lib/ReadyBitmap.h"
 
 #include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
 
-#include <semaphore.h>
-
 namespace agents::perf {
 
     class perf_source_adapter_t : public PrimarySource {
     public:
-        explicit perf_source_adapter_t(sem_t & sender_sem,
+        explicit perf_source_adapter_t(lib::ReadySignal sender_signal,
                                        ISender & sender,
                                        std::function<void(bool, std::vector<pid_t>)> agent_started_callback,
                                        std::function<void()> exec_target_app_callback,
@@ -103,7 +102,7 @@ namespace agents::perf {
         void exec_target_app();
 
     private:
-        sem_t & sender_sem;
+        lib::ReadySignal sender_signal;
         ISender & sender;
 
         // variables that are guarded by the event_mutex
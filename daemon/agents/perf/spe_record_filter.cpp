@@ -0,0 +1,263 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "agents/perf/spe_record_filter.hpp"
+
+#include <algorithm>
+#include <optional>
+
+namespace agents::perf {
+
+    namespace {
+        // Packet headers, see "Statistical Profiling Extension" in the Arm ARM
+        constexpr std::uint8_t padding_header = 0x00;
+        constexpr std::uint8_t end_header = 0x01;
+        constexpr std::uint8_t timestamp_header = 0x71;
+        constexpr std::uint8_t extended_header_mask = 0xfc;
+        constexpr std::uint8_t extended_header = 0x20;
+        constexpr std::uint8_t events_mask = 0xcf;
+        constexpr std::uint8_t events_header = 0x42;
+        constexpr std::uint8_t op_type_mask = 0xcc;
+        constexpr std::uint8_t op_type_header = 0x48;
+        constexpr std::uint8_t counter_mask = 0xf8;
+        constexpr std::uint8_t counter_header = 0x98;
+
+        constexpr std::uint8_t op_class_load_store = 1;
+        constexpr std::uint8_t op_class_branch = 2;
+
+        constexpr unsigned counter_total_latency = 0;
+        constexpr unsigned counter_issue_latency = 1;
+        constexpr unsigned counter_translation_latency = 2;
+
+        constexpr std::size_t packet_step = 256;
+
+        /** A decoded packet */
+        struct packet_t {
+            std::size_t size;
+            std::uint8_t header;
+            unsigned extended_index;
+            lib::Span<std::uint8_t const> payload;
+        };
+
+        /** Decode the packet at the start of data, returning nothing if it is incomplete */
+        [[nodiscard]] std::optional<packet_t> decode_packet(lib::Span<std::uint8_t const> data)
+        {
+            if (data.empty()) {
+                return {};
+            }
+
+            auto header = data[0];
+            std::size_t header_size = 1;
+            unsigned extended_index = 0;
+
+            if (header == timestamp_header) {
+                if (data.size() < 9) {
+                    return {};
+                }
+                return packet_t {9, header, 0, data.subspan(1, 8)};
+            }
+
+            if ((header & extended_header_mask) == extended_header) {
+                if (data.size() < 2) {
+                    return {};
+                }
+                extended_index = (header & ~extended_header_mask);
+                header = data[1];
+                header_size = 2;
+            }
+
+            // the payload size is encoded in bits 5:4 of the address, counter, events, data source, context and
+            // operation type packets, all of which have bits 7:6 as 0b01 or 0b10
+            auto const top_bits = (header & 0xc0);
+            if ((top_bits != 0x40) && (top_bits != 0x80)) {
+                return packet_t {header_size, header, extended_index, {}};
+            }
+
+            std::size_t const payload_size = (1U << ((header >> 4) & 0x3));
+            if (data.size() < header_size + payload_size) {
+                return {};
+            }
+
+            return packet_t {header_size + payload_size,
+                             header,
+                             extended_index,
+                             data.subspan(header_size, payload_size)};
+        }
+
+        [[nodiscard]] std::uint64_t read_payload(lib::Span<std::uint8_t const> payload)
+        {
+            std::uint64_t result = 0;
+            for (std::size_t n = 0; n < payload.size(); ++n) {
+                result |= (std::uint64_t(payload[n]) << (8 * n));
+            }
+            return result;
+        }
+    }
+
+    bool spe_record_filter_t::keep(lib::Span<std::uint8_t const> record) const
+    {
+        std::optional<std::uint32_t> latencies[3] {};
+        std::uint64_t events = 0;
+        std::uint32_t ops = 0;
+
+        while (!record.empty()) {
+            auto const packet = decode_packet(record);
+            if (!packet) {
+                break;
+            }
+
+            auto const header = packet->header;
+
+            if ((header & events_mask) == events_header) {
+                events = read_payload(packet->payload);
+            }
+            else if ((header & op_type_mask) == op_type_header) {
+                auto const op_class = (header & 0x3);
+                auto const subclass = (packet->payload.empty() ? 0 : packet->payload[0]);
+                if (op_class == op_class_load_store) {
+                    ops |= ((subclass & 0x1) != 0 ? spe_record_filter_config_t::ops_store
+                                                  : spe_record_filter_config_t::ops_load);
+                }
+                else if (op_class == op_class_branch) {
+                    ops |= spe_record_filter_config_t::ops_branch;
+                }
+            }
+            else if ((header & counter_mask) == counter_header) {
+                auto const index = (header & 0x7) | (packet->extended_index << 3);
+                if (index <= counter_translation_latency) {
+                    latencies[index] = std::uint32_t(read_payload(packet->payload) & 0xfff);
+                }
+            }
+
+            record = record.subspan(packet->size);
+        }
+
+        auto const latency_too_low = [&latencies](unsigned index, std::uint32_t threshold) {
+            return (threshold != 0) && ((!latencies[index]) || (*latencies[index] < threshold));
+        };
+
+        if (latency_too_low(counter_total_latency, config.min_total_latency)
+            || latency_too_low(counter_issue_latency, config.min_issue_latency)
+            || latency_too_low(counter_translation_latency, config.min_translation_latency)) {
+            return false;
+        }
+
+        if ((config.ops != 0) && ((config.ops & ops) == 0)) {
+            return false;
+        }
+
+        if ((config.any_event_mask != 0) && ((config.any_event_mask & events) == 0)) {
+            return false;
+        }
+
+        return true;
+    }
+
+    std::size_t spe_record_filter_t::consume(lib::Span<std::uint8_t const> data,
+                                             std::uint64_t offset,
+                                             std::vector<char> & out,
+                                             std::vector<spe_record_run_t> & runs) const
+    {
+        std::size_t record_start = 0;
+        std::size_t position = 0;
+
+        while (position < data.size()) {
+            // skip any padding between records
+            if ((position == record_start) && (data[position] == padding_header)) {
+                position += 1;
+                record_start = position;
+                continue;
+            }
+
+            auto const packet = decode_packet(data.subspan(position));
+            if (!packet) {
+                break;
+            }
+
+            position += packet->size;
+
+            if ((packet->header == end_header) || (packet->header == timestamp_header)) {
+                auto const record = data.subspan(record_start, position - record_start);
+                if (keep(record)) {
+                    auto const record_offset = offset + record_start;
+                    out.insert(out.end(), record.begin(), record.end());
+                    if ((!runs.empty()) && (runs.back().offset + runs.back().size == record_offset)
+                        && (runs.back().size + record.size() <= max_run_size)) {
+                        runs.back().size += record.size();
+                    }
+                    else {
+                        runs.push_back({record_offset, record.size()});
+                    }
+                }
+                record_start = position;
+            }
+        }
+
+        return record_start;
+    }
+
+    void spe_record_filter_t::filter_span(partial_record_t & partial,
+                                          lib::Span<std::uint8_t const> data,
+                                          std::uint64_t offset,
+                                          std::vector<char> & out,
+                                          std::vector<spe_record_run_t> & runs) const
+    {
+        std::size_t position = 0;
+
+        // the rest of the partial record is lost if the data in between was overwritten before it was read
+        if ((!partial.data.empty()) && (partial.offset + partial.data.size() != offset)) {
+            partial.data.clear();
+        }
+
+        // complete the partial record from the previous chunk, a few packets at a time so as not to copy the whole chunk
+        while (!partial.data.empty()) {
+            if (position >= data.size()) {
+                return;
+            }
+
+            auto const step = std::min(packet_step, data.size() - position);
+            partial.data.insert(partial.data.end(), data.begin() + position, data.begin() + position + step);
+            position += step;
+
+            auto const consumed = consume(partial.data, partial.offset, out, runs);
+            if (consumed > 0) {
+                // anything after the completed record was copied from the current step, so process it in place
+                position -= (partial.data.size() - consumed);
+                partial.data.clear();
+            }
+            else if (partial.data.size() > max_record_size) {
+                // no record end found, so the data is not understood
+                partial.data.clear();
+            }
+        }
+
+        auto const remaining = data.subspan(position);
+        auto const consumed = consume(remaining, offset + position, out, runs);
+
+        partial.data.assign(remaining.begin() + consumed, remaining.end());
+        partial.offset = offset + position + consumed;
+        if (partial.data.size() > max_record_size) {
+            partial.data.clear();
+        }
+    }
+
+    void spe_record_filter_t::filter(int cpu,
+                                     std::uint64_t offset,
+                                     lib::Span<char const> first,
+                                     lib::Span<char const> second,
+                                     std::vector<char> & out,
+                                     std::vector<spe_record_run_t> & runs)
+    {
+        partial_record_t * partial;
+        {
+            std::lock_guard lock {mutex};
+            partial = &partial_records[cpu];
+        }
+
+        filter_span(*partial, {reinterpret_cast<std::uint8_t const *>(first.data()), first.size()}, offset, out, runs);
+        filter_span(*partial,
+                    {reinterpret_cast<std::uint8_t const *>(second.data()), second.size()},
+                    offset + first.size(),
+                    out,
+                    runs);
+    }
+}
@@ -0,0 +1,130 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "lib/Span.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace agents::perf {
+
+    /** Configures which SPE records are kept by spe_record_filter_t; a zero field means no filtering on that field */
+    struct spe_record_filter_config_t {
+        static constexpr std::uint32_t ops_load = 1U << 0;
+        static constexpr std::uint32_t ops_store = 1U << 1;
+        static constexpr std::uint32_t ops_branch = 1U << 2;
+
+        /** Keep records with any of these event bits set (unlike PMSEVFR_EL1, which requires all of them) */
+        std::uint64_t any_event_mask;
+        /** Keep records with one of these operation types (ops_*) */
+        std::uint32_t ops;
+        /** Keep records with at least this total latency */
+        std::uint32_t min_total_latency;
+        /** Keep records with at least this issue latency */
+        std::uint32_t min_issue_latency;
+        /** Keep records with at least this translation latency */
+        std::uint32_t min_translation_latency;
+
+        /** @return True if any filtering is configured */
+        [[nodiscard]] bool is_enabled() const
+        {
+            return (any_event_mask != 0) || (ops != 0) || (min_total_latency != 0) || (min_issue_latency != 0)
+                || (min_translation_latency != 0);
+        }
+    };
+
+    /** A run of kept records that were next to each other in the aux data */
+    struct spe_record_run_t {
+        /** The position of the first record in the cpu's aux data, counted as aux_tail and aux_head are */
+        std::uint64_t offset;
+        /** The size of the run */
+        std::size_t size;
+    };
+
+    /**
+     * Filters the raw SPE aux data on target so that only records that are of interest are sent.
+     *
+     * The aux data is split into records at each End or Timestamp packet. Records that span the boundary between
+     * two chunks of aux data are held per cpu until the rest of the record is received. Padding is dropped.
+     *
+     * The kept records are reported as runs, each with its position in the aux data, so that they can be sent with
+     * their real aux offsets; the gaps between the runs are the records that were dropped.
+     */
+    class spe_record_filter_t {
+    public:
+        /** A record (or partial record) longer than this is assumed to be corrupt and is dropped */
+        static constexpr std::size_t max_record_size = 4096;
+
+        /**
+         * @param config The records to keep
+         * @param max_run_size The largest run to report, so that each run fits in one frame
+         */
+        spe_record_filter_t(spe_record_filter_config_t const & config, std::size_t max_run_size)
+            : config(config), max_run_size(std::max(max_run_size, max_record_size))
+        {
+        }
+
+        /**
+         * Filter one chunk of aux data
+         *
+         * @param cpu The cpu the aux data is from
+         * @param offset The position of the chunk in the cpu's aux data
+         * @param first The first part of the chunk
+         * @param second The second part of the chunk (after the ringbuffer wrapped)
+         * @param out The kept records are appended to this buffer
+         * @param runs The runs that the records appended to `out` form, in order
+         */
+        void filter(int cpu,
+                    std::uint64_t offset,
+                    lib::Span<char const> first,
+                    lib::Span<char const> second,
+                    std::vector<char> & out,
+                    std::vector<spe_record_run_t> & runs);
+
+        /**
+         * Decide whether a complete record should be kept
+         *
+         * @param record The record, ending with its End or Timestamp packet
+         * @return True to keep the record
+         */
+        [[nodiscard]] bool keep(lib::Span<std::uint8_t const> record) const;
+
+        /**
+         * Find the size of the complete records at the start of some aux data, appending those that are kept to `out`
+         *
+         * @param data The aux data
+         * @param offset The position of `data` in the cpu's aux data
+         * @param out The kept records are appended to this buffer
+         * @param runs The runs of the kept records are added to this, extending the last run if they follow on from it
+         * @return The number of bytes consumed, being the offset just after the last complete record
+         */
+        [[nodiscard]] std::size_t consume(lib::Span<std::uint8_t const> data,
+                                          std::uint64_t offset,
+                                          std::vector<char> & out,
+                                          std::vector<spe_record_run_t> & runs) const;
+
+    private:
+        /** The start of a record that continues into the next chunk */
+        struct partial_record_t {
+            std::vector<std::uint8_t> data {};
+            /** The position of the start of the record in the cpu's aux data */
+            std::uint64_t offset {0};
+        };
+
+        spe_record_filter_config_t config;
+        std::size_t max_run_size;
+        std::mutex mutex {};
+        std::map<int, partial_record_t> partial_records {};
+
+        void filter_span(partial_record_t & partial,
+                         lib::Span<std::uint8_t const> data,
+                         std::uint64_t offset,
+                         std::vector<char> & out,
+                         std::vector<spe_record_run_t> & runs) const;
+    };
+}
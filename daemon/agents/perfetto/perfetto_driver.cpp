@@ -41,7 +41,7 @@ namespace agents::perfetto {
         mxmlElementSetAttr(root, "name", "Perfetto");
     }
 
-    void perfetto_driver_t::readEvents(mxml_node_t * const /* unused */)
+    void perfetto_driver_t::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
     {
         bool is_android = lib::is_android();
         bool traced_running = lib::check_traced_running();
@@ -10,7 +10,7 @@ namespace agents::perfetto {
     public:
         explicit perfetto_driver_t(const char * maliFamilyName);
         void writeEvents(mxml_node_t * root) const override;
-        void readEvents(mxml_node_t * root) override;
+        void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
         std::vector<std::string> get_other_warnings() const override;
         void setupCounter(Counter & counter) override;
         bool perfettoEnabled() const;
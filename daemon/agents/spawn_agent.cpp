@@ -6,14 +6,18 @@
 #include "lib/AutoClosingFd.h"
 #include "lib/FsEntry.h"
 #include "lib/Process.h"
+#include "lib/Syscall.h"
 #include "lib/error_code_or.hpp"
 #include "lib/forked_process.h"
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include <boost/system/errc.hpp>
 
+#include <sys/wait.h>
+
 namespace agents {
     namespace {
 
@@ -42,7 +46,9 @@ namespace agents {
     }
 
     /** Simple agent spawner */
-    lib::error_code_or_t<lib::forked_process_t> simple_agent_spawner_t::spawn_agent_process(char const * agent_name)
+    lib::error_code_or_t<lib::forked_process_t> simple_agent_spawner_t::spawn_agent_process(
+        char const * agent_name,
+        lib::Span<int const> inherited_fds)
     {
         runtime_assert(agent_name != nullptr, "agent_name is required");
 
@@ -80,7 +86,8 @@ namespace agents {
                                                    arguments,
                                                    {},
                                                    {},
-                                                   lib::get_value(std::move(stdio_fds)));
+                                                   lib::get_value(std::move(stdio_fds)),
+                                                   inherited_fds);
     }
 
     android_pkg_agent_spawner_t::~android_pkg_agent_spawner_t() noexcept
@@ -92,7 +99,8 @@ namespace agents {
 
     /** Android agent spawner */
     lib::error_code_or_t<lib::forked_process_t> android_pkg_agent_spawner_t::spawn_agent_process(
-        char const * agent_name)
+        char const * agent_name,
+        lib::Span<int const> inherited_fds)
     {
         runtime_assert(agent_name != nullptr, "agent_name is required");
 
@@ -127,7 +135,70 @@ namespace agents {
                                                    arguments,
                                                    {},
                                                    {},
-                                                   lib::get_value(std::move(stdio_fds)));
+                                                   lib::get_value(std::move(stdio_fds)),
+                                                   inherited_fds);
+    }
+
+    lib::error_code_or_t<lib::forked_process_t> fd_inheriting_agent_spawner_t::spawn_agent_process(
+        char const * agent_name,
+        lib::Span<int const> inherited_fds)
+    {
+        runtime_assert(agent_name != nullptr, "agent_name is required");
+
+        if (fds.empty() || (this->agent_name != agent_name)) {
+            return spawner->spawn_agent_process(agent_name, inherited_fds);
+        }
+
+        std::vector<int> all_inherited_fds {fds};
+        all_inherited_fds.insert(all_inherited_fds.end(), inherited_fds.begin(), inherited_fds.end());
+
+        return spawner->spawn_agent_process(agent_name, all_inherited_fds);
+    }
+
+    bool prespawning_agent_spawner_t::prespawn(char const * agent_name)
+    {
+        runtime_assert(agent_name != nullptr, "agent_name is required");
+
+        auto result = spawner.spawn_agent_process(agent_name);
+        if (auto const * error = lib::get_error(result)) {
+            LOG_DEBUG("Could not start agent [%s] ahead of time: %s", agent_name, error->message().c_str());
+            return false;
+        }
+
+        auto process = lib::get_value(std::move(result));
+        // the agent waits on stdin for its configuration, so only its start up is done ahead of time
+        if (!process.exec()) {
+            LOG_DEBUG("Could not exec agent [%s] ahead of time", agent_name);
+            return false;
+        }
+
+        LOG_DEBUG("Started agent [%s] ahead of time as pid %d", agent_name, process.get_pid());
+        prespawned.insert_or_assign(agent_name, std::move(process));
+        return true;
+    }
+
+    lib::error_code_or_t<lib::forked_process_t> prespawning_agent_spawner_t::spawn_agent_process(
+        char const * agent_name,
+        lib::Span<int const> inherited_fds)
+    {
+        runtime_assert(agent_name != nullptr, "agent_name is required");
+
+        // an agent that was started ahead of time did not inherit any additional fds
+        auto it = (inherited_fds.size() == 0 ? prespawned.find(std::string_view(agent_name)) : prespawned.end());
+        if (it != prespawned.end()) {
+            auto process = std::move(it->second);
+            prespawned.erase(it);
+
+            // only use it if it is still running, as its exit may already have been reaped or missed
+            if (lib::waitpid(process.get_pid(), nullptr, WNOHANG) == 0) {
+                LOG_DEBUG("Using agent [%s] that was started ahead of time", agent_name);
+                return process;
+            }
+
+            LOG_DEBUG("Agent [%s] that was started ahead of time has exited", agent_name);
+        }
+
+        return spawner.spawn_agent_process(agent_name, inherited_fds);
     }
 
     /** Spawn the agent */
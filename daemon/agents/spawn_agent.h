@@ -7,12 +7,18 @@
 #include "async/proc/process_monitor.hpp"
 #include "ipc/raw_ipc_channel_sink.h"
 #include "ipc/raw_ipc_channel_source.h"
+#include "lib/Span.h"
 #include "lib/error_code_or.hpp"
 #include "lib/forked_process.h"
 #include "logging/agent_log.h"
 
+#include <functional>
+#include <map>
+#include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <boost/asio/io_context.hpp>
 
@@ -37,9 +43,19 @@ namespace agents {
          * Spawn the agent process with the specified ID
          *
          * @param agent_name The agent ID string
+         * @param inherited_fds Close-on-exec fds that the agent process must inherit; only the forked process makes
+         *  them inheritable
          * @return The process popen result
          */
-        virtual lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name) = 0;
+        virtual lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(
+            char const * agent_name,
+            lib::Span<int const> inherited_fds) = 0;
+
+        /** Spawn the agent process with the specified ID, without inheriting any additional fds */
+        lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name)
+        {
+            return spawn_agent_process(agent_name, {});
+        }
     };
 
     /**
@@ -47,7 +63,10 @@ namespace agents {
      */
     class simple_agent_spawner_t final : public i_agent_spawner_t {
     public:
-        lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name) override;
+        using i_agent_spawner_t::spawn_agent_process;
+
+        lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name,
+                                                                        lib::Span<int const> inherited_fds) override;
     };
 
     /**
@@ -62,13 +81,70 @@ namespace agents {
         android_pkg_agent_spawner_t & operator=(android_pkg_agent_spawner_t &&) noexcept = default;
         ~android_pkg_agent_spawner_t() noexcept override;
 
-        lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name) override;
+        using i_agent_spawner_t::spawn_agent_process;
+
+        lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name,
+                                                                        lib::Span<int const> inherited_fds) override;
 
     private:
         std::string package_name;
         std::optional<std::string> remote_exe_path {};
     };
 
+    /**
+     * Implementation of i_agent_spawner_t that lets one agent inherit some file descriptors that are otherwise
+     * close-on-exec, e.g. the ring buffer carriers that gator-main reserves for the perf agent.
+     *
+     * The descriptors stay close-on-exec in this process; only the forked agent process makes them inheritable, just
+     * before it execs, so nothing else that is forked at the same time inherits them.
+     */
+    class fd_inheriting_agent_spawner_t final : public i_agent_spawner_t {
+    public:
+        fd_inheriting_agent_spawner_t(std::unique_ptr<i_agent_spawner_t> spawner,
+                                      std::string_view agent_name,
+                                      std::vector<int> fds)
+            : spawner(std::move(spawner)), agent_name(agent_name), fds(std::move(fds))
+        {
+        }
+
+        using i_agent_spawner_t::spawn_agent_process;
+
+        lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name,
+                                                                        lib::Span<int const> inherited_fds) override;
+
+    private:
+        std::unique_ptr<i_agent_spawner_t> spawner;
+        std::string agent_name;
+        std::vector<int> fds;
+    };
+
+    /**
+     * Implementation of i_agent_spawner_t that can start the agent processes before they are needed, so that they have
+     * already been exec'd and initialised by the time the capture asks for them. An agent that is asked for, but that
+     * was not started ahead of time (or that has since exited), is spawned by the wrapped spawner as usual.
+     */
+    class prespawning_agent_spawner_t final : public i_agent_spawner_t {
+    public:
+        explicit prespawning_agent_spawner_t(i_agent_spawner_t & spawner) : spawner(spawner) {}
+
+        /**
+         * Spawn and exec an agent process now, to be returned by the next call to spawn_agent_process for that agent
+         *
+         * @param agent_name The agent ID string
+         * @return True if the agent process was started
+         */
+        bool prespawn(char const * agent_name);
+
+        using i_agent_spawner_t::spawn_agent_process;
+
+        lib::error_code_or_t<lib::forked_process_t> spawn_agent_process(char const * agent_name,
+                                                                        lib::Span<int const> inherited_fds) override;
+
+    private:
+        i_agent_spawner_t & spawner;
+        std::map<std::string, lib::forked_process_t, std::less<>> prespawned {};
+    };
+
     /**
      * The spawned agent resutl object
      */
@@ -162,7 +162,7 @@ namespace gator::android {
     /**
      *  Performs counter discovery. Checks for conditions and creates one or more counters if those conditions are met.
      */
-    void ThermalDriver::readEvents(mxml_node_t * /*unused*/)
+    void ThermalDriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
     {
         if (lib_ptr != nullptr) {
             setCounters(new ThermalCounter(getCounters(), "Android_ThermalState", lib_ptr));
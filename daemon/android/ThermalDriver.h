@@ -20,7 +20,7 @@ namespace gator::android {
         ThermalDriver(ThermalDriver &&) = delete;
         ThermalDriver & operator=(ThermalDriver &&) = delete;
 
-        void readEvents(mxml_node_t * xml) override;
+        void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
         void writeEvents(mxml_node_t * root) const override;
 
     private:
@@ -5,6 +5,7 @@
 #include "ISender.h"
 #include "Protocol.h"
 #include "Time.h"
+#include "agents/perf/apc_buffer_pool.hpp"
 #include "agents/perf/events/types.hpp"
 #include "agents/perf/perf_driver_summary.h"
 #include "apc/perf_apc_frame_utils.h"
@@ -39,8 +40,9 @@ namespace apc {
 
     class misc_apc_frame_ipc_sender_t {
     public:
-        explicit misc_apc_frame_ipc_sender_t(std::shared_ptr<ipc::raw_ipc_channel_sink_t> ipc_sink)
-            : ipc_sink(std::move(ipc_sink)) {};
+        misc_apc_frame_ipc_sender_t(std::shared_ptr<ipc::raw_ipc_channel_sink_t> ipc_sink,
+                                    std::shared_ptr<agents::perf::apc_buffer_pool_t> buffer_pool)
+            : ipc_sink(std::move(ipc_sink)), buffer_pool(std::move(buffer_pool)) {};
 
         template<typename CompletionToken>
         auto async_send_perf_events_attributes_frame(perf_event_attr const & pea, int key, CompletionToken && token)
@@ -102,10 +104,16 @@ namespace apc {
             }
 
             return async_initiate_explicit<void(boost::system::error_code)>(
-                [ipc_sink = ipc_sink, bytes = apc::make_maps_frame(pid, tid, maps)](auto && sc) mutable {
+                [ipc_sink = ipc_sink,
+                 buffer_pool = buffer_pool,
+                 bytes = apc::make_maps_frame(pid, tid, maps, *buffer_pool)](auto && sc) mutable {
                     submit(ipc_sink->async_send_message(ipc::msg_apc_frame_data_t {std::move(bytes)},
                                                         use_continuation) //
-                               | then([](auto const & ec, auto const &) { return ec; }),
+                               | then([buffer_pool](auto const & ec, auto msg) {
+                                     // the write is complete, so the buffer can be reused
+                                     buffer_pool->release(std::move(msg.suffix));
+                                     return ec;
+                                 }),
                            std::forward<decltype(sc)>(sc));
                 },
                 std::forward<CompletionToken>(token));
@@ -121,10 +129,16 @@ namespace apc {
             using namespace async::continuations;
 
             return async_initiate_explicit<void(boost::system::error_code)>(
-                [ipc_sink = ipc_sink, bytes = apc::make_comm_frame(pid, tid, image, comm)](auto && sc) mutable {
+                [ipc_sink = ipc_sink,
+                 buffer_pool = buffer_pool,
+                 bytes = apc::make_comm_frame(pid, tid, image, comm, *buffer_pool)](auto && sc) mutable {
                     submit(ipc_sink->async_send_message(ipc::msg_apc_frame_data_t {std::move(bytes)},
                                                         use_continuation) //
-                               | then([](auto const & ec, auto const &) { return ec; }),
+                               | then([buffer_pool](auto const & ec, auto msg) {
+                                     // the write is complete, so the buffer can be reused
+                                     buffer_pool->release(std::move(msg.suffix));
+                                     return ec;
+                                 }),
                            std::forward<decltype(sc)>(sc));
                 },
                 std::forward<CompletionToken>(token));
@@ -159,10 +173,16 @@ namespace apc {
             }
 
             return async_initiate_explicit<void(boost::system::error_code)>(
-                [ipc_sink = ipc_sink, bytes = apc::make_kallsyms_frame(kallsyms)](auto && sc) mutable {
+                [ipc_sink = ipc_sink,
+                 buffer_pool = buffer_pool,
+                 bytes = apc::make_kallsyms_frame(kallsyms, *buffer_pool)](auto && sc) mutable {
                     submit(ipc_sink->async_send_message(ipc::msg_apc_frame_data_t {std::move(bytes)},
                                                         use_continuation) //
-                               | then([](auto const & ec, auto const &) { return ec; }),
+                               | then([buffer_pool](auto const & ec, auto msg) {
+                                     // the write is complete, so the buffer can be reused
+                                     buffer_pool->release(std::move(msg.suffix));
+                                     return ec;
+                                 }),
                            std::forward<decltype(sc)>(sc));
                 },
                 std::forward<CompletionToken>(token));
@@ -248,6 +268,7 @@ namespace apc {
 
     private:
         std::shared_ptr<ipc::raw_ipc_channel_sink_t> ipc_sink;
+        std::shared_ptr<agents::perf::apc_buffer_pool_t> buffer_pool;
     };
 
 }
@@ -5,6 +5,7 @@
 #include "Buffer.h"
 #include "Protocol.h"
 #include "Time.h"
+#include "agents/perf/apc_buffer_pool.hpp"
 #include "agents/perf/async_buffer_builder.h"
 #include "agents/perf/events/types.hpp"
 #include "k/perf_event.h"
@@ -19,6 +20,15 @@ namespace apc {
 
     namespace detail {
 
+        /** The most bytes written by make_perf_attr_frame_header */
+        constexpr std::size_t max_perf_attr_frame_header_size = 3 * buffer_utils::MAXSIZE_PACK32;
+
+        /** The most bytes written by write_string_view */
+        [[nodiscard]] constexpr std::size_t max_string_view_size(std::string_view sv)
+        {
+            return sv.size() + buffer_utils::MAXSIZE_PACK32;
+        }
+
         inline void make_perf_attr_frame_header(CodeType type,
                                                 agents::perf::apc_buffer_builder_t<std::vector<char>> & buffer)
         {
@@ -90,9 +100,13 @@ namespace apc {
         return frame;
     }
 
-    [[nodiscard]] inline std::vector<char> make_maps_frame(int pid, int tid, std::string_view maps)
+    [[nodiscard]] inline std::vector<char> make_maps_frame(int pid,
+                                                           int tid,
+                                                           std::string_view maps,
+                                                           agents::perf::apc_buffer_pool_t & buffer_pool)
     {
-        std::vector<char> frame {};
+        auto frame = buffer_pool.acquire(detail::max_perf_attr_frame_header_size + (2 * buffer_utils::MAXSIZE_PACK32)
+                                         + detail::max_string_view_size(maps));
         agents::perf::apc_buffer_builder_t<std::vector<char>> buffer(frame);
         detail::make_perf_attr_frame_header(CodeType::MAPS, buffer);
         buffer.packInt(pid);
@@ -105,9 +119,11 @@ namespace apc {
     [[nodiscard]] inline std::vector<char> make_comm_frame(int pid,
                                                            int tid,
                                                            std::string_view image,
-                                                           std::string_view comm)
+                                                           std::string_view comm,
+                                                           agents::perf::apc_buffer_pool_t & buffer_pool)
     {
-        std::vector<char> frame {};
+        auto frame = buffer_pool.acquire(detail::max_perf_attr_frame_header_size + (2 * buffer_utils::MAXSIZE_PACK32)
+                                         + detail::max_string_view_size(image) + detail::max_string_view_size(comm));
         agents::perf::apc_buffer_builder_t<std::vector<char>> buffer(frame);
         detail::make_perf_attr_frame_header(CodeType::COMM, buffer);
 
@@ -130,9 +146,11 @@ namespace apc {
         return detail::make_cpu_frame(CodeType::OFFLINE_CPU, timestamp, cpu);
     }
 
-    [[nodiscard]] inline std::vector<char> make_kallsyms_frame(std::string_view kallsyms)
+    [[nodiscard]] inline std::vector<char> make_kallsyms_frame(std::string_view kallsyms,
+                                                               agents::perf::apc_buffer_pool_t & buffer_pool)
     {
-        std::vector<char> frame {};
+        auto frame = buffer_pool.acquire(detail::max_perf_attr_frame_header_size
+                                         + detail::max_string_view_size(kallsyms));
         agents::perf::apc_buffer_builder_t<std::vector<char>> buffer(frame);
         detail::make_perf_attr_frame_header(CodeType::KALLSYMS, buffer);
         detail::write_string_view(kallsyms, buffer);
@@ -16,8 +16,8 @@
 namespace armnn {
     class Source : public ::Source {
     public:
-        Source(ICaptureController & captureController, sem_t & readerSem)
-            : captureController(captureController), buffer(gSessionData.mTotalBufferSize * 1024 * 1024, readerSem)
+        Source(ICaptureController & captureController, lib::ReadySignal readerSignal)
+            : captureController(captureController), buffer(gSessionData.mTotalBufferSize * 1024 * 1024, readerSignal)
         {
         }
 
@@ -41,8 +41,8 @@ namespace armnn {
         Buffer buffer;
     };
 
-    std::shared_ptr<::Source> createSource(ICaptureController & captureController, sem_t & readerSem)
+    std::shared_ptr<::Source> createSource(ICaptureController & captureController, lib::ReadySignal readerSignal)
     {
-        return std::make_shared<Source>(captureController, readerSem);
+        return std::make_shared<Source>(captureController, readerSignal);
     }
 }
@@ -2,15 +2,15 @@
 
 #pragma once
 
+#include "lib/ReadyBitmap.h"
+
 #include <cstdint>
 #include <functional>
 #include <memory>
 
-#include <semaphore.h>
-
 class Child;
 class Source;
 namespace armnn {
     class ICaptureController;
-    std::shared_ptr<::Source> createSource(ICaptureController & captureController, sem_t & readerSem);
+    std::shared_ptr<::Source> createSource(ICaptureController & captureController, lib::ReadySignal readerSignal);
 }
@@ -1,7 +1,8 @@
-/* Copyright (C) 2021-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2021-2023 by Arm Limited. All rights reserved. */
 
 #pragma once
 
+#include "async/continuations/detail/recycling_allocator.h"
 #include "async/continuations/detail/then_state.h"
 #include "async/continuations/detail/trace.h"
 #include "lib/source_location.h"
@@ -27,7 +28,7 @@ namespace async::continuations::detail {
                 typename then_helper_t<generator_type &, InputArgs...>::initiator_helper_type;
 
             /** The shared state for each loop iteration */
-            struct iteration_state_t {
+            struct iteration_state_t : recycling_allocated_t {
                 state_type state;
                 next_type next;
                 std::size_t loop_count = 0;
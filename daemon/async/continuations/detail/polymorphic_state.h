@@ -1,8 +1,9 @@
-/* Copyright (C) 2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2022-2023 by Arm Limited. All rights reserved. */
 
 #pragma once
 
 #include "async/continuations/detail/initiation_chain.h"
+#include "async/continuations/detail/recycling_allocator.h"
 #include "async/continuations/detail/state_chain.h"
 #include "async/continuations/detail/trace.h"
 #include "lib/source_location.h"
@@ -73,7 +74,7 @@ namespace async::continuations::detail {
         {
             using value_type = polymorphic_exceptionally_value_t<Exceptionally>;
 
-            return {std::make_shared<value_type>(exceptionally)};
+            return {std::allocate_shared<value_type>(recycling_std_allocator_t<value_type>(), exceptionally)};
         }
 
         static polymorphic_exceptionally_t wrap_exceptionally(polymorphic_exceptionally_t const & exceptionally)
@@ -101,9 +102,9 @@ namespace async::continuations::detail {
 
     // ---------------------
 
-    /** Base type for wrapper around some NextInitiator that type erases it */
+    /** Base type for wrapper around some NextInitiator that type erases it (allocated per step, so recycled) */
     template<typename... InputArgs>
-    class polymorphic_next_initiator_base_t {
+    class polymorphic_next_initiator_base_t : public recycling_allocated_t {
     public:
         virtual ~polymorphic_next_initiator_base_t() noexcept = default;
 
@@ -172,9 +173,9 @@ namespace async::continuations::detail {
 
     // ---------------------
 
-    /** Base type for polymorphic state type */
+    /** Base type for polymorphic state type; as one is allocated for every polymorphic step, the blocks are recycled */
     template<typename... OutputArgs>
-    class polymorphic_state_base_t {
+    class polymorphic_state_base_t : public recycling_allocated_t {
     public:
         virtual ~polymorphic_state_base_t() noexcept = default;
 
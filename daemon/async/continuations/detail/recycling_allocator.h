@@ -0,0 +1,181 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include "Config.h"
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace async::continuations::detail {
+    /**
+     * A thread local cache of freed small blocks, for the type erased state that is allocated at each step of a
+     * polymorphic continuation.
+     *
+     * Those allocations are short lived and come in a handful of sizes, so reusing a freed block of the same size class
+     * avoids most calls to the global allocator. A block freed on a different thread to the one that allocated it is
+     * cached by the freeing thread, and each size class caches a bounded number of blocks so that memory is not held
+     * indefinitely when one thread mostly allocates and another mostly frees.
+     *
+     * Building with CONFIG_RECYCLE_CONTINUATION_STATE=0 passes every allocation straight to the global allocator.
+     */
+    class recycling_allocator_t {
+    public:
+        static constexpr std::size_t granularity = alignof(std::max_align_t);
+        static constexpr std::size_t max_block_size = 512;
+        static constexpr std::size_t max_cached_per_class = 64;
+
+        [[nodiscard]] static void * allocate(std::size_t size)
+        {
+            if ((!CONFIG_RECYCLE_CONTINUATION_STATE) || (size == 0) || (size > max_block_size)) {
+                return ::operator new(size);
+            }
+
+            // the block may be freed onto another thread's cache, so must always be the full size of its class
+            if (!cache_alive) {
+                return ::operator new(rounded_size(size));
+            }
+
+            auto & bucket = local_cache().buckets[class_of(size)];
+            if (bucket.head != nullptr) {
+                auto * block = bucket.head;
+                bucket.head = block->next;
+                --bucket.count;
+                return block;
+            }
+
+            return ::operator new(rounded_size(size));
+        }
+
+        static void deallocate(void * pointer, std::size_t size) noexcept
+        {
+            if ((!CONFIG_RECYCLE_CONTINUATION_STATE) || (size == 0) || (size > max_block_size) || !cache_alive) {
+                ::operator delete(pointer);
+                return;
+            }
+
+            auto & bucket = local_cache().buckets[class_of(size)];
+            if (bucket.count >= max_cached_per_class) {
+                ::operator delete(pointer);
+                return;
+            }
+
+            auto * block = static_cast<free_block_t *>(pointer);
+            block->next = bucket.head;
+            bucket.head = block;
+            ++bucket.count;
+        }
+
+    private:
+        struct free_block_t {
+            free_block_t * next;
+        };
+
+        struct bucket_t {
+            free_block_t * head = nullptr;
+            std::size_t count = 0;
+        };
+
+        struct cache_t {
+            std::array<bucket_t, max_block_size / granularity> buckets {};
+
+            cache_t() = default;
+            cache_t(cache_t const &) = delete;
+            cache_t & operator=(cache_t const &) = delete;
+            cache_t(cache_t &&) = delete;
+            cache_t & operator=(cache_t &&) = delete;
+
+            ~cache_t() noexcept
+            {
+                // anything freed later in thread exit goes straight to the global allocator
+                cache_alive = false;
+
+                for (auto & bucket : buckets) {
+                    while (bucket.head != nullptr) {
+                        auto * block = bucket.head;
+                        bucket.head = block->next;
+                        ::operator delete(block);
+                    }
+                }
+            }
+        };
+
+        /** Trivially destructible, so can still be read after the cache is destroyed */
+        static inline thread_local bool cache_alive = true;
+
+        [[nodiscard]] static cache_t & local_cache()
+        {
+            static thread_local cache_t cache {};
+            return cache;
+        }
+
+        [[nodiscard]] static constexpr std::size_t class_of(std::size_t size) { return (size - 1) / granularity; }
+
+        [[nodiscard]] static constexpr std::size_t rounded_size(std::size_t size)
+        {
+            return (class_of(size) + 1) * granularity;
+        }
+    };
+
+    /** Base class that makes `new` and `delete` of some (polymorphic or not) class use recycling_allocator_t */
+    class recycling_allocated_t {
+    public:
+        [[nodiscard]] static void * operator new(std::size_t size) { return recycling_allocator_t::allocate(size); }
+
+        static void operator delete(void * pointer, std::size_t size) noexcept
+        {
+            recycling_allocator_t::deallocate(pointer, size);
+        }
+
+        // over aligned types are left to the global allocator
+        [[nodiscard]] static void * operator new(std::size_t size, std::align_val_t align)
+        {
+            return ::operator new(size, align);
+        }
+
+        static void operator delete(void * pointer, std::size_t size, std::align_val_t align) noexcept
+        {
+            ::operator delete(pointer, size, align);
+        }
+    };
+
+    /** Standard allocator that uses recycling_allocator_t, for std::allocate_shared */
+    template<typename T>
+    class recycling_std_allocator_t {
+    public:
+        using value_type = T;
+
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over aligned types are not supported");
+
+        constexpr recycling_std_allocator_t() noexcept = default;
+
+        template<typename U>
+        // NOLINTNEXTLINE(hicpp-explicit-conversions)
+        constexpr recycling_std_allocator_t(recycling_std_allocator_t<U> const & /*that*/) noexcept
+        {
+        }
+
+        [[nodiscard]] T * allocate(std::size_t n)
+        {
+            return static_cast<T *>(recycling_allocator_t::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T * pointer, std::size_t n) noexcept
+        {
+            recycling_allocator_t::deallocate(pointer, n * sizeof(T));
+        }
+
+        template<typename U>
+        constexpr bool operator==(recycling_std_allocator_t<U> const & /*that*/) const noexcept
+        {
+            return true;
+        }
+
+        template<typename U>
+        constexpr bool operator!=(recycling_std_allocator_t<U> const & /*that*/) const noexcept
+        {
+            return false;
+        }
+    };
+}
@@ -1,4 +1,4 @@
-/* Copyright (C) 2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2022-2023 by Arm Limited. All rights reserved. */
 
 #pragma once
 
@@ -10,8 +10,11 @@
 #include "lib/FsEntry.h"
 #include "lib/Utils.h"
 #include "linux/proc/ProcessPollerBase.h"
+#include "linux/proc/ProcessScanner.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <boost/mp11/algorithm.hpp>
 #include <boost/mp11/bind.hpp>
@@ -31,74 +34,6 @@ namespace async {
         {
             return lnx::isPidDirectory(entry);
         }
-
-        /** @return The process exe path (or some estimation of it). Empty if the thread is a kernel thread, otherwise
-         * contains 'something'
-         */
-        inline std::optional<std::string> get_process_exe_path(const lib::FsEntry & entry)
-        {
-            return lnx::getProcessExePath(entry);
-        }
-
-        /** Helper for iterating some directory asynchronously */
-        template<typename Executor, typename Op>
-        class async_dir_iterator_t : public std::enable_shared_from_this<async_dir_iterator_t<Executor, Op>> {
-        public:
-            async_dir_iterator_t(Executor const & executor, lib::FsEntry const & dir, Op && op)
-                : executor(executor), dir(dir), iterator(dir.children()), op(std::forward<Op>(op))
-            {
-            }
-
-            [[nodiscard]] async::continuations::polymorphic_continuation_t<boost::system::error_code> async_run()
-            {
-                using namespace async::continuations;
-
-                LOG_TRACE("SCAN DIR: %s", dir.path().c_str());
-
-                auto self = this->shared_from_this();
-
-                return start_with(iterator.next(), boost::system::error_code {}) //
-                     | loop(
-                           // iterate while no error and has another value
-                           [self](std::optional<lib::FsEntry> entry, boost::system::error_code const & ec) {
-                               auto const valid = entry.has_value() && !ec;
-                               LOG_TRACE("LOOP DIR: '%s' = '%s' == %d",
-                                         self->dir.path().c_str(),
-                                         (entry ? entry->path().c_str() : ""),
-                                         valid);
-                               return start_with(valid, std::move(entry), ec);
-                           },
-                           [self](std::optional<lib::FsEntry> entry, boost::system::error_code const & /*ec*/) {
-                               LOG_TRACE("EXEC DIR: '%s' = '%s'", self->dir.path().c_str(), entry->path().c_str());
-                               return start_on(self->executor)    //
-                                    | self->op(std::move(*entry)) //
-                                    | post_on(self->executor)     //
-                                    | then([self](boost::system::error_code const & ec) {
-                                          LOG_TRACE("... ec=%s", ec.message().c_str());
-                                          return start_with(self->iterator.next(), ec);
-                                      });
-                           }) //
-                     | then(
-                           [self](std::optional<lib::FsEntry> const & /*entry*/, boost::system::error_code const & ec) {
-                               LOG_TRACE("FINISHED DIR: '%s' = %s", self->dir.path().c_str(), ec.message().c_str());
-                               return ec;
-                           });
-            }
-
-        private:
-            Executor executor;
-            lib::FsEntry dir;
-            lib::FsEntryDirectoryIterator iterator;
-            Op op;
-        };
-
-        template<typename Executor, typename Op>
-        auto make_async_dir_iterator(Executor && executor, lib::FsEntry const & dir, Op && op)
-        {
-            return std::make_shared<async_dir_iterator_t<Executor, Op>>(std::forward<Executor>(executor),
-                                                                        dir,
-                                                                        std::forward<Op>(op));
-        }
     }
 
     /**
@@ -195,18 +130,19 @@ namespace async {
             return async_initiate_cont<continuation_of_t<boost::system::error_code>>(
                 [self = this->shared_from_this(),
                  callbacks = std::make_shared<callbacks_t>(std::move(callbacks_wrapper))]() mutable {
-                    auto iterator = async::detail::make_async_dir_iterator(
-                        self->executor,
-                        self->procDir,
-                        [self, callbacks](lib::FsEntry entry) {
-                            return async_proc_poller_t::template process_pid_directory<want_threads, want_stats>(
-                                self,
-                                std::move(entry),
-                                callbacks);
-                        });
-
+                    // the directories are read (possibly in parallel) first, then passed to the callbacks in order
                     return start_on(self->executor) //
-                         | iterator->async_run();
+                         | then([self]() {
+                               return std::make_shared<std::vector<lnx::ProcessScanResult>>(
+                                   lnx::scanProcesses(self->procDir, want_threads, want_stats));
+                           })
+                         | then([self, callbacks](std::shared_ptr<std::vector<lnx::ProcessScanResult>> processes) {
+                               return async_for_each(self, processes, [self, callbacks](auto & process) {
+                                   return process_pid_directory<want_threads || want_stats, want_stats>(self,
+                                                                                                         process,
+                                                                                                         callbacks);
+                               });
+                           });
                 },
                 token);
         }
@@ -218,140 +154,116 @@ namespace async {
             on_thread_details_type on_thread_details;
         };
 
+        /**
+         * Call some asynchronous operation for each item in a vector, one at a time, stopping at the first error
+         */
+        template<typename T, typename Op>
+        static error_code_continuation_t async_for_each(std::shared_ptr<async_proc_poller_t> self,
+                                                        std::shared_ptr<std::vector<T>> items,
+                                                        Op op)
+        {
+            using namespace async::continuations;
+
+            return start_with(std::size_t {0}, boost::system::error_code {}) //
+                 | loop(
+                       [items](std::size_t index, boost::system::error_code const & ec) {
+                           return start_with((index < items->size()) && !ec, index, ec);
+                       },
+                       [self, items, op](std::size_t index, boost::system::error_code const & /*ec*/) {
+                           return start_on(self->executor) //
+                                | op((*items)[index])      //
+                                | post_on(self->executor)  //
+                                | then([index](boost::system::error_code const & ec) {
+                                      return start_with(index + 1, ec);
+                                  });
+                       }) //
+                 | then([](std::size_t /*index*/, boost::system::error_code const & ec) { return ec; });
+        }
+
         template<bool WantThreads, bool WantStats>
         static error_code_continuation_t process_pid_directory(std::shared_ptr<async_proc_poller_t> self,
-                                                               lib::FsEntry entry,
+                                                               lnx::ProcessScanResult & process,
                                                                std::shared_ptr<callbacks_t> callbacks)
         {
             using namespace async::continuations;
 
-            // ignore non-pid directories
-            if (!async::detail::is_pid_directory(entry)) {
-                return start_with(boost::system::error_code {});
-            }
-
-            auto name = entry.name();
-            auto exe_path = async::detail::get_process_exe_path(entry);
-            // read the pid
-            auto pid = std::strtol(name.c_str(), nullptr, 0);
+            auto const pid = process.pid;
+            auto pid_directory = lib::FsEntry::create(self->procDir, std::to_string(pid));
 
             // process threads?
-            if constexpr (WantThreads || WantStats) {
+            if constexpr (WantThreads) {
+                auto threads = std::make_shared<std::vector<lnx::ThreadScanResult>>(std::move(process.threads));
+
                 // call the receiver object
-                return callbacks->on_process_directory(pid, entry)
+                return callbacks->on_process_directory(pid, pid_directory)
                      // then process the threads
-                     | then([entry = std::move(entry),
-                             name = std::move(name),
-                             exe_path = std::move(exe_path),
+                     | then([self,
+                             callbacks,
                              pid,
-                             self = std::move(self),
-                             callbacks](boost::system::error_code const & ec) mutable -> error_code_continuation_t {
+                             pid_directory,
+                             threads = std::move(threads),
+                             exe = std::move(process.exe)](
+                                boost::system::error_code const & ec) mutable -> error_code_continuation_t {
                            // forward error?
                            if (ec) {
                                return start_with(ec);
                            }
 
-                           // the /proc/[PID]/task directory
-                           const auto task_directory = lib::FsEntry::create(entry, "task");
-
-                           // the /proc/[PID]/task/[PID]/ directory
-                           const auto task_pid_directory = lib::FsEntry::create(task_directory, name);
-                           const auto task_pid_directory_stats = task_pid_directory.read_stats();
+                           auto task_directory = lib::FsEntry::create(pid_directory, "task");
 
-                           // if for some reason taskPidDirectory does not exist, then use stat and statm in the procPid directory instead
-                           if ((!task_pid_directory_stats.exists())
-                               || (task_pid_directory_stats.type() != lib::FsEntry::Type::DIR)) {
-                               return process_tid_directory<WantStats>(pid,
-                                                                       std::move(entry),
-                                                                       std::move(exe_path),
-                                                                       std::move(callbacks));
-                           }
-
-                           // scan all the TIDs in the task directory
-                           auto task_iterator = async::detail::make_async_dir_iterator(
-                               self->executor,
-                               task_directory,
-                               [exe_path, callbacks, pid](lib::FsEntry entry) {
-                                   return async_proc_poller_t::template process_tid_directory<WantStats>(
+                           return async_for_each(
+                               self,
+                               std::move(threads),
+                               [pid, pid_directory, task_directory, exe = std::move(exe), callbacks](
+                                   lnx::ThreadScanResult & thread) {
+                                   return process_tid_directory<WantStats>(
                                        pid,
-                                       std::move(entry),
-                                       exe_path,
+                                       (thread.inTaskDirectory
+                                            ? lib::FsEntry::create(task_directory, std::to_string(thread.tid))
+                                            : pid_directory),
+                                       thread,
+                                       exe,
                                        callbacks);
                                });
-
-                           return task_iterator->async_run();
                        });
             }
             else {
                 // just call the receiver object
-                return callbacks->on_process_directory(pid, entry);
+                return callbacks->on_process_directory(pid, pid_directory);
             }
         }
 
         template<bool WantStats>
         static error_code_continuation_t process_tid_directory(int pid,
                                                                lib::FsEntry entry,
-                                                               std::optional<std::string> exe,
+                                                               lnx::ThreadScanResult & thread,
+                                                               std::optional<std::string> const & exe,
                                                                std::shared_ptr<callbacks_t> callbacks)
         {
             using namespace async::continuations;
 
-            const long tid = std::strtol(entry.name().c_str(), nullptr, 0);
-
             // process stats?
             if constexpr (WantStats) {
                 // call the receiver object
-                return callbacks->on_thread_directory(pid, tid, entry)
+                return callbacks->on_thread_directory(pid, thread.tid, entry)
                      // then call the stats handler
-                     | then([entry, callbacks, pid, tid, exe = std::move(exe)](
-                                boost::system::error_code const & ec) mutable -> error_code_continuation_t {
+                     | then([callbacks,
+                             pid,
+                             tid = thread.tid,
+                             stat_record = std::move(thread.statRecord),
+                             statm_record = std::move(thread.statmRecord),
+                             exe](boost::system::error_code const & ec) mutable -> error_code_continuation_t {
                            // forward error?
-                           if (ec) {
+                           if (ec || !stat_record) {
                                return start_with(ec);
                            }
 
-                           std::optional<lnx::ProcPidStatmFileRecord> statm_file_record {lnx::ProcPidStatmFileRecord()};
-
-                           // open /proc/[PID]/statm
-                           {
-                               const lib::FsEntry statm_file = lib::FsEntry::create(entry, "statm");
-                               const lib::FsEntry::Stats statm_file_stats = statm_file.read_stats();
-
-                               if (statm_file_stats.exists() && statm_file_stats.type() == lib::FsEntry::Type::FILE) {
-                                   const std::string statm_file_contents = lib::readFileContents(statm_file);
-
-                                   if (!lnx::ProcPidStatmFileRecord::parseStatmFile(*statm_file_record,
-                                                                                    statm_file_contents.c_str())) {
-                                       statm_file_record.reset();
-                                   }
-                               }
-                           }
-
-                           // open /proc/[PID]/stat
-                           {
-                               const lib::FsEntry stat_file = lib::FsEntry::create(entry, "stat");
-                               const lib::FsEntry::Stats stat_file_stats = stat_file.read_stats();
-
-                               if (stat_file_stats.exists() && stat_file_stats.type() == lib::FsEntry::Type::FILE) {
-                                   const std::string stat_file_contents = lib::readFileContents(stat_file);
-                                   lnx::ProcPidStatFileRecord stat_file_record;
-                                   if (lnx::ProcPidStatFileRecord::parseStatFile(stat_file_record,
-                                                                                 stat_file_contents.c_str())) {
-                                       return callbacks->on_thread_details(pid,
-                                                                           tid,
-                                                                           stat_file_record,
-                                                                           statm_file_record,
-                                                                           exe);
-                                   }
-                               }
-                           }
-
-                           return start_with(boost::system::error_code {});
+                           return callbacks->on_thread_details(pid, tid, *stat_record, statm_record, exe);
                        });
             }
             else {
                 // call the receiver object
-                return callbacks->on_thread_directory(pid, tid, entry);
+                return callbacks->on_thread_directory(pid, thread.tid, entry);
             }
         }
 
@@ -1,78 +1,217 @@
-/* Copyright (C) 2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2022-2023 by Arm Limited. All rights reserved. */
 
 #pragma once
 
+#include "Logging.h"
 #include "async/continuations/async_initiate.h"
 #include "async/continuations/continuation.h"
 #include "async/continuations/operations.h"
+#include "async/continuations/stored_continuation.h"
 #include "async/continuations/use_continuation.h"
 #include "async/proc/async_proc_poller.h"
+#include "lib/FsEntry.h"
+#include "lib/LineChunkReader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <boost/asio/error.hpp>
 #include <boost/system/error_code.hpp>
 
 namespace async {
+    namespace detail {
+        /** The most processes whose maps files are read at the same time */
+        constexpr std::size_t max_parallel_maps_readers = 8;
+
+        /** The size of the chunks that the maps files are read in */
+        constexpr std::size_t maps_read_chunk_size = 64 * 1024;
+
+        /**
+         * The most of one process's maps that is sent. This is room for tens of thousands of mappings, and bounds the
+         * memory held by the parallel readers.
+         */
+        constexpr std::size_t max_maps_frame_size = 4 * 1024 * 1024;
+
+        /**
+         * Read the maps file for some process. The contents are limited to max_maps_frame_size, and are truncated at a
+         * line boundary.
+         *
+         * @return The contents, or nothing if the file is missing or inaccessible
+         */
+        inline std::optional<std::string> read_proc_maps_file(int pid)
+        {
+            auto const path = "/proc/" + std::to_string(pid) + "/maps";
+
+            lib::LineChunkReader reader {path.c_str(), maps_read_chunk_size};
+            if (!reader.isOpen()) {
+                return {};
+            }
+
+            std::string contents {};
+            for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+                if ((contents.size() + chunk.size()) > max_maps_frame_size) {
+                    LOG_DEBUG("Truncated the maps for process %d", pid);
+                    break;
+                }
+                contents.append(chunk);
+            }
+
+            return contents;
+        }
+
+        /** The state that is shared by the readers that run in parallel for one snapshot */
+        template<typename Sender, typename StoredContinuation>
+        class proc_maps_reader_state_t {
+        public:
+            proc_maps_reader_state_t(std::shared_ptr<Sender> sender,
+                                     std::vector<int> pids,
+                                     std::size_t n_readers,
+                                     StoredContinuation && sc)
+                : sender(std::move(sender)),
+                  pids(std::move(pids)),
+                  remaining_readers(n_readers),
+                  sc(std::move(sc))
+            {
+            }
+
+            [[nodiscard]] bool has_next() const { return next_index < pids.size(); }
+
+            /** Read the maps for the next process and send them, then resume on the read executor */
+            template<typename ReadExecutor>
+            [[nodiscard]] async::continuations::polymorphic_continuation_t<> async_read_next(
+                ReadExecutor const & read_executor)
+            {
+                using namespace async::continuations;
+
+                auto const index = next_index++;
+                if (index >= pids.size()) {
+                    return {};
+                }
+
+                auto const pid = pids[index];
+
+                // missing or inaccessible file is not an error
+                auto const maps = read_proc_maps_file(pid);
+                if (!maps) {
+                    return {};
+                }
+
+                // one frame per process, as the host is not known to handle one process's maps split across frames
+                return sender->async_send_maps_frame(pid, pid, *maps, use_continuation) //
+                     | map_error()                                                       //
+                     | post_on(read_executor);
+            }
+
+            /** Called as each reader completes; the last one to complete resumes the stored continuation */
+            template<typename Executor>
+            void on_reader_complete(Executor const & executor, bool failed, boost::system::error_code ec)
+            {
+                std::lock_guard lock {mutex};
+
+                if (failed && !first_error) {
+                    first_error = (ec ? ec : boost::asio::error::operation_aborted);
+                }
+
+                if (--remaining_readers == 0) {
+                    resume_continuation(executor, std::move(sc), first_error);
+                }
+            }
+
+        private:
+            std::shared_ptr<Sender> sender;
+            std::vector<int> pids;
+            std::atomic_size_t next_index {0};
+            std::mutex mutex {};
+            std::size_t remaining_readers;
+            boost::system::error_code first_error {};
+            StoredContinuation sc;
+        };
+    }
 
     /**
      * Reads the /proc maps and sends the results via @a sender asynchronously.
      *
+     * The maps files are read on @a read_executor by several readers in parallel. Each process's maps are sent in a
+     * single frame, as the legacy path does, read in line aligned chunks and truncated at a line boundary once they
+     * reach detail::max_maps_frame_size, so that each reader holds at most that much in memory.
+     *
      * @tparam Executor Executor type
+     * @tparam ReadExecutor Executor type for the reads
      * @tparam Sender Sender type
      * @tparam CompletionToken CompletionToken type
      * @param executor Executor instance, typically the one used inside @a sender
+     * @param read_executor Executor instance that the files are read on, which should allow parallel execution
      * @param sender Sends the data
      * @param filter filter callable that decides whether or not to send a specific process's details
      * @param token Called upon completion with an error_code
      * @return Nothing or a continuation, depending on @a CompletionToken
      */
-    template<typename Executor, typename Sender, typename Filter, typename CompletionToken>
+    template<typename Executor, typename ReadExecutor, typename Sender, typename Filter, typename CompletionToken>
     auto async_read_proc_maps(Executor && executor,
+                              ReadExecutor const & read_executor,
                               std::shared_ptr<Sender> sender,
                               Filter && filter,
                               CompletionToken && token)
     {
         using namespace async::continuations;
 
-        return async_initiate_cont<continuation_of_t<boost::system::error_code>>(
-            [poller = make_async_proc_poller(std::forward<Executor>(executor)),
+        return async_initiate_explicit<void(boost::system::error_code)>(
+            [executor = std::forward<Executor>(executor),
+             read_executor,
              sender = std::move(sender),
-             filter = std::forward<Filter>(filter)]() mutable {
-                return poller->async_poll(use_continuation,
-                                          [sender, filter = std::move(filter)](int pid, const lib::FsEntry & entry)
-                                              -> polymorphic_continuation_t<boost::system::error_code> {
-                                              // check filter
-                                              if (!filter(pid)) {
-                                                  return start_with(boost::system::error_code {});
-                                              }
-
-                                              // missing or inaccessible file is not an error
-                                              const lib::FsEntry mapsFile = lib::FsEntry::create(entry, "maps");
-
-                                              if (!mapsFile.exists()) {
-                                                  return start_with(boost::system::error_code {});
-                                              }
-
-                                              if (!mapsFile.canAccess(true, false, false)) {
-                                                  return start_with(boost::system::error_code {});
-                                              }
-
-                                              // send the contents
-                                              return sender->async_send_maps_frame(pid,
-                                                                                   pid,
-                                                                                   lib::readFileContents(mapsFile),
-                                                                                   use_continuation);
-                                          });
+             filter = std::forward<Filter>(filter)](auto && sc) mutable {
+                using state_type = async::detail::proc_maps_reader_state_t<Sender, std::decay_t<decltype(sc)>>;
+
+                // find the processes first, which is cheap compared to reading their maps
+                std::vector<int> pids {};
+                lib::FsEntryDirectoryIterator iterator = lib::FsEntry::create("/proc").children();
+                for (auto entry = iterator.next(); entry; entry = iterator.next()) {
+                    if (async::detail::is_pid_directory(*entry)) {
+                        auto const pid = std::stoi(entry->name());
+                        if (filter(pid)) {
+                            pids.push_back(pid);
+                        }
+                    }
+                }
+
+                auto const n_readers = std::min(async::detail::max_parallel_maps_readers, pids.size());
+                if (n_readers == 0) {
+                    resume_continuation(executor, sc.move(), boost::system::error_code {});
+                    return;
+                }
+
+                auto state = std::make_shared<state_type>(std::move(sender), std::move(pids), n_readers, sc.move());
+
+                for (std::size_t n = 0; n < n_readers; ++n) {
+                    spawn("proc maps reader",
+                          start_on(read_executor) //
+                              | repeatedly([state]() { return state->has_next(); },
+                                           [state, read_executor]() { return state->async_read_next(read_executor); }),
+                          [state, executor](bool failed, boost::system::error_code ec) {
+                              state->on_reader_complete(executor, failed, ec);
+                          });
+                }
             },
-            token);
+            std::forward<CompletionToken>(token));
     }
 
-    template<typename Executor, typename Sender, typename CompletionToken>
-    auto async_read_proc_maps(Executor & executor, std::shared_ptr<Sender> sender, CompletionToken && token)
+    template<typename Executor, typename ReadExecutor, typename Sender, typename CompletionToken>
+    auto async_read_proc_maps(Executor & executor,
+                              ReadExecutor const & read_executor,
+                              std::shared_ptr<Sender> sender,
+                              CompletionToken && token)
     {
         return async_read_proc_maps(
             executor,
+            read_executor,
             std::move(sender),
             [](int) { return true; },
             std::forward<CompletionToken>(token));
@@ -4,6 +4,7 @@
 
 #include "AnnotateListener.h"
 #include "Child.h"
+#include "ConfigurationXML.h"
 #include "Drivers.h"
 #include "ExitStatus.h"
 #include "GatorException.h"
@@ -13,20 +14,26 @@
 #include "Sender.h"
 #include "SessionData.h"
 #include "StreamlineSetupLoop.h"
+#include "XmlResponseCache.h"
 #include "agents/spawn_agent.h"
 #include "android/AndroidActivityManager.h"
 #include "capture/internal/UdpListener.h"
+#include "lib/AutoClosingFd.h"
 #include "lib/FileDescriptor.h"
 #include "lib/Process.h"
 #include "xml/CurrentConfigXML.h"
 #include "xml/PmuXMLParser.h"
 
+#include <climits>
+#include <cstdint>
 #include <memory>
 #include <sstream>
 #include <thread>
+#include <utility>
 
 #include <sys/prctl.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/wait.h>
@@ -34,6 +41,11 @@
 
 namespace {
     constexpr int high_priority = -19;
+    /**
+     * How often to check, while idle, that the configuration read by the standby gator-child is still current, and to
+     * let the drivers check on what they keep between captures
+     */
+    constexpr int idle_check_interval_ms = 1000;
 
     enum class State {
         IDLE,
@@ -60,6 +72,90 @@ namespace {
     capture::internal::UdpListener udpListener;
     std::unique_ptr<AnnotateListener> annotateListenerPtr;
 
+    /**
+     * A gator-child that was forked before the connection arrived, and that has already done the setup that does not
+     * depend on the connection. It waits for gator-main to pass it the connection over `socket`.
+     */
+    struct StandbyChild {
+        int pid {-1};
+        lib::AutoClosingFd socket {};
+        /**
+         * Identifies the configuration files, and the state of gator-main that it inherited, as they were when the
+         * standby gator-child was forked
+         */
+        std::uint64_t configurationKey {0};
+    };
+
+    bool warmStandbyEnabled = false;
+    StandbyChild standbyChild;
+
+    /**
+     * Identifies the configuration files that gator-child reads during its setup, and the state that it inherits from
+     * the drivers (e.g. the reserved perf ring buffers, which a standby gator-child would otherwise keep allocated
+     * after gator-main releases or replaces them)
+     */
+    std::uint64_t getConfigurationKey(Drivers & drivers)
+    {
+        char path[PATH_MAX];
+        configuration_xml::getPath(path, sizeof(path));
+
+        XmlResponseCache::Key key;
+        key.addFile(path).addFile(gSessionData.mEventsXMLPath).addFile(gSessionData.mEventsXMLAppend);
+        for (const auto & driver : drivers.getAll()) {
+            key.add(driver->getChildInheritedStateGeneration());
+        }
+        return key.get();
+    }
+
+    /** @return True if the configuration or the inherited state has changed since the standby gator-child was forked */
+    bool isStandbyChildStale(Drivers & drivers)
+    {
+        return (standbyChild.pid > 0) && (standbyChild.configurationKey != getConfigurationKey(drivers));
+    }
+
+    /** Reap the standby gator-child if it has exited, which it should only do if something went wrong */
+    void reapStandbyChild(Drivers & drivers)
+    {
+        if (standbyChild.pid <= 0) {
+            return;
+        }
+
+        int status;
+        const int pid = waitpid(standbyChild.pid, &status, WNOHANG);
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        if (pid < 1 || !(WIFEXITED(status) || WIFSIGNALED(status))) {
+            return;
+        }
+
+        for (const auto & driver : drivers.getAll()) {
+            driver->postChildExitInParent();
+        }
+
+        // don't keep forking children that fail during setup
+        LOG_WARNING("The standby gator-child exited unexpectedly, captures will start without a standby process");
+        warmStandbyEnabled = false;
+        standbyChild = {};
+    }
+
+    /** Stop the standby gator-child, if there is one */
+    void discardStandbyChild(Drivers & drivers)
+    {
+        if (standbyChild.pid <= 0) {
+            return;
+        }
+
+        const int pid = std::exchange(standbyChild.pid, -1);
+        standbyChild.socket.close();
+
+        kill(pid, SIGKILL);
+        while ((waitpid(pid, nullptr, 0) < 0) && (errno == EINTR)) {
+        }
+
+        for (const auto & driver : drivers.getAll()) {
+            driver->postChildExitInParent();
+        }
+    }
+
     StateAndPid handleSigchld(StateAndPid currentStateAndChildPid, Drivers & drivers)
     {
         int status;
@@ -109,9 +205,22 @@ namespace {
     {
 
         if (signum == SIGCHLD) {
+            reapStandbyChild(drivers);
+            if (currentStateAndChildPid.state == State::IDLE) {
+                // the only other child is the standby gator-child
+                return currentStateAndChildPid;
+            }
             return handleSigchld(currentStateAndChildPid, drivers);
         }
 
+        if (signum == SIGUSR2) {
+            // triggers a flight recorder, which gator-child ignores if it does not have one
+            if (currentStateAndChildPid.state == State::CAPTURING) {
+                kill(currentStateAndChildPid.pid, SIGUSR2);
+            }
+            return currentStateAndChildPid;
+        }
+
         LOG_DEBUG("Received signal %d, gator daemon exiting", signum);
 
         switch (currentStateAndChildPid.state) {
@@ -219,7 +328,7 @@ namespace {
         client.closeSocket();
     }
 
-    std::array<std::unique_ptr<agents::i_agent_spawner_t>, 2> create_spawners()
+    std::array<std::unique_ptr<agents::i_agent_spawner_t>, 2> create_spawners(Drivers & drivers)
     {
         auto high_privilege_spawner = std::make_unique<agents::simple_agent_spawner_t>();
         std::unique_ptr<agents::i_agent_spawner_t> low_privilege_spawner {};
@@ -240,9 +349,165 @@ namespace {
             low_privilege_spawner = std::make_unique<agents::simple_agent_spawner_t>();
         }
 
+        // the primary source's agent (which is low privilege) may need some of gator-main's resources
+        const auto & primarySourceProvider = drivers.getPrimarySourceProvider();
+        auto inheritedFds = primarySourceProvider.getAgentInheritedFds();
+        if (!inheritedFds.empty()) {
+            low_privilege_spawner =
+                std::make_unique<agents::fd_inheriting_agent_spawner_t>(std::move(low_privilege_spawner),
+                                                                        primarySourceProvider.getAgentProcessId(),
+                                                                        std::move(inheritedFds));
+        }
+
         return {std::move(high_privilege_spawner), std::move(low_privilege_spawner)};
     }
 
+    /** Release the resources of gator-main that gator-child must not hold, in the child just after it is forked */
+    void setupForkedChild(Drivers & drivers, OlyServerSocket * sock, OlyServerSocket * otherSock)
+    {
+        gator::process::set_parent_death_signal(SIGKILL);
+
+        for (const auto & driver : drivers.getAll()) {
+            driver->postChildForkInChild();
+        }
+        if (sock != nullptr) {
+            sock->closeServerSocket();
+        }
+        if (otherSock != nullptr) {
+            otherSock->closeServerSocket();
+        }
+
+        standbyChild = {};
+        udpListener.close();
+        monitor.close();
+        annotateListenerPtr.reset();
+    }
+
+    /** Run the capture for a connection in gator-child */
+    [[noreturn]] void runLiveChild(std::array<std::unique_ptr<agents::i_agent_spawner_t>, 2> spawners,
+                                   Drivers & drivers,
+                                   OlySocket & client,
+                                   capture::capture_process_event_listener_t & event_listener,
+                                   logging::last_log_error_supplier_t last_log_error_supplier,
+                                   logging::log_setup_supplier_t log_setup_supplier)
+    {
+        auto & [high_privilege_spawner, low_privilege_spawner] = spawners;
+
+        auto child = Child::createLive(*high_privilege_spawner,
+                                       *low_privilege_spawner,
+                                       drivers,
+                                       client,
+                                       event_listener,
+                                       std::move(last_log_error_supplier),
+                                       std::move(log_setup_supplier));
+        child->run();
+        child.reset();
+        low_privilege_spawner.reset(); // the dtor may perform some necessary cleanup
+        high_privilege_spawner.reset();
+
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        exit(0);
+    }
+
+    /**
+     * Fork the standby gator-child. Before it waits for the connection, it does everything that does not depend on
+     * the connection: it creates the agent spawners (which for an android package involves checking that the package
+     * exists), reads the configuration and sets up the counters, builds the XML responses that Streamline requests
+     * first, and starts the agent processes that the capture will need. The capture then starts without that delay.
+     */
+    void forkStandbyChild(Drivers & drivers,
+                          OlyServerSocket * socketUds,
+                          OlyServerSocket * socketTcp,
+                          capture::capture_process_event_listener_t & event_listener,
+                          const logging::last_log_error_supplier_t & last_log_error_supplier,
+                          const logging::log_setup_supplier_t & log_setup_supplier)
+    {
+        int fds[2];
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+            LOG_DEBUG("socketpair failed (%d) %s", errno, strerror(errno));
+            warmStandbyEnabled = false;
+            return;
+        }
+
+        lib::AutoClosingFd parentSocket {fds[0]};
+        lib::AutoClosingFd childSocket {fds[1]};
+
+        for (const auto & driver : drivers.getAll()) {
+            driver->preChildFork();
+        }
+
+        // after preChildFork, which may reserve the state that the child inherits
+        const auto configurationKey = getConfigurationKey(drivers);
+
+        const int pid = fork();
+        if (pid < 0) {
+            LOG_DEBUG("Fork of standby process failed (%d) %s", errno, strerror(errno));
+            warmStandbyEnabled = false;
+        }
+        else if (pid == 0) {
+            // Standby child
+            parentSocket.close();
+            setupForkedChild(drivers, socketUds, socketTcp);
+            prctl(PR_SET_NAME, reinterpret_cast<unsigned long>(&"gatord-standby"), 0, 0, 0);
+
+            auto [high_privilege_spawner, low_privilege_spawner] = create_spawners(drivers);
+            {
+                agents::prespawning_agent_spawner_t high_privilege_prespawner {*high_privilege_spawner};
+                agents::prespawning_agent_spawner_t low_privilege_prespawner {*low_privilege_spawner};
+
+                auto child = Child::createStandby(high_privilege_prespawner,
+                                                  low_privilege_prespawner,
+                                                  drivers,
+                                                  event_listener,
+                                                  last_log_error_supplier,
+                                                  log_setup_supplier);
+                child->prepare();
+
+                // start the agents once the counters are set up, as that decides whether perfetto is needed
+                low_privilege_prespawner.prespawn(agents::agent_id_ext_source.data());
+                const auto primaryAgentId = drivers.getPrimarySourceProvider().getAgentProcessId();
+                if (!primaryAgentId.empty()) {
+                    low_privilege_prespawner.prespawn(primaryAgentId.data());
+                }
+#if defined(ANDROID) || defined(__ANDROID__)
+                if (drivers.getPerfettoDriver().perfettoEnabled()) {
+                    high_privilege_prespawner.prespawn(agents::agent_id_perfetto.data());
+                }
+#endif
+
+                LOG_DEBUG("Standby gator-child is waiting for a connection");
+                const int fd = lib::receiveFd(childSocket.get());
+                if (fd < 0) {
+                    // gator-main no longer wants this process
+                    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+                    exit(0);
+                }
+                childSocket.close();
+
+                OlySocket client {fd};
+                child->attachConnection(client);
+                child->run();
+                // leaving the scope stops any agents that were started but not used
+            }
+            low_privilege_spawner.reset(); // the dtor may perform some necessary cleanup
+            high_privilege_spawner.reset();
+
+            // NOLINTNEXTLINE(concurrency-mt-unsafe)
+            exit(0);
+        }
+        else {
+            LOG_DEBUG("Forked standby gator-child %d", pid);
+            standbyChild.pid = pid;
+            standbyChild.socket = std::move(parentSocket);
+            standbyChild.configurationKey = configurationKey;
+        }
+
+        for (const auto & driver : drivers.getAll()) {
+            driver->postChildForkInParent();
+        }
+    }
+
     StateAndPid handleClient(StateAndPid currentStateAndChildPid,
                              Drivers & drivers,
                              OlyServerSocket & sock,
@@ -260,6 +525,26 @@ namespace {
         }
 
         OlySocket client(sock.acceptConnection());
+
+        // A standby gator-child that read a configuration that has since changed can't be used
+        if (isStandbyChildStale(drivers)) {
+            LOG_DEBUG("The configuration or inherited state changed since the standby gator-child was forked");
+            discardStandbyChild(drivers);
+        }
+
+        // Hand the connection to the standby gator-child, if there is one
+        if (standbyChild.pid > 0) {
+            if (lib::sendFd(standbyChild.socket.get(), client.getFd())) {
+                const int pid = std::exchange(standbyChild.pid, -1);
+                standbyChild.socket.close();
+                LOG_DEBUG("Passed the connection to standby gator-child %d", pid);
+                client.closeSocket();
+                return {.state = State::CAPTURING, .pid = pid};
+            }
+            LOG_DEBUG("Unable to pass the connection to the standby gator-child");
+            discardStandbyChild(drivers);
+        }
+
         for (const auto & driver : drivers.getAll()) {
             driver->preChildFork();
         }
@@ -273,38 +558,16 @@ namespace {
         }
 
         if (pid == 0) {
-            gator::process::set_parent_death_signal(SIGKILL);
-
             // Child
-            for (const auto & driver : drivers.getAll()) {
-                driver->postChildForkInChild();
-            }
-            sock.closeServerSocket();
-            if (otherSock != nullptr) {
-                otherSock->closeServerSocket();
-            }
-
-            udpListener.close();
-            monitor.close();
-            annotateListenerPtr.reset();
+            setupForkedChild(drivers, &sock, otherSock);
 
             // create the agent process spawners
-            auto [high_privilege_spawner, low_privilege_spawner] = create_spawners();
-
-            auto child = Child::createLive(*high_privilege_spawner,
-                                           *low_privilege_spawner,
-                                           drivers,
-                                           client,
-                                           event_listener,
-                                           last_log_error_supplier,
-                                           std::move(log_setup_supplier));
-            child->run();
-            child.reset();
-            low_privilege_spawner.reset(); // the dtor may perform some necessary cleanup
-            high_privilege_spawner.reset();
-
-            // NOLINTNEXTLINE(concurrency-mt-unsafe)
-            exit(0);
+            runLiveChild(create_spawners(drivers),
+                         drivers,
+                         client,
+                         event_listener,
+                         std::move(last_log_error_supplier),
+                         std::move(log_setup_supplier));
         }
         else {
             // Parent
@@ -341,7 +604,7 @@ namespace {
             annotateListenerPtr.reset();
 
             // create the agent process spawners
-            auto [high_privilege_spawner, low_privilege_spawner] = create_spawners();
+            auto [high_privilege_spawner, low_privilege_spawner] = create_spawners(drivers);
 
             auto child = Child::createLocal(*high_privilege_spawner,
                                             *low_privilege_spawner,
@@ -391,6 +654,9 @@ int capture::beginCaptureProcess(const ParserResult & result,
     // only enable when running in system-wide mode
     bool enable_annotation_listener = result.mSystemWide;
 
+    // the standby process is only useful when waiting for connections from Streamline
+    warmStandbyEnabled = result.mWarmStandby && !gSessionData.mLocalCapture;
+
     StateAndPid stateAndChildPid = {.state = State::IDLE, .pid = -1};
 
     try {
@@ -453,12 +719,36 @@ int capture::beginCaptureProcess(const ParserResult & result,
 
         // Forever loop, can be exited via a signal or exception
         while (stateAndChildPid.state != State::EXIT) {
+            // (re)arm the standby gator-child whenever there is no capture running
+            if (warmStandbyEnabled && (stateAndChildPid.state == State::IDLE) && (standbyChild.pid <= 0)) {
+                forkStandbyChild(drivers,
+                                 socketUds.get(),
+                                 socketTcp.get(),
+                                 event_listener,
+                                 last_log_error_supplier,
+                                 log_setup_supplier);
+            }
+
             struct epoll_event events[3];
-            int ready = monitor.wait(events, ARRAY_LENGTH(events), -1);
+            // wake up periodically while there is a standby gator-child or a driver that wants to be checked on
+            bool checkPeriodically = (standbyChild.pid > 0);
+            if (stateAndChildPid.state == State::IDLE) {
+                for (const auto & driver : drivers.getAll()) {
+                    checkPeriodically = driver->idleInParent() || checkPeriodically;
+                }
+            }
+            const int timeout = (checkPeriodically ? idle_check_interval_ms : -1);
+            int ready = monitor.wait(events, ARRAY_LENGTH(events), timeout);
             if (ready < 0) {
                 throw GatorException("Monitor::wait failed");
             }
 
+            if ((ready == 0) && isStandbyChildStale(drivers)) {
+                // it will be forked again on the next iteration, so that it does not keep released state allocated
+                LOG_DEBUG("The configuration or inherited state changed, replacing the standby gator-child");
+                discardStandbyChild(drivers);
+            }
+
             for (int i = 0; i < ready; ++i) {
                 if ((socketUds != nullptr) && (events[i].data.fd == socketUds->getFd())) {
                     stateAndChildPid = handleClient(stateAndChildPid,
@@ -516,12 +806,16 @@ int capture::beginCaptureProcess(const ParserResult & result,
             }
         }
 
+        discardStandbyChild(drivers);
+
         // pid contains the exit code once the child process has ended
         return stateAndChildPid.pid;
     }
     catch (const GatorException & ex) {
         LOG_DEBUG("%s", ex.what());
 
+        discardStandbyChild(drivers);
+
         // hard-kill the child process if its running
         switch (stateAndChildPid.state) {
             case State::CAPTURING:
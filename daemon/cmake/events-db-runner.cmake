@@ -0,0 +1,154 @@
+# Copyright (C) 2023 by Arm Limited. All rights reserved.
+
+# The attributes to extract, in the same order as the fields of events_xml::StaticEvent
+SET(EVENT_ATTRIBUTES counter event tracepoint enable regex arg path flag expression)
+
+# load the file, removing comments and replacing the characters that are special in cmake lists
+FILE(READ "${INPUT_FILE}" INPUT_FILE_CONTENTS)
+STRING(REGEX REPLACE "<!--([^-]|-[^-])*-->" "" INPUT_FILE_CONTENTS "${INPUT_FILE_CONTENTS}")
+STRING(REPLACE ";" "@SEMICOLON@" INPUT_FILE_CONTENTS "${INPUT_FILE_CONTENTS}")
+STRING(REPLACE "[" "@LBRACKET@" INPUT_FILE_CONTENTS "${INPUT_FILE_CONTENTS}")
+STRING(REPLACE "]" "@RBRACKET@" INPUT_FILE_CONTENTS "${INPUT_FILE_CONTENTS}")
+
+# the category and event elements in document order, allowing for '>' inside quoted attribute values
+SET(ELEMENT_ATTRIBUTES_REGEX "([^>\"']|\"[^\"]*\"|'[^']*')*")
+STRING(REGEX MATCHALL "<category[ \t\r\n]${ELEMENT_ATTRIBUTES_REGEX}>|</category>|<event[ \t\r\n]${ELEMENT_ATTRIBUTES_REGEX}>"
+       ELEMENTS "${INPUT_FILE_CONTENTS}")
+
+#
+#   Read the value of an attribute of an element, which may be in double or single quotes, and unescape it. Fails the
+#   build rather than produce a wrong value when the attribute cannot be read.
+#
+FUNCTION(READ_ELEMENT_ATTRIBUTE     ELEMENT
+                                    NAME
+                                    FOUND_VARIABLE
+                                    VALUE_VARIABLE)
+    IF(ELEMENT MATCHES "[ \t\r\n]${NAME}[ \t\r\n]*=[ \t\r\n]*(\"([^\"]*)\"|'([^']*)')")
+        # only one of the alternatives matched, and the other is empty
+        SET(VALUE "${CMAKE_MATCH_2}${CMAKE_MATCH_3}")
+    ELSEIF(ELEMENT MATCHES "[ \t\r\n]${NAME}[ \t\r\n]*=")
+        MESSAGE(FATAL_ERROR "Cannot read the ${NAME} attribute of ${ELEMENT} in ${INPUT_FILE}")
+    ELSE()
+        SET(${FOUND_VARIABLE} FALSE PARENT_SCOPE)
+        RETURN()
+    ENDIF()
+
+    # the semicolons of the entities were replaced along with the rest of the file
+    STRING(REPLACE "@SEMICOLON@" ";" VALUE "${VALUE}")
+    STRING(REPLACE "&lt;" "@LT@" VALUE "${VALUE}")
+    STRING(REPLACE "&gt;" "@GT@" VALUE "${VALUE}")
+    STRING(REPLACE "&quot;" "@QUOT@" VALUE "${VALUE}")
+    STRING(REPLACE "&apos;" "@APOS@" VALUE "${VALUE}")
+    STRING(REPLACE "&amp;" "@AMP@" VALUE "${VALUE}")
+    IF(VALUE MATCHES "&")
+        MESSAGE(FATAL_ERROR "Unsupported reference in the ${NAME} attribute of ${ELEMENT} in ${INPUT_FILE}")
+    ENDIF()
+    STRING(REPLACE "@LT@" "<" VALUE "${VALUE}")
+    STRING(REPLACE "@GT@" ">" VALUE "${VALUE}")
+    STRING(REPLACE "@QUOT@" "\"" VALUE "${VALUE}")
+    STRING(REPLACE "@APOS@" "'" VALUE "${VALUE}")
+    STRING(REPLACE "@AMP@" "&" VALUE "${VALUE}")
+
+    SET(${FOUND_VARIABLE} TRUE PARENT_SCOPE)
+    SET(${VALUE_VARIABLE} "${VALUE}" PARENT_SCOPE)
+ENDFUNCTION()
+
+#
+#   Format a value read by READ_ELEMENT_ATTRIBUTE as a C string literal, or nullptr if the attribute was absent
+#
+FUNCTION(TO_C_STRING_OR_NULLPTR     FOUND
+                                    VALUE
+                                    RESULT_VARIABLE)
+    IF(FOUND)
+        STRING(REPLACE "\\" "\\\\" VALUE "${VALUE}")
+        STRING(REPLACE "\"" "\\\"" VALUE "${VALUE}")
+        SET(${RESULT_VARIABLE} "\"${VALUE}\"" PARENT_SCOPE)
+    ELSE()
+        SET(${RESULT_VARIABLE} "nullptr" PARENT_SCOPE)
+    ENDIF()
+ENDFUNCTION()
+
+#
+#   Finish the index entry of the current counter set category, if any
+#
+MACRO(END_COUNTER_SET)
+    IF(NOT COUNTER_SET STREQUAL "")
+        MATH(EXPR COUNTER_SET_SIZE "${PMU_EVENT_COUNT} - ${COUNTER_SET_FIRST}")
+        STRING(APPEND COUNTER_SET_ROWS "    {\"${COUNTER_SET}\", ${COUNTER_SET_FIRST}, ${COUNTER_SET_SIZE}},\n")
+        SET(COUNTER_SET "")
+    ENDIF()
+ENDMACRO()
+
+SET(TABLE_ROWS "")
+SET(CLUSTER_ROWS "")
+SET(PMU_EVENT_ROWS "")
+SET(PMU_EVENT_COUNT 0)
+SET(COUNTER_SET_ROWS "")
+SET(COUNTER_SET "")
+FOREACH(ELEMENT IN LISTS ELEMENTS)
+    IF(ELEMENT STREQUAL "</category>")
+        END_COUNTER_SET()
+        CONTINUE()
+    ENDIF()
+
+    IF(ELEMENT MATCHES "^<category")
+        END_COUNTER_SET()
+        # the events of a counter set category are indexed by the counter set name that pmus.xml uses, which has no
+        # _cnt suffix
+        READ_ELEMENT_ATTRIBUTE("${ELEMENT}" counter_set FOUND COUNTER_SET_NAME)
+        IF(FOUND)
+            STRING(REGEX REPLACE "_cnt$" "" COUNTER_SET "${COUNTER_SET_NAME}")
+            SET(COUNTER_SET_FIRST ${PMU_EVENT_COUNT})
+        ENDIF()
+        CONTINUE()
+    ENDIF()
+
+    READ_ELEMENT_ATTRIBUTE("${ELEMENT}" counter COUNTER_FOUND COUNTER)
+
+    # every event of a counter set goes in the per PMU table, whether or not it has a counter attribute
+    IF(NOT COUNTER_SET STREQUAL "")
+        READ_ELEMENT_ATTRIBUTE("${ELEMENT}" event FOUND VALUE)
+        TO_C_STRING_OR_NULLPTR("${COUNTER_FOUND}" "${COUNTER}" COUNTER_STRING)
+        TO_C_STRING_OR_NULLPTR("${FOUND}" "${VALUE}" EVENT_STRING)
+        STRING(APPEND PMU_EVENT_ROWS "    {${COUNTER_STRING}, ${EVENT_STRING}},\n")
+        MATH(EXPR PMU_EVENT_COUNT "${PMU_EVENT_COUNT} + 1")
+    ENDIF()
+
+    # otherwise only events with a counter attribute are read by the drivers
+    IF(NOT COUNTER_FOUND)
+        CONTINUE()
+    ENDIF()
+
+    # ${cluster} counters are expanded for each cluster, so only the part after ${cluster} is stored
+    IF(COUNTER MATCHES "^\\$\\{cluster\\}")
+        STRING(REGEX REPLACE "^\\$\\{cluster\\}" "" COUNTER_SUFFIX "${COUNTER}")
+        READ_ELEMENT_ATTRIBUTE("${ELEMENT}" event FOUND VALUE)
+        TO_C_STRING_OR_NULLPTR(TRUE "${COUNTER_SUFFIX}" COUNTER_STRING)
+        TO_C_STRING_OR_NULLPTR("${FOUND}" "${VALUE}" EVENT_STRING)
+        STRING(APPEND CLUSTER_ROWS "    {${COUNTER_STRING}, ${EVENT_STRING}},\n")
+        CONTINUE()
+    ENDIF()
+
+    SET(TABLE_ROW "")
+    FOREACH(EVENT_ATTRIBUTE ${EVENT_ATTRIBUTES})
+        READ_ELEMENT_ATTRIBUTE("${ELEMENT}" ${EVENT_ATTRIBUTE} FOUND VALUE)
+        TO_C_STRING_OR_NULLPTR("${FOUND}" "${VALUE}" VALUE_STRING)
+        STRING(APPEND TABLE_ROW "${VALUE_STRING}, ")
+    ENDFOREACH()
+
+    STRING(REGEX REPLACE ", $" "" TABLE_ROW "${TABLE_ROW}")
+    STRING(APPEND TABLE_ROWS "    {${TABLE_ROW}},\n")
+ENDFOREACH()
+END_COUNTER_SET()
+
+SET(OUTPUT_CONTENTS "constexpr StaticEvent ${CONSTANT_NAME}_EVENTS[] = {\n${TABLE_ROWS}};\n\n")
+STRING(APPEND OUTPUT_CONTENTS "constexpr StaticPmuEvent ${CONSTANT_NAME}_CLUSTER_EVENTS[] = {\n${CLUSTER_ROWS}};\n\n")
+STRING(APPEND OUTPUT_CONTENTS "constexpr StaticPmuEvent ${CONSTANT_NAME}_PMU_EVENTS[] = {\n${PMU_EVENT_ROWS}};\n\n")
+STRING(APPEND OUTPUT_CONTENTS "constexpr StaticCounterSet ${CONSTANT_NAME}_COUNTER_SETS[] = {\n${COUNTER_SET_ROWS}};\n")
+
+STRING(REPLACE "@SEMICOLON@" ";" OUTPUT_CONTENTS "${OUTPUT_CONTENTS}")
+STRING(REPLACE "@LBRACKET@" "[" OUTPUT_CONTENTS "${OUTPUT_CONTENTS}")
+STRING(REPLACE "@RBRACKET@" "]" OUTPUT_CONTENTS "${OUTPUT_CONTENTS}")
+
+# write the output file
+FILE(WRITE "${OUTPUT_FILE}" "${OUTPUT_CONTENTS}")
@@ -0,0 +1,28 @@
+# Copyright (C) 2023 by Arm Limited. All rights reserved.
+
+# Save this outside the macro so that development build will retrigger the generation of the source file if this file changes
+SET(EVENTS_DB_CMAKE_FILE            "${CMAKE_CURRENT_LIST_FILE}")
+
+#
+#   Macro to create a source file containing tables of the events in the input events XML file, so that they can be
+#   read at startup without parsing the XML. CONSTANT_NAME is the prefix of the tables:
+#       <CONSTANT_NAME>_EVENTS            the events that have a counter attribute, as read by the drivers
+#       <CONSTANT_NAME>_CLUSTER_EVENTS    the ${cluster} events, which are expanded for each cluster
+#       <CONSTANT_NAME>_PMU_EVENTS        the events of every counter set category, grouped by counter set
+#       <CONSTANT_NAME>_COUNTER_SETS      the range of <CONSTANT_NAME>_PMU_EVENTS for each counter set, by PMU name
+#
+FUNCTION(EVENTS_XML_TO_C_TABLE      CONSTANT_NAME
+                                    INPUT_FILE
+                                    OUTPUT_FILE)
+    # Target to generate OUTPUT_FILE destination file
+    SET(EVENTS_DB_RUNNER_FILE  "${CMAKE_CURRENT_SOURCE_DIR}/cmake/events-db-runner.cmake")
+    ADD_CUSTOM_COMMAND(OUTPUT       "${OUTPUT_FILE}"
+                       COMMAND      "${CMAKE_COMMAND}"  -DCONSTANT_NAME="${CONSTANT_NAME}"
+                                                        -DINPUT_FILE="${INPUT_FILE}"
+                                                        -DOUTPUT_FILE="${OUTPUT_FILE}"
+                                                        -P "${EVENTS_DB_RUNNER_FILE}"
+                       DEPENDS      "${INPUT_FILE}"
+                                    "${EVENTS_DB_CMAKE_FILE}"
+                                    "${EVENTS_DB_RUNNER_FILE}"
+                       WORKING_DIRECTORY             "${CMAKE_CURRENT_SOURCE_DIR}")
+ENDFUNCTION()
@@ -0,0 +1,120 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+/**
+ * Measures the cost of one iteration of a polymorphic continuation loop, in the shape of the per-cpu perf data poll and
+ * the IPC send and receive loops: each iteration is started on an io_context, and runs a step that returns another
+ * polymorphic continuation. Reports the time and the number of global allocations per iteration.
+ *
+ * Build with CONFIG_RECYCLE_CONTINUATION_STATE=0 (gatord-benchmark-continuations-no-recycling) to compare against
+ * allocating the type erased state from the global allocator.
+ *
+ * Usage: gatord-benchmark-continuations [iterations [threads]], defaulting to 200000 iterations on one thread.
+ */
+
+#include "async/continuations/async_initiate.h"
+#include "async/continuations/continuation.h"
+#include "async/continuations/operations.h"
+#include "async/continuations/use_continuation.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+namespace {
+    std::atomic<unsigned long long> numAllocations {0};
+}
+
+// count every allocation made by the global allocator (not inlined, so the compiler cannot pair malloc with delete)
+[[gnu::noinline]] void * operator new(std::size_t size)
+{
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void * pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void * pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void * pointer, std::size_t /*size*/) noexcept
+{
+    std::free(pointer);
+}
+
+namespace {
+    using namespace async::continuations;
+
+    /** One step of the loop body, which (like a poll of one buffer) returns a type erased continuation */
+    polymorphic_continuation_t<> step(unsigned long long & counter)
+    {
+        return start_with() | then([&counter]() { ++counter; });
+    }
+
+    polymorphic_continuation_t<> iteration(boost::asio::io_context & context, unsigned long long & counter)
+    {
+        return start_on(context) | then([&counter]() -> polymorphic_continuation_t<> { return step(counter); });
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const auto numIterations = (argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 200000ULL);
+    const auto numThreads = unsigned(argc > 2 ? std::strtoul(argv[2], nullptr, 0) : 1UL);
+
+    if ((numIterations == 0) || (numThreads == 0)) {
+        fprintf(stderr, "the number of iterations and threads must be at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    boost::asio::io_context context {int(numThreads)};
+    unsigned long long counter = 0;
+    unsigned long long remaining = numIterations;
+    bool failed = false;
+
+    spawn(
+        "benchmark loop",
+        repeatedly([&remaining]() { return (remaining-- > 0); },
+                   [&context, &counter]() { return iteration(context, counter); }),
+        [&failed](bool f) { failed = f; });
+
+    const auto startAllocations = numAllocations.load();
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads {};
+    for (unsigned index = 1; index < numThreads; ++index) {
+        threads.emplace_back([&context]() { context.run(); });
+    }
+    context.run();
+    for (auto & thread : threads) {
+        thread.join();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const auto allocations = numAllocations.load() - startAllocations;
+
+    if (failed || (counter != numIterations)) {
+        fprintf(stderr, "the loop failed after %llu of %llu iterations\n", counter, numIterations);
+        return EXIT_FAILURE;
+    }
+
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    printf("continuations (recycling %s, %u threads): %llu iterations in %lld ns; %.1f ns/iteration, "
+           "%.2f allocations/iteration\n",
+           (CONFIG_RECYCLE_CONTINUATION_STATE ? "on" : "off"),
+           numThreads,
+           numIterations,
+           static_cast<long long>(ns),
+           double(ns) / double(numIterations),
+           double(allocations) / double(numIterations));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+/**
+ * Measures the per thread cost of the non-root process scan (see non_root/ProcessStateTracker) with the node based
+ * std::map containers it used to use, and with lib::FlatHashMap and lib::PerCoreArray.
+ *
+ * Each scan marks every tracked thread as unseen, looks up (or inserts) each live thread and adds its time to its core,
+ * erases the threads that were not seen while iterating, and sums the per core times. Between scans 1% of the threads
+ * exit and are replaced by new ones.
+ *
+ * Usage: gatord-benchmark-process-scan [threads [scans [cores]]], defaulting to 1000 threads, 1000 scans and 8 cores.
+ */
+
+#include "lib/FlatHashMap.h"
+#include "lib/PerCoreArray.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+namespace {
+    struct ThreadInfo {
+        unsigned long long lastTime {0};
+        bool seen {false};
+    };
+
+    template<typename TrackedMap, typename PerCoreMap>
+    unsigned long long runScans(std::vector<int> threads, unsigned numberOfScans, unsigned numberOfCores)
+    {
+        TrackedMap trackedThreads {};
+        PerCoreMap accumulatedTimePerCore {};
+        int nextTid = 1;
+        for (auto & tid : threads) {
+            tid = nextTid++;
+        }
+
+        unsigned long long checksum = 0;
+
+        for (unsigned scan = 0; scan < numberOfScans; ++scan) {
+            accumulatedTimePerCore.clear();
+
+            for (auto & entry : trackedThreads) {
+                entry.second.seen = false;
+            }
+
+            for (const auto tid : threads) {
+                auto & info = trackedThreads[tid];
+                const unsigned long long time = info.lastTime + unsigned(tid % 7) + 1;
+                accumulatedTimePerCore[unsigned(tid) % numberOfCores] += (time - info.lastTime);
+                info.lastTime = time;
+                info.seen = true;
+            }
+
+            for (auto iterator = trackedThreads.begin(); iterator != trackedThreads.end();) {
+                if (!iterator->second.seen) {
+                    iterator = trackedThreads.erase(iterator);
+                }
+                else {
+                    ++iterator;
+                }
+            }
+
+            for (const auto & entry : accumulatedTimePerCore) {
+                checksum += entry.second;
+            }
+
+            // replace 1% of the threads (at least one) with new ones
+            const std::size_t churn = (threads.size() + 99) / 100;
+            for (std::size_t index = 0; index < churn; ++index) {
+                threads[(std::size_t(scan) * 7919 + index * 101) % threads.size()] = nextTid++;
+            }
+        }
+
+        return checksum + trackedThreads.size();
+    }
+
+    template<typename TrackedMap, typename PerCoreMap>
+    double measure(const char * name,
+                   const std::vector<int> & threads,
+                   unsigned numberOfScans,
+                   unsigned numberOfCores,
+                   unsigned long long & checksum)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        checksum = runScans<TrackedMap, PerCoreMap>(threads, numberOfScans, numberOfCores);
+        const auto end = std::chrono::steady_clock::now();
+
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        const double nsPerThread = double(ns) / (double(numberOfScans) * double(threads.size()));
+
+        printf("process-scan (%s): %zu threads x %u scans in %lld ns; %.1f ns/thread/scan\n",
+               name,
+               threads.size(),
+               numberOfScans,
+               static_cast<long long>(ns),
+               nsPerThread);
+
+        return nsPerThread;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const auto numberOfThreads = (argc > 1 ? std::strtoul(argv[1], nullptr, 0) : 1000UL);
+    const auto numberOfScans = unsigned(argc > 2 ? std::strtoul(argv[2], nullptr, 0) : 1000UL);
+    const auto numberOfCores = unsigned(argc > 3 ? std::strtoul(argv[3], nullptr, 0) : 8UL);
+
+    if ((numberOfThreads == 0) || (numberOfScans == 0) || (numberOfCores == 0)) {
+        fprintf(stderr, "the number of threads, scans and cores must be at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    const std::vector<int> threads(numberOfThreads);
+
+    unsigned long long stdMapChecksum = 0;
+    unsigned long long flatChecksum = 0;
+
+    const auto stdMapCost = measure<std::map<int, ThreadInfo>, std::map<unsigned long, unsigned long long>>( //
+        "std::map",
+        threads,
+        numberOfScans,
+        numberOfCores,
+        stdMapChecksum);
+    const auto flatCost = measure<lib::FlatHashMap<int, ThreadInfo>, lib::PerCoreArray<unsigned long long>>(
+        "FlatHashMap/PerCoreArray",
+        threads,
+        numberOfScans,
+        numberOfCores,
+        flatChecksum);
+
+    if (stdMapChecksum != flatChecksum) {
+        fprintf(stderr, "the results differ (%llu != %llu)\n", stdMapChecksum, flatChecksum);
+        return EXIT_FAILURE;
+    }
+
+    printf("process-scan: speed-up %.2fx\n", stdMapCost / flatCost);
+
+    return EXIT_SUCCESS;
+}
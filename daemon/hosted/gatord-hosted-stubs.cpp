@@ -0,0 +1,49 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+/**
+ * Replaces the daemon's logging (which forwards to protobuf and the log sinks set up in main) and exception handling
+ * for the hosted executables, so that the parts under test can be linked without the rest of the daemon.
+ */
+
+#include "Logging.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace logging {
+    namespace detail {
+        bool enabled_log_trace = false;
+
+        void do_log_item(log_level_t level, source_loc_t const & location, const char * format, ...)
+        {
+            std::va_list args;
+            va_start(args, format);
+            fprintf(stderr,
+                    "[%d] %.*s:%u: ",
+                    int(level),
+                    int(location.file_name().size()),
+                    location.file_name().data(),
+                    unsigned(location.line_no()));
+            vfprintf(stderr, format, args);
+            fputc('\n', stderr);
+            va_end(args);
+        }
+
+        void do_log_item(log_level_t level, source_loc_t const & location, std::string_view msg)
+        {
+            do_log_item(level, location, "%.*s", int(msg.size()), msg.data());
+        }
+
+        void do_log_item(pid_t /*tid*/, log_level_t level, source_loc_t const & location, std::string_view msg)
+        {
+            do_log_item(level, location, msg);
+        }
+    }
+}
+
+void handleException()
+{
+    fprintf(stderr, "handleException called\n");
+    std::abort();
+}
@@ -0,0 +1,284 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+/**
+ * Tests FlightRecorder: that perf data frames are split so that only their mmap, mmap2, comm, fork and exit records
+ * are pinned, that a perf data frame that cannot be parsed is pinned whole, that windowed frames are dropped once they
+ * are older than the window or do not fit in the capacity, and each of the triggers.
+ */
+
+#include "BufferUtils.h"
+#include "FlightRecorder.h"
+#include "ISender.h"
+#include "Protocol.h"
+#include "k/perf_event.h"
+#include "lib/Span.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                             \
+            ++numErrors;                                                                                               \
+        }                                                                                                              \
+    } while (false)
+
+namespace {
+    unsigned numErrors = 0;
+
+    constexpr std::uint64_t NS_PER_MS = 1000000;
+    constexpr std::uint64_t WINDOW_NS = 10 * NS_PER_MS;
+    constexpr std::size_t LARGE_CAPACITY = 1024 * 1024;
+    constexpr int CPU = 3;
+
+    using Bytes = std::vector<char>;
+
+    void appendPacked(Bytes & bytes, std::int64_t value)
+    {
+        char buffer[buffer_utils::MAXSIZE_PACK64];
+        int length = 0;
+        buffer_utils::packInt64(buffer, length, value);
+        bytes.insert(bytes.end(), buffer, buffer + length);
+    }
+
+    void appendLEInt(Bytes & bytes, std::uint32_t value)
+    {
+        char buffer[sizeof(std::uint32_t)];
+        buffer_utils::writeLEInt(buffer, value);
+        bytes.insert(bytes.end(), buffer, buffer + sizeof(buffer));
+    }
+
+    /** A perf record of some type and number of words, with each word packed as the perf agent sends it */
+    Bytes perfRecord(std::uint32_t type, unsigned words)
+    {
+        Bytes bytes {};
+        // a perf_event_header: type in the low 32 bits, then misc, then the size in bytes in the top 16 bits
+        appendPacked(bytes, std::int64_t(type) | (std::int64_t(words * sizeof(std::uint64_t)) << 48));
+        for (unsigned word = 1; word < words; ++word) {
+            appendPacked(bytes, 1000 + word);
+        }
+        return bytes;
+    }
+
+    /** The payload of a PERF_DATA frame holding some records */
+    Bytes perfDataPayload(std::initializer_list<Bytes> records)
+    {
+        Bytes recordBytes {};
+        for (const auto & record : records) {
+            recordBytes.insert(recordBytes.end(), record.begin(), record.end());
+        }
+
+        Bytes bytes {static_cast<char>(FrameType::PERF_DATA)};
+        appendPacked(bytes, CPU);
+        appendLEInt(bytes, recordBytes.size());
+        bytes.insert(bytes.end(), recordBytes.begin(), recordBytes.end());
+        return bytes;
+    }
+
+    /** The payload of a COUNTER frame */
+    Bytes counterPayload(std::int64_t key, std::int64_t value)
+    {
+        Bytes bytes {static_cast<char>(FrameType::COUNTER)};
+        appendPacked(bytes, 12345); // time
+        appendPacked(bytes, CPU);
+        appendPacked(bytes, key);
+        appendPacked(bytes, value);
+        return bytes;
+    }
+
+    /** The payload of an EXTERNAL frame */
+    Bytes externalPayload(const std::string & text)
+    {
+        Bytes bytes {static_cast<char>(FrameType::EXTERNAL)};
+        appendPacked(bytes, 1); // fd
+        bytes.insert(bytes.end(), text.begin(), text.end());
+        return bytes;
+    }
+
+    /** A payload as it is written to the data file, preceded by its length */
+    Bytes frame(const Bytes & payload)
+    {
+        Bytes bytes {};
+        appendLEInt(bytes, payload.size());
+        bytes.insert(bytes.end(), payload.begin(), payload.end());
+        return bytes;
+    }
+
+    Bytes concat(std::initializer_list<Bytes> parts)
+    {
+        Bytes bytes {};
+        for (const auto & part : parts) {
+            bytes.insert(bytes.end(), part.begin(), part.end());
+        }
+        return bytes;
+    }
+
+    void add(FlightRecorder & recorder, const Bytes & payload, std::uint64_t timeNs)
+    {
+        const lib::Span<const char, int> part {payload.data(), int(payload.size())};
+        recorder.add({&part, 1}, ResponseType::APC_DATA, timeNs);
+    }
+
+    Bytes written(const FlightRecorder & recorder)
+    {
+        FILE * file = tmpfile();
+        if (file == nullptr) {
+            fprintf(stderr, "tmpfile failed\n");
+            exit(EXIT_FAILURE);
+        }
+
+        CHECK(recorder.writeTo(file));
+
+        Bytes bytes(std::size_t(ftell(file)));
+        rewind(file);
+        CHECK(fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+        fclose(file);
+        return bytes;
+    }
+
+    void testSplitsPerfData()
+    {
+        unsigned triggers = 0;
+        FlightRecorder recorder {LARGE_CAPACITY, WINDOW_NS, "", std::nullopt, [&triggers]() { ++triggers; }};
+
+        const auto mmap = perfRecord(PERF_RECORD_MMAP2, 6);
+        const auto comm = perfRecord(PERF_RECORD_COMM, 3);
+        const auto sample = perfRecord(PERF_RECORD_SAMPLE, 4);
+        const auto contextSwitch = perfRecord(PERF_RECORD_SWITCH_CPU_WIDE, 2);
+        const auto aux = perfRecord(PERF_RECORD_AUX, 4);
+        const auto lost = perfRecord(PERF_RECORD_LOST, 3);
+
+        add(recorder, perfDataPayload({sample, mmap, contextSwitch, aux, comm, lost}), 0);
+
+        // the pinned records come first, then the window, each in the order they arrived
+        CHECK(written(recorder)
+              == concat({frame(perfDataPayload({mmap, comm})),
+                         frame(perfDataPayload({sample, contextSwitch, aux, lost}))}));
+
+        // once the window has passed, only the pinned records are kept
+        const auto counter = counterPayload(1, 2);
+        add(recorder, counter, WINDOW_NS + 1);
+        CHECK(written(recorder) == concat({frame(perfDataPayload({mmap, comm})), frame(counter)}));
+
+        CHECK(triggers == 0);
+    }
+
+    void testPinsNothingForOnlySamples()
+    {
+        FlightRecorder recorder {LARGE_CAPACITY, WINDOW_NS, "", std::nullopt, []() {}};
+
+        const auto payload = perfDataPayload({perfRecord(PERF_RECORD_SAMPLE, 4), perfRecord(PERF_RECORD_SAMPLE, 5)});
+        add(recorder, payload, 0);
+        CHECK(written(recorder) == frame(payload));
+
+        add(recorder, counterPayload(1, 2), WINDOW_NS + 1);
+        add(recorder, counterPayload(1, 2), (2 * WINDOW_NS) + 2);
+        CHECK(written(recorder) == frame(counterPayload(1, 2)));
+    }
+
+    void testPinsUnparseablePerfData()
+    {
+        FlightRecorder recorder {LARGE_CAPACITY, WINDOW_NS, "", std::nullopt, []() {}};
+
+        // the length of the records does not match the frame
+        auto payload = perfDataPayload({perfRecord(PERF_RECORD_SAMPLE, 4)});
+        payload.push_back(0);
+        add(recorder, payload, 0);
+
+        // a record that runs past the end of the frame
+        auto truncated = perfDataPayload({perfRecord(PERF_RECORD_SAMPLE, 4)});
+        truncated.back() = char(0x80);
+        add(recorder, truncated, 0);
+
+        add(recorder, counterPayload(1, 2), WINDOW_NS + 1);
+        CHECK(written(recorder) == concat({frame(payload), frame(truncated), frame(counterPayload(1, 2))}));
+    }
+
+    void testDropsOldestOverCapacity()
+    {
+        const auto first = counterPayload(1, 1);
+        const auto second = counterPayload(1, 2);
+        const auto third = counterPayload(1, 3);
+
+        // only room for two of the frames
+        unsigned triggers = 0;
+        FlightRecorder recorder {frame(first).size() * 2, WINDOW_NS, "", std::nullopt, [&triggers]() { ++triggers; }};
+
+        add(recorder, first, 0);
+        add(recorder, second, 1);
+        add(recorder, third, 2);
+
+        CHECK(written(recorder) == concat({frame(second), frame(third)}));
+        CHECK(triggers == 0);
+    }
+
+    void testTriggersWhenFullOfPinnedData()
+    {
+        const auto pinned = perfDataPayload({perfRecord(PERF_RECORD_MMAP2, 6)});
+
+        unsigned triggers = 0;
+        FlightRecorder recorder {frame(pinned).size(), WINDOW_NS, "", std::nullopt, [&triggers]() { ++triggers; }};
+
+        add(recorder, pinned, 0);
+        CHECK(triggers == 0);
+
+        add(recorder, pinned, 1);
+        add(recorder, pinned, 2);
+        CHECK(triggers == 1);
+    }
+
+    void testTriggersOnAnnotation()
+    {
+        unsigned triggers = 0;
+        FlightRecorder recorder {LARGE_CAPACITY, WINDOW_NS, "stop here", std::nullopt, [&triggers]() { ++triggers; }};
+
+        add(recorder, externalPayload("keep going"), 0);
+        CHECK(triggers == 0);
+
+        add(recorder, externalPayload("please stop here now"), 1);
+        CHECK(triggers == 1);
+
+        add(recorder, externalPayload("stop here"), 2);
+        CHECK(triggers == 1);
+    }
+
+    void testTriggersOnThreshold()
+    {
+        unsigned triggers = 0;
+        FlightRecorder recorder {LARGE_CAPACITY,
+                                 WINDOW_NS,
+                                 "",
+                                 FlightRecorder::Threshold {7, 100},
+                                 [&triggers]() { ++triggers; }};
+
+        add(recorder, counterPayload(7, 99), 0);
+        add(recorder, counterPayload(8, 1000), 1);
+        CHECK(triggers == 0);
+
+        add(recorder, counterPayload(7, 100), 2);
+        CHECK(triggers == 1);
+    }
+}
+
+int main()
+{
+    testSplitsPerfData();
+    testPinsNothingForOnlySamples();
+    testPinsUnparseablePerfData();
+    testDropsOldestOverCapacity();
+    testTriggersWhenFullOfPinnedData();
+    testTriggersOnAnnotation();
+    testTriggersOnThreshold();
+
+    if (numErrors != 0) {
+        fprintf(stderr, "%u errors\n", numErrors);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+/**
+ * Tests lib::ReadyBitmap: the producer masks, that notifications made while the consumer is not waiting are coalesced
+ * into its next wait, the timeout, and that a consumer blocked in the futex is always woken (stressed with several
+ * producer threads, where a lost wakeup shows up as a wait that times out with data outstanding).
+ */
+
+#include "lib/ReadyBitmap.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                             \
+            ++numErrors;                                                                                               \
+        }                                                                                                              \
+    } while (false)
+
+namespace {
+    unsigned numErrors = 0;
+
+    constexpr auto SHORT_TIMEOUT = std::chrono::milliseconds(10);
+    constexpr auto LONG_TIMEOUT = std::chrono::seconds(5);
+
+    void testProducerMasks()
+    {
+        lib::ReadyBitmap bitmap {};
+
+        std::vector<lib::ReadySignal> signals {};
+        for (unsigned index = 0; index < 65; ++index) {
+            signals.push_back(bitmap.addProducer());
+        }
+
+        std::uint64_t all = 0;
+        for (unsigned index = 0; index < 64; ++index) {
+            CHECK(signals[index].mask() == (std::uint64_t(1) << index));
+            all |= signals[index].mask();
+        }
+        CHECK(all == ~std::uint64_t(0));
+
+        // the 65th producer shares the first producer's bit
+        CHECK(signals[64].mask() == signals[0].mask());
+    }
+
+    void testCoalescesNotifications()
+    {
+        lib::ReadyBitmap bitmap {};
+        const auto first = bitmap.addProducer();
+        const auto second = bitmap.addProducer();
+        const auto third = bitmap.addProducer();
+
+        first.notify();
+        first.notify();
+        third.notify();
+
+        CHECK(bitmap.wait() == (first.mask() | third.mask()));
+
+        // the bits were all taken by the previous wait
+        CHECK(bitmap.waitFor(SHORT_TIMEOUT) == 0);
+
+        second.notify();
+        CHECK(bitmap.waitFor(SHORT_TIMEOUT) == second.mask());
+    }
+
+    void testTimeout()
+    {
+        lib::ReadyBitmap bitmap {};
+        (void) bitmap.addProducer();
+
+        const auto start = std::chrono::steady_clock::now();
+        CHECK(bitmap.waitFor(SHORT_TIMEOUT) == 0);
+        CHECK((std::chrono::steady_clock::now() - start) >= SHORT_TIMEOUT);
+    }
+
+    void testWakesWaitingConsumer()
+    {
+        lib::ReadyBitmap bitmap {};
+        const auto signal = bitmap.addProducer();
+
+        std::thread producer {[&signal]() {
+            std::this_thread::sleep_for(SHORT_TIMEOUT);
+            signal.notify();
+        }};
+
+        CHECK(bitmap.waitFor(LONG_TIMEOUT) == signal.mask());
+
+        producer.join();
+    }
+
+    void testManyProducers()
+    {
+        constexpr unsigned numProducers = 4;
+        constexpr unsigned itemsPerProducer = 100000;
+
+        lib::ReadyBitmap bitmap {};
+        std::vector<lib::ReadySignal> signals {};
+        std::array<std::atomic<unsigned>, numProducers> produced {};
+        for (unsigned index = 0; index < numProducers; ++index) {
+            signals.push_back(bitmap.addProducer());
+        }
+
+        std::vector<std::thread> producers {};
+        for (unsigned index = 0; index < numProducers; ++index) {
+            producers.emplace_back([&signal = signals[index], &count = produced[index]]() {
+                for (unsigned item = 0; item < itemsPerProducer; ++item) {
+                    count.fetch_add(1, std::memory_order_release);
+                    signal.notify();
+                    if ((item % 1024) == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        std::array<unsigned, numProducers> consumed {};
+        unsigned numFinished = 0;
+        while (numFinished < numProducers) {
+            const auto ready = bitmap.waitFor(LONG_TIMEOUT);
+            if (ready == 0) {
+                fprintf(stderr, "lost wakeup: consumer timed out with data outstanding\n");
+                ++numErrors;
+                break;
+            }
+
+            for (unsigned index = 0; index < numProducers; ++index) {
+                if ((ready & signals[index].mask()) == 0) {
+                    continue;
+                }
+
+                const auto count = produced[index].load(std::memory_order_acquire);
+                CHECK(count >= consumed[index]);
+                if ((count == itemsPerProducer) && (consumed[index] != itemsPerProducer)) {
+                    ++numFinished;
+                }
+                consumed[index] = count;
+            }
+        }
+
+        for (auto & producer : producers) {
+            producer.join();
+        }
+    }
+}
+
+int main()
+{
+    testProducerMasks();
+    testCoalescesNotifications();
+    testTimeout();
+    testWakesWaitingConsumer();
+    testManyProducers();
+
+    if (numErrors != 0) {
+        fprintf(stderr, "%u errors\n", numErrors);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -5,8 +5,10 @@
 #include <algorithm>
 #include <cerrno>
 #include <cstdint>
+#include <cstring>
 
 #include <fcntl.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 namespace lib {
@@ -111,4 +113,62 @@ namespace lib {
 
         return true;
     }
+
+    bool sendFd(const int socket, const int fd)
+    {
+        char data = 0;
+        iovec iov {&data, sizeof(data)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fd))] {};
+
+        msghdr msg {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        cmsghdr * const cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fd));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+
+        while (sendmsg(socket, &msg, MSG_NOSIGNAL) < 0) {
+            if (errno != EINTR) {
+                LOG_DEBUG("sendmsg failed (%d) %s", errno, strerror(errno));
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    int receiveFd(const int socket)
+    {
+        char data = 0;
+        iovec iov {&data, sizeof(data)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] {};
+
+        msghdr msg {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t bytes;
+        while ((bytes = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC)) < 0) {
+            if (errno != EINTR) {
+                LOG_DEBUG("recvmsg failed (%d) %s", errno, strerror(errno));
+                return -1;
+            }
+        }
+
+        const cmsghdr * const cmsg = CMSG_FIRSTHDR(&msg);
+        if ((bytes == 0) || (cmsg == nullptr) || (cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS)) {
+            return -1;
+        }
+
+        int fd;
+        std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+        return fd;
+    }
 }
@@ -12,6 +12,10 @@ namespace lib {
     bool writeAll(int fd, const void * buf, size_t pos);
     bool readAll(int fd, void * buf, size_t count);
     bool skipAll(int fd, size_t count);
+    /** Send a file descriptor over a unix domain socket */
+    bool sendFd(int socket, int fd);
+    /** Receive a file descriptor from a unix domain socket, returns -1 on error or if the peer closed the socket */
+    int receiveFd(int socket);
 }
 
 #endif // INCLUDE_LIB_FILE_DESCRIPTOR_H
@@ -0,0 +1,270 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lib {
+    /**
+     * An unordered map that stores its entries inline in a single array (open addressing with linear probing), so that
+     * lookups do not chase pointers and inserts do not allocate except when the table grows.
+     *
+     * Erasing an entry leaves a marker in its slot rather than moving other entries, so erasing while iterating (as
+     * with std::map, using the iterator returned by erase) visits each remaining entry exactly once. The markers are
+     * removed when the table is next rehashed.
+     *
+     * Unlike std::unordered_map, iterators and references are invalidated by any insert, and both the key and value
+     * must be default constructible and move assignable. The key of an entry must not be modified through an iterator.
+     *
+     * @tparam Key The key type
+     * @tparam Value The mapped type
+     * @tparam Hash The hash function for Key
+     */
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class FlatHashMap {
+    private:
+        enum class SlotState : std::uint8_t {
+            EMPTY,
+            FULL,
+            ERASED,
+        };
+
+        template<bool Const>
+        class Iterator {
+        public:
+            using map_type = std::conditional_t<Const, const FlatHashMap, FlatHashMap>;
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<Key, Value>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+            using reference = std::conditional_t<Const, const value_type &, value_type &>;
+
+            Iterator() = default;
+            Iterator(map_type * map, std::size_t index) : map(map), index(index) { skipToFull(); }
+
+            // NOLINTNEXTLINE(hicpp-explicit-conversions)
+            template<bool C = Const, typename = std::enable_if_t<C>>
+            Iterator(const Iterator<false> & that) : map(that.map), index(that.index)
+            {
+            }
+
+            reference operator*() const { return map->slots[index]; }
+            pointer operator->() const { return &(map->slots[index]); }
+
+            Iterator & operator++()
+            {
+                ++index;
+                skipToFull();
+                return *this;
+            }
+
+            Iterator operator++(int)
+            {
+                auto result = *this;
+                ++(*this);
+                return result;
+            }
+
+            bool operator==(const Iterator & that) const { return (index == that.index); }
+            bool operator!=(const Iterator & that) const { return (index != that.index); }
+
+        private:
+            friend class FlatHashMap;
+            friend class Iterator<true>;
+
+            map_type * map {nullptr};
+            std::size_t index {0};
+
+            void skipToFull()
+            {
+                while ((index < map->states.size()) && (map->states[index] != SlotState::FULL)) {
+                    ++index;
+                }
+            }
+        };
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+        using value_type = std::pair<Key, Value>;
+        using size_type = std::size_t;
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        FlatHashMap() = default;
+
+        iterator begin() { return {this, 0}; }
+        iterator end() { return {this, states.size()}; }
+        const_iterator begin() const { return {this, 0}; }
+        const_iterator end() const { return {this, states.size()}; }
+
+        [[nodiscard]] bool empty() const { return (count == 0); }
+        [[nodiscard]] size_type size() const { return count; }
+
+        /** Find the entry for some key */
+        iterator find(const Key & key) { return {this, findIndex(key)}; }
+        const_iterator find(const Key & key) const { return {this, findIndex(key)}; }
+
+        /** Find the value for some key, inserting a default constructed value if there is none */
+        Value & operator[](const Key & key)
+        {
+            const auto existing = findIndex(key);
+            if (existing != states.size()) {
+                return slots[existing].second;
+            }
+
+            if ((used + 1) * MAX_LOAD_DENOMINATOR > states.size() * MAX_LOAD_NUMERATOR) {
+                // grow if mostly full of entries, otherwise just clear out the erased markers
+                rehash((count + 1) * 2 > states.size() ? std::max(states.size() * 2, MIN_CAPACITY) : states.size());
+            }
+
+            // the key is not present so the first free slot on its probe sequence is where it goes
+            auto index = firstIndexFor(key);
+            while (states[index] == SlotState::FULL) {
+                index = (index + 1) & mask();
+            }
+
+            if (states[index] == SlotState::EMPTY) {
+                ++used;
+            }
+            ++count;
+
+            states[index] = SlotState::FULL;
+            slots[index] = value_type {key, Value {}};
+
+            return slots[index].second;
+        }
+
+        /**
+         * Remove an entry
+         *
+         * @return The iterator following the removed entry
+         */
+        iterator erase(const_iterator position)
+        {
+            const auto index = position.index;
+
+            states[index] = SlotState::ERASED;
+            slots[index] = value_type {};
+            --count;
+
+            if (count == 0) {
+                clear();
+            }
+
+            return {this, index};
+        }
+
+        /**
+         * Remove the entry for some key, if there is one
+         *
+         * @return The number of entries removed
+         */
+        size_type erase(const Key & key)
+        {
+            const auto index = findIndex(key);
+            if (index == states.size()) {
+                return 0;
+            }
+            erase(const_iterator {this, index});
+            return 1;
+        }
+
+        /** Remove all entries, keeping the storage */
+        void clear()
+        {
+            for (std::size_t index = 0; index < states.size(); ++index) {
+                if (states[index] == SlotState::FULL) {
+                    slots[index] = value_type {};
+                }
+                states[index] = SlotState::EMPTY;
+            }
+            count = 0;
+            used = 0;
+        }
+
+        /** Make room for at least `n` entries without growing */
+        void reserve(size_type n)
+        {
+            auto capacity = MIN_CAPACITY;
+            while (n * MAX_LOAD_DENOMINATOR > capacity * MAX_LOAD_NUMERATOR) {
+                capacity *= 2;
+            }
+            if (capacity > states.size()) {
+                rehash(capacity);
+            }
+        }
+
+    private:
+        static constexpr std::size_t MIN_CAPACITY = 16;
+        /** Grow (or clean) when more than 7/8ths of the slots are full or erased */
+        static constexpr std::size_t MAX_LOAD_NUMERATOR = 7;
+        static constexpr std::size_t MAX_LOAD_DENOMINATOR = 8;
+
+        std::vector<SlotState> states {};
+        std::vector<value_type> slots {};
+        /** The number of full slots */
+        std::size_t count {0};
+        /** The number of full or erased slots */
+        std::size_t used {0};
+
+        [[nodiscard]] std::size_t mask() const { return states.size() - 1; }
+
+        [[nodiscard]] std::size_t firstIndexFor(const Key & key) const
+        {
+            // fibonacci hashing spreads out sequential keys (such as pids) whose std::hash is the identity
+            constexpr std::uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+            const std::uint64_t hash = std::uint64_t(Hash {}(key)) * multiplier;
+            return std::size_t(hash >> 32) & mask();
+        }
+
+        /** @return The index of the key, or states.size() if it is not present */
+        [[nodiscard]] std::size_t findIndex(const Key & key) const
+        {
+            if (count == 0) {
+                return states.size();
+            }
+
+            // the load limit guarantees at least one empty slot so this terminates
+            for (auto index = firstIndexFor(key); states[index] != SlotState::EMPTY; index = (index + 1) & mask()) {
+                if ((states[index] == SlotState::FULL) && (slots[index].first == key)) {
+                    return index;
+                }
+            }
+
+            return states.size();
+        }
+
+        void rehash(std::size_t capacity)
+        {
+            auto oldStates = std::move(states);
+            auto oldSlots = std::move(slots);
+
+            states.assign(capacity, SlotState::EMPTY);
+            slots.clear();
+            slots.resize(capacity);
+            used = count;
+
+            for (std::size_t oldIndex = 0; oldIndex < oldStates.size(); ++oldIndex) {
+                if (oldStates[oldIndex] != SlotState::FULL) {
+                    continue;
+                }
+
+                auto index = firstIndexFor(oldSlots[oldIndex].first);
+                while (states[index] == SlotState::FULL) {
+                    index = (index + 1) & mask();
+                }
+
+                states[index] = SlotState::FULL;
+                slots[index] = std::move(oldSlots[oldIndex]);
+            }
+        }
+    };
+}
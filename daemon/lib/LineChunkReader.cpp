@@ -0,0 +1,66 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "lib/LineChunkReader.h"
+
+#include "Logging.h"
+#include "lib/Syscall.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+
+namespace lib {
+    LineChunkReader::LineChunkReader(const char * path, std::size_t maxChunkSize)
+        : fd(lib::open(path, O_RDONLY | O_CLOEXEC)), buffer(maxChunkSize)
+    {
+    }
+
+    std::string_view LineChunkReader::next()
+    {
+        if (!isOpen() || buffer.empty()) {
+            return {};
+        }
+
+        // keep any partial line that followed the previous chunk
+        if (consumed > 0) {
+            std::memmove(buffer.data(), buffer.data() + consumed, used - consumed);
+            used -= consumed;
+            consumed = 0;
+        }
+
+        // fill the buffer, so that there are as few chunks as possible
+        while ((!eof) && (used < buffer.size())) {
+            const ssize_t bytes = lib::read(fd.get(), buffer.data() + used, buffer.size() - used);
+            if (bytes < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_DEBUG("read failed (%s)", strerror(errno));
+                eof = true;
+            }
+            else if (bytes == 0) {
+                eof = true;
+            }
+            else {
+                used += bytes;
+            }
+        }
+
+        if (used == 0) {
+            return {};
+        }
+
+        // end the chunk at the last complete line, unless the rest of the file is in the buffer or the line is too long
+        consumed = used;
+        if (!eof) {
+            const std::string_view contents {buffer.data(), used};
+            const auto newline = contents.rfind('\n');
+            if (newline != std::string_view::npos) {
+                consumed = newline + 1;
+            }
+        }
+
+        return {buffer.data(), consumed};
+    }
+}
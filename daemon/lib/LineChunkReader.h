@@ -0,0 +1,48 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef INCLUDE_LIB_LINE_CHUNK_READER_H
+#define INCLUDE_LIB_LINE_CHUNK_READER_H
+
+#include "lib/AutoClosingFd.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace lib {
+    /**
+     * Reads a text file in chunks of bounded size, where each chunk ends at a line boundary, so that large files such as
+     * /proc/kallsyms can be processed without holding the whole file in memory.
+     *
+     * A line that is longer than the chunk size is split across several chunks.
+     */
+    class LineChunkReader {
+    public:
+        /**
+         * Constructor, opens the file
+         *
+         * @param path The path of the file to read
+         * @param maxChunkSize The largest chunk that is returned by next()
+         */
+        LineChunkReader(const char * path, std::size_t maxChunkSize);
+
+        /** @return True if the file was opened */
+        [[nodiscard]] bool isOpen() const { return fd.get() >= 0; }
+
+        /**
+         * Read the next chunk of the file
+         *
+         * @return The chunk, which is only valid until the next call, or empty at the end of the file or on error
+         */
+        [[nodiscard]] std::string_view next();
+
+    private:
+        AutoClosingFd fd;
+        std::vector<char> buffer;
+        std::size_t used {0};
+        std::size_t consumed {0};
+        bool eof {false};
+    };
+}
+
+#endif // INCLUDE_LIB_LINE_CHUNK_READER_H
@@ -0,0 +1,129 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lib {
+    /**
+     * A map from core number to some value, stored as a dense array indexed by the core number.
+     *
+     * Core numbers are small and contiguous so this avoids the allocation and pointer chasing of a std::map. The
+     * storage only ever grows, so clearing and refilling it (e.g. once per scan) does not allocate. Entries are
+     * iterated in order of core number, as with std::map.
+     *
+     * @tparam T The value type, which must be default constructible and move assignable
+     */
+    template<typename T>
+    class PerCoreArray {
+    private:
+        template<bool Const>
+        class Iterator {
+        public:
+            using array_type = std::conditional_t<Const, const PerCoreArray, PerCoreArray>;
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<std::size_t, std::conditional_t<Const, const T &, T &>>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            Iterator() = default;
+            Iterator(array_type * array, std::size_t index) : array(array), index(index) { skipToPresent(); }
+
+            /** @return The pair of core number and value */
+            reference operator*() const { return {index, array->values[index]}; }
+
+            Iterator & operator++()
+            {
+                ++index;
+                skipToPresent();
+                return *this;
+            }
+
+            Iterator operator++(int)
+            {
+                auto result = *this;
+                ++(*this);
+                return result;
+            }
+
+            bool operator==(const Iterator & that) const { return (index == that.index); }
+            bool operator!=(const Iterator & that) const { return (index != that.index); }
+
+        private:
+            array_type * array {nullptr};
+            std::size_t index {0};
+
+            void skipToPresent()
+            {
+                while ((index < array->present.size()) && (!array->present[index])) {
+                    ++index;
+                }
+            }
+        };
+
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        PerCoreArray() = default;
+
+        iterator begin() { return {this, 0}; }
+        iterator end() { return {this, present.size()}; }
+        const_iterator begin() const { return {this, 0}; }
+        const_iterator end() const { return {this, present.size()}; }
+
+        [[nodiscard]] bool empty() const { return (count == 0); }
+        [[nodiscard]] size_type size() const { return count; }
+
+        /** Find the value for some core, inserting a default constructed value if there is none */
+        T & operator[](std::size_t core)
+        {
+            if (core >= present.size()) {
+                present.resize(core + 1, false);
+                values.resize(core + 1);
+            }
+
+            if (!present[core]) {
+                present[core] = true;
+                ++count;
+            }
+
+            return values[core];
+        }
+
+        /** @return The value for some core, or nullptr if there is none */
+        [[nodiscard]] T * find(std::size_t core)
+        {
+            return ((core < present.size()) && present[core] ? &(values[core]) : nullptr);
+        }
+
+        [[nodiscard]] const T * find(std::size_t core) const
+        {
+            return ((core < present.size()) && present[core] ? &(values[core]) : nullptr);
+        }
+
+        /** Remove all entries, keeping the storage */
+        void clear()
+        {
+            for (std::size_t core = 0; core < present.size(); ++core) {
+                if (present[core]) {
+                    values[core] = T {};
+                    present[core] = false;
+                }
+            }
+            count = 0;
+        }
+
+    private:
+        std::vector<T> values {};
+        std::vector<bool> present {};
+        std::size_t count {0};
+    };
+}
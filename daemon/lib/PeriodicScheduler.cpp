@@ -0,0 +1,200 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "lib/PeriodicScheduler.h"
+
+#include "Logging.h"
+#include "lib/Syscall.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <utility>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+namespace lib {
+    namespace {
+        constexpr std::uint64_t NS_PER_S = 1000000000ULL;
+
+        std::uint64_t getClockNS(clockid_t id)
+        {
+            struct timespec ts;
+            clock_gettime(id, &ts);
+            return (ts.tv_sec * NS_PER_S) + ts.tv_nsec;
+        }
+
+        struct timespec toTimespec(std::uint64_t ns)
+        {
+            return {time_t(ns / NS_PER_S), long(ns % NS_PER_S)};
+        }
+
+        /** Read (and discard) the value of a timerfd or eventfd, so that it is no longer readable */
+        void drain(int fd)
+        {
+            std::uint64_t value;
+            (void) lib::read(fd, &value, sizeof(value));
+        }
+    }
+
+    PeriodicScheduler::PeriodicScheduler()
+        : timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)),
+          stopFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    {
+        if (!timerFd) {
+            LOG_DEBUG("timerfd_create failed (%d) %s, polling deadlines instead", errno, strerror(errno));
+        }
+        if (!stopFd) {
+            LOG_DEBUG("eventfd failed (%d) %s, stop will wait for the next deadline", errno, strerror(errno));
+        }
+    }
+
+    void PeriodicScheduler::addTask(std::uint64_t periodNS, TaskCallback callback)
+    {
+        tasks.push_back(Task {std::max<std::uint64_t>(periodNS, 1), 0, std::move(callback)});
+    }
+
+    void PeriodicScheduler::addFd(int fd, FdCallback callback)
+    {
+        watchedFds.push_back(WatchedFd {fd, std::move(callback)});
+    }
+
+    void PeriodicScheduler::stop()
+    {
+        stopped.store(true, std::memory_order_seq_cst);
+
+        if (stopFd) {
+            const std::uint64_t value = 1;
+            (void) lib::write(stopFd.get(), &value, sizeof(value));
+        }
+    }
+
+    void PeriodicScheduler::run(std::uint64_t epochNS)
+    {
+        auto getNowNS = [epochNS]() -> std::uint64_t {
+            const auto rawNS = getClockNS(CLOCK_MONOTONIC_RAW);
+            return (rawNS > epochNS ? rawNS - epochNS : 0);
+        };
+
+        // start from the most recent deadline of each task so that they all run straight away
+        auto nowNS = getNowNS();
+        for (auto & task : tasks) {
+            task.nextTickNS = (nowNS / task.periodNS) * task.periodNS;
+        }
+
+        std::vector<pollfd> pfds {};
+
+        while (!stopped.load(std::memory_order_acquire)) {
+            runDueTasks(nowNS);
+
+            if (stopped.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            auto deadlineNS = std::numeric_limits<std::uint64_t>::max();
+            for (const auto & task : tasks) {
+                deadlineNS = std::min(deadlineNS, task.nextTickNS);
+            }
+
+            const bool hasDeadline = !tasks.empty();
+            nowNS = getNowNS();
+            const bool useTimer = hasDeadline && armTimer(epochNS + deadlineNS, epochNS + nowNS);
+
+            pfds.clear();
+            if (stopFd) {
+                pfds.push_back(pollfd {stopFd.get(), POLLIN, 0});
+            }
+            const auto timerIndex = pfds.size();
+            if (useTimer) {
+                pfds.push_back(pollfd {timerFd.get(), POLLIN, 0});
+            }
+            const auto firstWatchedFd = pfds.size();
+            for (const auto & watchedFd : watchedFds) {
+                pfds.push_back(pollfd {watchedFd.fd, POLLIN, 0});
+            }
+
+            // without a timer the deadline is a (relative) timeout instead
+            const auto timeout = toTimespec(deadlineNS > nowNS ? deadlineNS - nowNS : 0);
+            const auto * timeoutOrNull = (hasDeadline && !useTimer ? &timeout : nullptr);
+
+            const int result = ppoll(pfds.data(), pfds.size(), timeoutOrNull, nullptr);
+            if (result < 0) {
+                if (errno != EINTR) {
+                    LOG_ERROR("ppoll failed (%d) %s", errno, strerror(errno));
+                    return;
+                }
+            }
+            else if (result > 0) {
+                if (useTimer && ((pfds[timerIndex].revents & POLLIN) != 0)) {
+                    drain(timerFd.get());
+                }
+
+                std::vector<WatchedFd> stillWatched {};
+                for (std::size_t index = 0; index < watchedFds.size(); ++index) {
+                    const auto revents = pfds[firstWatchedFd + index].revents;
+                    if ((revents != 0) && !watchedFds[index].callback()) {
+                        continue;
+                    }
+                    stillWatched.push_back(std::move(watchedFds[index]));
+                }
+                watchedFds = std::move(stillWatched);
+            }
+
+            nowNS = getNowNS();
+        }
+
+        if (stopFd) {
+            drain(stopFd.get());
+        }
+    }
+
+    bool PeriodicScheduler::armTimer(std::uint64_t deadlineNS, std::uint64_t nowNS)
+    {
+        if (!timerFd) {
+            return false;
+        }
+
+        // timerfd does not support CLOCK_MONOTONIC_RAW, so convert using the current offset between the two; this is
+        // resampled for every deadline so any difference in their rates does not accumulate
+        const auto monotonicNowNS = getClockNS(CLOCK_MONOTONIC);
+        const auto monotonicDeadlineNS =
+            (deadlineNS > nowNS ? monotonicNowNS + (deadlineNS - nowNS) : monotonicNowNS);
+
+        struct itimerspec spec {};
+        spec.it_value = toTimespec(monotonicDeadlineNS);
+
+        if (timerfd_settime(timerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+            LOG_DEBUG("timerfd_settime failed (%d) %s", errno, strerror(errno));
+            return false;
+        }
+
+        return true;
+    }
+
+    void PeriodicScheduler::runDueTasks(std::uint64_t nowNS)
+    {
+        while (!stopped.load(std::memory_order_acquire)) {
+            // run the earliest due task first, and tasks with the same deadline in the order they were added
+            Task * next = nullptr;
+            for (auto & task : tasks) {
+                if ((task.nextTickNS <= nowNS) && ((next == nullptr) || (task.nextTickNS < next->nextTickNS))) {
+                    next = &task;
+                }
+            }
+
+            if (next == nullptr) {
+                return;
+            }
+
+            const std::uint64_t missedTicks = (nowNS - next->nextTickNS) / next->periodNS;
+            const std::uint64_t tickTimeNS = next->nextTickNS + (missedTicks * next->periodNS);
+
+            next->nextTickNS = tickTimeNS + next->periodNS;
+
+            next->callback(tickTimeNS, missedTicks);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef INCLUDE_LIB_PERIODICSCHEDULER_H
+#define INCLUDE_LIB_PERIODICSCHEDULER_H
+
+#include "lib/AutoClosingFd.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace lib {
+    /**
+     * Runs periodic tasks (and handlers for readable file descriptors) on the calling thread.
+     *
+     * Each task runs at absolute deadlines that are whole multiples of its period from a common epoch, so running late
+     * does not push back later deadlines, and tasks with the same or related periods stay in phase with each other and
+     * with any other scheduler using the same epoch. The epoch is a CLOCK_MONOTONIC_RAW time (e.g. the capture start);
+     * the deadlines are armed on a timerfd, or used as a poll timeout if a timerfd is not available.
+     *
+     * If a task runs more than a whole period late, the deadlines that were missed are skipped, and the number skipped
+     * is passed to the task.
+     */
+    class PeriodicScheduler {
+    public:
+        /**
+         * A periodic task
+         *
+         * @param tickTimeNS The deadline being run, relative to the epoch
+         * @param missedTicks The number of deadlines skipped since the previous call
+         */
+        using TaskCallback = std::function<void(std::uint64_t tickTimeNS, std::uint64_t missedTicks)>;
+
+        /**
+         * Handler for a readable file descriptor
+         *
+         * @return False to stop watching the file descriptor
+         */
+        using FdCallback = std::function<bool()>;
+
+        PeriodicScheduler();
+
+        PeriodicScheduler(const PeriodicScheduler &) = delete;
+        PeriodicScheduler & operator=(const PeriodicScheduler &) = delete;
+        PeriodicScheduler(PeriodicScheduler &&) = delete;
+        PeriodicScheduler & operator=(PeriodicScheduler &&) = delete;
+        ~PeriodicScheduler() = default;
+
+        /** Add a task (before calling run); tasks due at the same deadline run in the order they were added */
+        void addTask(std::uint64_t periodNS, TaskCallback callback);
+
+        /** Call a handler (from run) whenever some file descriptor is readable */
+        void addFd(int fd, FdCallback callback);
+
+        /**
+         * Run the tasks until stop is called.
+         *
+         * Each task first runs immediately, for the most recent deadline.
+         *
+         * @param epochNS The CLOCK_MONOTONIC_RAW time that the deadlines are multiples of the periods from
+         */
+        void run(std::uint64_t epochNS);
+
+        /** Make run return (or not start); may be called from any thread */
+        void stop();
+
+    private:
+        struct Task {
+            std::uint64_t periodNS;
+            /** Relative to the epoch */
+            std::uint64_t nextTickNS;
+            TaskCallback callback;
+        };
+
+        struct WatchedFd {
+            int fd;
+            FdCallback callback;
+        };
+
+        std::vector<Task> tasks {};
+        std::vector<WatchedFd> watchedFds {};
+        lib::AutoClosingFd timerFd;
+        lib::AutoClosingFd stopFd;
+        std::atomic_bool stopped {false};
+
+        /** Arm the timer for some deadline; returns false if there is no timer and the deadline must be polled */
+        bool armTimer(std::uint64_t deadlineNS, std::uint64_t nowNS);
+        void runDueTasks(std::uint64_t nowNS);
+    };
+}
+
+#endif /* INCLUDE_LIB_PERIODICSCHEDULER_H */
@@ -0,0 +1,91 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "lib/ReadyBitmap.h"
+
+#include "Logging.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace lib {
+    namespace {
+        constexpr unsigned BITS_PER_MASK = 64;
+
+        static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex word must be 32 bits");
+
+        std::uint32_t * futexWord(std::atomic<std::uint32_t> & word)
+        {
+            return reinterpret_cast<std::uint32_t *>(&word);
+        }
+    }
+
+    void ReadySignal::notify() const
+    {
+        bitmap->notify(bit);
+    }
+
+    ReadySignal ReadyBitmap::addProducer()
+    {
+        const unsigned index = producerCount++;
+        return ReadySignal {*this, std::uint64_t(1) << (index % BITS_PER_MASK)};
+    }
+
+    void ReadyBitmap::notify(std::uint64_t bit)
+    {
+        // if anything was already ready then whoever set it has already woken the consumer (or seen that it did not
+        // need to), and the consumer will take this bit along with it
+        if ((ready.fetch_or(bit, std::memory_order_seq_cst) == 0) && waiting.load(std::memory_order_seq_cst)) {
+            wakeups.fetch_add(1, std::memory_order_release);
+            syscall(SYS_futex, futexWord(wakeups), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+    }
+
+    std::uint64_t ReadyBitmap::wait()
+    {
+        while (true) {
+            const std::uint64_t result = waitOnce(nullptr);
+            if (result != 0) {
+                return result;
+            }
+        }
+    }
+
+    std::uint64_t ReadyBitmap::waitFor(std::chrono::nanoseconds timeout)
+    {
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        const struct timespec relative {
+            static_cast<time_t>(seconds.count()), static_cast<long>((timeout - seconds).count())
+        };
+        return waitOnce(&relative);
+    }
+
+    std::uint64_t ReadyBitmap::waitOnce(const struct timespec * timeout)
+    {
+        std::uint64_t result = ready.exchange(0, std::memory_order_acquire);
+        if (result != 0) {
+            return result;
+        }
+
+        // read the futex word before announcing that we are waiting, so that a wake after that is not missed
+        const std::uint32_t expected = wakeups.load(std::memory_order_acquire);
+        waiting.store(true, std::memory_order_seq_cst);
+
+        result = ready.exchange(0, std::memory_order_seq_cst);
+        if (result != 0) {
+            waiting.store(false, std::memory_order_relaxed);
+            return result;
+        }
+
+        if ((syscall(SYS_futex, futexWord(wakeups), FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0) != 0)
+            && (errno != EAGAIN) && (errno != EINTR) && (errno != ETIMEDOUT)) {
+            LOG_ERROR("futex wait failed: %d, (%s)", errno, strerror(errno));
+        }
+
+        waiting.store(false, std::memory_order_relaxed);
+        return ready.exchange(0, std::memory_order_acquire);
+    }
+}
@@ -0,0 +1,88 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef INCLUDE_LIB_READYBITMAP_H
+#define INCLUDE_LIB_READYBITMAP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+namespace lib {
+    class ReadyBitmap;
+
+    /**
+     * The handle that a producer uses to tell the consumer of a ReadyBitmap that it has something for it.
+     *
+     * It is cheap to copy, so may be shared by all the buffers that belong to one producer, but must not outlive the
+     * bitmap.
+     */
+    class ReadySignal {
+    public:
+        /** Mark the producer as ready, waking the consumer if it is waiting */
+        void notify() const;
+
+        /** @return The bit that is set in the result of ReadyBitmap::wait when this producer is ready */
+        [[nodiscard]] std::uint64_t mask() const { return bit; }
+
+    private:
+        friend class ReadyBitmap;
+
+        ReadyBitmap * bitmap;
+        std::uint64_t bit;
+
+        ReadySignal(ReadyBitmap & bitmap, std::uint64_t bit) : bitmap(&bitmap), bit(bit) {}
+    };
+
+    /**
+     * Lets a single consumer sleep until any of a number of producers has something for it, and then find out which.
+     *
+     * Each producer has a bit that it sets when it is ready; the consumer takes (and clears) all the set bits at once
+     * so that it only needs to visit the producers that are ready. The consumer sleeps on a futex, which producers
+     * only wake if it is actually waiting and nothing else has been made ready since it last looked, so repeated
+     * notifications between two waits cost no more than an atomic or.
+     *
+     * If there are more than 64 producers then some share a bit, so the consumer must check each of them.
+     */
+    class ReadyBitmap {
+    public:
+        ReadyBitmap() = default;
+
+        ReadyBitmap(const ReadyBitmap &) = delete;
+        ReadyBitmap & operator=(const ReadyBitmap &) = delete;
+        ReadyBitmap(ReadyBitmap &&) = delete;
+        ReadyBitmap & operator=(ReadyBitmap &&) = delete;
+        ~ReadyBitmap() = default;
+
+        /** Allocate the signal for a new producer (before any producer or the consumer is running) */
+        [[nodiscard]] ReadySignal addProducer();
+
+        /**
+         * Wait until at least one producer is ready
+         *
+         * @return The masks of the producers that became ready since the previous call, which is never zero
+         */
+        [[nodiscard]] std::uint64_t wait();
+
+        /**
+         * Wait until at least one producer is ready, or some time has passed
+         *
+         * @return As for wait, except that it is zero if no producer became ready in time
+         */
+        [[nodiscard]] std::uint64_t waitFor(std::chrono::nanoseconds timeout);
+
+    private:
+        friend class ReadySignal;
+
+        std::atomic<std::uint64_t> ready {0};
+        /** The futex word, which changes whenever a waiting consumer is woken */
+        std::atomic<std::uint32_t> wakeups {0};
+        std::atomic_bool waiting {false};
+        unsigned producerCount = 0;
+
+        void notify(std::uint64_t bit);
+        [[nodiscard]] std::uint64_t waitOnce(const struct timespec * timeout);
+    };
+}
+
+#endif // INCLUDE_LIB_READYBITMAP_H
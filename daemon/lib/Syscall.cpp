@@ -1,4 +1,4 @@
-/* Copyright (C) 2018-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2018-2023 by Arm Limited. All rights reserved. */
 
 #include "Syscall.h"
 
@@ -46,6 +46,8 @@ namespace lib {
 
     ssize_t read(int fd, void * buf, size_t count) { return ::read(fd, buf, count); }
 
+    ssize_t pread(int fd, void * buf, size_t count, off_t offset) { return ::pread(fd, buf, count, offset); }
+
     ssize_t write(int fd, const void * buf, size_t count) { return ::write(fd, buf, count); }
 
     int pipe2(std::array<int, 2> & fds, int flags) { return ::pipe2(fds.data(), flags); }
@@ -70,4 +72,6 @@ namespace lib {
     pid_t getppid() { return ::getppid(); }
     pid_t getpid() { return ::getpid(); }
     pid_t gettid() { return pid_t(syscall(__NR_gettid)); }
+
+    ssize_t getdents64(int fd, void * dirp, size_t count) { return syscall(__NR_getdents64, fd, dirp, count); }
 }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2018-2023 by Arm Limited. All rights reserved. */
 
 #ifndef INCLUDE_LIB_SYSCALL_H
 #define INCLUDE_LIB_SYSCALL_H
@@ -34,8 +34,12 @@ namespace lib {
     int accept4(int sockfd, struct sockaddr * addr, socklen_t * addrlen, int flags);
 
     ssize_t read(int fd, void * buf, size_t count);
+    ssize_t pread(int fd, void * buf, size_t count, off_t offset);
     ssize_t write(int fd, const void * buf, size_t count);
 
+    /** Read directory entries as struct linux_dirent64 records */
+    ssize_t getdents64(int fd, void * dirp, size_t count);
+
     int pipe2(std::array<int, 2> & fds, int flags);
 
     int uname(struct utsname * buf);
@@ -13,6 +13,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <string>
+#include <string_view>
 
 #include <fcntl.h>
 #include <pwd.h>
@@ -259,6 +261,20 @@ namespace lib {
         return 0;
     }
 
+    std::optional<std::uint64_t> readMemAvailable()
+    {
+        constexpr std::string_view memAvailable {"MemAvailable:"};
+
+        const auto contents = readFileContents(FsEntry::create("/proc/meminfo"));
+        const auto pos = contents.find(memAvailable);
+        if (pos == std::string::npos) {
+            return {};
+        }
+
+        // the value is in kB
+        return std::strtoull(contents.c_str() + pos + memAvailable.size(), nullptr, 10) << 10;
+    }
+
     bool isRootOrShell()
     {
         const uint32_t uid = lib::geteuid();
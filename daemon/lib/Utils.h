@@ -32,6 +32,9 @@ namespace lib {
     uint64_t roundDownToPowerOfTwo(uint64_t in);
     int calculatePerfMmapSizeInPages(const std::uint64_t perfEventMlockKb, const std::uint64_t pageSizeBytes);
 
+    /** @return The value of MemAvailable from /proc/meminfo in bytes, or nothing if it is not known */
+    std::optional<std::uint64_t> readMemAvailable();
+
     /**
     * @returns true if current uid is for Root or Android Shell, false otherwise
     */
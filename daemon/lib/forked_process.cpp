@@ -48,7 +48,8 @@ namespace lib {
         lib::Span<std::string const> args,
         boost::filesystem::path const & cwd,
         std::optional<std::pair<uid_t, gid_t>> const & uid_gid,
-        stdio_fds_t stdio_fds)
+        stdio_fds_t stdio_fds,
+        lib::Span<int const> inherited_fds)
     {
         prepend_command |= args.empty();
 
@@ -197,6 +198,13 @@ namespace lib {
             kill_self();
         }
 
+        // only this process inherits them, rather than anything else forked while they are not close-on-exec
+        for (auto fd : inherited_fds) {
+            if (fcntl(fd, F_SETFD, 0) != 0) {
+                CHILD_LOG_ERROR("Could not make fd %d inheritable, with errno %d", fd, errno);
+            }
+        }
+
         prctl(PR_SET_NAME, reinterpret_cast<unsigned long>(args_null_term[0]), 0, 0, 0);
         execvp(cmd.c_str(), args_null_term);
 
@@ -219,6 +227,8 @@ namespace lib {
             }
         }
 
+        execed = false;
+
         auto pid = std::exchange(this->pid, 0);
         if (pid > 0) {
             if (lib::kill(-pid, SIGTERM) == -1) {
@@ -232,7 +242,7 @@ namespace lib {
         AutoClosingFd exec_abort_write {std::move(this->exec_abort_write)};
 
         if (!exec_abort_write) {
-            return false;
+            return execed;
         }
 
         forked_process_t::exec_state_t exec = forked_process_t::exec_state_t::go;
@@ -250,6 +260,7 @@ namespace lib {
             }
         }
 
+        execed = true;
         return true;
     };
 }
@@ -39,7 +39,8 @@ namespace lib {
               stdout_read(std::move(that.stdout_read)),
               stderr_read(std::move(that.stderr_read)),
               exec_abort_write(std::move(that.exec_abort_write)),
-              pid(std::exchange(that.pid, 0))
+              pid(std::exchange(that.pid, 0)),
+              execed(std::exchange(that.execed, false))
         {
         }
 
@@ -52,6 +53,7 @@ namespace lib {
                 std::swap(this->stderr_read, tmp.stderr_read);
                 std::swap(this->exec_abort_write, tmp.exec_abort_write);
                 std::swap(this->pid, tmp.pid);
+                std::swap(this->execed, tmp.execed);
             }
             return *this;
         }
@@ -64,7 +66,7 @@ namespace lib {
         /** Abort the command that was execvp, send SIGTERM to the command and any children */
         void abort();
 
-        /** Will make the forked child process stop waiting and exec the command */
+        /** Will make the forked child process stop waiting and exec the command. Returns true if it already did. */
         [[nodiscard]] bool exec();
 
         /** @return the write end of the process's stdin (may be closed if not reading stdin, or moved out for use elsewhere) */
@@ -83,13 +85,15 @@ namespace lib {
          * Fork a process and returns the forked_process_t if created without any error. Returns errno in case of an error.
          * Child process forked will wait for a notification from the caller to start the commad
          * This is done by calling the exec() on forked_process_t created.
+         * The close-on-exec flag is cleared on @a inherited_fds in the child only, just before it execs the command.
          */
         static error_code_or_t<forked_process_t> fork_process(bool prepend_command,
                                                               std::string const & cmd,
                                                               lib::Span<std::string const> args,
                                                               boost::filesystem::path const & cwd,
                                                               std::optional<std::pair<uid_t, gid_t>> const & uid_gid,
-                                                              stdio_fds_t stdio_fds);
+                                                              stdio_fds_t stdio_fds,
+                                                              lib::Span<int const> inherited_fds = {});
 
         /** Constructor */
         forked_process_t(AutoClosingFd && stdin_write,
@@ -111,5 +115,6 @@ namespace lib {
         AutoClosingFd stderr_read;
         AutoClosingFd exec_abort_write;
         pid_t pid {0};
+        bool execed {false};
     };
 }
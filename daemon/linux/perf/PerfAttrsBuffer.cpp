@@ -11,7 +11,7 @@
 
 #include <cstring>
 
-PerfAttrsBuffer::PerfAttrsBuffer(const int size, sem_t & readerSem) : buffer(size, readerSem)
+PerfAttrsBuffer::PerfAttrsBuffer(const int size, lib::ReadySignal readerSignal) : buffer(size, readerSignal)
 {
     // fresh buffer will always have room for header
     // so no need to check space
@@ -10,7 +10,7 @@ struct perf_event_attr;
 
 class PerfAttrsBuffer : public IPerfAttrsConsumer {
 public:
-    PerfAttrsBuffer(int size, sem_t & readerSem);
+    PerfAttrsBuffer(int size, lib::ReadySignal readerSignal);
     ~PerfAttrsBuffer() override = default;
 
     // Intentionally unimplemented
@@ -21,6 +21,7 @@
 #include "linux/perf/IPerfGroups.h"
 #include "linux/perf/PerfAttrsBuffer.h"
 #include "linux/perf/PerfEventGroupIdentifier.h"
+#include "xml/EventsXML.h"
 #include "xml/PmuXML.h"
 
 #include <array>
@@ -251,7 +252,8 @@ PerfDriver::PerfDriver(PerfDriverConfiguration && configuration,
       mConfig(std::move(configuration)),
       mPmuXml(pmuXml),
       mCpuInfo(cpuInfo),
-      mDisableKernelAnnotations(disableKernelAnnotations)
+      mDisableKernelAnnotations(disableKernelAnnotations),
+      mRingbufferReserve(mConfig.config, int(cpuInfo.getNumberOfCores()))
 {
     static constexpr std::size_t buffer_size = 64;
 
@@ -526,32 +528,23 @@ void PerfDriver::addUncoreCounters(const PerfUncore & perfUncore)
     }
 }
 
-void PerfDriver::readEvents(mxml_node_t * const xml)
+void PerfDriver::readEvents(lib::Span<const events_xml::StaticEvent> events)
 {
-    mxml_node_t * node = xml;
-
     // Only for use with perf
     if (!getConfig().can_access_tracepoints) {
         return;
     }
 
-    while (true) {
-        node = mxmlFindElement(node, xml, "event", nullptr, nullptr, MXML_DESCEND);
-        if (node == nullptr) {
-            break;
-        }
-        const char * counter = mxmlElementGetAttr(node, "counter");
-        if (counter == nullptr) {
-            continue;
-        }
+    for (const auto & event : events) {
+        const char * counter = event.counter;
 
         if (strncmp(counter, "ftrace_", 7) != 0) {
             continue;
         }
 
-        const char * tracepoint = mxmlElementGetAttr(node, "tracepoint");
+        const char * tracepoint = event.tracepoint;
         if (tracepoint == nullptr) {
-            const char * regex = mxmlElementGetAttr(node, "regex");
+            const char * regex = event.regex;
             if (regex == nullptr) {
                 LOG_ERROR("The tracepoint counter %s is missing the required tracepoint attribute", counter);
                 handleException();
@@ -570,7 +563,7 @@ void PerfDriver::readEvents(mxml_node_t * const xml)
             continue;
         }
 
-        const char * arg = mxmlElementGetAttr(node, "arg");
+        const char * arg = event.arg;
 
         long long id = _getTracepointId(traceFsConstants, counter, tracepoint);
         if (id >= 0) {
@@ -11,12 +11,14 @@
 #include "linux/Tracepoints.h"
 #include "linux/perf/PerfConfig.h"
 #include "linux/perf/PerfDriverConfiguration.h"
+#include "linux/perf/PerfRingbufferReserve.h"
 
 #include <cstdint>
 #include <functional>
 #include <list>
 #include <memory>
 #include <set>
+#include <vector>
 
 static constexpr const char * SCHED_SWITCH = "sched/sched_switch";
 static constexpr const char * CPU_IDLE = "power/cpu_idle";
@@ -27,6 +29,7 @@ static constexpr const char * GATOR_COUNTER = "gator/gator_counter";
 static constexpr const char * GATOR_TEXT = "gator/gator_text";
 
 class Child;
+class DerivedMetrics;
 class ISummaryConsumer;
 class GatorCpu;
 class IPerfGroups;
@@ -68,7 +71,16 @@ public:
 
     const PerfConfig & getConfig() const { return mConfig.config; }
 
-    void readEvents(mxml_node_t * xml) override;
+    void preChildFork() override;
+    void postChildForkInChild() override;
+    void postChildExitInParent() override;
+    bool idleInParent() override;
+    std::uint64_t getChildInheritedStateGeneration() const override { return mRingbufferReserve.getGeneration(); }
+
+    /** @return The fds that the perf agent must inherit */
+    std::vector<int> getAgentInheritedFds() const { return mRingbufferReserve.getFds(); }
+
+    void readEvents(lib::Span<const events_xml::StaticEvent> events) override;
     int writeCounters(mxml_node_t * root) const override;
     std::optional<std::uint64_t> summary(ISummaryConsumer & consumer,
                                          const std::function<uint64_t()> & getMonotonicTime);
@@ -81,7 +93,7 @@ public:
 
     const TraceFsConstants & getTraceFsConstants() const { return traceFsConstants; };
 
-    std::shared_ptr<PrimarySource> create_source(sem_t & senderSem,
+    std::shared_ptr<PrimarySource> create_source(lib::ReadySignal senderSignal,
                                                  ISender & sender,
                                                  std::function<bool()> session_ended_callback,
                                                  std::function<void()> exec_target_app_callback,
@@ -89,6 +101,7 @@ public:
                                                  const std::set<int> & appTids,
                                                  FtraceDriver & ftraceDriver,
                                                  bool enableOnCommandExec,
+                                                 std::shared_ptr<const DerivedMetrics> derivedMetrics,
                                                  ICpuInfo & cpuInfo,
                                                  lib::Span<UncorePmu> uncore_pmus,
                                                  agents::agent_workers_process_t<Child> & agent_workers_process);
@@ -100,6 +113,7 @@ private:
     PmuXML mPmuXml;
     const ICpuInfo & mCpuInfo;
     bool mDisableKernelAnnotations;
+    PerfRingbufferReserve mRingbufferReserve;
 
     void addCpuCounters(const PerfCpu & cpu);
     void addUncoreCounters(const PerfUncore & uncore);
@@ -113,7 +127,7 @@ private:
 
     std::shared_ptr<agents::perf::perf_source_adapter_t> create_source_adapter(
         agents::agent_workers_process_t<Child> & agent_workers_process,
-        sem_t & senderSem,
+        lib::ReadySignal senderSignal,
         ISender & sender,
         std::function<bool()> session_ended_callback,
         std::function<void()> exec_target_app_callback,
@@ -122,7 +136,8 @@ private:
         lib::Span<UncorePmu> uncore_pmus,
         const perf_groups_configurer_state_t & perf_groups,
         const agents::perf::buffer_config_t & ringbuffer_config,
-        bool enable_on_exec);
+        bool enable_on_exec,
+        std::shared_ptr<const DerivedMetrics> const & derived_metrics);
 };
 
 #endif // PERFDRIVER_H
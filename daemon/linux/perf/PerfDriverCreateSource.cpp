@@ -75,9 +75,34 @@ namespace {
 
 }
 
+void PerfDriver::preChildFork()
+{
+    mRingbufferReserve.releaseUnderMemoryPressure();
+
+    // the buffer size only stays the same from one capture to the next when it is set by --mmap-pages
+    if (gSessionData.mPerfMmapSizeInPages > 0) {
+        mRingbufferReserve.reserve(create_perf_buffer_config());
+    }
+}
+
+void PerfDriver::postChildForkInChild()
+{
+    mRingbufferReserve.postChildForkInChild();
+}
+
+void PerfDriver::postChildExitInParent()
+{
+    mRingbufferReserve.releaseUnderMemoryPressure();
+}
+
+bool PerfDriver::idleInParent()
+{
+    return mRingbufferReserve.releaseUnderMemoryPressure();
+}
+
 /// this method is extracted so that it can be excluded from the unit tests as it brings deps on PerfSource...
 
-std::shared_ptr<PrimarySource> PerfDriver::create_source(sem_t & senderSem,
+std::shared_ptr<PrimarySource> PerfDriver::create_source(lib::ReadySignal senderSignal,
                                                          ISender & sender,
                                                          std::function<bool()> session_ended_callback,
                                                          std::function<void()> exec_target_app_callback,
@@ -85,11 +110,12 @@ std::shared_ptr<PrimarySource> PerfDriver::create_source(sem_t & senderSem,
                                                          const std::set<int> & appTids,
                                                          FtraceDriver & ftraceDriver,
                                                          bool enableOnCommandExec,
+                                                         std::shared_ptr<const DerivedMetrics> derivedMetrics,
                                                          ICpuInfo & cpuInfo,
                                                          lib::Span<UncorePmu> uncore_pmus,
                                                          agents::agent_workers_process_t<Child> & agent_workers_process)
 {
-    auto attrs_buffer = std::make_unique<PerfAttrsBuffer>(gSessionData.mTotalBufferSize * MEGABYTES, senderSem);
+    auto attrs_buffer = std::make_unique<PerfAttrsBuffer>(gSessionData.mTotalBufferSize * MEGABYTES, senderSignal);
 
     perf_event_group_configurer_config_t event_configurer_config {
         mConfig.config,
@@ -136,7 +162,7 @@ std::shared_ptr<PrimarySource> PerfDriver::create_source(sem_t & senderSem,
     attrs_buffer->write(sender);
 
     return create_source_adapter(agent_workers_process,
-                                 senderSem,
+                                 senderSignal,
                                  sender,
                                  std::move(session_ended_callback),
                                  std::move(exec_target_app_callback),
@@ -145,7 +171,8 @@ std::shared_ptr<PrimarySource> PerfDriver::create_source(sem_t & senderSem,
                                  uncore_pmus,
                                  event_configurer_state,
                                  create_perf_buffer_config(),
-                                 enableOnCommandExec);
+                                 enableOnCommandExec,
+                                 derivedMetrics);
 }
 
 [[nodiscard]] static bool wait_for_ready(std::optional<bool> const & ready_worker,
@@ -173,7 +200,7 @@ std::shared_ptr<PrimarySource> PerfDriver::create_source(sem_t & senderSem,
 
 std::shared_ptr<agents::perf::perf_source_adapter_t> PerfDriver::create_source_adapter(
     agents::agent_workers_process_t<Child> & agent_workers_process,
-    sem_t & senderSem,
+    lib::ReadySignal senderSignal,
     ISender & sender,
     std::function<bool()> session_ended_callback, // NOLINT(performance-unnecessary-value-param)
     std::function<void()> exec_target_app_callback,
@@ -182,7 +209,8 @@ std::shared_ptr<agents::perf::perf_source_adapter_t> PerfDriver::create_source_a
     lib::Span<UncorePmu> uncore_pmus,
     const perf_groups_configurer_state_t & perf_groups,
     const agents::perf::buffer_config_t & ringbuffer_config,
-    bool enable_on_exec)
+    bool enable_on_exec,
+    std::shared_ptr<const DerivedMetrics> const & derived_metrics)
 {
     auto cluster_keys_for_freq_counter = get_cpu_cluster_keys_for_cpu_frequency_counter();
 
@@ -224,7 +252,11 @@ std::shared_ptr<agents::perf::perf_source_adapter_t> PerfDriver::create_source_a
         }
     }
     agents::perf::add_pids(config_msg, app_tids);
+    agents::perf::add_ringbuffer_carriers(config_msg, mRingbufferReserve.getCarriers(ringbuffer_config));
     agents::perf::add_wait_for_process(config_msg, gSessionData.mWaitForProcessCommand);
+    if (derived_metrics != nullptr) {
+        agents::perf::add_derived_metrics(config_msg, *derived_metrics);
+    }
 
     // start the agent worker and tell it to communicate with the source adapter
     struct wait_state_t {
@@ -237,7 +269,7 @@ std::shared_ptr<agents::perf::perf_source_adapter_t> PerfDriver::create_source_a
     auto wait_state = std::make_shared<wait_state_t>();
 
     auto source = std::make_shared<agents::perf::perf_source_adapter_t>(
-        senderSem,
+        senderSignal,
         sender,
         [wait_state, &agent_workers_process](bool success, std::vector<pid_t> monitored_pids) {
             LOG_DEBUG("Received agent-ready notification, success=%u", success);
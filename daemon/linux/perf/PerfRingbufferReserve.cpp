@@ -0,0 +1,172 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "linux/perf/PerfRingbufferReserve.h"
+
+#include "Logging.h"
+#include "k/perf_event.h"
+#include "lib/Syscall.h"
+#include "lib/Utils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+void PerfRingbufferReserve::reserve(const agents::perf::buffer_config_t & bufferConfig)
+{
+    if (!mBuffers.empty()) {
+        if ((mBufferConfig.page_size == bufferConfig.page_size)
+            && (mBufferConfig.data_buffer_size == bufferConfig.data_buffer_size)) {
+            return;
+        }
+        release();
+    }
+
+    mBufferConfig = bufferConfig;
+
+    if (!fitsInMemoryLimit(std::size_t(mNumberOfCores) * getMappingLength())) {
+        LOG_DEBUG("Not reserving perf ring buffers as %d x %zu bytes would use too much of the available memory",
+                  mNumberOfCores,
+                  getMappingLength());
+        return;
+    }
+
+    for (int cpu = 0; cpu < mNumberOfCores; ++cpu) {
+        if (!reserveBuffer(cpu)) {
+            // an offline core just does not get a reserved buffer
+            LOG_DEBUG("Could not reserve a perf ring buffer for cpu %d", cpu);
+        }
+    }
+
+    if (!mBuffers.empty()) {
+        ++mGeneration;
+    }
+
+    LOG_DEBUG("Reserved %zu perf ring buffers of %zu bytes", mBuffers.size(), getMappingLength());
+}
+
+bool PerfRingbufferReserve::releaseUnderMemoryPressure()
+{
+    if (mBuffers.empty()) {
+        return false;
+    }
+
+    if (!fitsInMemoryLimit(mBuffers.size() * getMappingLength())) {
+        LOG_DEBUG("Releasing the reserved perf ring buffers due to memory pressure");
+        release();
+    }
+
+    return !mBuffers.empty();
+}
+
+void PerfRingbufferReserve::release()
+{
+    if (mBuffers.empty()) {
+        return;
+    }
+
+    for (auto & [cpu, buffer] : mBuffers) {
+        if (mOwnsMappings) {
+            lib::munmap(buffer.mapping, getMappingLength());
+        }
+    }
+    mBuffers.clear();
+    ++mGeneration;
+}
+
+void PerfRingbufferReserve::postChildForkInChild()
+{
+    // perf mappings are VM_DONTCOPY, so the addresses may be reused by anything the child maps
+    mOwnsMappings = false;
+    for (auto & [cpu, buffer] : mBuffers) {
+        buffer.mapping = nullptr;
+    }
+}
+
+std::map<int, PerfRingbufferReserve::Carrier> PerfRingbufferReserve::getCarriers(
+    const agents::perf::buffer_config_t & bufferConfig) const
+{
+    std::map<int, Carrier> result {};
+
+    if ((mBufferConfig.page_size != bufferConfig.page_size)
+        || (mBufferConfig.data_buffer_size != bufferConfig.data_buffer_size)) {
+        return result;
+    }
+
+    for (const auto & [cpu, buffer] : mBuffers) {
+        result.emplace(cpu, Carrier {buffer.fd.get(), buffer.id});
+    }
+
+    return result;
+}
+
+std::vector<int> PerfRingbufferReserve::getFds() const
+{
+    std::vector<int> result {};
+    result.reserve(mBuffers.size());
+    for (const auto & [cpu, buffer] : mBuffers) {
+        result.push_back(buffer.fd.get());
+    }
+    return result;
+}
+
+bool PerfRingbufferReserve::fitsInMemoryLimit(std::size_t total) const
+{
+    const auto available = lib::readMemAvailable();
+    if (!available) {
+        // no way to tell if the memory is needed, so don't hold on to it
+        return false;
+    }
+
+    return total <= (*available / AVAILABLE_MEMORY_FRACTION);
+}
+
+bool PerfRingbufferReserve::reserveBuffer(int cpu)
+{
+    // the carrier only needs to agree with the header event on the things SET_OUTPUT checks, i.e. the clock
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_DUMMY;
+    attr.disabled = 1;
+    attr.exclude_kernel = (mConfig.exclude_kernel ? 1 : 0);
+    attr.exclude_hv = 1;
+    attr.use_clockid = mConfig.has_attr_clockid_support ? 1 : 0;
+    attr.clockid = mConfig.has_attr_clockid_support ? CLOCK_MONOTONIC_RAW : 0;
+
+    // without system-wide access, the event can only monitor gator-main itself, which is fine as it is never enabled
+    const int fd = lib::perf_event_open(&attr, (mConfig.is_system_wide ? -1 : 0), cpu, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0) {
+        LOG_DEBUG("perf_event_open failed for the ring buffer carrier on cpu %d (%d) %s", cpu, errno, strerror(errno));
+        return false;
+    }
+    lib::AutoClosingFd carrier {fd};
+
+    std::uint64_t id = 0;
+    //NOLINTNEXTLINE(hicpp-signed-bitwise) - PERF_EVENT_IOC_ID
+    if (lib::ioctl(fd, PERF_EVENT_IOC_ID, reinterpret_cast<unsigned long>(&id)) != 0) {
+        LOG_DEBUG("Reading the id of the ring buffer carrier on cpu %d failed (%d) %s", cpu, errno, strerror(errno));
+        return false;
+    }
+
+    // populate the mapping up front, so that the buffer is allocated and faulted in before the capture needs it
+    //NOLINTNEXTLINE(hicpp-signed-bitwise)
+    void * const mapping =
+        lib::mmap(nullptr, getMappingLength(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    if (mapping == MAP_FAILED) {
+        LOG_DEBUG("mmap failed for the ring buffer carrier on cpu %d (%d) %s", cpu, errno, strerror(errno));
+        return false;
+    }
+
+    // the buffer pages are already pinned by perf; this keeps the mapping itself resident too, where permitted
+    if (mlock(mapping, getMappingLength()) != 0) {
+        LOG_DEBUG("mlock failed for the ring buffer carrier on cpu %d (%d) %s", cpu, errno, strerror(errno));
+    }
+
+    mBuffers.emplace(cpu, Buffer {std::move(carrier), id, mapping});
+    return true;
+}
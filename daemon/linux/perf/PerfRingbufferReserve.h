@@ -0,0 +1,113 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef INCLUDE_LINUX_PERF_PERF_RINGBUFFER_RESERVE_H
+#define INCLUDE_LINUX_PERF_PERF_RINGBUFFER_RESERVE_H
+
+#include "agents/perf/record_types.h"
+#include "lib/AutoClosingFd.h"
+#include "linux/perf/PerfConfig.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * The perf data ring buffers that gator-main keeps between captures, so that each capture does not have to allocate,
+ * lock and fault in a new set of buffers.
+ *
+ * Each buffer belongs to a disabled dummy event (the carrier), which never produces any records. gator-main keeps the
+ * carrier fds and a mapping of each buffer, which is populated and locked when it is created. The perf agent inherits
+ * the carrier fds, maps the same buffers (which the kernel shares rather than allocating new ones) and redirects its
+ * header events into them.
+ *
+ * The buffers are only reserved when the size is fixed by --mmap-pages, as otherwise it depends on the buffer mode of
+ * each capture. The whole reserve is bounded by a fraction of the available memory, and is released when it no longer
+ * fits (i.e. under memory pressure); it is reserved again before the next capture if there is room.
+ */
+class PerfRingbufferReserve {
+public:
+    /** A carrier event, as passed to the perf agent */
+    struct Carrier {
+        int fd;
+        std::uint64_t id;
+    };
+
+    /** The reserve may use at most 1/N of the available memory */
+    static constexpr std::uint64_t AVAILABLE_MEMORY_FRACTION = 4;
+
+    /**
+     * Constructor
+     *
+     * @param config The perf config, which decides how the carrier events are created
+     * @param numberOfCores The number of cores to reserve a buffer for
+     */
+    PerfRingbufferReserve(const PerfConfig & config, int numberOfCores) : mConfig(config), mNumberOfCores(numberOfCores)
+    {
+    }
+
+    ~PerfRingbufferReserve() { release(); }
+
+    // Intentionally undefined
+    PerfRingbufferReserve(const PerfRingbufferReserve &) = delete;
+    PerfRingbufferReserve & operator=(const PerfRingbufferReserve &) = delete;
+    PerfRingbufferReserve(PerfRingbufferReserve &&) = delete;
+    PerfRingbufferReserve & operator=(PerfRingbufferReserve &&) = delete;
+
+    /**
+     * Reserve the buffers for some configuration (in gator-main), replacing any that were reserved for a different
+     * configuration. Nothing is reserved if the buffers would not fit in the memory limit.
+     */
+    void reserve(const agents::perf::buffer_config_t & bufferConfig);
+
+    /**
+     * Release the buffers if they no longer fit in the memory limit
+     *
+     * @return True if buffers are still reserved
+     */
+    bool releaseUnderMemoryPressure();
+
+    /** Release all the buffers */
+    void release();
+
+    /**
+     * Called in gator-child after it is forked. The mappings are not inherited by the child, only the carrier fds,
+     * which are kept to pass to the perf agent.
+     */
+    void postChildForkInChild();
+
+    /** @return The carriers by cpu, if they were reserved for this configuration */
+    [[nodiscard]] std::map<int, Carrier> getCarriers(const agents::perf::buffer_config_t & bufferConfig) const;
+
+    /** @return The carrier fds, which the perf agent must inherit */
+    [[nodiscard]] std::vector<int> getFds() const;
+
+    /**
+     * @return A number that changes whenever the buffers are released or replaced. A forked gator-child (and its
+     * agents) keeps its own copies of the carrier fds, and so keeps the old buffers allocated until it exits.
+     */
+    [[nodiscard]] std::uint64_t getGeneration() const { return mGeneration; }
+
+private:
+    struct Buffer {
+        lib::AutoClosingFd fd;
+        std::uint64_t id;
+        void * mapping;
+    };
+
+    const PerfConfig & mConfig;
+    int mNumberOfCores;
+    agents::perf::buffer_config_t mBufferConfig {0, 0, 0};
+    std::map<int, Buffer> mBuffers {};
+    bool mOwnsMappings {true};
+    std::uint64_t mGeneration {0};
+
+    [[nodiscard]] std::size_t getMappingLength() const
+    {
+        return mBufferConfig.page_size + mBufferConfig.data_buffer_size;
+    }
+    [[nodiscard]] bool fitsInMemoryLimit(std::size_t total) const;
+    [[nodiscard]] bool reserveBuffer(int cpu);
+};
+
+#endif // INCLUDE_LINUX_PERF_PERF_RINGBUFFER_RESERVE_H
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #include "linux/proc/ProcessPollerBase.h"
 
@@ -6,9 +6,9 @@
 #include "lib/Format.h"
 #include "lib/FsEntry.h"
 #include "lib/String.h"
+#include "linux/proc/ProcessScanner.h"
 
 #include <cctype>
-#include <cstdlib>
 #include <string>
 
 namespace lnx {
@@ -202,95 +202,28 @@ namespace lnx {
 
     void ProcessPollerBase::poll(bool wantThreads, bool wantStats, IProcessPollerReceiver & receiver)
     {
-        // scan directory /proc for all pid files
-        lib::FsEntryDirectoryIterator iterator = procDir.children();
+        // the directories are read (possibly in parallel) first, then passed to the receiver in order of pid/tid
+        for (const auto & process : scanProcesses(procDir, wantThreads, wantStats)) {
+            const lib::FsEntry pidDirectory = lib::FsEntry::create(procDir, std::to_string(process.pid));
 
-        while (std::optional<lib::FsEntry> entry = iterator.next()) {
-            if (isPidDirectory(*entry)) {
-                processPidDirectory(wantThreads, wantStats, receiver, *entry);
-            }
-        }
-    }
-
-    void ProcessPollerBase::processPidDirectory(bool wantThreads,
-                                                bool wantStats,
-                                                IProcessPollerReceiver & receiver,
-                                                const lib::FsEntry & entry)
-    {
-        const auto name = entry.name();
-        const auto exe_path = getProcessExePath(entry);
-
-        // read the pid
-        const long pid = std::strtol(name.c_str(), nullptr, 0);
-
-        // call the receiver object
-        receiver.onProcessDirectory(pid, entry);
-
-        // process threads?
-        if (wantThreads || wantStats) {
-            // the /proc/[PID]/task directory
-            const lib::FsEntry task_directory = lib::FsEntry::create(entry, "task");
-
-            // the /proc/[PID]/task/[PID]/ directory
-            const lib::FsEntry task_pid_directory = lib::FsEntry::create(task_directory, name);
-            const lib::FsEntry::Stats task_pid_directory_stats = task_pid_directory.read_stats();
-
-            // if for some reason taskPidDirectory does not exist, then use stat and statm in the procPid directory instead
-            if ((!task_pid_directory_stats.exists()) || (task_pid_directory_stats.type() != lib::FsEntry::Type::DIR)) {
-                processTidDirectory(wantStats, receiver, pid, entry, exe_path);
-            }
-
-            // scan all the TIDs in the task directory
-            lib::FsEntryDirectoryIterator task_iterator = task_directory.children();
-
-            while (std::optional<lib::FsEntry> task_entry = task_iterator.next()) {
-                if (isPidDirectory(*task_entry)) {
-                    processTidDirectory(wantStats, receiver, pid, *task_entry, exe_path);
-                }
-            }
-        }
-    }
-
-    void ProcessPollerBase::processTidDirectory(bool wantStats,
-                                                IProcessPollerReceiver & receiver,
-                                                const int pid,
-                                                const lib::FsEntry & entry,
-                                                const std::optional<std::string> & exe)
-    {
-        const long tid = std::strtol(entry.name().c_str(), nullptr, 0);
-
-        // call the receiver object
-        receiver.onThreadDirectory(pid, tid, entry);
+            // call the receiver object
+            receiver.onProcessDirectory(process.pid, pidDirectory);
 
-        // process stats?
-        if (wantStats) {
-            std::optional<ProcPidStatmFileRecord> statm_file_record {ProcPidStatmFileRecord()};
+            const lib::FsEntry taskDirectory = lib::FsEntry::create(pidDirectory, "task");
 
-            // open /proc/[PID]/statm
-            {
-                const lib::FsEntry statm_file = lib::FsEntry::create(entry, "statm");
-                const lib::FsEntry::Stats statm_file_stats = statm_file.read_stats();
+            for (const auto & thread : process.threads) {
+                const lib::FsEntry threadDirectory =
+                    (thread.inTaskDirectory ? lib::FsEntry::create(taskDirectory, std::to_string(thread.tid))
+                                            : pidDirectory);
 
-                if (statm_file_stats.exists() && statm_file_stats.type() == lib::FsEntry::Type::FILE) {
-                    const std::string statm_file_contents = lib::readFileContents(statm_file);
+                receiver.onThreadDirectory(process.pid, thread.tid, threadDirectory);
 
-                    if (!ProcPidStatmFileRecord::parseStatmFile(*statm_file_record, statm_file_contents.c_str())) {
-                        statm_file_record.reset();
-                    }
-                }
-            }
-
-            // open /proc/[PID]/stat
-            {
-                const lib::FsEntry stat_file = lib::FsEntry::create(entry, "stat");
-                const lib::FsEntry::Stats stat_file_stats = stat_file.read_stats();
-
-                if (stat_file_stats.exists() && stat_file_stats.type() == lib::FsEntry::Type::FILE) {
-                    const std::string stat_file_contents = lib::readFileContents(stat_file);
-                    ProcPidStatFileRecord stat_file_record;
-                    if (ProcPidStatFileRecord::parseStatFile(stat_file_record, stat_file_contents.c_str())) {
-                        receiver.onThreadDetails(pid, tid, stat_file_record, statm_file_record, exe);
-                    }
+                if (thread.statRecord) {
+                    receiver.onThreadDetails(process.pid,
+                                             thread.tid,
+                                             *thread.statRecord,
+                                             thread.statmRecord,
+                                             process.exe);
                 }
             }
         }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #ifndef INCLUDE_LINUX_PROC_PROCESSPOLLERBASE_H
 #define INCLUDE_LINUX_PROC_PROCESSPOLLERBASE_H
@@ -48,16 +48,6 @@ namespace lnx {
 
     private:
         lib::FsEntry procDir;
-
-        static void processPidDirectory(bool wantThreads,
-                                        bool wantStats,
-                                        IProcessPollerReceiver & receiver,
-                                        const lib::FsEntry & entry);
-        static void processTidDirectory(bool wantStats,
-                                        IProcessPollerReceiver & receiver,
-                                        int pid,
-                                        const lib::FsEntry & entry,
-                                        const std::optional<std::string> & exe);
     };
 
     /**
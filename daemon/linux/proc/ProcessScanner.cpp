@@ -0,0 +1,214 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "linux/proc/ProcessScanner.h"
+
+#include "Logging.h"
+#include "lib/AutoClosingFd.h"
+#include "lib/Syscall.h"
+#include "linux/proc/ProcessPollerBase.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+
+namespace lnx {
+    namespace {
+        /** The most threads (including the caller) that a scan is shared between */
+        constexpr std::size_t MAX_WORKERS = 8;
+        /** Don't bother starting another worker for fewer than this many processes */
+        constexpr std::size_t MIN_PROCESSES_PER_WORKER = 32;
+        /** Enough for a few thousand entries per getdents64 call */
+        constexpr std::size_t DIRENT_BUFFER_SIZE = 32 * 1024;
+
+        // The layout of struct linux_dirent64, which is not provided by all libcs
+        constexpr std::size_t DIRENT_RECLEN_OFFSET = 16;
+        constexpr std::size_t DIRENT_TYPE_OFFSET = 18;
+        constexpr std::size_t DIRENT_NAME_OFFSET = 19;
+
+        /** @return The value of a name that is only digits, or -1 if it is anything else */
+        int parseNumberedName(const char * name)
+        {
+            if (*name == '\0') {
+                return -1;
+            }
+
+            int result = 0;
+            for (; *name != '\0'; ++name) {
+                if ((*name < '0') || (*name > '9')) {
+                    return -1;
+                }
+                result = (result * 10) + (*name - '0');
+            }
+            return result;
+        }
+
+        /** Read the whole of a (small) proc file, or nothing if it could not be opened */
+        std::optional<std::string> readProcFile(const std::string & path)
+        {
+            lib::AutoClosingFd fd {lib::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (!fd) {
+                return {};
+            }
+
+            std::string result {};
+            std::array<char, 1024> buffer {};
+            while (true) {
+                auto const n = lib::read(fd.get(), buffer.data(), buffer.size());
+                if (n <= 0) {
+                    break;
+                }
+                result.append(buffer.data(), std::size_t(n));
+            }
+            return result;
+        }
+
+        void readProcess(const lib::FsEntry & procDir, ProcessScanResult & process, bool wantStats)
+        {
+            const auto pidName = std::to_string(process.pid);
+            const auto pidDirectory = lib::FsEntry::create(procDir, pidName);
+            const auto pidPath = pidDirectory.path();
+            const auto taskPath = pidPath + "/task";
+
+            if (wantStats) {
+                process.exe = getProcessExePath(pidDirectory);
+            }
+
+            const auto tids = readNumberedDirectories(taskPath);
+
+            // if for some reason /proc/[PID]/task/[PID] does not exist, then use stat and statm in /proc/[PID] instead
+            if (!std::binary_search(tids.begin(), tids.end(), process.pid)) {
+                process.threads.emplace_back(readThreadDirectory(pidPath, process.pid, false, wantStats));
+            }
+
+            for (const int tid : tids) {
+                process.threads.emplace_back(
+                    readThreadDirectory(taskPath + "/" + std::to_string(tid), tid, true, wantStats));
+            }
+        }
+    }
+
+    ThreadScanResult readThreadDirectory(const std::string & path, int tid, bool inTaskDirectory, bool wantStats)
+    {
+        ThreadScanResult result {tid, inTaskDirectory, {}, {}};
+
+        if (!wantStats) {
+            return result;
+        }
+
+        // statm is passed as a default value if it does not exist, but not if it exists and is invalid
+        result.statmRecord.emplace();
+        if (auto contents = readProcFile(path + "/statm")) {
+            if (!ProcPidStatmFileRecord::parseStatmFile(*result.statmRecord, contents->c_str())) {
+                result.statmRecord.reset();
+            }
+        }
+
+        if (auto contents = readProcFile(path + "/stat")) {
+            ProcPidStatFileRecord statRecord;
+            if (ProcPidStatFileRecord::parseStatFile(statRecord, contents->c_str())) {
+                result.statRecord = std::move(statRecord);
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<int> readNumberedDirectories(const std::string & path)
+    {
+        std::vector<int> result {};
+
+        lib::AutoClosingFd fd {lib::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!fd) {
+            return result;
+        }
+
+        std::vector<char> buffer(DIRENT_BUFFER_SIZE);
+
+        while (true) {
+            auto const n = lib::getdents64(fd.get(), buffer.data(), buffer.size());
+            if (n <= 0) {
+                if (n < 0) {
+                    LOG_DEBUG("getdents64 failed for %s (%d)", path.c_str(), errno);
+                }
+                break;
+            }
+
+            for (std::size_t offset = 0; offset < std::size_t(n);) {
+                const char * record = buffer.data() + offset;
+
+                std::uint16_t reclen;
+                std::memcpy(&reclen, record + DIRENT_RECLEN_OFFSET, sizeof(reclen));
+                const auto type = static_cast<unsigned char>(record[DIRENT_TYPE_OFFSET]);
+
+                if ((type == DT_DIR) || (type == DT_UNKNOWN)) {
+                    const int number = parseNumberedName(record + DIRENT_NAME_OFFSET);
+                    if (number >= 0) {
+                        result.push_back(number);
+                    }
+                }
+
+                offset += reclen;
+            }
+        }
+
+        std::sort(result.begin(), result.end());
+
+        return result;
+    }
+
+    std::vector<ProcessScanResult> scanProcesses(const lib::FsEntry & procDir, bool wantThreads, bool wantStats)
+    {
+        std::vector<ProcessScanResult> result {};
+
+        for (const int pid : readNumberedDirectories(procDir.path())) {
+            result.push_back(ProcessScanResult {pid, {}, {}});
+        }
+
+        if ((!wantThreads) && (!wantStats)) {
+            return result;
+        }
+
+        // each worker takes the next unread process until there are none left; as each writes to a different element
+        // of result, the order is unaffected
+        std::atomic<std::size_t> nextIndex {0};
+        auto worker = [&]() {
+            for (auto index = nextIndex++; index < result.size(); index = nextIndex++) {
+                readProcess(procDir, result[index], wantStats);
+            }
+        };
+
+        const auto numberOfWorkers =
+            std::clamp<std::size_t>(std::min<std::size_t>(std::thread::hardware_concurrency(),
+                                                          result.size() / MIN_PROCESSES_PER_WORKER),
+                                    1,
+                                    MAX_WORKERS);
+
+        std::vector<std::thread> threads {};
+        for (std::size_t n = 1; n < numberOfWorkers; ++n) {
+            try {
+                threads.emplace_back(worker);
+            }
+            catch (const std::system_error & ex) {
+                // just carry on with fewer workers
+                LOG_DEBUG("Could not start process scan worker: %s", ex.what());
+                break;
+            }
+        }
+
+        worker();
+
+        for (auto & thread : threads) {
+            thread.join();
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,73 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef INCLUDE_LINUX_PROC_PROCESSSCANNER_H
+#define INCLUDE_LINUX_PROC_PROCESSSCANNER_H
+
+#include "lib/FsEntry.h"
+#include "linux/proc/ProcPidStatFileRecord.h"
+#include "linux/proc/ProcPidStatmFileRecord.h"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lnx {
+    /**
+     * The result of reading one /proc/[PID]/task/[TID] directory (or /proc/[PID] if the process has no task directory)
+     */
+    struct ThreadScanResult {
+        int tid;
+        /** True if read from /proc/[PID]/task/[TID], false if read from /proc/[PID] */
+        bool inTaskDirectory;
+        /** The contents of stat, if stats were requested and it could be read */
+        std::optional<ProcPidStatFileRecord> statRecord;
+        /** The contents of statm, if stats were requested */
+        std::optional<ProcPidStatmFileRecord> statmRecord;
+    };
+
+    /**
+     * The result of reading one /proc/[PID] directory
+     */
+    struct ProcessScanResult {
+        int pid;
+        /** The exe path, if stats were requested; empty for kernel threads */
+        std::optional<std::string> exe;
+        /** The threads in ascending order of tid, if threads or stats were requested */
+        std::vector<ThreadScanResult> threads;
+    };
+
+    /**
+     * Read the names of the numbered sub-directories of some directory (e.g. the pids in /proc) using getdents64, which
+     * provides the type of each entry so that they need not be stat'd
+     *
+     * @return The numbers, in ascending order, or empty if the directory could not be read
+     */
+    std::vector<int> readNumberedDirectories(const std::string & path);
+
+    /**
+     * Read the stat and statm files of a single thread
+     *
+     * @param path The /proc/[PID]/task/[TID] (or /proc/[PID]) directory
+     * @param tid The thread id
+     * @param inTaskDirectory True if path is a task directory
+     * @param wantStats False to skip reading the files
+     */
+    ThreadScanResult readThreadDirectory(const std::string & path, int tid, bool inTaskDirectory, bool wantStats);
+
+    /**
+     * Read the /proc/[PID] directories, and optionally their threads and the stat/statm files for each thread.
+     *
+     * Reading the threads and their files is shared between a small number of worker threads, as on systems with many
+     * processes doing it serially can take longer than the interval between scans. The result is always in ascending
+     * order of pid, then tid, regardless of how the work was divided.
+     *
+     * @param procDir The /proc directory
+     * @param wantThreads True to list the threads of each process
+     * @param wantStats True to also read the stat and statm files for each thread, and the exe path for each process
+     * @return The processes, in ascending order of pid
+     */
+    std::vector<ProcessScanResult> scanProcesses(const lib::FsEntry & procDir, bool wantThreads, bool wantStats);
+}
+
+#endif /* INCLUDE_LINUX_PROC_PROCESSSCANNER_H */
@@ -13,7 +13,7 @@ namespace mali_userspace {
         LOG_DEBUG("GPU CLOCK POLLING '%s' for mali%d", mClockPath.c_str(), deviceNumber);
     }
 
-    void MaliGPUClockPolledDriver::readEvents(mxml_node_t * const /*root*/)
+    void MaliGPUClockPolledDriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
     {
         if (access(mClockPath.c_str(), R_OK) == 0) {
             LOG_SETUP("Mali GPU counters\nAccess %s is OK. GPU frequency counters available.", mClockPath.c_str());
@@ -29,7 +29,7 @@ namespace mali_userspace {
         MaliGPUClockPolledDriver(MaliGPUClockPolledDriver &&) = delete;
         MaliGPUClockPolledDriver & operator=(MaliGPUClockPolledDriver &&) = delete;
 
-        void readEvents(mxml_node_t * const /*root*/) override;
+        void readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/) override;
 
         int writeCounters(mxml_node_t * root) const override;
 
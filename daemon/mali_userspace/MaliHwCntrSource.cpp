@@ -28,26 +28,32 @@
 #include <utility>
 #include <vector>
 
-#include <semaphore.h>
 #include <sys/prctl.h>
 #include <unistd.h>
 
 namespace mali_userspace {
     class MaliHwCntrSource : public Source, public virtual IMaliDeviceCounterDumpCallback {
     public:
-        MaliHwCntrSource(sem_t & senderSem, MaliHwCntrDriver & driver) : mDriver(driver) { createTasks(senderSem); }
+        MaliHwCntrSource(lib::ReadySignal senderSignal,
+                         MaliHwCntrDriver & driver,
+                         const std::shared_ptr<const DerivedMetrics> & derivedMetrics)
+            : mDriver(driver)
+        {
+            createTasks(senderSignal, derivedMetrics);
+        }
 
-        void createTasks(sem_t & mSenderSem)
+        void createTasks(lib::ReadySignal senderSignal, const std::shared_ptr<const DerivedMetrics> & derivedMetrics)
         {
             for (const auto & pair : mDriver.getDevices()) {
                 const auto deviceNumber = static_cast<std::int32_t>(pair.first);
                 const MaliDevice & device = *pair.second;
 
                 // NOLINTNEXTLINE(readability-magic-numbers)
-                std::unique_ptr<Buffer> taskBuffer(new Buffer(gSessionData.mTotalBufferSize * 1024 * 1024, mSenderSem));
+                std::unique_ptr<Buffer> taskBuffer(
+                    new Buffer(gSessionData.mTotalBufferSize * 1024 * 1024, senderSignal));
 
                 std::unique_ptr<BlockCounterFrameBuilder> frameBuilder(
-                    new BlockCounterFrameBuilder(*taskBuffer, gSessionData.mLiveRate));
+                    new BlockCounterFrameBuilder(*taskBuffer, gSessionData.mLiveRate, derivedMetrics));
                 std::unique_ptr<MaliHwCntrTask> task(new MaliHwCntrTask(std::move(taskBuffer),
                                                                         std::move(frameBuilder),
                                                                         deviceNumber,
@@ -118,9 +124,11 @@ namespace mali_userspace {
         std::vector<std::unique_ptr<MaliHwCntrTask>> tasks {};
     };
 
-    std::shared_ptr<Source> createMaliHwCntrSource(sem_t & senderSem, MaliHwCntrDriver & driver)
+    std::shared_ptr<Source> createMaliHwCntrSource(lib::ReadySignal senderSignal,
+                                                   MaliHwCntrDriver & driver,
+                                                   std::shared_ptr<const DerivedMetrics> derivedMetrics)
     {
-        auto source = std::make_shared<MaliHwCntrSource>(senderSem, driver);
+        auto source = std::make_shared<MaliHwCntrSource>(senderSignal, driver, derivedMetrics);
         if (!source->prepare()) {
             return {};
         }
@@ -2,12 +2,16 @@
 
 #pragma once
 
+#include "lib/ReadyBitmap.h"
+
 #include <memory>
 
-#include <semaphore.h>
+class DerivedMetrics;
 class Source;
 
 namespace mali_userspace {
     class MaliHwCntrDriver;
-    std::shared_ptr<Source> createMaliHwCntrSource(sem_t & senderSem, MaliHwCntrDriver & driver);
+    std::shared_ptr<Source> createMaliHwCntrSource(lib::ReadySignal senderSignal,
+                                                   MaliHwCntrDriver & driver,
+                                                   std::shared_ptr<const DerivedMetrics> derivedMetrics);
 }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017-2021 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #include "non_root/GlobalStatsTracker.h"
 
@@ -65,11 +65,12 @@ namespace non_root {
         writeCounter(timestampNS, DeltaGlobalCounter::NUM_SOFTIRQ, numSoftIrq);
         writeCounter(timestampNS, DeltaGlobalCounter::NUM_FORKS, numForks);
 
-        const bool oneOneCoreStatsEntry = (perCoreStats.size() == 1);
-        for (auto & perCoreEntry : perCoreStats) {
-            if (oneOneCoreStatsEntry || (perCoreEntry.first != lnx::ProcStatFileRecord::GLOBAL_CPU_TIME_ID)) {
-                perCoreEntry.second.sendStats(timestampNS, handler, perCoreEntry.first);
-            }
+        // the aggregate is only sent if there are no per core entries
+        if (perCoreStats.empty() && globalCpuStats) {
+            globalCpuStats->sendStats(timestampNS, handler, lnx::ProcStatFileRecord::GLOBAL_CPU_TIME_ID);
+        }
+        for (auto perCoreEntry : perCoreStats) {
+            perCoreEntry.second.sendStats(timestampNS, handler, perCoreEntry.first);
         }
 
         first = false;
@@ -101,7 +102,15 @@ namespace non_root {
         }
 
         for (const auto & cpuTime : record.getCpus()) {
-            perCoreStats[cpuTime.cpu_id].updateFromProcStatFileRecordCpuTime(cpuTime);
+            if (cpuTime.cpu_id == lnx::ProcStatFileRecord::GLOBAL_CPU_TIME_ID) {
+                if (!globalCpuStats) {
+                    globalCpuStats.emplace();
+                }
+                globalCpuStats->updateFromProcStatFileRecordCpuTime(cpuTime);
+            }
+            else {
+                perCoreStats[cpuTime.cpu_id].updateFromProcStatFileRecordCpuTime(cpuTime);
+            }
         }
     }
 
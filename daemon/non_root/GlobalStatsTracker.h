@@ -1,14 +1,15 @@
-/* Copyright (C) 2017-2021 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #ifndef INCLUDE_NON_ROOT_GLOBALSTATSTRACKER_H
 #define INCLUDE_NON_ROOT_GLOBALSTATSTRACKER_H
 
+#include "lib/PerCoreArray.h"
 #include "linux/proc/ProcLoadAvgFileRecord.h"
 #include "linux/proc/ProcStatFileRecord.h"
 #include "non_root/CounterHelpers.h"
 #include "non_root/GlobalCounter.h"
 
-#include <map>
+#include <optional>
 
 namespace non_root {
     class GlobalStateChangeHandler;
@@ -57,7 +58,9 @@ namespace non_root {
         void updateFromProcStatFileRecord(const lnx::ProcStatFileRecord & record);
 
     private:
-        std::map<unsigned long, PerCoreStatsTracker> perCoreStats {};
+        lib::PerCoreArray<PerCoreStatsTracker> perCoreStats {};
+        /** The stats for the aggregate of all cores (i.e. GLOBAL_CPU_TIME_ID) */
+        std::optional<PerCoreStatsTracker> globalCpuStats {};
         AbsoluteCounter<unsigned long> loadavgOver1Minute {};
         AbsoluteCounter<unsigned long> loadavgOver5Minutes {};
         AbsoluteCounter<unsigned long> loadavgOver15Minutes {};
@@ -108,7 +108,7 @@ namespace non_root {
     {
     }
 
-    void NonRootDriver::readEvents(mxml_node_t * /*unused*/)
+    void NonRootDriver::readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/)
     {
         const double ticks_mult = 1.0 / sysconf(_SC_CLK_TCK);
 
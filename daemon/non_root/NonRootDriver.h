@@ -18,7 +18,7 @@ namespace non_root {
     public:
         NonRootDriver(PmuXML && pmuXml, lib::Span<const GatorCpu> clusters);
 
-        void readEvents(mxml_node_t * const /*unused*/) override;
+        void readEvents(lib::Span<const events_xml::StaticEvent> /*unused*/) override;
         void writeEvents(mxml_node_t * const /*unused*/) const override;
 
         std::map<NonRootCounter, int> getEnabledCounters() const;
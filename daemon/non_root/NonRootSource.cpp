@@ -1,4 +1,4 @@
-/* Copyright (C) 2017-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 #define BUFFER_USE_SESSION_DATA
 
 #include "non_root/NonRootSource.h"
@@ -10,16 +10,20 @@
 #include "Logging.h"
 #include "Protocol.h"
 #include "SessionData.h"
+#include "Time.h"
 #include "lib/String.h"
 #include "lib/Time.h"
 #include "non_root/GlobalPoller.h"
 #include "non_root/GlobalStateChangeHandler.h"
 #include "non_root/GlobalStatsTracker.h"
 #include "non_root/NonRootDriver.h"
+#include "non_root/ProcessLifecycleMonitor.h"
 #include "non_root/ProcessPoller.h"
 #include "non_root/ProcessStateChangeHandler.h"
 
+#include <cinttypes>
 #include <utility>
+#include <vector>
 
 #include <sys/prctl.h>
 #include <sys/utsname.h>
@@ -27,17 +31,18 @@
 
 namespace non_root {
     static constexpr std::size_t default_buffer_size = 1UL * 1024UL * 1024UL;
+    /** How many iterations between process scans, when every fork and exit is reported as it happens */
+    static constexpr unsigned lifecycle_process_scan_interval = 10;
 
     NonRootSource::NonRootSource(NonRootDriver & driver_,
-                                 sem_t & senderSem_,
+                                 lib::ReadySignal senderSignal_,
                                  std::function<void()> execTargetAppCallback_,
                                  std::function<void()> profilingStartedCallback_,
                                  const ICpuInfo & cpuInfo)
-        : mSwitchBuffers(default_buffer_size, senderSem_),
-          mGlobalCounterBuffer(default_buffer_size, senderSem_),
-          mProcessCounterBuffer(default_buffer_size, senderSem_),
-          mMiscBuffer(default_buffer_size, senderSem_),
-          interrupted(false),
+        : mSwitchBuffers(default_buffer_size, senderSignal_),
+          mGlobalCounterBuffer(default_buffer_size, senderSignal_),
+          mProcessCounterBuffer(default_buffer_size, senderSignal_),
+          mMiscBuffer(default_buffer_size, senderSignal_),
           timestampSource(CLOCK_MONOTONIC_RAW),
           driver(driver_),
           execTargetAppCallback(std::move(execTargetAppCallback_)),
@@ -47,7 +52,7 @@ namespace non_root {
     {
     }
 
-    void NonRootSource::run(std::uint64_t /* monotonicStarted */, std::function<void()> endSession)
+    void NonRootSource::run(std::uint64_t monotonicStarted, std::function<void()> endSession)
     {
         prctl(PR_SET_NAME, reinterpret_cast<unsigned long>(&"gatord-nrsrc"), 0, 0, 0);
 
@@ -74,13 +79,22 @@ namespace non_root {
         ProcessStateTracker processStateTracker(processChangeHandler, getBootTimeTicksBase(), clktck, pageSize);
         ProcessPoller processPoller(processStateTracker, timestampSource);
 
-        profilingStartedCallback();
-        execTargetAppCallback();
+        // short lived processes are only seen by the process scan if they are reported as they happen
+        auto lifecycleMonitor = ProcessLifecycleMonitor::create(timestampSource, gSessionData.mPids);
+        std::vector<ProcessLifecycleEvent> lifecycleEvents {};
+
+        // the scan is then only needed to update the per process stats, so need not run as often
+        const unsigned processScanInterval =
+            (lifecycleMonitor && lifecycleMonitor->reportsAllProcesses() ? lifecycle_process_scan_interval : 1);
 
-        const useconds_t sleepIntervalUs =
-            (gSessionData.mSampleRate < 1000 ? 10000 : 1000); // select 1ms or 10ms depending on normal or low rate
+        // poll at 1ms or 10ms depending on normal or low rate
+        const std::uint64_t pollIntervalNS = (gSessionData.mSampleRate < 1000 ? 10 * NS_PER_MS : NS_PER_MS);
+
+        scheduler.addTask(pollIntervalNS, [&](std::uint64_t /* tickTimeNS */, std::uint64_t missedTicks) {
+            if (missedTicks > 0) {
+                LOG_DEBUG("Too slow, missed %" PRIu64 " polls (nrsrc)", missedTicks);
+            }
 
-        while (!interrupted) {
             // check buffer not full
             if (gSessionData.mOneShot
                 && (mGlobalCounterBuffer.isFull() || mProcessCounterBuffer.isFull() || mMiscBuffer.isFull()
@@ -91,17 +105,31 @@ namespace non_root {
 
             // update global stats
             globalPoller.poll();
+        });
+
+        // update process stats; as both tasks have the same epoch this runs straight after every nth global poll
+        scheduler.addTask(pollIntervalNS * processScanInterval,
+                          [&](std::uint64_t /* tickTimeNS */, std::uint64_t /* missedTicks */) {
+                              processPoller.poll();
+                          });
+
+        if (lifecycleMonitor) {
+            for (const int fd : lifecycleMonitor->getFds()) {
+                scheduler.addFd(fd, [&, fd]() {
+                    lifecycleEvents.clear();
+                    lifecycleMonitor->read(lifecycleEvents);
+                    for (const auto & event : lifecycleEvents) {
+                        processPoller.processLifecycleEvent(event);
+                    }
+                    return lifecycleMonitor->isWatching(fd);
+                });
+            }
+        }
 
-            // update process stats
-            processPoller.poll();
-
-            // sleep an amount of time to align to the next 1 or 10 millisecond boundary depending on rate
-            const unsigned long long timestampNowUs =
-                (timestampSource.getTimestampNS() + 500) / 1000; // round to nearest uS
-            const useconds_t sleepUs = sleepIntervalUs - (timestampNowUs % sleepIntervalUs);
+        profilingStartedCallback();
+        execTargetAppCallback();
 
-            usleep(sleepUs);
-        }
+        scheduler.run(monotonicStarted);
 
         processCounterBuilder.flush();
         globalCounterBuilder.flush();
@@ -114,7 +142,7 @@ namespace non_root {
 
     void NonRootSource::interrupt()
     {
-        interrupted.store(true, std::memory_order_seq_cst);
+        scheduler.stop();
     }
 
     bool NonRootSource::write(ISender & sender)
@@ -1,18 +1,17 @@
-/* Copyright (C) 2017-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #ifndef INCLUDE_NON_ROOT_NONROOTSOURCE_H
 #define INCLUDE_NON_ROOT_NONROOTSOURCE_H
 
 #include "Buffer.h"
 #include "Source.h"
+#include "lib/PeriodicScheduler.h"
+#include "lib/ReadyBitmap.h"
 #include "lib/TimestampSource.h"
 #include "non_root/PerCoreMixedFrameBuffer.h"
 
-#include <atomic>
 #include <functional>
 
-#include <semaphore.h>
-
 class ICpuInfo;
 
 namespace non_root {
@@ -24,7 +23,7 @@ namespace non_root {
     class NonRootSource : public PrimarySource {
     public:
         NonRootSource(NonRootDriver & driver,
-                      sem_t & senderSem,
+                      lib::ReadySignal senderSignal,
                       std::function<void()> execTargetAppCallback,
                       std::function<void()> profilingStartedCallback,
                       const ICpuInfo & cpuInfo);
@@ -39,7 +38,7 @@ namespace non_root {
         Buffer mGlobalCounterBuffer;
         Buffer mProcessCounterBuffer;
         Buffer mMiscBuffer;
-        std::atomic<bool> interrupted;
+        lib::PeriodicScheduler scheduler;
         lib::TimestampSource timestampSource;
         NonRootDriver & driver;
         std::function<void()> execTargetAppCallback;
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017-2021 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 #define BUFFER_USE_SESSION_DATA
 
 #include "non_root/PerCoreMixedFrameBuffer.h"
@@ -8,14 +8,14 @@
 #include "SessionData.h"
 
 namespace non_root {
-    PerCoreMixedFrameBuffer::PerCoreMixedFrameBuffer(int bufferSize_, sem_t & readerSem_)
-        : readerSem(readerSem_), bufferSize(bufferSize_)
+    PerCoreMixedFrameBuffer::PerCoreMixedFrameBuffer(int bufferSize_, lib::ReadySignal readerSignal_)
+        : readerSignal(readerSignal_), bufferSize(bufferSize_)
     {
     }
 
     bool PerCoreMixedFrameBuffer::anyFull() const
     {
-        for (const auto & entry : buffers) {
+        for (auto entry : buffers) {
             if (entry.second && entry.second->bytesAvailable() <= 0) {
                 return true;
             }
@@ -26,7 +26,7 @@ namespace non_root {
 
     void PerCoreMixedFrameBuffer::setDone()
     {
-        for (auto & entry : buffers) {
+        for (auto entry : buffers) {
             if (entry.second) {
                 entry.second->setDone();
             }
@@ -36,7 +36,7 @@ namespace non_root {
     bool PerCoreMixedFrameBuffer::write(ISender & sender)
     {
         bool done = true;
-        for (auto & entry : buffers) {
+        for (auto entry : buffers) {
             if (entry.second) {
                 done &= entry.second->write(sender);
             }
@@ -51,7 +51,7 @@ namespace non_root {
         if (wrapperPtrRef == nullptr) {
             auto & bufferPtrRef = buffers[core];
             if (bufferPtrRef == nullptr) {
-                bufferPtrRef = std::make_unique<Buffer>(bufferSize, readerSem);
+                bufferPtrRef = std::make_unique<Buffer>(bufferSize, readerSignal);
             }
 
             wrapperPtrRef =
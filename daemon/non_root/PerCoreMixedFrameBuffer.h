@@ -1,16 +1,15 @@
-/* Copyright (C) 2017-2021 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #ifndef INCLUDE_NON_ROOT_PERCOREMIXEDFRAMEBUFFER_H
 #define INCLUDE_NON_ROOT_PERCOREMIXEDFRAMEBUFFER_H
 
 #include "Buffer.h"
+#include "lib/PerCoreArray.h"
+#include "lib/ReadyBitmap.h"
 #include "non_root/MixedFrameBuffer.h"
 
-#include <map>
 #include <memory>
 
-#include <semaphore.h>
-
 class ISender;
 
 namespace non_root {
@@ -18,7 +17,7 @@ namespace non_root {
     public:
         using core_type = unsigned long;
 
-        PerCoreMixedFrameBuffer(int bufferSize, sem_t & readerSem);
+        PerCoreMixedFrameBuffer(int bufferSize, lib::ReadySignal readerSignal);
 
         bool anyFull() const;
         void setDone();
@@ -27,9 +26,9 @@ namespace non_root {
         MixedFrameBuffer & operator[](core_type core);
 
     private:
-        std::map<core_type, std::unique_ptr<Buffer>> buffers {};
-        std::map<core_type, std::unique_ptr<MixedFrameBuffer>> wrappers {};
-        sem_t & readerSem;
+        lib::PerCoreArray<std::unique_ptr<Buffer>> buffers {};
+        lib::PerCoreArray<std::unique_ptr<MixedFrameBuffer>> wrappers {};
+        lib::ReadySignal readerSignal;
         int bufferSize;
     };
 }
@@ -0,0 +1,302 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#include "non_root/ProcessLifecycleMonitor.h"
+
+#include "Logging.h"
+#include "OlySocket.h"
+#include "lib/Syscall.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace non_root {
+    namespace {
+        /** How long to wait for the kernel to acknowledge the listen request */
+        constexpr int LISTEN_ACK_TIMEOUT_MS = 100;
+
+        constexpr std::size_t NETLINK_BUFFER_SIZE = 4096;
+
+        /** Send a PROC_CN_MCAST_LISTEN request */
+        bool sendListen(int fd)
+        {
+            constexpr std::size_t payloadSize = sizeof(cn_msg) + sizeof(proc_cn_mcast_op);
+
+            std::array<char, NLMSG_SPACE(payloadSize)> buffer {};
+
+            nlmsghdr header {};
+            header.nlmsg_len = NLMSG_LENGTH(payloadSize);
+            header.nlmsg_type = NLMSG_DONE;
+            std::memcpy(buffer.data(), &header, sizeof(header));
+
+            cn_msg message {};
+            message.id.idx = CN_IDX_PROC;
+            message.id.val = CN_VAL_PROC;
+            message.len = sizeof(proc_cn_mcast_op);
+            std::memcpy(NLMSG_DATA(buffer.data()), &message, sizeof(message));
+
+            const proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+            std::memcpy(static_cast<char *>(NLMSG_DATA(buffer.data())) + sizeof(cn_msg), &op, sizeof(op));
+
+            return (send(fd, buffer.data(), header.nlmsg_len, 0) == ssize_t(header.nlmsg_len));
+        }
+
+        /**
+         * Call op with each proc_event in a datagram received from the proc connector
+         */
+        template<typename Op>
+        void forEachProcEvent(const char * buffer, ssize_t length, Op && op)
+        {
+            int remaining = int(length);
+            for (auto const * header = reinterpret_cast<const nlmsghdr *>(buffer); NLMSG_OK(header, remaining);
+                 header = NLMSG_NEXT(header, remaining)) {
+                if ((header->nlmsg_type == NLMSG_ERROR) || (header->nlmsg_type == NLMSG_NOOP)) {
+                    continue;
+                }
+
+                if (header->nlmsg_len < NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_event))) {
+                    continue;
+                }
+
+                proc_event event;
+                std::memcpy(&event, static_cast<const char *>(NLMSG_DATA(header)) + sizeof(cn_msg), sizeof(event));
+                op(event);
+            }
+        }
+
+        /** Open the proc connector, returning an invalid fd if it is not available to this user */
+        lib::AutoClosingFd openProcConnector()
+        {
+            lib::AutoClosingFd fd {socket_cloexec(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK, NETLINK_CONNECTOR)};
+            if (!fd) {
+                LOG_DEBUG("Socket failed for proc connector (%d - %s)", errno, strerror(errno));
+                return {};
+            }
+
+            sockaddr_nl sockaddr {};
+            sockaddr.nl_family = AF_NETLINK;
+            sockaddr.nl_groups = CN_IDX_PROC;
+            sockaddr.nl_pid = 0;
+            if (bind(fd.get(), reinterpret_cast<struct sockaddr *>(&sockaddr), sizeof(sockaddr)) != 0) {
+                LOG_DEBUG("Bind failed for proc connector (%d - %s)", errno, strerror(errno));
+                return {};
+            }
+
+            if (!sendListen(fd.get())) {
+                LOG_DEBUG("Send failed for proc connector (%d - %s)", errno, strerror(errno));
+                return {};
+            }
+
+            // the kernel replies with an ack, whose error is set if we are not permitted to listen
+            std::array<char, NETLINK_BUFFER_SIZE> buffer {};
+            pollfd pfd {fd.get(), POLLIN, 0};
+            while (lib::poll(&pfd, 1, LISTEN_ACK_TIMEOUT_MS) > 0) {
+                const auto length = recv(fd.get(), buffer.data(), buffer.size(), 0);
+                if (length <= 0) {
+                    break;
+                }
+
+                bool acked = false;
+                int error = 0;
+                forEachProcEvent(buffer.data(), length, [&](const proc_event & event) {
+                    if (event.what == proc_event::PROC_EVENT_NONE) {
+                        acked = true;
+                        error = int(event.event_data.ack.err);
+                    }
+                });
+
+                if (acked) {
+                    if (error != 0) {
+                        LOG_DEBUG("Proc connector listen was refused (%d - %s)", error, strerror(error));
+                        return {};
+                    }
+                    return fd;
+                }
+            }
+
+            LOG_DEBUG("Proc connector did not acknowledge listen");
+            return {};
+        }
+
+        lib::AutoClosingFd openPidfd(int pid)
+        {
+#ifdef __NR_pidfd_open
+            return lib::AutoClosingFd {int(syscall(__NR_pidfd_open, pid, 0))};
+#else
+            (void) pid;
+            errno = ENOSYS;
+            return {};
+#endif
+        }
+
+        unsigned long long getMonotonicNS()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+        }
+    }
+
+    std::unique_ptr<ProcessLifecycleMonitor> ProcessLifecycleMonitor::create(
+        const lib::TimestampSource & timestampSource,
+        const std::set<int> & pids)
+    {
+        auto netlinkFd = openProcConnector();
+
+        std::vector<WatchedProcess> watchedProcesses {};
+        if (!netlinkFd) {
+            for (const int pid : pids) {
+                auto pidfd = openPidfd(pid);
+                if (!pidfd) {
+                    LOG_DEBUG("Could not open pidfd for %d (%d - %s)", pid, errno, strerror(errno));
+                    continue;
+                }
+                watchedProcesses.push_back(WatchedProcess {std::move(pidfd), pid});
+            }
+        }
+
+        if ((!netlinkFd) && watchedProcesses.empty()) {
+            return {};
+        }
+
+        LOG_DEBUG("Receiving process lifecycle events from %s",
+                  (netlinkFd ? "the proc connector" : "pidfds of the target processes"));
+
+        return std::unique_ptr<ProcessLifecycleMonitor>(
+            new ProcessLifecycleMonitor(timestampSource, std::move(netlinkFd), std::move(watchedProcesses)));
+    }
+
+    ProcessLifecycleMonitor::ProcessLifecycleMonitor(const lib::TimestampSource & timestampSource,
+                                                     lib::AutoClosingFd netlinkFd,
+                                                     std::vector<WatchedProcess> watchedProcesses)
+        : timestampSource(timestampSource),
+          netlinkFd(std::move(netlinkFd)),
+          watchedProcesses(std::move(watchedProcesses))
+    {
+    }
+
+    std::vector<int> ProcessLifecycleMonitor::getFds() const
+    {
+        std::vector<int> result {};
+        if (netlinkFd) {
+            result.push_back(netlinkFd.get());
+        }
+        for (const auto & watchedProcess : watchedProcesses) {
+            result.push_back(watchedProcess.pidfd.get());
+        }
+        return result;
+    }
+
+    bool ProcessLifecycleMonitor::isWatching(int fd) const
+    {
+        if (netlinkFd.get() == fd) {
+            return true;
+        }
+        for (const auto & watchedProcess : watchedProcesses) {
+            if (watchedProcess.pidfd.get() == fd) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ProcessLifecycleMonitor::read(std::vector<ProcessLifecycleEvent> & events)
+    {
+        if (netlinkFd) {
+            readNetlink(events);
+        }
+        if (!watchedProcesses.empty()) {
+            readPidfds(events);
+        }
+    }
+
+    void ProcessLifecycleMonitor::readNetlink(std::vector<ProcessLifecycleEvent> & events)
+    {
+        // events are timestamped with CLOCK_MONOTONIC, so convert to the timestamp source's clock by their age
+        const unsigned long long nowNS = timestampSource.getTimestampNS();
+        const unsigned long long monotonicNowNS = getMonotonicNS();
+
+        auto convertTimestamp = [&](unsigned long long eventNS) -> unsigned long long {
+            const unsigned long long ageNS = (monotonicNowNS > eventNS ? monotonicNowNS - eventNS : 0);
+            return (nowNS > ageNS ? nowNS - ageNS : 0);
+        };
+
+        std::array<char, NETLINK_BUFFER_SIZE> buffer {};
+        while (true) {
+            const auto length = recv(netlinkFd.get(), buffer.data(), buffer.size(), MSG_DONTWAIT);
+            if (length <= 0) {
+                if ((length < 0) && (errno == ENOBUFS)) {
+                    // some events were dropped; the next full scan will find anything that was missed
+                    LOG_DEBUG("Proc connector overflowed");
+                    continue;
+                }
+                if ((length < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+                    LOG_DEBUG("recv failed for proc connector (%d - %s)", errno, strerror(errno));
+                }
+                break;
+            }
+
+            forEachProcEvent(buffer.data(), length, [&](const proc_event & event) {
+                const unsigned long long timestampNS = convertTimestamp(event.timestamp_ns);
+                switch (event.what) {
+                    case proc_event::PROC_EVENT_FORK:
+                        events.push_back(ProcessLifecycleEvent {ProcessLifecycleEvent::Type::FORK,
+                                                                timestampNS,
+                                                                int(event.event_data.fork.child_tgid),
+                                                                int(event.event_data.fork.child_pid)});
+                        break;
+                    case proc_event::PROC_EVENT_EXEC:
+                        events.push_back(ProcessLifecycleEvent {ProcessLifecycleEvent::Type::EXEC,
+                                                                timestampNS,
+                                                                int(event.event_data.exec.process_tgid),
+                                                                int(event.event_data.exec.process_pid)});
+                        break;
+                    case proc_event::PROC_EVENT_EXIT:
+                        events.push_back(ProcessLifecycleEvent {ProcessLifecycleEvent::Type::EXIT,
+                                                                timestampNS,
+                                                                int(event.event_data.exit.process_tgid),
+                                                                int(event.event_data.exit.process_pid)});
+                        break;
+                    default:
+                        break;
+                }
+            });
+        }
+    }
+
+    void ProcessLifecycleMonitor::readPidfds(std::vector<ProcessLifecycleEvent> & events)
+    {
+        std::vector<pollfd> pfds {};
+        for (const auto & watchedProcess : watchedProcesses) {
+            pfds.push_back(pollfd {watchedProcess.pidfd.get(), POLLIN, 0});
+        }
+
+        if (lib::poll(pfds.data(), pfds.size(), 0) <= 0) {
+            return;
+        }
+
+        // a pidfd becomes readable once the whole process has exited, but says nothing about when
+        const unsigned long long nowNS = timestampSource.getTimestampNS();
+
+        std::vector<WatchedProcess> stillRunning {};
+        for (std::size_t index = 0; index < watchedProcesses.size(); ++index) {
+            if ((pfds[index].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                stillRunning.push_back(std::move(watchedProcesses[index]));
+            }
+            else {
+                events.push_back(
+                    ProcessLifecycleEvent {ProcessLifecycleEvent::Type::EXIT, nowNS, watchedProcesses[index].pid, -1});
+            }
+        }
+        watchedProcesses = std::move(stillRunning);
+    }
+}
@@ -0,0 +1,88 @@
+/* Copyright (C) 2023 by Arm Limited. All rights reserved. */
+
+#ifndef INCLUDE_NON_ROOT_PROCESSLIFECYCLEMONITOR_H
+#define INCLUDE_NON_ROOT_PROCESSLIFECYCLEMONITOR_H
+
+#include "lib/AutoClosingFd.h"
+#include "lib/TimestampSource.h"
+
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace non_root {
+    /**
+     * A process or thread being created, exec'ing or exiting
+     */
+    struct ProcessLifecycleEvent {
+        enum class Type {
+            FORK,
+            EXEC,
+            EXIT,
+        };
+
+        Type type;
+        /** The time of the event, relative to the timestamp source */
+        unsigned long long timestampNS;
+        int pid;
+        /** The thread, or -1 for all the threads of pid */
+        int tid;
+    };
+
+    /**
+     * Receives process lifecycle events as they happen, so that they are seen even if the process does not live until
+     * the next /proc scan.
+     *
+     * The netlink proc connector is used when permitted (it requires CAP_NET_ADMIN), which reports every fork, exec and
+     * exit. Otherwise a pidfd is opened for each of the processes being profiled, which only reports their exit.
+     */
+    class ProcessLifecycleMonitor {
+    public:
+        /**
+         * Create the monitor
+         *
+         * @param timestampSource The source that event times are relative to
+         * @param pids The processes to watch if the proc connector is not available
+         * @return The monitor, or nullptr if neither source is available
+         */
+        static std::unique_ptr<ProcessLifecycleMonitor> create(const lib::TimestampSource & timestampSource,
+                                                               const std::set<int> & pids);
+
+        ProcessLifecycleMonitor(const ProcessLifecycleMonitor &) = delete;
+        ProcessLifecycleMonitor & operator=(const ProcessLifecycleMonitor &) = delete;
+        ProcessLifecycleMonitor(ProcessLifecycleMonitor &&) = delete;
+        ProcessLifecycleMonitor & operator=(ProcessLifecycleMonitor &&) = delete;
+        ~ProcessLifecycleMonitor() = default;
+
+        /** @return True if every fork and exit is reported, so that /proc need not be scanned as often */
+        bool reportsAllProcesses() const { return netlinkFd.get() >= 0; }
+
+        /** @return The file descriptors that become readable when there are events to read */
+        std::vector<int> getFds() const;
+
+        /** @return True if some file descriptor (from getFds) is still in use; pidfds are closed once they are read */
+        bool isWatching(int fd) const;
+
+        /** Read any events that are available, without blocking */
+        void read(std::vector<ProcessLifecycleEvent> & events);
+
+    private:
+        struct WatchedProcess {
+            lib::AutoClosingFd pidfd;
+            int pid;
+        };
+
+        const lib::TimestampSource & timestampSource;
+        lib::AutoClosingFd netlinkFd;
+        std::vector<WatchedProcess> watchedProcesses;
+
+        ProcessLifecycleMonitor(const lib::TimestampSource & timestampSource,
+                                lib::AutoClosingFd netlinkFd,
+                                std::vector<WatchedProcess> watchedProcesses);
+
+        void readNetlink(std::vector<ProcessLifecycleEvent> & events);
+        void readPidfds(std::vector<ProcessLifecycleEvent> & events);
+    };
+}
+
+#endif /* INCLUDE_NON_ROOT_PROCESSLIFECYCLEMONITOR_H */
@@ -1,7 +1,9 @@
-/* Copyright (C) 2017-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #include "non_root/ProcessPoller.h"
 
+#include "linux/proc/ProcessScanner.h"
+
 #include <optional>
 #include <string>
 
@@ -42,4 +44,39 @@ namespace non_root {
         ProcessStateTrackerActiveScanIProcessPollerReceiver receiver(*processScan);
         ProcessPollerBase::poll(true, true, receiver);
     }
+
+    void ProcessPoller::processLifecycleEvent(const ProcessLifecycleEvent & event)
+    {
+        switch (event.type) {
+            case ProcessLifecycleEvent::Type::FORK:
+            case ProcessLifecycleEvent::Type::EXEC: {
+                const std::string pidPath = "/proc/" + std::to_string(event.pid);
+                const auto thread =
+                    lnx::readThreadDirectory(pidPath + "/task/" + std::to_string(event.tid), event.tid, true, true);
+                // it has already exited, so cannot be reported
+                if (!thread.statRecord) {
+                    return;
+                }
+
+                // the exe is per process, so only look it up for the main thread
+                const auto exe = (event.pid == event.tid ? lnx::getProcessExePath(lib::FsEntry::create(pidPath))
+                                                         : std::optional<std::string> {});
+
+                processStateTracker.addCreatedThread(event.timestampNS,
+                                                     event.pid,
+                                                     event.tid,
+                                                     *thread.statRecord,
+                                                     thread.statmRecord,
+                                                     exe);
+                return;
+            }
+            case ProcessLifecycleEvent::Type::EXIT: {
+                processStateTracker.markExited(event.timestampNS, event.pid, event.tid);
+                return;
+            }
+            default: {
+                return;
+            }
+        }
+    }
 }
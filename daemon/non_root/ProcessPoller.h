@@ -1,4 +1,4 @@
-/* Copyright (C) 2017-2021 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #ifndef INCLUDE_NON_ROOT_PROCESSPOLLER_H
 #define INCLUDE_NON_ROOT_PROCESSPOLLER_H
@@ -6,6 +6,7 @@
 #include "lib/FsEntry.h"
 #include "lib/TimestampSource.h"
 #include "linux/proc/ProcessPollerBase.h"
+#include "non_root/ProcessLifecycleMonitor.h"
 #include "non_root/ProcessStateTracker.h"
 
 #include <optional>
@@ -20,6 +21,12 @@ namespace non_root {
         ProcessPoller(ProcessStateTracker & processStateTracker, lib::TimestampSource & timestampSource);
         void poll();
 
+        /**
+         * Pass a lifecycle event to the ProcessStateTracker, reading the stat and statm files of any new thread
+         * immediately so that it is recorded even if it exits before the next poll
+         */
+        void processLifecycleEvent(const ProcessLifecycleEvent & event);
+
     private:
         ProcessStateTracker & processStateTracker;
         lib::TimestampSource & timestampSource;
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #include "non_root/ProcessStateTracker.h"
 
@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <vector>
 
 namespace non_root {
     namespace {
@@ -24,11 +25,12 @@ namespace non_root {
     ProcessStateTracker::ActiveScan::ActiveScan(ProcessStateTracker & parent_, unsigned long long timestampNS_)
         : parent(parent_), timestampNS(timestampNS_)
     {
+        parent.coreScanStates.clear();
     }
 
     ProcessStateTracker::ActiveScan::~ActiveScan()
     {
-        parent.endScan(*this, accumulatedTimePerCore);
+        parent.endScan(*this);
     }
 
     void ProcessStateTracker::ActiveScan::addProcess(int pid,
@@ -41,7 +43,7 @@ namespace non_root {
         const unsigned long long processTimeDelta = parent.add(timestampNS, pid, tid, statRecord, statmRecord, exe);
 
         // update time accumulation
-        accumulatedTimePerCore[statRecord.getProcessor()] += processTimeDelta;
+        parent.coreScanStates[statRecord.getProcessor()].accumulatedTime += processTimeDelta;
     }
 
     ProcessStateTracker::ProcessInfo::ProcessInfo()
@@ -64,10 +66,14 @@ namespace non_root {
         : statsTracker(std::move(that.statsTracker)),
           startTimeNS(that.startTimeNS),
           parentPid(that.parentPid),
-          state(that.state)
+          state(that.state),
+          exitTimeNS(that.exitTimeNS),
+          exitSent(that.exitSent)
     {
         that.parentPid = PARENT_PID_UNKNOWN;
         that.state = State::EMPTY;
+        that.exitTimeNS.reset();
+        that.exitSent = false;
     }
 
     ProcessStateTracker::ProcessInfo & ProcessStateTracker::ProcessInfo::operator=(ProcessInfo && that) noexcept
@@ -76,9 +82,13 @@ namespace non_root {
         this->startTimeNS = that.startTimeNS;
         this->parentPid = that.parentPid;
         this->state = that.state;
+        this->exitTimeNS = that.exitTimeNS;
+        this->exitSent = that.exitSent;
 
         that.parentPid = PARENT_PID_UNKNOWN;
         that.state = State::EMPTY;
+        that.exitTimeNS.reset();
+        that.exitSent = false;
 
         return *this;
     }
@@ -180,10 +190,13 @@ namespace non_root {
     {
         const unsigned long long newStartTimestampNS =
             convertClkTicksToNS(statRecord.getStarttime(), bootTimeBaseNS, clktck);
-        const unsigned long long timestampToUse = std::min(timestampNS, newStartTimestampNS - 1);
+        const unsigned long long timestampToUse =
+            std::min(processInfo.getExitTimeNS().value_or(timestampNS), newStartTimestampNS - 1);
 
-        // send exit event
-        sendProcessExit(timestampToUse, processInfo);
+        // send exit event, unless already sent
+        if (!processInfo.isExitSent()) {
+            sendProcessExit(timestampToUse, processInfo);
+        }
 
         // create new
         processInfo = ProcessInfo(statRecord.getPgid(), statRecord.getPid(), pageSize, newStartTimestampNS);
@@ -210,12 +223,52 @@ namespace non_root {
         return processInfo.update(bootTimeBaseNS, clktck, statRecord, statmRecord, exe);
     }
 
+    void ProcessStateTracker::addCreatedThread(unsigned long long timestampNS,
+                                               int pid,
+                                               int tid,
+                                               const lnx::ProcPidStatFileRecord & statRecord,
+                                               const std::optional<lnx::ProcPidStatmFileRecord> & statmRecord,
+                                               const std::optional<std::string> & exe)
+    {
+        auto iterator = trackedProcesses.find(tid);
+        if (iterator != trackedProcesses.end()) {
+            if (!iterator->second.hasExited()) {
+                return;
+            }
+
+            // the tid was reused by a thread that has not yet been reported, so there is nothing to send for it
+            if (iterator->second.isNew()) {
+                trackedProcesses.erase(iterator);
+            }
+        }
+
+        // the time delta is always zero for a new thread, so there is nothing to accumulate
+        add(timestampNS, pid, tid, statRecord, statmRecord, exe);
+    }
+
+    void ProcessStateTracker::markExited(unsigned long long timestampNS, int pid, int tid)
+    {
+        if (tid >= 0) {
+            auto iterator = trackedProcesses.find(tid);
+            if (iterator != trackedProcesses.end()) {
+                iterator->second.setExited(timestampNS);
+            }
+            return;
+        }
+
+        for (auto & entry : trackedProcesses) {
+            if (entry.second.getPid() == pid) {
+                entry.second.setExited(timestampNS);
+            }
+        }
+    }
+
     /**
      * Generates events into the capture buffer based on the changes detected in the scan.
      * This process will:
      *   - send new-process events
      *   - update the various per-process counters
-     *   - send ended-process events
+     *   - send ended-process events (with the time of the exit, if a lifecycle event reported it)
      *   - generate *fake* scheduling data
      *
      * The process of generating fake scheduling data envolves (for each core) calculating the number of ticks spend by each process running (utime and stime deltas since last scan)
@@ -224,52 +277,61 @@ namespace non_root {
      * This is obviously incorrect with respect to the actual scheduling of processes on the system, but since it is not possible to observe the actual scheduling events, this at least allows Streamline
      * to display an approximately correct heatmap and core map view.
      */
-    void ProcessStateTracker::endScan(const ActiveScan & activeScan,
-                                      const std::map<unsigned long, unsigned long long> & accumulatedTimePerCore)
+    void ProcessStateTracker::endScan(const ActiveScan & activeScan)
     {
         runtime_assert(firstIteration || (activeScan.timestampNS > lastTimestampNS), "timestampNS <= lastTimestampNS");
 
         const unsigned long long scanDurationNS = (!firstIteration ? activeScan.timestampNS - lastTimestampNS : 0);
 
-        std::map<unsigned long, unsigned long long> relativeTimestampMap;
-        std::map<unsigned long, double> coreRunningTimeMultiplier;
-        std::map<unsigned long, double> coreTotalTimeMultiplier;
-
         const double hzToNs = (1e9 / clktck);
-        for (const auto & entry : accumulatedTimePerCore) {
-            if (entry.second > 0) {
-                const unsigned long long coreDurationTicks = entry.second;
+        for (auto entry : coreScanStates) {
+            auto & coreScanState = entry.second;
+            if (coreScanState.accumulatedTime > 0) {
+                const unsigned long long coreDurationTicks = coreScanState.accumulatedTime;
                 const unsigned long long coreDurationNs = coreDurationTicks * hzToNs;
-                const double multiplier = scanDurationNS / double(entry.second);
+                const double multiplier = scanDurationNS / double(coreScanState.accumulatedTime);
 
-                coreTotalTimeMultiplier[entry.first] = multiplier;
+                coreScanState.totalTimeMultiplier = multiplier;
 
                 if (coreDurationNs < scanDurationNS) {
                     // lest time spent on core than in scan...
                     // convert direct from ticks to ns, so that any remaining time is allocated to an idle gap
                     // so the capture will end up "[PROCESS..][IDLE][PROCESS.....][IDLE...]..."
-                    coreRunningTimeMultiplier[entry.first] = hzToNs;
+                    coreScanState.runningTimeMultiplier = hzToNs;
                 }
                 else {
                     // somehow the value is bigger than expected
                     // scale ticks down accoringly
                     // there will be no idles inserted
-                    coreRunningTimeMultiplier[entry.first] = multiplier;
+                    coreScanState.runningTimeMultiplier = multiplier;
                 }
             }
             else {
-                coreRunningTimeMultiplier[entry.first] = 0;
-                coreTotalTimeMultiplier[entry.first] = 0;
+                coreScanState.runningTimeMultiplier = 0;
+                coreScanState.totalTimeMultiplier = 0;
             }
         }
 
+        // exits with a known time are sent after the fake scheduling events, so that they can be placed after them
+        struct PendingExit {
+            unsigned long processor;
+            int tid;
+            unsigned long long timestampNS;
+        };
+        std::vector<PendingExit> pendingExits {};
+
         // iterate over all entries in the trackedProcesses map; if an entry is marked seen, then just emit any state changes
         // and mark it as unseen ready for the next scan, otherwise remove it and send the process ended state change
         auto iterator = trackedProcesses.begin();
         const auto end = trackedProcesses.end();
         while (iterator != end) {
             auto & processInfo = iterator->second;
-            if (processInfo.isSeenSinceLastScan()) {
+            if (processInfo.isSeenSinceLastScan() && processInfo.isExitSent()) {
+                // still visible after exiting (e.g. a zombie); there is nothing more to send
+                processInfo.setSeenSinceLastScan(false);
+                ++iterator;
+            }
+            else if (processInfo.isSeenSinceLastScan()) {
                 // send new event if required
                 if (processInfo.isNew()) {
                     handler.onNewProcess(processInfo.getStartTimeNS(),
@@ -288,12 +350,11 @@ namespace non_root {
                 bool shouldSendSchedEvent = (!firstIteration) && (!processInfo.isNew()) && (processRunningTime > 0);
 
                 // calculate fake timestamp for process
-                unsigned long long & relativeTimestampEntryRef = relativeTimestampMap[processInfo.getProcessor()];
+                auto & coreScanState = coreScanStates[processInfo.getProcessor()];
+                unsigned long long & relativeTimestampEntryRef = coreScanState.relativeTimestampNS;
                 const unsigned long long fakeTimestampNS = relativeTimestampEntryRef + lastTimestampNS;
-                const unsigned long long totalGapTimeNs =
-                    coreTotalTimeMultiplier[processInfo.getProcessor()] * processRunningTime;
-                const unsigned long long fakeRunningTimeNS =
-                    coreRunningTimeMultiplier[processInfo.getProcessor()] * processRunningTime;
+                const unsigned long long totalGapTimeNs = coreScanState.totalTimeMultiplier * processRunningTime;
+                const unsigned long long fakeRunningTimeNS = coreScanState.runningTimeMultiplier * processRunningTime;
                 // update fake timestamp tracker for core by some relative fraction of overall ticks
                 if (shouldSendSchedEvent) {
                     relativeTimestampEntryRef += std::max(fakeRunningTimeNS, totalGapTimeNs);
@@ -316,10 +377,21 @@ namespace non_root {
                     handler.idle(fakeTimestampNS + fakeRunningTimeNS, processInfo.getProcessor());
                 }
 
+                // the entry is kept (but not sent again) until a scan no longer sees it
+                if (processInfo.hasExited()) {
+                    pendingExits.push_back(
+                        PendingExit {processInfo.getProcessor(), processInfo.getTid(), *processInfo.getExitTimeNS()});
+                    processInfo.setExitSent();
+                }
+
                 ++iterator;
             }
             else {
-                if (!processInfo.isEmpty()) {
+                if (processInfo.hasExited() && !processInfo.isExitSent()) {
+                    pendingExits.push_back(
+                        PendingExit {processInfo.getProcessor(), processInfo.getTid(), *processInfo.getExitTimeNS()});
+                }
+                else if (!processInfo.isEmpty() && !processInfo.isExitSent()) {
                     // send process exit state change
                     sendProcessExit(activeScan.timestampNS, processInfo);
                 }
@@ -329,6 +401,16 @@ namespace non_root {
             }
         }
 
+        for (const auto & pendingExit : pendingExits) {
+            const auto * coreScanState = coreScanStates.find(pendingExit.processor);
+            const unsigned long long earliestNS =
+                lastTimestampNS + (coreScanState != nullptr ? coreScanState->relativeTimestampNS : 0);
+            const unsigned long long timestampNS =
+                std::min(std::max(pendingExit.timestampNS, earliestNS), activeScan.timestampNS);
+
+            handler.onExitProcess(timestampNS, pendingExit.processor, pendingExit.tid);
+        }
+
         // clear first iteration flag and save last value of timestampNS
         firstIteration = false;
         lastTimestampNS = activeScan.timestampNS;
@@ -1,11 +1,12 @@
-/* Copyright (C) 2017-2022 by Arm Limited. All rights reserved. */
+/* Copyright (C) 2017-2023 by Arm Limited. All rights reserved. */
 
 #ifndef INCLUDE_NON_ROOT_PROCESSSTATETRACKER_H
 #define INCLUDE_NON_ROOT_PROCESSSTATETRACKER_H
 
+#include "lib/FlatHashMap.h"
+#include "lib/PerCoreArray.h"
 #include "non_root/ProcessStatsTracker.h"
 
-#include <map>
 #include <memory>
 #include <optional>
 #include <string>
@@ -55,8 +56,6 @@ namespace non_root {
             /** Only ProcessStateTracker can construct */
             friend class ProcessStateTracker;
 
-            // sum up all time per core spent in system and user for all processes
-            std::map<unsigned long, unsigned long long> accumulatedTimePerCore {};
             ProcessStateTracker & parent;
             unsigned long long timestampNS;
 
@@ -74,6 +73,27 @@ namespace non_root {
          */
         std::unique_ptr<ProcessStateTracker::ActiveScan> beginScan(unsigned long long timestampNS);
 
+        /**
+         * Start tracking a thread that was created (or exec'd) since the last scan, so that it is reported even if it
+         * exits before the next scan. Does nothing if the thread is already tracked; the next scan will update it.
+         */
+        void addCreatedThread(unsigned long long timestampNS,
+                              int pid,
+                              int tid,
+                              const lnx::ProcPidStatFileRecord & statRecord,
+                              const std::optional<lnx::ProcPidStatmFileRecord> & statmRecord,
+                              const std::optional<std::string> & exe);
+
+        /**
+         * Record that a thread has exited, so that its exit is sent with that time at the end of the next scan rather
+         * than with the time of the first scan that does not see it.
+         *
+         * @param timestampNS The time of the exit
+         * @param pid The process id
+         * @param tid The thread id, or -1 for all threads of the process
+         */
+        void markExited(unsigned long long timestampNS, int pid, int tid);
+
     private:
         /**
          * State object for a given TID
@@ -97,6 +117,22 @@ namespace non_root {
 
             bool isSeenSinceLastScan() const { return (state == State::NEW) || (state == State::SEEN); }
 
+            bool hasExited() const { return exitTimeNS.has_value(); }
+
+            const std::optional<unsigned long long> & getExitTimeNS() const { return exitTimeNS; }
+
+            /** Record the exit time, unless already recorded */
+            void setExited(unsigned long long timestampNS)
+            {
+                if (!exitTimeNS) {
+                    exitTimeNS = timestampNS;
+                }
+            }
+
+            bool isExitSent() const { return exitSent; }
+
+            void setExitSent() { exitSent = true; }
+
             int getPid() const { return statsTracker.getPid(); }
 
             int getTid() const { return statsTracker.getTid(); }
@@ -137,6 +173,22 @@ namespace non_root {
             unsigned long long startTimeNS;
             int parentPid;
             State state;
+            /** Set if the exit was reported by a lifecycle event */
+            std::optional<unsigned long long> exitTimeNS {};
+            /** The exit has been sent but the entry is kept until a scan no longer sees it (e.g. while a zombie) */
+            bool exitSent {false};
+        };
+
+        /**
+         * Per core state used while processing a scan
+         */
+        struct CoreScanState {
+            /** Sum of all time spent in system and user for all processes */
+            unsigned long long accumulatedTime {0};
+            /** Offset from the last scan of the next fake scheduling event */
+            unsigned long long relativeTimestampNS {0};
+            double runningTimeMultiplier {0};
+            double totalTimeMultiplier {0};
         };
 
         /** Can call endScan */
@@ -158,7 +210,10 @@ namespace non_root {
         unsigned long pageSize;
 
         /** Tracked processes map: TID->ProcessInfo */
-        std::map<int, ProcessInfo> trackedProcesses {};
+        lib::FlatHashMap<int, ProcessInfo> trackedProcesses {};
+
+        /** Per core state for the current scan; reset at the start of each scan */
+        lib::PerCoreArray<CoreScanState> coreScanStates {};
 
         /** True only on the first time the scan runs */
         bool firstIteration {false};
@@ -174,8 +229,7 @@ namespace non_root {
                                const std::optional<std::string> & exe);
 
         /** Called when active scan is destructed to mutate state */
-        void endScan(const ActiveScan & activeScan,
-                     const std::map<unsigned long, unsigned long long> & accumulatedTimePerCore);
+        void endScan(const ActiveScan & activeScan);
 
         /** Find the ProcessInformation object for some pid-tid pair */
         ProcessInfo & getProcessInfoFor(unsigned long long timestampNS, int pgid, int pid, int tid);
@@ -16,7 +16,169 @@
 
 namespace events_xml {
     namespace {
+#include "events_db.h"
 #include "events_xml.h"
+
+        const StaticCounterSet * findStaticCounterSet(std::string_view name)
+        {
+            for (const auto & counterSet : DEFAULT_STATIC_COUNTER_SETS) {
+                if (name == counterSet.name) {
+                    return &counterSet;
+                }
+            }
+            return nullptr;
+        }
+
+        void addCounterToEventMapping(std::map<std::string, EventCode> & counterToEventMap,
+                                      std::string counter,
+                                      const char * event)
+        {
+            if (event != nullptr) {
+                const auto eventNo = strtoull(event, nullptr, 0);
+                counterToEventMap[std::move(counter)] = EventCode(eventNo);
+            }
+            else {
+                counterToEventMap[std::move(counter)] = EventCode();
+            }
+        }
+
+        void addCounterToEventMappings(std::map<std::string, EventCode> & counterToEventMap, mxml_node_t * xml)
+        {
+            mxml_node_t * node = xml;
+            while (true) {
+                node = mxmlFindElement(node, xml, "event", nullptr, nullptr, MXML_DESCEND);
+                if (node == nullptr) {
+                    break;
+                }
+                const char * counter = mxmlElementGetAttr(node, "counter");
+                if (counter == nullptr) {
+                    continue;
+                }
+
+                addCounterToEventMapping(counterToEventMap, counter, mxmlElementGetAttr(node, "event"));
+            }
+        }
+
+        /// Adds the counters of the copy of a PMU's counter set that processClusters makes when the PMU id differs
+        /// from the counter set name
+        template<typename T>
+        void addPmuCounterToEventMappings(std::map<std::string, EventCode> & counterToEventMap, lib::Span<const T> pmus)
+        {
+            for (const T & pmu : pmus) {
+                const std::string_view counterSetName = pmu.getCounterSet();
+                const StaticCounterSet * counterSet = findStaticCounterSet(counterSetName);
+                if (counterSet == nullptr) {
+                    LOG_ERROR("Missing category or counter set named '%s_cnt'", pmu.getCounterSet());
+                    handleException();
+                }
+
+                // the table already has the counters where the id == the counter_set
+                if (counterSetName == pmu.getId()) {
+                    continue;
+                }
+
+                const std::string oldEventPrefix = std::string(counterSetName) + "_";
+                const std::string newEventPrefix = std::string(pmu.getId()) + "_";
+
+                for (const auto & event : findStaticPmuEvents(counterSetName)) {
+                    if ((event.counter == nullptr)
+                        || (std::string_view(event.counter).substr(0, oldEventPrefix.size()) != oldEventPrefix)) {
+                        continue;
+                    }
+
+                    addCounterToEventMapping(counterToEventMap,
+                                             newEventPrefix + (event.counter + oldEventPrefix.size()),
+                                             event.event);
+                }
+            }
+        }
+
+        /// The same as getCounterToEventMap, but reading the builtin events.xml from the precompiled tables
+        std::map<std::string, EventCode> getStaticCounterToEventMap(lib::Span<const Driver * const> drivers,
+                                                                    lib::Span<const GatorCpu> clusters,
+                                                                    lib::Span<const UncorePmu> uncores)
+        {
+            std::map<std::string, EventCode> counterToEventMap {};
+
+            for (const auto & event : DEFAULT_STATIC_EVENTS) {
+                addCounterToEventMapping(counterToEventMap, event.counter, event.event);
+            }
+
+            addPmuCounterToEventMappings(counterToEventMap, clusters);
+            addPmuCounterToEventMappings(counterToEventMap, uncores);
+
+            // Resolve ${cluster}
+            for (const GatorCpu & cluster : clusters) {
+                for (const auto & event : DEFAULT_STATIC_CLUSTER_EVENTS) {
+                    addCounterToEventMapping(counterToEventMap,
+                                             std::string(cluster.getId()) + event.counter,
+                                             event.event);
+                }
+            }
+
+            // Add dynamic events from the drivers
+            mxml_unique_ptr xml = makeMxmlUniquePtr(mxmlNewXML("1.0"));
+            mxml_node_t * events = mxmlNewElement(xml.get(), "events");
+            for (const Driver * driver : drivers) {
+                driver->writeEvents(events);
+            }
+
+            addCounterToEventMappings(counterToEventMap, xml.get());
+
+            return counterToEventMap;
+        }
+    }
+
+    StaticEvents::StaticEvents(mxml_unique_ptr tree) : xml(std::move(tree))
+    {
+        mxml_node_t * node = xml.get();
+        while (true) {
+            node = mxmlFindElement(node, xml.get(), "event", nullptr, nullptr, MXML_DESCEND);
+            if (node == nullptr) {
+                break;
+            }
+            const char * counter = mxmlElementGetAttr(node, "counter");
+            if (counter == nullptr) {
+                continue;
+            }
+
+            parsedEvents.push_back({counter,
+                                    mxmlElementGetAttr(node, "event"),
+                                    mxmlElementGetAttr(node, "tracepoint"),
+                                    mxmlElementGetAttr(node, "enable"),
+                                    mxmlElementGetAttr(node, "regex"),
+                                    mxmlElementGetAttr(node, "arg"),
+                                    mxmlElementGetAttr(node, "path"),
+                                    mxmlElementGetAttr(node, "flag"),
+                                    mxmlElementGetAttr(node, "expression")});
+        }
+    }
+
+    lib::Span<const StaticEvent> StaticEvents::getEvents() const
+    {
+        if (xml == nullptr) {
+            return DEFAULT_STATIC_EVENTS;
+        }
+        return parsedEvents;
+    }
+
+    StaticEvents getStaticEvents(lib::Span<const GatorCpu> clusters, lib::Span<const UncorePmu> uncores)
+    {
+        // The builtin events.xml is only needed as a tree when it is sent to Streamline, so use the precompiled table
+        if ((gSessionData.mEventsXMLPath == nullptr) && (gSessionData.mEventsXMLAppend == nullptr)) {
+            return {};
+        }
+
+        return StaticEvents {getStaticTree(clusters, uncores)};
+    }
+
+    lib::Span<const StaticPmuEvent> findStaticPmuEvents(std::string_view counterSet)
+    {
+        const StaticCounterSet * found = findStaticCounterSet(counterSet);
+        if (found == nullptr) {
+            return {};
+        }
+        return {DEFAULT_STATIC_PMU_EVENTS + found->first, found->count};
     }
 
     std::unique_ptr<mxml_node_t, void (*)(mxml_node_t *)> getStaticTree(lib::Span<const GatorCpu> clusters,
@@ -96,31 +258,18 @@ namespace events_xml {
                                                           lib::Span<const GatorCpu> clusters,
                                                           lib::Span<const UncorePmu> uncores)
     {
+        // The builtin events.xml need not be parsed just to find the counters' event codes
+        if ((gSessionData.mEventsXMLPath == nullptr) && (gSessionData.mEventsXMLAppend == nullptr)) {
+            return getStaticCounterToEventMap(drivers, clusters, uncores);
+        }
+
         std::map<std::string, EventCode> counterToEventMap {};
 
         auto xml = events_xml::getDynamicTree(drivers, clusters, uncores);
 
         // build map of counter->event
-        mxml_node_t * node = xml.get();
-        while (true) {
-            node = mxmlFindElement(node, xml.get(), "event", nullptr, nullptr, MXML_DESCEND);
-            if (node == nullptr) {
-                break;
-            }
-            const char * counter = mxmlElementGetAttr(node, "counter");
-            const char * event = mxmlElementGetAttr(node, "event");
-            if (counter == nullptr) {
-                continue;
-            }
+        addCounterToEventMappings(counterToEventMap, xml.get());
 
-            if (event != nullptr) {
-                const auto eventNo = strtoull(event, nullptr, 0);
-                counterToEventMap[counter] = EventCode(eventNo);
-            }
-            else {
-                counterToEventMap[counter] = EventCode();
-            }
-        }
         return counterToEventMap;
     }
 
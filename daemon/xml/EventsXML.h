@@ -6,17 +6,73 @@
 #include "EventCode.h"
 #include "lib/Span.h"
 #include "linux/perf/PerfEventGroupIdentifier.h"
+#include "xml/MxmlUtils.h"
+
 #include <mxml.h>
 
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class Driver;
 class GatorCpu;
 class UncorePmu;
 
 namespace events_xml {
+    /// The attributes of an <event> element with a counter attribute, as read by the drivers at startup.
+    /// Absent attributes are nullptr.
+    struct StaticEvent {
+        const char * counter;
+        const char * event;
+        const char * tracepoint;
+        const char * enable;
+        const char * regex;
+        const char * arg;
+        const char * path;
+        const char * flag;
+        const char * expression;
+    };
+
+    /// An <event> element of a counter set category in the builtin events.xml, or a ${cluster} event (where counter
+    /// is the part after ${cluster}). Absent attributes are nullptr.
+    struct StaticPmuEvent {
+        const char * counter;
+        const char * event;
+    };
+
+    /// The events of one counter set category in the builtin events.xml
+    struct StaticCounterSet {
+        /// The counter set name as used by pmus.xml, i.e. without the _cnt suffix
+        const char * name;
+        /// The index of the first event in the table of PMU events
+        std::size_t first;
+        /// The number of events
+        std::size_t count;
+    };
+
+    /// The static events; either the table compiled from the builtin events.xml, or those parsed from the
+    /// commandline events.xml (which must then be kept alive, as the attributes point into it)
+    class StaticEvents {
+    public:
+        StaticEvents() = default;
+        explicit StaticEvents(mxml_unique_ptr tree);
+
+        [[nodiscard]] lib::Span<const StaticEvent> getEvents() const;
+
+    private:
+        mxml_unique_ptr xml {makeMxmlUniquePtr(nullptr)};
+        std::vector<StaticEvent> parsedEvents {};
+    };
+
+    /// Gets the events that come from commandline/builtin events.xml, only parsing the xml if it came from the commandline
+    StaticEvents getStaticEvents(lib::Span<const GatorCpu> clusters, lib::Span<const UncorePmu> uncores);
+
+    /// Finds the builtin events of a CPU or uncore PMU by its counter set name, without parsing the events xml.
+    /// Returns an empty span if the builtin events.xml has no such counter set.
+    lib::Span<const StaticPmuEvent> findStaticPmuEvents(std::string_view counterSet);
+
     /// Gets the events that come from commandline/builtin events.xml
     std::unique_ptr<mxml_node_t, void (*)(mxml_node_t *)> getStaticTree(lib::Span<const GatorCpu> clusters,
                                                                         lib::Span<const UncorePmu> uncores);